@@ -4,12 +4,14 @@
 #include <unordered_map>
 
 #include "common/async_log.h"
+#include "common/shared_arena.h"
 #include "common/types.h"
 #include "proto/internal.pb.h"
 
 namespace slog {
 
-using BatchPtr = std::unique_ptr<internal::Batch>;
+// Batches may be on a shared arena
+using BatchPtr = std::unique_ptr<internal::Batch, MessageDeleter<internal::Batch>>;
 
 class BatchLog {
  public:
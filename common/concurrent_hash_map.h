@@ -5,15 +5,41 @@
  * into different segments. However, each segment here is only coarsely guarded with a read-write
  * latch as opposed to a more granular approach in the highly-optimized folly::ConcurrentHashMap.
  *
+ * Segments can optionally serve reads optimistically (ReadMode::OPTIMISTIC). In this mode, readers
+ * never take the latch. Instead, they validate their traversal against a per-segment sequence number
+ * that writers bump around structural changes (i.e. rehashing), and the nodes they visit are kept alive
+ * by epoch-based reclamation (see common/epoch.h). Writers still hold the latch exclusively. Because a
+ * reader may copy a value at any time, nodes are never modified after being published; an update
+ * replaces the node of the key instead.
+ *
+ * A chained segment grows incrementally. When it reaches its load factor, it allocates a bucket array
+ * twice as large and every subsequent write moves a few buckets from the old array to the new one, so
+ * no single write relinks the whole segment while blocking readers. Lookups search both arrays until
+ * all buckets have been moved. Reserve() sizes the segments up front for bulk loading.
+ *
+ * Alternatively, FlatSegmentT lays a segment out as an open-addressing table in the spirit of
+ * Swiss tables (absl::flat_hash_map) to avoid a heap allocation and a pointer chase per entry.
+ * The segment type is a template parameter of ConcurrentHashMap.
+ *
  * This map should be used in conjuction with shared_ptr because its destructor is not
  * thread-safe. With shared_ptr, the last thread that releases the pointer will be the only
  * one accessing the map at destruction time.
  */
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <limits>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "common/epoch.h"
+#include "common/pinned_view.h"
 #include "common/rwlatch.h"
 
 namespace slog {
@@ -25,21 +51,30 @@ struct NodeT {
   NodeT() = default;
 
   NodeT(const NodeT& other) {
-    next = other.next;
+    next.store(other.next.load());
     key = other.key;
     value = other.value;
   }
 
-  NodeT* next{nullptr};
+  std::atomic<NodeT*> next{nullptr};
   KeyType key;
   ValueType value;
 };
 
-template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8>
+enum class ReadMode { LATCHED, OPTIMISTIC };
+
+template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8,
+          ReadMode Mode = ReadMode::LATCHED>
 class SegmentT {
   using Node = NodeT<KeyType, ValueType>;
 
+ public:
+  // Optimistic readers may be looking at a node so an update replaces the node with a copy
+  static constexpr bool kUpdatesInPlace = Mode == ReadMode::LATCHED;
+
   static constexpr float kLoadFactor = 1.05;
+  // Number of old buckets moved to the new bucket array by each write during a rehash
+  static constexpr size_t kRehashStep = 16;
 
  public:
   /**
@@ -47,89 +82,326 @@ class SegmentT {
    */
   SegmentT(size_t initial_bucket_count = 8)
       : load_factor_max_size_(static_cast<size_t>(kLoadFactor * initial_bucket_count)), size_(0) {
-    buckets_.reset(Buckets::CreateBuckets(initial_bucket_count));
+    buckets_.store(Buckets::CreateBuckets(initial_bucket_count));
+  }
+
+  ~SegmentT() {
+    delete buckets_.load();
+    delete old_buckets_.load();
   }
 
   bool Get(ValueType& res, const KeyType& key) const {
     auto h = HashFn{}(key);
-    bool found = false;
 
-    rw_latch_.RLock();
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      EpochGuard guard;
+      auto node = FindNodeOptimistic(key, h);
+      if (node == nullptr) {
+        return false;
+      }
+      // The node is immutable once published and cannot be freed while the guard is held
+      res = node->value;
+      return true;
+    } else {
+      bool found = false;
 
-    auto idx = GetIndex(buckets_->count, h);
-    auto node = buckets_->bucket_roots[idx];
-    while (node) {
-      if (key == node->key) {
-        break;
+      rw_latch_.RLock();
+
+      auto node = Lookup(key, h);
+      if (node) {
+        res = node->value;
+        found = true;
       }
-      node = node->next;
+
+      rw_latch_.RUnlock();
+
+      return found;
     }
-    if (node) {
-      res = node->value;
-      found = true;
+  }
+
+  /**
+   * Returns a view of the value without copying it. The view is empty if the key does not exist
+   */
+  PinnedView<ValueType> GetView(const KeyType& key) const {
+    auto h = HashFn{}(key);
+
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      EpochManager::Instance().Enter();
+      auto node = FindNodeOptimistic(key, h);
+      if (node == nullptr) {
+        EpochManager::Instance().Exit();
+        return {};
+      }
+      return PinnedView<ValueType>::EpochPinned(&node->value);
+    } else {
+      rw_latch_.RLock();
+      auto node = Lookup(key, h);
+      if (node == nullptr) {
+        rw_latch_.RUnlock();
+        return {};
+      }
+      return PinnedView<ValueType>::LatchPinned(&node->value, &rw_latch_);
     }
+  }
 
-    rw_latch_.RUnlock();
+  /**
+   * Calls fn with a pointer to the value of the key, or null if the key does not exist, while the value
+   * is protected from writers. hash must be HashFn{}(key). fn must not access the map.
+   */
+  template <typename Fn>
+  void Visit(const KeyType& key, size_t hash, Fn&& fn) const {
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      EpochGuard guard;
+      auto node = FindNodeOptimistic(key, hash);
+      fn(node ? &node->value : nullptr);
+    } else {
+      rw_latch_.RLock();
+      auto node = Lookup(key, hash);
+      fn(node ? static_cast<const ValueType*>(&node->value) : nullptr);
+      rw_latch_.RUnlock();
+    }
+  }
 
-    return found;
+  /**
+   * Prefetches the bucket of the given hash. The calling thread must hold an epoch guard. Only optimistic
+   * segments prefetch because the bucket array of a latched segment may be freed without the latch held.
+   */
+  void PrefetchBucket(size_t hash) const {
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      auto buckets = buckets_.load(std::memory_order_acquire);
+      __builtin_prefetch(&buckets->bucket_roots[GetIndex(buckets->count, hash)]);
+    }
+  }
+
+  /**
+   * Prefetches the first node in the bucket of the given hash, which is the node of the key most of the
+   * time. The calling thread must hold an epoch guard.
+   */
+  void PrefetchNode(size_t hash) const {
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      auto buckets = buckets_.load(std::memory_order_acquire);
+      if (auto node = buckets->bucket_roots[GetIndex(buckets->count, hash)].load(std::memory_order_acquire); node) {
+        __builtin_prefetch(node);
+      }
+    }
   }
 
   ValueType* GetUnsafe(const KeyType& key) {
+    auto node = Lookup(key, HashFn{}(key));
+    return node ? &node->value : nullptr;
+  }
+
+  bool InsertOrUpdate(const KeyType& key, const ValueType& value) { return DoInsertOrUpdate(key, value); }
+
+  bool InsertOrUpdate(KeyType&& key, ValueType&& value) { return DoInsertOrUpdate(std::move(key), std::move(value)); }
+
+  /**
+   * Applies update_fn to the value of the given key while holding the write latch.
+   * Returns false if the key does not exist.
+   */
+  template <typename UpdateFn>
+  bool Update(const KeyType& key, UpdateFn&& update_fn) {
     auto h = HashFn{}(key);
-    auto idx = GetIndex(buckets_->count, h);
-    auto node = buckets_->bucket_roots[idx];
-    while (node) {
-      if (key == node->key) {
-        return &node->value;
+
+    rw_latch_.WLock();
+
+    MigrateBuckets(h);
+    auto link = FindLink(buckets_.load(std::memory_order_relaxed), key, h);
+    auto node = link->load(std::memory_order_relaxed);
+    if (node) {
+      if constexpr (Mode == ReadMode::OPTIMISTIC) {
+        // Readers may be looking at the current node so the update is applied to a copy
+        auto new_node = new Node(*node);
+        update_fn(new_node->value);
+        link->store(new_node, std::memory_order_release);
+        FreeNode(node);
+      } else {
+        update_fn(node->value);
       }
-      node = node->next;
     }
-    return nullptr;
+
+    rw_latch_.WUnlock();
+
+    return node != nullptr;
   }
 
-  bool InsertOrUpdate(const KeyType& key, const ValueType& value) {
+  /**
+   * Calls fn(key, value) on every entry of the segment while holding the read latch
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    rw_latch_.RLock();
+
+    for (auto buckets : {buckets_.load(std::memory_order_relaxed), old_buckets_.load(std::memory_order_relaxed)}) {
+      for (size_t i = 0; buckets != nullptr && i < buckets->count; i++) {
+        auto node = buckets->bucket_roots[i].load(std::memory_order_relaxed);
+        for (; node; node = node->next.load(std::memory_order_relaxed)) {
+          fn(node->key, node->value);
+        }
+      }
+    }
+
+    rw_latch_.RUnlock();
+  }
+
+  /**
+   * Grows the bucket array at once so that the segment can take n entries without rehashing
+   */
+  void Reserve(size_t n) {
+    rw_latch_.WLock();
+
+    auto bucket_count = buckets_.load(std::memory_order_relaxed)->count;
+    auto new_bucket_count = bucket_count;
+    while (static_cast<size_t>(kLoadFactor * new_bucket_count) <= n) {
+      new_bucket_count <<= 1;
+    }
+    if (new_bucket_count > bucket_count) {
+      Rehash(new_bucket_count);
+      FinishRehash();
+    }
+
+    rw_latch_.WUnlock();
+  }
+
+  bool Erase(const KeyType& key) {
+    return EraseIf(key, [](const ValueType&) { return true; });
+  }
+
+  template <typename Pred>
+  bool EraseIf(const KeyType& key, Pred&& pred) {
     auto h = HashFn{}(key);
 
     rw_latch_.WLock();
 
-    auto idx = GetIndex(buckets_->count, h);
-    Node* prev = nullptr;
-    bool key_exists = false;
-    auto node = buckets_->bucket_roots[idx];
+    MigrateBuckets(h);
+    auto link = FindLink(buckets_.load(std::memory_order_relaxed), key, h);
+    auto node = link->load(std::memory_order_relaxed);
+    bool erased = node != nullptr && pred(static_cast<const ValueType&>(node->value));
+    if (erased) {
+      link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+      FreeNode(node);
+      size_--;
+    }
+
+    rw_latch_.WUnlock();
+
+    return erased;
+  }
+
+ private:
+  struct Buckets {
+    static Buckets* CreateBuckets(size_t num_buckets) {
+      auto buckets = new Buckets();
+      buckets->count = num_buckets;
+      buckets->bucket_roots = std::make_unique<std::atomic<Node*>[]>(num_buckets);
+      return buckets;
+    }
+
+    ~Buckets() {
+      for (size_t i = 0; i < count; i++) {
+        auto node = bucket_roots[i].load(std::memory_order_relaxed);
+        while (node) {
+          auto next = node->next.load(std::memory_order_relaxed);
+          delete node;
+          node = next;
+        }
+      }
+    }
+
+    size_t count;
+    std::unique_ptr<std::atomic<Node*>[]> bucket_roots;
+  };
+
+  // Must hold lock
+  static uint64_t GetIndex(size_t nbuckets, size_t hash) { return (hash >> ShardBits) & (nbuckets - 1); }
+
+  // Must hold lock, or be validated against version_ in optimistic mode
+  static Node* FindNode(const Buckets* buckets, const KeyType& key, size_t hash) {
+    auto idx = GetIndex(buckets->count, hash);
+    auto node = buckets->bucket_roots[idx].load(std::memory_order_acquire);
     while (node) {
       if (key == node->key) {
-        key_exists = true;
-        // If key already exists, replace the corresponding
-        // node with a new node containing the new value
-        auto new_node = new Node();
-        new_node->key = key;
-        new_node->value = value;
-        new_node->next = node->next;
-        if (prev) {
-          prev->next = new_node;
-        } else {
-          buckets_->bucket_roots[idx] = new_node;
-        }
-        delete node;
+        return node;
+      }
+      node = node->next.load(std::memory_order_acquire);
+    }
+    return nullptr;
+  }
 
+  // Must hold lock, or be validated against version_ in optimistic mode. During a rehash, a key
+  // is in the old buckets if its bucket has not been moved yet
+  Node* Lookup(const KeyType& key, size_t hash) const {
+    auto node = FindNode(buckets_.load(std::memory_order_acquire), key, hash);
+    if (node == nullptr) {
+      if (auto old_buckets = old_buckets_.load(std::memory_order_acquire); old_buckets != nullptr) {
+        node = FindNode(old_buckets, key, hash);
+      }
+    }
+    return node;
+  }
+
+  // Must hold lock. Returns the link that points to the node of the key, or the
+  // null link at the end of the bucket if the key does not exist
+  static std::atomic<Node*>* FindLink(Buckets* buckets, const KeyType& key, size_t hash) {
+    auto link = &buckets->bucket_roots[GetIndex(buckets->count, hash)];
+    for (auto node = link->load(std::memory_order_relaxed); node; node = link->load(std::memory_order_relaxed)) {
+      if (key == node->key) {
         break;
       }
-      prev = node;
-      node = node->next;
+      link = &node->next;
     }
+    return link;
+  }
 
-    if (!key_exists) {
-      // If key does not exist, at new node to the bucket
+  // Must hold an epoch guard
+  Node* FindNodeOptimistic(const KeyType& key, size_t hash) const {
+    for (;;) {
+      auto version = version_.load(std::memory_order_acquire);
+      if (version & 1) {
+        // Nodes are being moved between bucket arrays
+        continue;
+      }
+      auto node = Lookup(key, hash);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (version_.load(std::memory_order_relaxed) == version) {
+        return node;
+      }
+    }
+  }
+
+  template <typename K, typename V>
+  bool DoInsertOrUpdate(K&& key, V&& value) {
+    auto h = HashFn{}(key);
+
+    rw_latch_.WLock();
+
+    MigrateBuckets(h);
+    auto link = FindLink(buckets_.load(std::memory_order_relaxed), key, h);
+    auto node = link->load(std::memory_order_relaxed);
+    bool key_exists = node != nullptr;
+    if (key_exists && Mode == ReadMode::LATCHED) {
+      // Readers hold the latch so the value can be overwritten in place. When the
+      // value is assigned from one of the same size, this does not allocate
+      node->value = std::forward<V>(value);
+    } else {
+      // In optimistic mode, readers may be copying the current value so
+      // an existing node is replaced instead of being modified
       auto new_node = new Node();
-      new_node->key = key;
-      new_node->value = value;
-      new_node->next = buckets_->bucket_roots[idx];
-      buckets_->bucket_roots[idx] = new_node;
-      size_++;
+      new_node->key = std::forward<K>(key);
+      new_node->value = std::forward<V>(value);
+      if (key_exists) {
+        new_node->next.store(node->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+      link->store(new_node, std::memory_order_release);
+      if (key_exists) {
+        FreeNode(node);
+      } else {
+        size_++;
+      }
     }
 
     if (size_ >= load_factor_max_size_) {
-      Rehash();
+      Rehash(buckets_.load(std::memory_order_relaxed)->count << 1);
     }
 
     rw_latch_.WUnlock();
@@ -137,101 +409,437 @@ class SegmentT {
     return key_exists;
   }
 
-  bool Erase(const KeyType& key) {
-    auto h = HashFn{}(key);
+  // Must hold lock
+  void FreeNode(Node* node) {
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      retired_.Retire(node);
+    } else {
+      delete node;
+    }
+  }
 
-    rw_latch_.WLock();
+  // Must hold lock. Starts moving the nodes to a new bucket array. The nodes are moved a few
+  // buckets at a time by the subsequent writes
+  void Rehash(size_t new_bucket_count) {
+    FinishRehash();
+    auto old_buckets = buckets_.load(std::memory_order_relaxed);
+    old_buckets_.store(old_buckets, std::memory_order_relaxed);
+    // A reader that sees the new buckets also sees the old ones, where all nodes still are
+    buckets_.store(Buckets::CreateBuckets(new_bucket_count), std::memory_order_release);
+    next_bucket_to_move_ = 0;
+    load_factor_max_size_ = static_cast<size_t>(kLoadFactor * new_bucket_count);
+  }
 
-    bool key_exists = false;
-    auto idx = GetIndex(buckets_->count, h);
-    Node* prev = nullptr;
-    auto node = buckets_->bucket_roots[idx];
+  // Must hold lock. Moves the old bucket of the given hash, so that the key is only in the new
+  // buckets afterwards, and the next few old buckets
+  void MigrateBuckets(size_t hash) {
+    auto old_buckets = old_buckets_.load(std::memory_order_relaxed);
+    if (old_buckets == nullptr) {
+      return;
+    }
+    BeginRelink();
+    MoveBucket(old_buckets, GetIndex(old_buckets->count, hash));
+    for (size_t i = 0; i < kRehashStep && next_bucket_to_move_ < old_buckets->count; i++) {
+      MoveBucket(old_buckets, next_bucket_to_move_++);
+    }
+    EndRelink();
+    if (next_bucket_to_move_ == old_buckets->count) {
+      ReleaseOldBuckets();
+    }
+  }
+
+  // Must hold lock. Moves all remaining old buckets
+  void FinishRehash() {
+    auto old_buckets = old_buckets_.load(std::memory_order_relaxed);
+    if (old_buckets == nullptr) {
+      return;
+    }
+    BeginRelink();
+    for (; next_bucket_to_move_ < old_buckets->count; next_bucket_to_move_++) {
+      MoveBucket(old_buckets, next_bucket_to_move_);
+    }
+    EndRelink();
+    ReleaseOldBuckets();
+  }
+
+  // Must hold lock
+  void MoveBucket(Buckets* old_buckets, size_t idx) {
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    auto node = old_buckets->bucket_roots[idx].load(std::memory_order_relaxed);
     while (node) {
-      if (key == node->key) {
-        key_exists = true;
-        if (prev) {
-          prev->next = node->next;
-        } else {
-          buckets_->bucket_roots[idx] = node->next;
-        }
-        delete node;
-        break;
+      auto next_node = node->next.load(std::memory_order_relaxed);
+
+      auto new_idx = GetIndex(buckets->count, HashFn{}(node->key));
+      node->next.store(buckets->bucket_roots[new_idx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      buckets->bucket_roots[new_idx].store(node, std::memory_order_relaxed);
+
+      node = next_node;
+    }
+    old_buckets->bucket_roots[idx].store(nullptr, std::memory_order_relaxed);
+  }
+
+  // Must hold lock. All old buckets must have been moved
+  void ReleaseOldBuckets() {
+    auto old_buckets = old_buckets_.load(std::memory_order_relaxed);
+    old_buckets_.store(nullptr, std::memory_order_release);
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      // The old buckets no longer own any node but readers may still be scanning them
+      retired_.Retire(old_buckets);
+    } else {
+      delete old_buckets;
+    }
+  }
+
+  // Relinking nodes can lead concurrent optimistic readers astray so they must retry
+  void BeginRelink() {
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+  }
+
+  void EndRelink() {
+    if constexpr (Mode == ReadMode::OPTIMISTIC) {
+      version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+  }
+
+  mutable bustub::ReaderWriterLatch rw_latch_;
+  std::atomic<Buckets*> buckets_;
+  // Bucket array being moved to buckets_ during a rehash, or null
+  std::atomic<Buckets*> old_buckets_{nullptr};
+  size_t next_bucket_to_move_ = 0;
+  size_t load_factor_max_size_;
+  size_t size_;
+
+  // Only used in optimistic mode
+  std::atomic<uint64_t> version_{0};
+  RetireList retired_;
+};
+
+template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8>
+using OptimisticSegmentT = SegmentT<KeyType, ValueType, HashFn, ShardBits, ReadMode::OPTIMISTIC>;
+
+/**
+ * A group of control bytes that are probed together. A control byte is either kEmpty, kDeleted,
+ * or, for a full slot, the lowest 7 bits of the hash of the key in that slot.
+ */
+struct CtrlGroup {
+  static constexpr size_t kWidth = 16;
+  static constexpr int8_t kEmpty = -128;
+  static constexpr int8_t kDeleted = -2;
+
+#ifdef __SSE2__
+  explicit CtrlGroup(const int8_t* pos) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+  // Returns a bitmask of the positions whose control byte equals to h2
+  uint32_t Match(int8_t h2) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)); }
+
+  uint32_t MatchEmpty() const { return Match(kEmpty); }
+
+  // Both kEmpty and kDeleted have the sign bit set, while full control bytes do not
+  uint32_t MatchEmptyOrDeleted() const { return _mm_movemask_epi8(ctrl); }
+
+  __m128i ctrl;
+#else
+  explicit CtrlGroup(const int8_t* pos) : ctrl(pos) {}
+
+  uint32_t Match(int8_t h2) const {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kWidth; i++) {
+      mask |= static_cast<uint32_t>(ctrl[i] == h2) << i;
+    }
+    return mask;
+  }
+
+  uint32_t MatchEmpty() const { return Match(kEmpty); }
+
+  uint32_t MatchEmptyOrDeleted() const {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kWidth; i++) {
+      mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+    }
+    return mask;
+  }
+
+  const int8_t* ctrl;
+#endif
+};
+
+/**
+ * An open-addressing segment. Entries are stored inline in a flat array of slots, accompanied by an
+ * array of control bytes. A lookup compares a whole group of control bytes against 7 bits of the hash
+ * at once and only compares keys in the slots that match, so most lookups touch one control group and
+ * one slot. Updating an existing key replaces its value in place.
+ *
+ * Because values are modified in place, reads always take the latch in this layout.
+ */
+template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8>
+class FlatSegmentT {
+  using Slot = std::pair<KeyType, ValueType>;
+  using SlotAllocator = std::allocator<Slot>;
+
+  static constexpr size_t kNotFound = std::numeric_limits<size_t>::max();
+
+ public:
+  static constexpr bool kUpdatesInPlace = true;
+
+  /**
+   * initial_capacity must be a power of 2 and at least CtrlGroup::kWidth
+   */
+  FlatSegmentT(size_t initial_capacity = CtrlGroup::kWidth) : size_(0), deleted_(0) { Allocate(initial_capacity); }
+
+  ~FlatSegmentT() { Deallocate(); }
+
+  FlatSegmentT(const FlatSegmentT&) = delete;
+  FlatSegmentT& operator=(const FlatSegmentT&) = delete;
+
+  bool Get(ValueType& res, const KeyType& key) const {
+    auto h = HashFn{}(key) >> ShardBits;
+    bool found = false;
+
+    rw_latch_.RLock();
+
+    auto idx = Find(key, h);
+    if (idx != kNotFound) {
+      res = slots_[idx].second;
+      found = true;
+    }
+
+    rw_latch_.RUnlock();
+
+    return found;
+  }
+
+  PinnedView<ValueType> GetView(const KeyType& key) const {
+    auto h = HashFn{}(key) >> ShardBits;
+
+    rw_latch_.RLock();
+
+    auto idx = Find(key, h);
+    if (idx == kNotFound) {
+      rw_latch_.RUnlock();
+      return {};
+    }
+    return PinnedView<ValueType>::LatchPinned(&slots_[idx].second, &rw_latch_);
+  }
+
+  template <typename Fn>
+  void Visit(const KeyType& key, size_t hash, Fn&& fn) const {
+    rw_latch_.RLock();
+    auto idx = Find(key, hash >> ShardBits);
+    fn(idx != kNotFound ? &slots_[idx].second : nullptr);
+    rw_latch_.RUnlock();
+  }
+
+  // The table may be reallocated by a writer at any time so it cannot be prefetched without the latch
+  void PrefetchBucket(size_t) const {}
+  void PrefetchNode(size_t) const {}
+
+  ValueType* GetUnsafe(const KeyType& key) {
+    auto idx = Find(key, HashFn{}(key) >> ShardBits);
+    return idx != kNotFound ? &slots_[idx].second : nullptr;
+  }
+
+  bool InsertOrUpdate(const KeyType& key, const ValueType& value) { return DoInsertOrUpdate(key, value); }
+
+  bool InsertOrUpdate(KeyType&& key, ValueType&& value) { return DoInsertOrUpdate(std::move(key), std::move(value)); }
+
+  template <typename UpdateFn>
+  bool Update(const KeyType& key, UpdateFn&& update_fn) {
+    auto h = HashFn{}(key) >> ShardBits;
+
+    rw_latch_.WLock();
+
+    auto idx = Find(key, h);
+    if (idx != kNotFound) {
+      update_fn(slots_[idx].second);
+    }
+
+    rw_latch_.WUnlock();
+
+    return idx != kNotFound;
+  }
+
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    rw_latch_.RLock();
+
+    for (size_t i = 0; i < capacity_; i++) {
+      if (ctrl_[i] >= 0) {
+        fn(slots_[i].first, slots_[i].second);
       }
-      prev = node;
-      node = node->next;
+    }
+
+    rw_latch_.RUnlock();
+  }
+
+  /**
+   * Grows the table at once so that the segment can take n entries without resizing
+   */
+  void Reserve(size_t n) {
+    rw_latch_.WLock();
+
+    auto new_capacity = capacity_;
+    while (MaxLoad(new_capacity) < n) {
+      new_capacity <<= 1;
+    }
+    if (new_capacity > capacity_) {
+      Resize(new_capacity);
     }
 
     rw_latch_.WUnlock();
+  }
 
-    return key_exists;
+  bool Erase(const KeyType& key) {
+    return EraseIf(key, [](const ValueType&) { return true; });
+  }
+
+  template <typename Pred>
+  bool EraseIf(const KeyType& key, Pred&& pred) {
+    auto h = HashFn{}(key) >> ShardBits;
+
+    rw_latch_.WLock();
+
+    auto idx = Find(key, h);
+    bool erased = idx != kNotFound && pred(static_cast<const ValueType&>(slots_[idx].second));
+    if (erased) {
+      std::allocator_traits<SlotAllocator>::destroy(alloc_, slots_ + idx);
+      ctrl_[idx] = CtrlGroup::kDeleted;
+      size_--;
+      deleted_++;
+    }
+
+    rw_latch_.WUnlock();
+
+    return erased;
   }
 
  private:
-  // Must hold lock
-  static uint64_t GetIndex(size_t nbuckets, size_t hash) { return (hash >> ShardBits) & (nbuckets - 1); }
+  static size_t H1(size_t hash) { return hash >> 7; }
+  static int8_t H2(size_t hash) { return hash & 0x7F; }
+  static size_t MaxLoad(size_t capacity) { return capacity - capacity / 8; }
 
   // Must hold lock
-  void Rehash() {
-    auto new_bucket_count = buckets_->count << 1;
-    auto new_buckets = Buckets::CreateBuckets(new_bucket_count);
-
-    for (size_t idx = 0; idx < buckets_->count; idx++) {
-      auto node = buckets_->bucket_roots[idx];
-      if (node == nullptr) {
-        continue;
+  size_t Find(const KeyType& key, size_t hash) const {
+    auto h2 = H2(hash);
+    auto group = H1(hash) & group_mask_;
+    // Triangular probing visits every group when the number of groups is a power of 2
+    for (size_t i = 1;; i++) {
+      CtrlGroup g(ctrl_.get() + group * CtrlGroup::kWidth);
+      for (auto match = g.Match(h2); match; match &= match - 1) {
+        auto idx = group * CtrlGroup::kWidth + __builtin_ctz(match);
+        if (key == slots_[idx].first) {
+          return idx;
+        }
       }
+      if (g.MatchEmpty()) {
+        return kNotFound;
+      }
+      group = (group + i) & group_mask_;
+    }
+  }
 
-      while (node) {
-        auto next_node = node->next;
+  template <typename K, typename V>
+  bool DoInsertOrUpdate(K&& key, V&& value) {
+    auto h = HashFn{}(key) >> ShardBits;
 
-        auto idx = GetIndex(new_bucket_count, HashFn{}(node->key));
-        node->next = new_buckets->bucket_roots[idx];
-        new_buckets->bucket_roots[idx] = node;
+    rw_latch_.WLock();
 
-        node = next_node;
+    bool key_exists = false;
+    auto idx = Find(key, h);
+    if (idx != kNotFound) {
+      key_exists = true;
+      slots_[idx].second = std::forward<V>(value);
+    } else {
+      if (size_ + deleted_ >= MaxLoad(capacity_)) {
+        // Only grow if the table is actually full. Otherwise, rehashing at the same
+        // capacity is enough to get rid of the tombstones
+        Resize(size_ >= MaxLoad(capacity_) / 2 ? capacity_ << 1 : capacity_);
+      }
+      idx = FindInsertSlot(h);
+      if (ctrl_[idx] == CtrlGroup::kDeleted) {
+        deleted_--;
       }
-      buckets_->bucket_roots[idx] = nullptr;
+      std::allocator_traits<SlotAllocator>::construct(alloc_, slots_ + idx, std::forward<K>(key),
+                                                      std::forward<V>(value));
+      ctrl_[idx] = H2(h);
+      size_++;
     }
-    buckets_.reset(new_buckets);
-    load_factor_max_size_ = static_cast<size_t>(kLoadFactor * buckets_->count);
+
+    rw_latch_.WUnlock();
+
+    return key_exists;
   }
 
-  struct Buckets {
-    static Buckets* CreateBuckets(size_t num_buckets) {
-      auto buckets = new Buckets();
-      buckets->count = num_buckets;
-      buckets->bucket_roots = std::make_unique<Node*[]>(num_buckets);
-      return buckets;
+  // Must hold lock
+  size_t FindInsertSlot(size_t hash) const {
+    auto group = H1(hash) & group_mask_;
+    for (size_t i = 1;; i++) {
+      CtrlGroup g(ctrl_.get() + group * CtrlGroup::kWidth);
+      if (auto match = g.MatchEmptyOrDeleted(); match) {
+        return group * CtrlGroup::kWidth + __builtin_ctz(match);
+      }
+      group = (group + i) & group_mask_;
     }
+  }
 
-    ~Buckets() {
-      for (size_t i = 0; i < count; i++) {
-        auto node = bucket_roots[i];
-        while (node) {
-          auto next = node->next;
-          delete node;
-          node = next;
-        }
+  void Allocate(size_t capacity) {
+    capacity_ = capacity;
+    group_mask_ = capacity / CtrlGroup::kWidth - 1;
+    ctrl_ = std::make_unique<int8_t[]>(capacity);
+    std::fill_n(ctrl_.get(), capacity, CtrlGroup::kEmpty);
+    slots_ = std::allocator_traits<SlotAllocator>::allocate(alloc_, capacity);
+  }
+
+  void Deallocate() {
+    for (size_t i = 0; i < capacity_; i++) {
+      if (ctrl_[i] >= 0) {
+        std::allocator_traits<SlotAllocator>::destroy(alloc_, slots_ + i);
       }
     }
+    std::allocator_traits<SlotAllocator>::deallocate(alloc_, slots_, capacity_);
+  }
 
-    size_t count;
-    std::unique_ptr<Node*[]> bucket_roots;
-  };
+  // Must hold lock
+  void Resize(size_t new_capacity) {
+    auto old_ctrl = std::move(ctrl_);
+    auto old_slots = slots_;
+    auto old_capacity = capacity_;
+
+    Allocate(new_capacity);
+    for (size_t i = 0; i < old_capacity; i++) {
+      if (old_ctrl[i] >= 0) {
+        auto h = HashFn{}(old_slots[i].first) >> ShardBits;
+        auto idx = FindInsertSlot(h);
+        std::allocator_traits<SlotAllocator>::construct(alloc_, slots_ + idx, std::move(old_slots[i]));
+        ctrl_[idx] = H2(h);
+        std::allocator_traits<SlotAllocator>::destroy(alloc_, old_slots + i);
+      }
+    }
+    std::allocator_traits<SlotAllocator>::deallocate(alloc_, old_slots, old_capacity);
+    deleted_ = 0;
+  }
 
   mutable bustub::ReaderWriterLatch rw_latch_;
-  std::unique_ptr<Buckets> buckets_;
-  size_t load_factor_max_size_;
+  SlotAllocator alloc_;
+  std::unique_ptr<int8_t[]> ctrl_;
+  Slot* slots_;
+  size_t capacity_;
+  size_t group_mask_;
   size_t size_;
+  size_t deleted_;
 };
 
 }  // namespace concurrent_hash_map
 
-template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8>
+template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8,
+          typename Segment = concurrent_hash_map::SegmentT<KeyType, ValueType, HashFn, ShardBits>>
 class ConcurrentHashMap {
-  using Segment = concurrent_hash_map::SegmentT<KeyType, ValueType, HashFn, ShardBits>;
-
  public:
+  // Whether Update modifies the value without copying it
+  static constexpr bool kUpdatesInPlace = Segment::kUpdatesInPlace;
+
   ConcurrentHashMap() {
     for (uint64_t i = 0; i < NumShards; i++) {
       segments_[i].store(nullptr);
@@ -247,6 +855,35 @@ class ConcurrentHashMap {
     }
   }
 
+  /**
+   * Calls fn(i, value) for every keys[i] in order, where value points to the value of the key or is null if
+   * the key does not exist. The keys are hashed and their buckets prefetched in batches before they are looked
+   * up, so that the cache misses of different keys overlap instead of being paid one after another.
+   * The value is only valid during the call. fn must not access the map.
+   */
+  template <typename Fn>
+  void MultiGet(const std::vector<const KeyType*>& keys, Fn&& fn) const {
+    // Bounded so that the prefetched lines are still in the cache when they are used
+    constexpr size_t kBatchSize = 16;
+    size_t hashes[kBatchSize];
+    Segment* segments[kBatchSize];
+    for (size_t begin = 0; begin < keys.size(); begin += kBatchSize) {
+      auto n = std::min(kBatchSize, keys.size() - begin);
+      EpochGuard guard;
+      for (size_t i = 0; i < n; i++) {
+        hashes[i] = HashFn{}(*keys[begin + i]);
+        segments[i] = EnsureSegment(hashes[i] & (NumShards - 1));
+        segments[i]->PrefetchBucket(hashes[i]);
+      }
+      for (size_t i = 0; i < n; i++) {
+        segments[i]->PrefetchNode(hashes[i]);
+      }
+      for (size_t i = 0; i < n; i++) {
+        segments[i]->Visit(*keys[begin + i], hashes[i], [&](const ValueType* value) { fn(begin + i, value); });
+      }
+    }
+  }
+
   ValueType* GetUnsafe(const KeyType& key) {
     auto idx = PickSegment(key);
     return EnsureSegment(idx)->GetUnsafe(key);
@@ -257,16 +894,81 @@ class ConcurrentHashMap {
     return EnsureSegment(idx)->Get(res, key);
   }
 
+  PinnedView<ValueType> GetView(const KeyType& key) const {
+    auto idx = PickSegment(key);
+    return EnsureSegment(idx)->GetView(key);
+  }
+
   bool InsertOrUpdate(const KeyType& key, const ValueType& value) {
     auto idx = PickSegment(key);
     return EnsureSegment(idx)->InsertOrUpdate(key, value);
   }
 
+  bool InsertOrUpdate(KeyType&& key, ValueType&& value) {
+    auto idx = PickSegment(key);
+    return EnsureSegment(idx)->InsertOrUpdate(std::move(key), std::move(value));
+  }
+
+  /**
+   * Applies update_fn to the value of the given key in place. Returns false if the key does not exist.
+   * update_fn must not access the map.
+   */
+  template <typename UpdateFn>
+  bool Update(const KeyType& key, UpdateFn&& update_fn) {
+    auto idx = PickSegment(key);
+    return EnsureSegment(idx)->Update(key, std::forward<UpdateFn>(update_fn));
+  }
+
   bool Erase(const KeyType& key) {
     auto idx = PickSegment(key);
     return EnsureSegment(idx)->Erase(key);
   }
 
+  /**
+   * Erases the given key only if pred(value) returns true. pred is called while holding the latch of the
+   * segment so the value cannot change in between. pred must not access the map.
+   */
+  template <typename Pred>
+  bool EraseIf(const KeyType& key, Pred&& pred) {
+    auto idx = PickSegment(key);
+    return EnsureSegment(idx)->EraseIf(key, std::forward<Pred>(pred));
+  }
+
+  /**
+   * Calls fn(key, value) on every entry of the map. Only one segment is latched at a time so
+   * the entries visited do not necessarily form a consistent snapshot of the map.
+   * fn must not access the map.
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    ForEach(std::forward<Fn>(fn), [] {});
+  }
+
+  /**
+   * Same as above but also calls segment_done() after visiting each segment, once its latch is released.
+   * Slow work on the visited entries can be deferred to segment_done so that it does not block the writers
+   */
+  template <typename Fn, typename SegmentDoneFn>
+  void ForEach(Fn&& fn, SegmentDoneFn&& segment_done) const {
+    for (uint64_t i = 0; i < NumShards; i++) {
+      if (auto segment = segments_[i].load(); segment) {
+        segment->ForEach(fn);
+        segment_done();
+      }
+    }
+  }
+
+  /**
+   * Sizes every segment up front for a total of n entries, assuming that the keys are spread evenly
+   * across the segments, so that bulk loading n entries does not repeatedly grow the segments
+   */
+  void Reserve(size_t n) {
+    auto per_segment = n / NumShards + 1;
+    for (uint64_t i = 0; i < NumShards; i++) {
+      EnsureSegment(i)->Reserve(per_segment);
+    }
+  }
+
  private:
   uint64_t PickSegment(const KeyType& key) const {
     auto h = HashFn{}(key);
@@ -291,4 +993,14 @@ class ConcurrentHashMap {
   mutable std::atomic<Segment*> segments_[NumShards];
 };
 
-}  // namespace slog
\ No newline at end of file
+template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8>
+using OptimisticConcurrentHashMap =
+    ConcurrentHashMap<KeyType, ValueType, HashFn, ShardBits,
+                      concurrent_hash_map::OptimisticSegmentT<KeyType, ValueType, HashFn, ShardBits>>;
+
+template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8>
+using FlatConcurrentHashMap =
+    ConcurrentHashMap<KeyType, ValueType, HashFn, ShardBits,
+                      concurrent_hash_map::FlatSegmentT<KeyType, ValueType, HashFn, ShardBits>>;
+
+}  // namespace slog
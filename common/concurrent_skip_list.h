@@ -0,0 +1,220 @@
+/**
+ * concurrent_skip_list.h
+ *
+ * An ordered map based on a skip list. Writers are serialized by a latch while readers, including
+ * range scans, never take it. A node is made visible to readers by linking it bottom-up with release
+ * stores, so a reader that can reach a node at any level also sees its key and its lower links.
+ *
+ * The value of a node is held behind an atomic pointer. Updating a key publishes a new value object
+ * and retires the old one, and erasing a key unlinks and retires its node. Retired objects are freed
+ * through epoch-based reclamation (see common/epoch.h) once no reader can hold a reference to them.
+ *
+ * A scan is not a snapshot: it observes every key that exists throughout the scan, and each value it
+ * returns is the complete value of its key at some point during the scan.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <random>
+
+#include "common/epoch.h"
+#include "common/pinned_view.h"
+
+namespace slog {
+
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+class ConcurrentSkipList {
+  static constexpr int kMaxHeight = 20;
+  // Each level has 1/kBranching of the nodes of the level below
+  static constexpr uint32_t kBranching = 4;
+
+  struct Node {
+    template <typename K>
+    Node(K&& key, ValueType* value, int height) : key(std::forward<K>(key)), value(value), height(height) {
+      for (int i = 0; i < height; i++) {
+        new (&next[i]) std::atomic<Node*>(nullptr);
+      }
+    }
+
+    ~Node() { delete value.load(std::memory_order_relaxed); }
+
+    // The links array is allocated past the end of the node
+    template <typename K>
+    static Node* New(K&& key, ValueType* value, int height) {
+      auto mem = ::operator new(sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
+      return new (mem) Node(std::forward<K>(key), value, height);
+    }
+
+    static void operator delete(void* p) { ::operator delete(p); }
+
+    KeyType key;
+    std::atomic<ValueType*> value;
+    int height;
+    std::atomic<Node*> next[1];
+  };
+
+ public:
+  ConcurrentSkipList() : head_(Node::New(KeyType(), nullptr, kMaxHeight)), height_(1), size_(0) {}
+
+  ~ConcurrentSkipList() {
+    auto node = head_;
+    while (node) {
+      auto next = node->next[0].load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+
+  ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+  ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+  bool Get(ValueType& res, const KeyType& key) const {
+    EpochGuard guard;
+    auto node = FindGreaterOrEqual(key, nullptr);
+    if (node == nullptr || !Equal(node->key, key)) {
+      return false;
+    }
+    res = *node->value.load(std::memory_order_acquire);
+    return true;
+  }
+
+  PinnedView<ValueType> GetView(const KeyType& key) const {
+    EpochManager::Instance().Enter();
+    auto node = FindGreaterOrEqual(key, nullptr);
+    if (node == nullptr || !Equal(node->key, key)) {
+      EpochManager::Instance().Exit();
+      return {};
+    }
+    return PinnedView<ValueType>::EpochPinned(node->value.load(std::memory_order_acquire));
+  }
+
+  /**
+   * Calls fn(key, value) on the entries whose keys are not less than start, in key order,
+   * until fn returns false or the end of the list is reached. fn must not access the list.
+   */
+  template <typename ScanFn>
+  void Scan(const KeyType& start, ScanFn&& fn) const {
+    EpochGuard guard;
+    for (auto node = FindGreaterOrEqual(start, nullptr); node != nullptr;
+         node = node->next[0].load(std::memory_order_acquire)) {
+      if (!fn(node->key, *node->value.load(std::memory_order_acquire))) {
+        break;
+      }
+    }
+  }
+
+  bool InsertOrUpdate(const KeyType& key, const ValueType& value) { return DoInsertOrUpdate(key, value); }
+
+  bool InsertOrUpdate(KeyType&& key, ValueType&& value) { return DoInsertOrUpdate(std::move(key), std::move(value)); }
+
+  /**
+   * Applies update_fn to a copy of the value of the given key and publishes the copy.
+   * Returns false if the key does not exist.
+   */
+  template <typename UpdateFn>
+  bool Update(const KeyType& key, UpdateFn&& update_fn) {
+    std::lock_guard<std::mutex> guard(write_mut_);
+    auto node = FindGreaterOrEqual(key, nullptr);
+    if (node == nullptr || !Equal(node->key, key)) {
+      return false;
+    }
+    auto new_value = new ValueType(*node->value.load(std::memory_order_relaxed));
+    update_fn(*new_value);
+    retired_.Retire(node->value.exchange(new_value, std::memory_order_acq_rel));
+    return true;
+  }
+
+  bool Erase(const KeyType& key) {
+    std::lock_guard<std::mutex> guard(write_mut_);
+    Node* prev[kMaxHeight];
+    auto node = FindGreaterOrEqual(key, prev);
+    if (node == nullptr || !Equal(node->key, key)) {
+      return false;
+    }
+    // Unlink from the top so that the node stays reachable at the lower levels until the end
+    for (int i = node->height - 1; i >= 0; i--) {
+      prev[i]->next[i].store(node->next[i].load(std::memory_order_relaxed), std::memory_order_release);
+    }
+    retired_.Retire(node);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+ private:
+  static bool Equal(const KeyType& a, const KeyType& b) { return !Compare{}(a, b) && !Compare{}(b, a); }
+
+  template <typename K, typename V>
+  bool DoInsertOrUpdate(K&& key, V&& value) {
+    std::lock_guard<std::mutex> guard(write_mut_);
+    Node* prev[kMaxHeight];
+    auto node = FindGreaterOrEqual(key, prev);
+    if (node != nullptr && Equal(node->key, key)) {
+      auto new_value = new ValueType(std::forward<V>(value));
+      retired_.Retire(node->value.exchange(new_value, std::memory_order_acq_rel));
+      return true;
+    }
+
+    auto height = RandomHeight();
+    auto current_height = height_.load(std::memory_order_relaxed);
+    if (height > current_height) {
+      for (int i = current_height; i < height; i++) {
+        prev[i] = head_;
+      }
+      // Readers that see the new height before the new node simply move down from the head
+      height_.store(height, std::memory_order_relaxed);
+    }
+
+    auto new_node = Node::New(std::forward<K>(key), new ValueType(std::forward<V>(value)), height);
+    for (int i = 0; i < height; i++) {
+      new_node->next[i].store(prev[i]->next[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      prev[i]->next[i].store(new_node, std::memory_order_release);
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Readers must hold an epoch guard. If prev is not null, it is filled with the
+  // last node before the returned node at each level, which requires holding the latch
+  Node* FindGreaterOrEqual(const KeyType& key, Node** prev) const {
+    auto node = head_;
+    auto level = height_.load(std::memory_order_relaxed) - 1;
+    for (;;) {
+      auto next = node->next[level].load(std::memory_order_acquire);
+      if (next != nullptr && Compare{}(next->key, key)) {
+        node = next;
+        continue;
+      }
+      if (prev != nullptr) {
+        prev[level] = node;
+      }
+      if (level == 0) {
+        return next;
+      }
+      level--;
+    }
+  }
+
+  // Must hold the latch
+  int RandomHeight() {
+    int height = 1;
+    while (height < kMaxHeight && rg_() % kBranching == 0) {
+      height++;
+    }
+    return height;
+  }
+
+  Node* const head_;
+  std::atomic<int> height_;
+  std::atomic<size_t> size_;
+
+  std::mutex write_mut_;
+  std::minstd_rand rg_;
+  RetireList retired_;
+};
+
+}  // namespace slog
@@ -221,8 +221,47 @@ vector<int> Configuration::cpu_pinnings(ModuleId module) const {
   return cpus;
 }
 
+internal::PollingOptions Configuration::polling_options(ModuleId module) const {
+  internal::PollingOptions options;
+  for (auto& entry : config_.polling()) {
+    if (entry.module() == module) {
+      options = entry;
+      break;
+    }
+  }
+  // The lower bound keeps the loops that receive messages less often than the upper bound spinning about as
+  // long as the fixed number of rounds that they used to spin for. It can only be set to 0 together with a
+  // nonzero upper bound
+  if (options.min_spin_us() == 0 && options.max_spin_us() == 0) {
+    options.set_min_spin_us(500);
+  }
+  if (options.max_spin_us() == 0) {
+    options.set_max_spin_us(1000);
+  }
+  options.set_max_spin_us(std::max(options.min_spin_us(), options.max_spin_us()));
+  return options;
+}
+
 internal::ExecutionType Configuration::execution_type() const { return config_.execution_type(); }
 
+internal::StorageType Configuration::storage_type() const { return config_.storage_type(); }
+
+const internal::DurableStorageOptions& Configuration::durable_storage_options() const {
+  return config_.durable_storage();
+}
+
+bool Configuration::master_metadata_index() const { return config_.master_metadata_index(); }
+
+const internal::TieredStorageOptions& Configuration::tiered_storage_options() const {
+  return config_.tiered_storage();
+}
+
+bool Configuration::lazy_data() const { return config_.lazy_data(); }
+
+const internal::MessageCoalescingOptions& Configuration::message_coalescing_options() const {
+  return config_.message_coalescing();
+}
+
 const vector<uint32_t>& Configuration::replication_order() const { return replication_order_; }
 
 bool Configuration::synchronized_batching() const { return config_.synchronized_batching(); }
@@ -254,6 +293,16 @@ int Configuration::long_sender_sndbuf() const {
   return config_.long_sender_sndbuf() <= 0 ? -1 : config_.long_sender_sndbuf();
 }
 
+uint32_t Configuration::shm_ring_size() const {
+  return config_.shm_ring_size() == 0 ? 1024 * 1024 : config_.shm_ring_size();
+}
+
 int Configuration::tps_limit() const { return config_.tps_limit(); }
 
+uint32_t Configuration::max_inflight_txns() const { return config_.max_inflight_txns(); }
+
+milliseconds Configuration::credit_interval() const {
+  return milliseconds(config_.credit_interval() == 0 ? 10 : config_.credit_interval());
+}
+
 }  // namespace slog
\ No newline at end of file
@@ -60,7 +60,14 @@ class Configuration {
   bool bypass_mh_orderer() const;
   std::chrono::milliseconds ddr_interval() const;
   std::vector<int> cpu_pinnings(ModuleId module) const;
+  internal::PollingOptions polling_options(ModuleId module) const;
   internal::ExecutionType execution_type() const;
+  internal::StorageType storage_type() const;
+  const internal::DurableStorageOptions& durable_storage_options() const;
+  bool master_metadata_index() const;
+  const internal::TieredStorageOptions& tiered_storage_options() const;
+  bool lazy_data() const;
+  const internal::MessageCoalescingOptions& message_coalescing_options() const;
   const std::vector<uint32_t>& replication_order() const;
   bool synchronized_batching() const;
   const internal::MetricOptions& metric_options() const;
@@ -73,7 +80,10 @@ class Configuration {
 
   int broker_rcvbuf() const;
   int long_sender_sndbuf() const;
+  uint32_t shm_ring_size() const;
   int tps_limit() const;
+  uint32_t max_inflight_txns() const;
+  std::chrono::milliseconds credit_interval() const;
 
  private:
   internal::Configuration config_;
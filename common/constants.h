@@ -26,13 +26,9 @@ const Channel kLogManagerChannel = 15;
 // Worker channels are in [kWorkerChannel, kMaxChannel)
 const Channel kWorkerChannel = 45;
 // The broker considers anything larger than or equal to kMaxChannel as a tag.
-// Tags are like channels but can be added/removed on the fly. Tags are used
-// by log managers and workers. Log managers use tag to instruct the broker to
-// distribute messages to the correct logs. Workers use tag to tell the broker
-// which txn it is processing.
+// Tags are like channels but can be added/removed on the fly. Log managers use
+// tag to instruct the broker to distribute messages to the correct logs.
 const Channel kMaxChannel = 70;
-// Since workers use TxnId for their tags and TxnId starts from kMaxNumMachines,
-// anything larger than or equal to kMaxNumMachines must be reserved for workers' tags.
 // The range [kMaxChannel, kMaxNumMachines) is reserved for the log managers.
 const uint32_t kMaxNumMachines = 100;
 
@@ -45,8 +41,6 @@ const uint32_t kPaxosDefaultLeaderPosition = 0;
 
 const size_t kLockTableSizeLimit = 1000000;
 
-const int kRecvRetries = 4000;
-
 // We never use 0 for txn id
 const TxnId kSentinelTxnId = 0;
 
@@ -96,4 +90,12 @@ const char TXN_EXPECTED_NUM_LO[] = "expected_num_lo";
 const char TXN_MULTI_HOME[] = "multi_home";
 const char TXN_MULTI_PARTITION[] = "multi_partition";
 
+/* Storage */
+const char STORAGE_HITS[] = "storage_hits";
+const char STORAGE_MISSES[] = "storage_misses";
+const char STORAGE_PREFETCHES[] = "storage_prefetches";
+const char STORAGE_EVICTIONS[] = "storage_evictions";
+const char STORAGE_HOT_BYTES[] = "storage_hot_bytes";
+const char STORAGE_AVG_PREFETCH_LEAD_TIME_US[] = "storage_avg_prefetch_lead_time_us";
+
 }  // namespace slog
\ No newline at end of file
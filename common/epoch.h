@@ -0,0 +1,182 @@
+/**
+ * epoch.h
+ *
+ * A small epoch-based reclamation (EBR) scheme for data structures whose readers do not take latches.
+ *
+ * A reader pins itself by copying the global epoch into a slot owned by its thread. Each slot sits on
+ * its own cache line, so entering and leaving a read-side critical section never writes to memory
+ * shared with other threads. A writer that unlinks an object retires it, tagging it with the global
+ * epoch observed after the unlink. The object is freed only after every pinned reader has published
+ * an epoch greater than that tag, at which point no reader can still hold a reference to it.
+ */
+#pragma once
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace slog {
+
+class EpochManager {
+ public:
+  static constexpr uint64_t kInactive = std::numeric_limits<uint64_t>::max();
+  static constexpr size_t kMaxThreads = 1024;
+
+  static EpochManager& Instance() {
+    static EpochManager instance;
+    return instance;
+  }
+
+  /**
+   * Pins the calling thread to the current global epoch. Calls may be nested, in which
+   * case only the outermost call has an effect.
+   */
+  void Enter() {
+    auto& local = LocalState();
+    if (local.depth++ == 0) {
+      slots_[local.slot].epoch.store(global_epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+      // Orders the slot store before any read in the critical section. Pairs with the fence in RetireEpoch
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void Exit() {
+    auto& local = LocalState();
+    if (--local.depth == 0) {
+      slots_[local.slot].epoch.store(kInactive, std::memory_order_release);
+    }
+  }
+
+  /**
+   * Returns the tag for an object that has just been made unreachable to new readers
+   */
+  uint64_t RetireEpoch() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return global_epoch_.load(std::memory_order_seq_cst);
+  }
+
+  /**
+   * Advances the global epoch and returns the smallest epoch published by a pinned reader.
+   * Objects whose tag is strictly smaller than the returned value can be freed.
+   */
+  uint64_t SafeEpoch() {
+    global_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    uint64_t min_epoch = kInactive;
+    auto num_slots = num_slots_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < num_slots; i++) {
+      min_epoch = std::min(min_epoch, slots_[i].epoch.load(std::memory_order_acquire));
+    }
+    return min_epoch;
+  }
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{kInactive};
+  };
+
+  struct ThreadState {
+    ThreadState(EpochManager& manager) : manager(manager), slot(manager.AcquireSlot()), depth(0) {}
+    ~ThreadState() { manager.ReleaseSlot(slot); }
+
+    EpochManager& manager;
+    size_t slot;
+    uint32_t depth;
+  };
+
+  EpochManager() = default;
+
+  ThreadState& LocalState() {
+    thread_local ThreadState state(*this);
+    return state;
+  }
+
+  size_t AcquireSlot() {
+    std::lock_guard<std::mutex> guard(slots_mut_);
+    if (!free_slots_.empty()) {
+      auto slot = free_slots_.back();
+      free_slots_.pop_back();
+      return slot;
+    }
+    auto slot = num_slots_.load(std::memory_order_relaxed);
+    CHECK_LT(slot, kMaxThreads) << "Too many threads registered with the epoch manager";
+    num_slots_.store(slot + 1, std::memory_order_release);
+    return slot;
+  }
+
+  void ReleaseSlot(size_t slot) {
+    std::lock_guard<std::mutex> guard(slots_mut_);
+    slots_[slot].epoch.store(kInactive, std::memory_order_release);
+    free_slots_.push_back(slot);
+  }
+
+  alignas(64) std::atomic<uint64_t> global_epoch_{0};
+  Slot slots_[kMaxThreads];
+  std::atomic<size_t> num_slots_{0};
+  std::mutex slots_mut_;
+  std::vector<size_t> free_slots_;
+};
+
+/**
+ * RAII wrapper around EpochManager::Enter and EpochManager::Exit
+ */
+class EpochGuard {
+ public:
+  EpochGuard() { EpochManager::Instance().Enter(); }
+  ~EpochGuard() { EpochManager::Instance().Exit(); }
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+/**
+ * Holds objects that were unlinked from a shared structure until no reader can reach them.
+ * This class is not thread-safe. It is meant to be owned by a single writer, or be guarded by
+ * the latch that already serializes the writers.
+ */
+class RetireList {
+  static constexpr size_t kReclaimThreshold = 64;
+
+ public:
+  RetireList() = default;
+  RetireList(const RetireList&) = delete;
+  RetireList& operator=(const RetireList&) = delete;
+
+  ~RetireList() {
+    for (auto& item : items_) {
+      item.deleter(item.ptr);
+    }
+  }
+
+  template <typename T>
+  void Retire(T* ptr) {
+    items_.push_back({EpochManager::Instance().RetireEpoch(), ptr, [](void* p) { delete static_cast<T*>(p); }});
+    if (items_.size() >= next_reclaim_) {
+      Reclaim();
+      // Back off if lagging readers keep many items alive so that retiring stays cheap
+      next_reclaim_ = std::max(kReclaimThreshold, 2 * items_.size());
+    }
+  }
+
+  void Reclaim() {
+    auto safe_epoch = EpochManager::Instance().SafeEpoch();
+    auto it = std::partition(items_.begin(), items_.end(), [&](const Item& item) { return item.epoch >= safe_epoch; });
+    for (auto free_it = it; free_it != items_.end(); free_it++) {
+      free_it->deleter(free_it->ptr);
+    }
+    items_.erase(it, items_.end());
+  }
+
+ private:
+  struct Item {
+    uint64_t epoch;
+    void* ptr;
+    void (*deleter)(void*);
+  };
+  std::vector<Item> items_;
+  size_t next_reclaim_ = kReclaimThreshold;
+};
+
+}  // namespace slog
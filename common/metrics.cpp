@@ -398,6 +398,54 @@ class GenericMetrics {
   list<Data> data_;
 };
 
+class PollerMetrics {
+ public:
+  PollerMetrics(bool enabled, const std::string& thread_name, uint32_t local_region, uint32_t local_partition) {
+    if (enabled) {
+      data_.push_back({.thread = thread_name, .region = local_region, .partition = local_partition});
+    }
+  }
+
+  void Record(uint64_t num_spins, uint64_t num_sleeps, int64_t sleep_time, int64_t work_time, int64_t elapsed_time) {
+    if (data_.empty()) {
+      return;
+    }
+    auto& d = data_.front();
+    d.num_spins += num_spins;
+    d.num_sleeps += num_sleeps;
+    d.sleep_time += sleep_time;
+    d.work_time += work_time;
+    d.elapsed_time += elapsed_time;
+  }
+
+  struct Data {
+    std::string thread;
+    uint32_t region;
+    uint32_t partition;
+    uint64_t num_spins = 0;
+    uint64_t num_sleeps = 0;
+    // In microseconds. The utilization of the thread is work_time / elapsed_time
+    int64_t sleep_time = 0;
+    int64_t work_time = 0;
+    int64_t elapsed_time = 0;
+  };
+
+  list<Data>& data() { return data_; }
+
+  static void WriteToDisk(const std::string& dir, const list<Data>& data) {
+    CSVWriter poller_csv(dir + "/poller.csv", {"thread", "region", "partition", "num_spins", "num_sleeps",
+                                               "sleep_time", "work_time", "elapsed_time"});
+    for (const auto& d : data) {
+      poller_csv << d.thread << d.region << d.partition << d.num_spins << d.num_sleeps << d.sleep_time << d.work_time
+                 << d.elapsed_time << csvendl;
+    }
+  }
+
+ private:
+  // A single entry with the totals of the thread if enabled
+  list<Data> data_;
+};
+
 struct AllMetrics {
   TransactionEventMetrics txn_event_metrics;
   DeadlockResolverRunMetrics deadlock_resolver_run_metrics;
@@ -410,13 +458,17 @@ struct AllMetrics {
   BatchMetrics mhorderer_batch_metrics;
   TxnTimestampMetrics txn_timestamp_metrics;
   GenericMetrics generic_metrics;
+  PollerMetrics poller_metrics;
 };
 
 /**
  *  MetricsRepository
  */
 
-MetricsRepository::MetricsRepository(const ConfigurationPtr& config) : config_(config) { Reset(); }
+MetricsRepository::MetricsRepository(const ConfigurationPtr& config, const std::string& thread_name)
+    : config_(config), thread_name_(thread_name) {
+  Reset();
+}
 
 system_clock::time_point MetricsRepository::RecordTxnEvent(TxnId txn_id, TransactionEvent event) {
   std::lock_guard<SpinLatch> guard(latch_);
@@ -487,6 +539,12 @@ void MetricsRepository::RecordGeneric(int type, int64_t time, int64_t data) {
   return metrics_->generic_metrics.Record(type, time, data);
 }
 
+void MetricsRepository::RecordPoller(uint64_t num_spins, uint64_t num_sleeps, int64_t sleep_time, int64_t work_time,
+                                     int64_t elapsed_time) {
+  std::lock_guard<SpinLatch> guard(latch_);
+  return metrics_->poller_metrics.Record(num_spins, num_sleeps, sleep_time, work_time, elapsed_time);
+}
+
 std::unique_ptr<AllMetrics> MetricsRepository::Reset() {
   auto local_region = config_->local_region();
   auto local_partition = config_->local_partition();
@@ -505,7 +563,9 @@ std::unique_ptr<AllMetrics> MetricsRepository::Reset() {
        .sequencer_batch_metrics = BatchMetrics(config_->metric_options().sequencer_batch_sample()),
        .mhorderer_batch_metrics = BatchMetrics(config_->metric_options().mhorderer_batch_sample()),
        .txn_timestamp_metrics = TxnTimestampMetrics(config_->metric_options().txn_timestamp_sample()),
-       .generic_metrics = GenericMetrics(config_->metric_options().generic_sample(), local_region, local_partition)}));
+       .generic_metrics = GenericMetrics(config_->metric_options().generic_sample(), local_region, local_partition),
+       .poller_metrics =
+           PollerMetrics(config_->metric_options().poller(), thread_name_, local_region, local_partition)}));
 
   std::lock_guard<SpinLatch> guard(latch_);
   metrics_.swap(new_metrics);
@@ -522,10 +582,10 @@ thread_local std::shared_ptr<MetricsRepository> per_thread_metrics_repo;
 MetricsRepositoryManager::MetricsRepositoryManager(const std::string& config_name, const ConfigurationPtr& config)
     : config_name_(config_name), config_(config) {}
 
-void MetricsRepositoryManager::RegisterCurrentThread() {
+void MetricsRepositoryManager::RegisterCurrentThread(const std::string& thread_name) {
   std::lock_guard<std::mutex> guard(mut_);
   const auto thread_id = std::this_thread::get_id();
-  auto ins = metrics_repos_.try_emplace(thread_id, config_, new MetricsRepository(config_));
+  auto ins = metrics_repos_.try_emplace(thread_id, config_, new MetricsRepository(config_, thread_name));
   per_thread_metrics_repo = ins.first->second;
 }
 
@@ -540,6 +600,7 @@ void MetricsRepositoryManager::AggregateAndFlushToDisk(const std::string& dir) {
   list<BatchMetrics::Data> forwarder_batch_data, sequencer_batch_data, mhorderer_batch_data;
   list<TxnTimestampMetrics::Data> txn_timestamp_data;
   list<GenericMetrics::Data> generic_data;
+  list<PollerMetrics::Data> poller_data;
   {
     std::lock_guard<std::mutex> guard(mut_);
     for (auto& kv : metrics_repos_) {
@@ -560,6 +621,7 @@ void MetricsRepositoryManager::AggregateAndFlushToDisk(const std::string& dir) {
       mhorderer_batch_data.splice(mhorderer_batch_data.end(), metrics->mhorderer_batch_metrics.data());
       txn_timestamp_data.splice(txn_timestamp_data.end(), metrics->txn_timestamp_metrics.data());
       generic_data.splice(generic_data.end(), metrics->generic_metrics.data());
+      poller_data.splice(poller_data.end(), metrics->poller_metrics.data());
     }
   }
 
@@ -580,6 +642,7 @@ void MetricsRepositoryManager::AggregateAndFlushToDisk(const std::string& dir) {
     BatchMetrics::WriteToDisk(dir + "/mhorderer_batch.csv", mhorderer_batch_data);
     TxnTimestampMetrics::WriteToDisk(dir, txn_timestamp_data);
     GenericMetrics::WriteToDisk(dir, generic_data);
+    PollerMetrics::WriteToDisk(dir, poller_data);
     LOG(INFO) << "Metrics written to: \"" << dir << "/\"";
   } catch (std::runtime_error& e) {
     LOG(ERROR) << e.what();
@@ -23,7 +23,7 @@ struct AllMetrics;
  */
 class MetricsRepository {
  public:
-  MetricsRepository(const ConfigurationPtr& config);
+  MetricsRepository(const ConfigurationPtr& config, const std::string& thread_name = "");
 
   std::chrono::system_clock::time_point RecordTxnEvent(TxnId txn_id, TransactionEvent event);
   void RecordDeadlockResolverRun(int64_t runtime, size_t unstable_graph_sz, size_t stable_graph_sz,
@@ -41,11 +41,14 @@ class MetricsRepository {
   void RecordMHOrdererBatch(BatchId batch_id, size_t batch_size, int64_t batch_duration);
   void RecordTxnTimestamp(TxnId txn_id, uint32_t from, int64_t txn_timestamp, int64_t server_time);
   void RecordGeneric(int type, int64_t time, int64_t data);
+  void RecordPoller(uint64_t num_spins, uint64_t num_sleeps, int64_t sleep_time, int64_t work_time,
+                    int64_t elapsed_time);
 
   std::unique_ptr<AllMetrics> Reset();
 
  private:
   const ConfigurationPtr config_;
+  const std::string thread_name_;
   SpinLatch latch_;
 
   std::unique_ptr<AllMetrics> metrics_;
@@ -59,7 +62,7 @@ extern thread_local std::shared_ptr<MetricsRepository> per_thread_metrics_repo;
 class MetricsRepositoryManager {
  public:
   MetricsRepositoryManager(const std::string& config_name, const ConfigurationPtr& config);
-  void RegisterCurrentThread();
+  void RegisterCurrentThread(const std::string& thread_name = "");
   void AggregateAndFlushToDisk(const std::string& dir);
 
  private:
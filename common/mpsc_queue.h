@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glog/logging.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/spsc_queue.h"
+
+namespace slog {
+
+/**
+ * An unbounded lock-free queue for many producer threads and one consumer thread.
+ *
+ * Each producer gets its own single-producer lane so producers never contend with each other. The
+ * consumer takes items from the lanes in a round-robin manner. Items of the same producer are taken
+ * in the order they are added but there is no order among the items of different producers, which
+ * is the same guarantee as a zmq socket with many connected peers.
+ */
+template <typename T, size_t kMaxProducers = 128>
+class MpscQueue {
+ public:
+  using Lane = SpscQueue<T>;
+
+  MpscQueue() : num_lanes_(0), next_lane_(0) {
+    for (auto& state : states_) {
+      state.store(kFree, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  /**
+   * Returns a lane for a producer to push items to. The lane must only be used by one thread at a time
+   * and is valid until it is given back with ReleaseLane. At most kMaxProducers lanes can be in use at once
+   */
+  Lane* NewLane() {
+    std::lock_guard<std::mutex> guard(new_lane_mut_);
+    size_t i;
+    if (!free_lanes_.empty()) {
+      // The consumer has drained the lane before putting it in the free list
+      i = free_lanes_.back();
+      free_lanes_.pop_back();
+      states_[i].store(kActive, std::memory_order_release);
+    } else {
+      i = num_lanes_.load(std::memory_order_relaxed);
+      CHECK_LT(i, kMaxProducers) << "Too many producers";
+      lanes_[i] = std::make_unique<Lane>();
+      states_[i].store(kActive, std::memory_order_relaxed);
+      num_lanes_.store(i + 1, std::memory_order_release);
+    }
+    return lanes_[i].get();
+  }
+
+  /**
+   * Called by the producer of a lane after its last push. The consumer takes the remaining items of the
+   * lane before reusing it for another producer
+   */
+  void ReleaseLane(Lane* lane) {
+    auto num_lanes = num_lanes_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < num_lanes; i++) {
+      if (lanes_[i].get() == lane) {
+        states_[i].store(kDetached, std::memory_order_release);
+        return;
+      }
+    }
+    LOG(FATAL) << "Lane does not belong to this queue";
+  }
+
+  /**
+   * Must only be called by the consumer. Returns false if the queue is empty
+   */
+  bool Pop(T& item) {
+    auto num_lanes = num_lanes_.load(std::memory_order_acquire);
+    for (size_t n = 0; n < num_lanes; n++) {
+      if (next_lane_ >= num_lanes) {
+        next_lane_ = 0;
+      }
+      auto i = next_lane_++;
+      // The state is read before the lane so that a detached lane is known to be drained if it is empty
+      auto state = states_[i].load(std::memory_order_acquire);
+      if (state == kFree) {
+        continue;
+      }
+      if (lanes_[i]->Pop(item)) {
+        return true;
+      }
+      if (state == kDetached) {
+        Reclaim(i);
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Must only be called by the consumer
+   */
+  bool empty() const {
+    auto num_lanes = num_lanes_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < num_lanes; i++) {
+      if (states_[i].load(std::memory_order_acquire) != kFree && !lanes_[i]->empty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  enum : uint8_t { kFree, kActive, kDetached };
+
+  void Reclaim(size_t i) {
+    states_[i].store(kFree, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(new_lane_mut_);
+    free_lanes_.push_back(i);
+  }
+
+  std::array<std::unique_ptr<Lane>, kMaxProducers> lanes_;
+  std::array<std::atomic<uint8_t>, kMaxProducers> states_;
+  std::atomic<size_t> num_lanes_;
+  // Protects free_lanes_ and the creation of new lanes
+  std::mutex new_lane_mut_;
+  std::vector<size_t> free_lanes_;
+  // Only accessed by the consumer
+  size_t next_lane_;
+};
+
+}  // namespace slog
@@ -1,7 +1,11 @@
 #include "common/offline_data_reader.h"
 
+#include <fcntl.h>
 #include <glog/logging.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::FileInputStream;
@@ -46,4 +50,75 @@ Datum OfflineDataReader::GetNextDatum() {
   return datum;
 }
 
+namespace {
+
+bool DecodeVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; pos < end && shift < 64; shift += 7) {
+    auto byte = *pos++;
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+OfflineDataChunkReader::OfflineDataChunkReader(const std::string& path, uint32_t datums_per_chunk)
+    : data_(nullptr), file_size_(0), num_datums_(0) {
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    LOG(FATAL) << "Error while reading data file";
+  }
+  file_size_ = st.st_size;
+  auto addr = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED) {
+    LOG(FATAL) << "Error while mapping data file: " << strerror(errno);
+  }
+  close(fd);
+  // The file is scanned from front to back, first here and then by the parsing threads
+  madvise(addr, file_size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const uint8_t*>(addr);
+
+  const uint8_t* pos = data_;
+  const uint8_t* end = data_ + file_size_;
+  uint64_t num_datums;
+  if (!DecodeVarint(pos, end, num_datums)) {
+    LOG(FATAL) << "Error while reading data file";
+  }
+  num_datums_ = num_datums;
+
+  for (uint32_t i = 0; i < num_datums_; i++) {
+    if (i % datums_per_chunk == 0) {
+      chunks_.push_back(pos - data_);
+    }
+    uint64_t size;
+    if (!DecodeVarint(pos, end, size) || size > static_cast<uint64_t>(end - pos)) {
+      LOG(FATAL) << "Error while reading data file";
+    }
+    pos += size;
+  }
+  chunks_.push_back(pos - data_);
+}
+
+OfflineDataChunkReader::~OfflineDataChunkReader() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), file_size_);
+  }
+}
+
+uint64_t OfflineDataChunkReader::ReadSize(const uint8_t*& pos) {
+  uint64_t size;
+  DecodeVarint(pos, pos + 10, size);
+  return size;
+}
+
+void OfflineDataChunkReader::LogParseError() { LOG(FATAL) << "Error while parsing datum"; }
+
 }  // namespace slog
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream.h>
 
+#include <string>
+#include <vector>
+
 #include "proto/offline_data.pb.h"
 
 namespace slog {
@@ -23,4 +26,51 @@ class OfflineDataReader {
   uint32_t num_read_datums_;
 };
 
+/**
+ * Maps a data file and splits it into chunks of consecutive datums. Finding the chunk boundaries only
+ * decodes the size prefix of each datum, so the costly parsing of the datums can be done in parallel
+ * by handing different chunks to different threads.
+ */
+class OfflineDataChunkReader {
+ public:
+  OfflineDataChunkReader(const std::string& path, uint32_t datums_per_chunk);
+  ~OfflineDataChunkReader();
+
+  OfflineDataChunkReader(const OfflineDataChunkReader&) = delete;
+  OfflineDataChunkReader& operator=(const OfflineDataChunkReader&) = delete;
+
+  bool is_open() const { return data_ != nullptr; }
+  uint32_t GetNumDatums() const { return num_datums_; }
+  size_t GetNumChunks() const { return chunks_.empty() ? 0 : chunks_.size() - 1; }
+
+  /**
+   * Calls fn(datum) on every datum in the given chunk. Safe to call from multiple threads
+   */
+  template <typename Fn>
+  void ForEachDatum(size_t chunk, Fn&& fn) const {
+    Datum datum;
+    const uint8_t* pos = data_ + chunks_[chunk];
+    const uint8_t* end = data_ + chunks_[chunk + 1];
+    while (pos < end) {
+      auto size = ReadSize(pos);
+      if (!datum.ParseFromArray(pos, size)) {
+        LogParseError();
+      }
+      pos += size;
+      fn(datum);
+    }
+  }
+
+ private:
+  // Decodes a varint size prefix, which has been validated when the chunks were split
+  static uint64_t ReadSize(const uint8_t*& pos);
+  static void LogParseError();
+
+  const uint8_t* data_;
+  size_t file_size_;
+  uint32_t num_datums_;
+  // Offsets of the chunk boundaries, including the end of the last chunk
+  std::vector<size_t> chunks_;
+};
+
 }  // namespace slog
\ No newline at end of file
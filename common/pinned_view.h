@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+
+#include "common/epoch.h"
+#include "common/rwlatch.h"
+
+namespace slog {
+
+/**
+ * A borrowed, read-only pointer to an object owned by a concurrent data structure. The object stays
+ * valid and unchanged for as long as the view is alive because the view does one of the following:
+ *   - pins the calling thread to the current epoch (see common/epoch.h),
+ *   - holds the read latch that protects the object,
+ *   - owns a private copy of the object, for structures that cannot lend out their objects.
+ *
+ * A view is bound to the thread that created it. A view holding a read latch must be released before
+ * the same thread writes to, or creates another view into, the part of the structure guarded by that
+ * latch. In any case, views are meant to be short-lived.
+ */
+template <typename T>
+class PinnedView {
+  enum class Pin { NONE, EPOCH, LATCH, OWNED };
+
+ public:
+  PinnedView() = default;
+
+  /**
+   * The calling thread must have entered the epoch. The view takes over the responsibility of exiting it.
+   */
+  static PinnedView EpochPinned(const T* object) { return PinnedView(object, Pin::EPOCH); }
+
+  /**
+   * The calling thread must hold the read latch. The view takes over the responsibility of releasing it.
+   */
+  static PinnedView LatchPinned(const T* object, bustub::ReaderWriterLatch* latch) {
+    PinnedView view(object, Pin::LATCH);
+    view.latch_ = latch;
+    return view;
+  }
+
+  static PinnedView Owned(std::unique_ptr<T>&& object) {
+    PinnedView view(object.get(), Pin::OWNED);
+    view.owned_ = std::move(object);
+    return view;
+  }
+
+  PinnedView(PinnedView&& other) { *this = std::move(other); }
+
+  PinnedView& operator=(PinnedView&& other) {
+    if (this != &other) {
+      Release();
+      object_ = other.object_;
+      pin_ = other.pin_;
+      latch_ = other.latch_;
+      owned_ = std::move(other.owned_);
+      other.object_ = nullptr;
+      other.pin_ = Pin::NONE;
+    }
+    return *this;
+  }
+
+  PinnedView(const PinnedView&) = delete;
+  PinnedView& operator=(const PinnedView&) = delete;
+
+  ~PinnedView() { Release(); }
+
+  void Release() {
+    switch (pin_) {
+      case Pin::EPOCH:
+        EpochManager::Instance().Exit();
+        break;
+      case Pin::LATCH:
+        latch_->RUnlock();
+        break;
+      case Pin::OWNED:
+        owned_.reset();
+        break;
+      case Pin::NONE:
+        break;
+    }
+    object_ = nullptr;
+    pin_ = Pin::NONE;
+  }
+
+  const T* get() const { return object_; }
+  const T& operator*() const { return *object_; }
+  const T* operator->() const { return object_; }
+  explicit operator bool() const { return object_ != nullptr; }
+
+ private:
+  PinnedView(const T* object, Pin pin) : object_(object), pin_(pin) {}
+
+  const T* object_ = nullptr;
+  Pin pin_ = Pin::NONE;
+  bustub::ReaderWriterLatch* latch_ = nullptr;
+  std::unique_ptr<T> owned_;
+};
+
+}  // namespace slog
@@ -9,6 +9,8 @@
 #include <sstream>
 #include <unordered_set>
 
+#include "common/shared_arena.h"
+
 using std::string;
 using std::vector;
 
@@ -352,8 +354,14 @@ vector<Transaction*> Unbatch(internal::Batch* batch) {
 
   vector<Transaction*> buffer(transactions->size());
 
+  // Txns of a batch on a shared arena stay on the arena and each holds a reference to it
+  auto arena = batch->GetArena();
+  if (arena != nullptr) {
+    RefSharedArena(arena, transactions->size());
+  }
+
   for (int i = transactions->size() - 1; i >= 0; i--) {
-    auto txn = transactions->ReleaseLast();
+    auto txn = arena != nullptr ? transactions->UnsafeArenaReleaseLast() : transactions->ReleaseLast();
     auto txn_internal = txn->mutable_internal();
 
     // Transfer recorded events from batch to each txn in the batch
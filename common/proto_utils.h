@@ -91,7 +91,7 @@ bool operator==(const KeyValueEntry& kv1, const KeyValueEntry& kv2);
 bool operator==(const Transaction& txn1, const Transaction txn2);
 
 /**
- * Extract txns from a batch
+ * Extract txns from a batch. The txns of a batch on a shared arena must be freed with DeleteMessage
  */
 std::vector<Transaction*> Unbatch(internal::Batch* batch);
 
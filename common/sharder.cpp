@@ -14,6 +14,15 @@ uint32_t FNVHash(It begin, It end) {
   return hash;
 }
 
+// Numeric keys are parsed without allocating or throwing. Other keys are left to std::stoll as before
+uint64_t ParseKey(const Key& key) {
+  uint64_t id;
+  if (ParseIntKey(key, id)) {
+    return id;
+  }
+  return std::stoll(key);
+}
+
 }  // namespace
 
 std::shared_ptr<Sharder> Sharder::MakeSharder(const ConfigurationPtr& config) {
@@ -62,7 +71,7 @@ uint32_t HashSharder::compute_partition(const Key& key) const {
  * Taking the modulo of the key by the number of partitions gives the partition of the key
  */
 SimpleSharder::SimpleSharder(const ConfigurationPtr& config) : Sharder(config) {}
-uint32_t SimpleSharder::compute_partition(const Key& key) const { return std::stoll(key) % num_partitions_; }
+uint32_t SimpleSharder::compute_partition(const Key& key) const { return ParseKey(key) % num_partitions_; }
 
 /**
  * Simple Sharder 2
@@ -83,7 +92,7 @@ uint32_t SimpleSharder::compute_partition(const Key& key) const { return std::st
  */
 SimpleSharder2::SimpleSharder2(const ConfigurationPtr& config) : Sharder(config), num_regions_(config->num_regions()) {}
 uint32_t SimpleSharder2::compute_partition(const Key& key) const {
-  return (std::stoll(key) / num_regions_) % num_partitions_;
+  return (ParseKey(key) / num_regions_) % num_partitions_;
 }
 
 /**
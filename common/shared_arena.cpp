@@ -0,0 +1,54 @@
+#include "common/shared_arena.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace slog {
+
+using google::protobuf::Arena;
+using google::protobuf::ArenaOptions;
+
+namespace {
+
+// The reference count lives in the same allocation as the arena, right before it, so that it can be found
+// from the arena pointer that every message on the arena returns
+struct SharedArena {
+  std::atomic<int> refs;
+  alignas(Arena) unsigned char arena[sizeof(Arena)];
+};
+
+inline SharedArena* ToShared(Arena* arena) {
+  return reinterpret_cast<SharedArena*>(reinterpret_cast<unsigned char*>(arena) - offsetof(SharedArena, arena));
+}
+
+}  // namespace
+
+Arena* NewSharedArena(size_t start_block_size) {
+  ArenaOptions options;
+  options.start_block_size = std::max(options.start_block_size, start_block_size);
+  options.max_block_size = std::max(options.max_block_size, options.start_block_size);
+  auto shared = new SharedArena();
+  shared->refs.store(1, std::memory_order_relaxed);
+  return new (shared->arena) Arena(options);
+}
+
+void RefSharedArena(Arena* arena, int n) {
+  auto prev = ToShared(arena)->refs.fetch_add(n, std::memory_order_relaxed);
+  DCHECK_GT(prev, 0) << "Arena has already been freed";
+}
+
+void UnrefSharedArena(Arena* arena) {
+  auto shared = ToShared(arena);
+  auto prev = shared->refs.fetch_sub(1, std::memory_order_acq_rel);
+  DCHECK_GT(prev, 0) << "Arena has already been freed";
+  if (prev == 1) {
+    arena->~Arena();
+    delete shared;
+  }
+}
+
+}  // namespace slog
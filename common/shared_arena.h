@@ -0,0 +1,65 @@
+#pragma once
+
+#include <google/protobuf/arena.h>
+
+#include <memory>
+
+namespace slog {
+
+/**
+ * Batches that the log managers receive from other machines are deserialized into a protobuf arena so that
+ * a batch, its txns, and all of their nested messages and strings are bump-allocated in a few large blocks.
+ * Since the txns of a batch finish at different times, the arena is reference-counted: the batch and each
+ * of its txns hold a reference, and the arena is freed at once when the last of them is released.
+ *
+ * Every arena that messages in the system are allocated on must be created with NewSharedArena.
+ */
+
+/**
+ * Creates an arena with one reference. The first block of the arena has at least the given size
+ */
+google::protobuf::Arena* NewSharedArena(size_t start_block_size = 0);
+
+void RefSharedArena(google::protobuf::Arena* arena, int n = 1);
+
+void UnrefSharedArena(google::protobuf::Arena* arena);
+
+/**
+ * Frees a message that is either on the heap or on a shared arena
+ */
+template <typename T>
+void DeleteMessage(T* message) {
+  if (message == nullptr) {
+    return;
+  }
+  if (auto arena = message->GetArena(); arena != nullptr) {
+    UnrefSharedArena(arena);
+  } else {
+    delete message;
+  }
+}
+
+/**
+ * Adds a reference to the shared arena of a message, if it is on one, and returns the message. This is used
+ * when a message is taken out of its parent with unsafe_arena_release_*() so that it stays alive after the
+ * parent is freed. The message is then freed with DeleteMessage
+ */
+template <typename T>
+T* RetainArena(T* message) {
+  if (message != nullptr) {
+    if (auto arena = message->GetArena(); arena != nullptr) {
+      RefSharedArena(arena);
+    }
+  }
+  return message;
+}
+
+template <typename T>
+struct MessageDeleter {
+  MessageDeleter() = default;
+  // Allows taking over messages from std::unique_ptr with the default deleter
+  MessageDeleter(const std::default_delete<T>&) {}
+  void operator()(T* message) const { DeleteMessage(message); }
+};
+
+}  // namespace slog
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace slog {
+
+/**
+ * An unbounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ * The items are kept in a linked list of fixed-size ring segments. The producer only allocates a
+ * new segment once every kSegmentSize items and the consumer frees a segment once it has taken
+ * all items out of it, so neither side ever waits for the other.
+ */
+template <typename T, size_t kSegmentSize = 512>
+class SpscQueue {
+ public:
+  SpscQueue() : tail_segment_(new Segment()), head_segment_(tail_segment_), head_(0), cached_tail_(0) {}
+
+  ~SpscQueue() {
+    while (head_segment_ != nullptr) {
+      auto next = head_segment_->next.load(std::memory_order_relaxed);
+      delete head_segment_;
+      head_segment_ = next;
+    }
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  /**
+   * Must only be called by the producer
+   */
+  void Push(T&& item) {
+    auto segment = tail_segment_;
+    auto tail = segment->tail.load(std::memory_order_relaxed);
+    if (tail == kSegmentSize) {
+      auto new_segment = new Segment();
+      segment->next.store(new_segment, std::memory_order_release);
+      tail_segment_ = segment = new_segment;
+      tail = 0;
+    }
+    segment->items[tail] = std::move(item);
+    segment->tail.store(tail + 1, std::memory_order_release);
+  }
+
+  /**
+   * Must only be called by the consumer. Returns false if the queue is empty
+   */
+  bool Pop(T& item) {
+    if (!HasItem()) {
+      return false;
+    }
+    item = std::move(head_segment_->items[head_]);
+    head_++;
+    return true;
+  }
+
+  /**
+   * Must only be called by the consumer
+   */
+  bool empty() const { return !const_cast<SpscQueue*>(this)->HasItem(); }
+
+ private:
+  struct Segment {
+    std::array<T, kSegmentSize> items;
+    // Written by the producer. The producer and the consumer access different segments most of the
+    // time so this does not need its own cache line
+    std::atomic<size_t> tail = 0;
+    std::atomic<Segment*> next = nullptr;
+  };
+
+  // Moves to the next segment if the current one is used up
+  bool HasItem() {
+    if (head_ < cached_tail_) {
+      return true;
+    }
+    if (head_ == kSegmentSize) {
+      auto next = head_segment_->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        return false;
+      }
+      // The producer has moved on to the next segment so it no longer touches this one
+      delete head_segment_;
+      head_segment_ = next;
+      head_ = 0;
+    }
+    cached_tail_ = head_segment_->tail.load(std::memory_order_acquire);
+    return head_ < cached_tail_;
+  }
+
+  // Only accessed by the producer
+  alignas(64) Segment* tail_segment_;
+
+  // Only accessed by the consumer
+  alignas(64) Segment* head_segment_;
+  size_t head_;
+  // The last seen tail of the head segment, which saves reading the atomic tail on every pop
+  size_t cached_tail_;
+};
+
+}  // namespace slog
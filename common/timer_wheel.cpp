@@ -0,0 +1,180 @@
+#include "common/timer_wheel.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+using namespace std::chrono;
+
+namespace slog {
+
+namespace {
+
+// Rotates the bits to the right so that bit i becomes bit 0
+inline uint64_t RotateRight(uint64_t bits, uint32_t i) { return i == 0 ? bits : (bits >> i) | (bits << (64 - i)); }
+
+}  // namespace
+
+TimerWheel::TimerWheel(Clock::time_point start) : start_(start), now_tick_(0), next_handle_(0) {}
+
+TimerWheel::Handle TimerWheel::Add(Clock::time_point deadline, std::function<void()>&& cb) {
+  auto handle = next_handle_++;
+  auto& timer = timers_[handle];
+  timer.handle = handle;
+  timer.expiry = ToTick(deadline, true /* round_up */);
+  timer.cb = std::move(cb);
+  Place(timer);
+  return handle;
+}
+
+bool TimerWheel::Remove(Handle handle) {
+  auto it = timers_.find(handle);
+  if (it == timers_.end()) {
+    return false;
+  }
+  if (it->second.level < 0) {
+    // The handle may not be in the list if the timer is about to be run
+    if (auto due_it = std::find(due_.begin(), due_.end(), handle); due_it != due_.end()) {
+      due_.erase(due_it);
+    }
+  } else {
+    Unlink(it->second);
+  }
+  timers_.erase(it);
+  return true;
+}
+
+size_t TimerWheel::RunExpired(Clock::time_point now) {
+  Advance(ToTick(now, false /* round_up */));
+  if (due_.empty()) {
+    return 0;
+  }
+
+  std::vector<Handle> due;
+  due.swap(due_);
+  std::sort(due.begin(), due.end(), [this](Handle a, Handle b) {
+    return std::make_pair(timers_.at(a).expiry, a) < std::make_pair(timers_.at(b).expiry, b);
+  });
+
+  size_t num_run = 0;
+  for (auto handle : due) {
+    // A callback may have removed the ones after it
+    auto it = timers_.find(handle);
+    if (it == timers_.end()) {
+      continue;
+    }
+    auto cb = std::move(it->second.cb);
+    timers_.erase(it);
+    cb();
+    num_run++;
+  }
+  return num_run;
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::NextDeadline() const {
+  if (!due_.empty()) {
+    return start_ + microseconds(now_tick_);
+  }
+  if (auto tick = NextSlotTick(); tick.has_value()) {
+    return start_ + microseconds(tick.value());
+  }
+  return std::nullopt;
+}
+
+uint64_t TimerWheel::ToTick(Clock::time_point time, bool round_up) const {
+  if (time <= start_) {
+    return 0;
+  }
+  auto ns = duration_cast<nanoseconds>(time - start_).count();
+  return round_up ? (ns + 999) / 1000 : ns / 1000;
+}
+
+void TimerWheel::Place(Timer& timer) {
+  if (timer.expiry <= now_tick_) {
+    timer.level = -1;
+    due_.push_back(timer.handle);
+    return;
+  }
+
+  // A timer too far away is parked in the top level and placed again when its slot comes
+  auto expiry = std::min(timer.expiry, now_tick_ + kMaxSpan - 1);
+  auto delta = expiry - now_tick_;
+  int level = 0;
+  while (level < kNumLevels - 1 && delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) {
+    level++;
+  }
+  auto slot = (expiry >> (kSlotBits * level)) & (kNumSlots - 1);
+
+  auto& head = levels_[level].slots[slot];
+  timer.level = level;
+  timer.slot = slot;
+  timer.prev = nullptr;
+  timer.next = head;
+  if (head != nullptr) {
+    head->prev = &timer;
+  }
+  head = &timer;
+  levels_[level].occupied |= uint64_t(1) << slot;
+}
+
+void TimerWheel::Unlink(Timer& timer) {
+  auto& level = levels_[timer.level];
+  if (timer.prev != nullptr) {
+    timer.prev->next = timer.next;
+  } else {
+    level.slots[timer.slot] = timer.next;
+  }
+  if (timer.next != nullptr) {
+    timer.next->prev = timer.prev;
+  }
+  if (level.slots[timer.slot] == nullptr) {
+    level.occupied &= ~(uint64_t(1) << timer.slot);
+  }
+  timer.prev = timer.next = nullptr;
+}
+
+std::optional<uint64_t> TimerWheel::NextSlotTick() const {
+  std::optional<uint64_t> next;
+  for (int l = 0; l < kNumLevels; l++) {
+    if (levels_[l].occupied == 0) {
+      continue;
+    }
+    // Every non-empty slot is between one slot and one full rotation ahead of the current tick, so the slot
+    // of the current tick comes last
+    auto shift = kSlotBits * l;
+    auto pos = (now_tick_ >> shift) & (kNumSlots - 1);
+    auto rotated = RotateRight(levels_[l].occupied, (pos + 1) & (kNumSlots - 1));
+    auto distance = __builtin_ctzll(rotated) + 1;
+    auto tick = ((now_tick_ >> shift) + distance) << shift;
+    if (!next.has_value() || tick < next.value()) {
+      next = tick;
+    }
+  }
+  return next;
+}
+
+void TimerWheel::Advance(uint64_t tick) {
+  for (auto next = NextSlotTick(); next.has_value() && next.value() <= tick; next = NextSlotTick()) {
+    now_tick_ = next.value();
+    // Empty the slots that start at the current tick. Their timers are either due or moved down to a slot
+    // that starts later
+    for (int l = 0; l < kNumLevels; l++) {
+      auto shift = kSlotBits * l;
+      if (now_tick_ & ((uint64_t(1) << shift) - 1)) {
+        break;
+      }
+      auto slot = (now_tick_ >> shift) & (kNumSlots - 1);
+      auto timer = levels_[l].slots[slot];
+      levels_[l].slots[slot] = nullptr;
+      levels_[l].occupied &= ~(uint64_t(1) << slot);
+      while (timer != nullptr) {
+        auto next_timer = timer->next;
+        Place(*timer);
+        timer = next_timer;
+      }
+    }
+  }
+  now_tick_ = std::max(now_tick_, tick);
+}
+
+}  // namespace slog
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace slog {
+
+/**
+ * A hierarchical timing wheel of callbacks with microsecond ticks. Each level has 64 slots and each slot
+ * of a level spans all slots of the level below it. A callback is kept on the lowest level whose span covers
+ * its deadline and moves down one level at a time as the time of its slot comes, so adding, removing, and
+ * firing a callback take constant time no matter how many callbacks are pending.
+ *
+ * Callbacks never fire before their deadlines. Those with the same tick fire in the order they were added.
+ */
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Handle = uint64_t;
+
+  TimerWheel(Clock::time_point start = Clock::now());
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  Handle Add(Clock::time_point deadline, std::function<void()>&& cb);
+
+  // Returns false if the callback has already fired or been removed
+  bool Remove(Handle handle);
+
+  /**
+   * Runs the callbacks whose deadlines are not after the given time. Callbacks added while running are left for
+   * the next call. Returns the number of callbacks run
+   */
+  size_t RunExpired(Clock::time_point now);
+
+  /**
+   * Returns a time at which the wheel should be checked again. It is never after the earliest deadline but
+   * may be before it if the earliest callback is still on an upper level
+   */
+  std::optional<Clock::time_point> NextDeadline() const;
+
+  bool empty() const { return timers_.empty(); }
+  size_t size() const { return timers_.size(); }
+
+ private:
+  static constexpr int kSlotBits = 6;
+  static constexpr uint64_t kNumSlots = 1 << kSlotBits;
+  static constexpr int kNumLevels = 7;
+  // Number of ticks covered by the wheel (~50 days)
+  static constexpr uint64_t kMaxSpan = uint64_t(1) << (kSlotBits * kNumLevels);
+
+  struct Timer {
+    Handle handle;
+    uint64_t expiry;
+    std::function<void()> cb;
+    // Position in the wheel. A level of -1 means that the timer is due
+    int level = -1;
+    uint32_t slot = 0;
+    Timer* prev = nullptr;
+    Timer* next = nullptr;
+  };
+
+  struct Level {
+    Timer* slots[kNumSlots] = {};
+    // Bit i is set if slot i is not empty
+    uint64_t occupied = 0;
+  };
+
+  uint64_t ToTick(Clock::time_point time, bool round_up) const;
+  void Place(Timer& timer);
+  void Unlink(Timer& timer);
+  // Returns the first tick after the current one at which a non-empty slot is reached
+  std::optional<uint64_t> NextSlotTick() const;
+  // Moves the current tick forward, moving down or marking as due the timers of the slots passed along the way
+  void Advance(uint64_t tick);
+
+  const Clock::time_point start_;
+  uint64_t now_tick_;
+  Handle next_handle_;
+  std::unordered_map<Handle, Timer> timers_;
+  Level levels_[kNumLevels];
+  std::vector<Handle> due_;
+};
+
+}  // namespace slog
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstring>
+#include <limits>
 #include <string>
+#include <utility>
 
 #include "proto/transaction.pb.h"
 
@@ -47,6 +50,14 @@ inline std::tuple<RegionId, ReplicaId, PartitionId> UnpackMachineId(MachineId id
 #define TXN_ID_STR(id) \
   (std::to_string((id) >> kMachineIdBits) + "/" + MACHINE_ID_STR((id) & ((1LL << kMachineIdBits) - 1)))
 
+/**
+ * Returns the worker that executes a txn. Every partition dispatches the same txn to the same worker so
+ * that the partitions can send their reads of the txn directly to that worker
+ */
+inline uint32_t WorkerOfTxn(TxnId txn_id, uint32_t num_workers) {
+  return (TXN_ID_GET_COUNTER(txn_id) + TXN_ID_GET_MACHINE_ID(txn_id)) % num_workers;
+}
+
 struct Metadata {
   Metadata() = default;
   Metadata(const MasterMetadata& metadata) : master(metadata.master()), counter(metadata.counter()) {}
@@ -68,11 +79,21 @@ struct Record {
     SetMetadata(other.metadata_);
   }
 
+  Record(Record&& other) noexcept
+      : metadata_(other.metadata_), data_(std::move(other.data_)), size_(std::exchange(other.size_, 0)) {}
+
   Record& operator=(const Record& other) {
-    Record tmp(other);
-    data_.swap(tmp.data_);
-    std::swap(size_, tmp.size_);
-    std::swap(metadata_, tmp.metadata_);
+    if (this != &other) {
+      SetValue(other.data_.get(), other.size_);
+      SetMetadata(other.metadata_);
+    }
+    return *this;
+  }
+
+  Record& operator=(Record&& other) noexcept {
+    metadata_ = other.metadata_;
+    data_ = std::move(other.data_);
+    size_ = std::exchange(other.size_, 0);
     return *this;
   }
 
@@ -80,9 +101,14 @@ struct Record {
 
   void SetValue(const std::string& v) { SetValue(v.data(), v.size()); }
 
+  /**
+   * The current buffer is reused if it has the same size as the new value
+   */
   void SetValue(const char* data, size_t size) {
-    size_ = size;
-    data_.reset(new char[size_]);
+    if (data_ == nullptr || size != size_) {
+      size_ = size;
+      data_.reset(new char[size_]);
+    }
     memcpy(data_.get(), data, size_);
   }
 
@@ -97,7 +123,8 @@ struct Record {
 
   const Metadata& metadata() const { return metadata_; }
   char* data() { return data_.get(); }
-  size_t size() { return size_; }
+  const char* data() const { return data_.get(); }
+  size_t size() const { return size_; }
 
  private:
   Metadata metadata_;
@@ -108,6 +135,46 @@ struct Record {
 enum class LockMode { UNLOCKED, READ, WRITE };
 enum class AcquireLocksResult { ACQUIRED, WAITING, ABORT };
 
+/**
+ * Parses a key that is the canonical decimal representation of a 64-bit unsigned integer, i.e. without
+ * a sign or leading zeros. Returns false for any other key so that different keys never parse to the
+ * same integer.
+ */
+inline bool ParseIntKey(const Key& key, uint64_t& id) {
+  if (key.empty() || key.size() > std::numeric_limits<uint64_t>::digits10 + 1 || (key[0] == '0' && key.size() > 1)) {
+    return false;
+  }
+  uint64_t res = 0;
+  for (auto c : key) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    uint64_t digit = c - '0';
+    if (res > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+      return false;
+    }
+    res = res * 10 + digit;
+  }
+  id = res;
+  return true;
+}
+
+/**
+ * Mixes the bits of an integer key. The identity hash of std::hash would put keys that are strided by the
+ * number of partitions into only a fraction of the segments or buckets of a hash map
+ */
+struct IntKeyHash {
+  size_t operator()(uint64_t id) const {
+    // Finalizer of MurmurHash3
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdULL;
+    id ^= id >> 33;
+    id *= 0xc4ceb9fe1a85ec53ULL;
+    id ^= id >> 33;
+    return id;
+  }
+};
+
 inline KeyRegion MakeKeyRegion(const Key& key, uint32_t master) {
   std::string new_key;
   auto master_str = std::to_string(master);
@@ -5,6 +5,9 @@
 #include "common/constants.h"
 #include "common/proto_utils.h"
 #include "common/thread_utils.h"
+#include "connection/inproc_queue.h"
+#include "connection/poller.h"
+#include "connection/shm_transport.h"
 #include "connection/zmq_utils.h"
 #include "proto/internal.pb.h"
 
@@ -24,24 +27,22 @@ namespace {
 
 class BrokerThread : public Module {
  public:
-  BrokerThread(const shared_ptr<zmq::context_t>& context, const string& internal_endpoint,
-               const string& external_endpoint, const vector<Broker::ChannelOption>& channels,
-               std::chrono::milliseconds poll_timeout_ms, int rcvbuf)
+  BrokerThread(const shared_ptr<zmq::context_t>& context, Channel internal_channel, const string& external_endpoint,
+               const vector<Broker::ChannelOption>& channels, std::chrono::milliseconds poll_timeout_ms, int rcvbuf,
+               bool use_shm, const internal::PollingOptions& polling)
       : external_socket_(*context, ZMQ_PULL),
-        internal_socket_(*context, ZMQ_PULL),
-        internal_endpoint_(internal_endpoint),
+        internal_channel_(GetInprocChannel(*context, internal_channel)),
         external_endpoint_(external_endpoint),
-        poll_timeout_ms_(poll_timeout_ms),
-        recv_retries_(0) {
+        poller_(poll_timeout_ms, polling) {
     external_socket_.set(zmq::sockopt::rcvhwm, 0);
     external_socket_.set(zmq::sockopt::rcvbuf, rcvbuf);
+    if (use_shm) {
+      shm_receiver_ = std::make_unique<ShmReceiver>(external_socket_);
+    }
 
     for (const auto& c : channels) {
       DCHECK(channels_.find(c.channel) == channels_.end()) << "Duplicate channel: " << c.channel;
-      zmq::socket_t new_channel(*context, ZMQ_PUSH);
-      new_channel.set(zmq::sockopt::sndhwm, 0);
-      new_channel.connect(MakeInProcChannelAddress(c.channel));
-      channels_.try_emplace(c.channel, move(new_channel), c.is_raw);
+      channels_.try_emplace(c.channel, GetInprocChannel(*context, c.channel), c.is_raw);
       for (const auto& t : c.initial_tags) {
         redirect_[t].to = c.channel;
       }
@@ -54,56 +55,54 @@ class BrokerThread : public Module {
     LOG(INFO) << "Binding a broker thread to \"" << external_endpoint_ << "\"";
 
     external_socket_.bind(external_endpoint_);
-    internal_socket_.bind(internal_endpoint_);
 
-    poll_items_ = {{static_cast<void*>(external_socket_), 0, ZMQ_POLLIN, 0},
-                   {static_cast<void*>(internal_socket_), 0, ZMQ_POLLIN, 0}};
+    if (shm_receiver_ != nullptr) {
+      poller_.PushShmReceiver(*shm_receiver_);
+    } else {
+      poller_.PushSocket(external_socket_);
+    }
+    poller_.PushQueue(*internal_channel_);
   }
 
   bool Loop() final {
-    if (recv_retries_ <= 0 && !zmq::poll(poll_items_, poll_timeout_ms_)) {
+    if (!poller_.NextRound()) {
+      poller_.FinishRound(false /* did_work */);
       return false;
     }
 
-    if (zmq::message_t msg; external_socket_.recv(msg, zmq::recv_flags::dontwait)) {
-      recv_retries_ = kRecvRetries;
-      HandleIncomingMessage(move(msg));
+    bool did_work = false;
+    zmq::message_t msg, body;
+    if (shm_receiver_ != nullptr ? shm_receiver_->Recv(msg)
+                                 : RecvAddressedBuffer(external_socket_, msg, body, true /* dont_wait */)) {
+      did_work = true;
+      HandleIncomingMessage(move(msg), move(body));
     }
 
-    if (auto env = RecvEnvelope(internal_socket_, true /* dont_wait */); env != nullptr) {
-      recv_retries_ = kRecvRetries;
-
-      if (!env->has_request() || !env->request().has_broker_redirect()) {
-        return false;
-      }
-      auto tag = env->request().broker_redirect().tag();
-      if (env->request().broker_redirect().stop()) {
-        redirect_.erase(tag);
-        return false;
-      }
-      auto channel = env->request().broker_redirect().channel();
-      auto chan_it = channels_.find(channel);
-      if (chan_it == channels_.end()) {
-        LOG(ERROR) << "Invalid channel to redirect to: \"" << channel << "\".";
-        return false;
+    if (auto env = RecvEnvelope(*internal_channel_, true /* dont_wait */); env != nullptr) {
+      did_work = true;
+      if (env->has_request() && env->request().has_broker_redirect()) {
+        HandleRedirect(env->request().broker_redirect());
       }
-      auto& entry = redirect_[tag];
-      entry.to = channel;
-      for (auto& msg : entry.pending_msgs) {
-        ForwardMessage(chan_it->second.socket, chan_it->second.send_raw, move(msg));
-      }
-      entry.pending_msgs.clear();
     }
 
-    if (recv_retries_ > 0) {
-      --recv_retries_;
-    }
+    poller_.FinishRound(did_work);
 
     return false;
   }
 
  private:
-  void HandleIncomingMessage(zmq::message_t&& msg) {
+  void HandleIncomingMessage(zmq::message_t&& msg, zmq::message_t&& body) {
+    if (IsCoalescedMessage(msg)) {
+      vector<zmq::message_t> messages;
+      if (!SplitCoalescedMessage(msg, messages)) {
+        LOG(ERROR) << "Malformed coalesced message";
+      }
+      for (auto& m : messages) {
+        HandleIncomingMessage(move(m), zmq::message_t());
+      }
+      return;
+    }
+
     Channel tag_or_chan_id;
     if (!ParseChannel(tag_or_chan_id, msg)) {
       LOG(ERROR) << "Message without channel info";
@@ -117,7 +116,7 @@ class BrokerThread : public Module {
       auto& entry = redirect_[tag_or_chan_id];
       // Buffer the message if the redirection is not established yet
       if (!entry.to.has_value()) {
-        entry.pending_msgs.push_back(move(msg));
+        entry.pending_msgs.emplace_back(move(msg), move(body));
         return;
       }
       chan_id = entry.to.value();
@@ -128,18 +127,42 @@ class BrokerThread : public Module {
       LOG(ERROR) << "Unknown channel: \"" << chan_id << "\". Dropping message";
       return;
     }
-    ForwardMessage(chan_it->second.socket, chan_it->second.send_raw, move(msg));
+    ForwardMessage(chan_it->second.producer, chan_it->second.send_raw, move(msg), move(body));
+  }
+
+  void HandleRedirect(const internal::BrokerRedirect& redirect) {
+    auto tag = redirect.tag();
+    if (redirect.stop()) {
+      redirect_.erase(tag);
+      return;
+    }
+    auto channel = redirect.channel();
+    auto chan_it = channels_.find(channel);
+    if (chan_it == channels_.end()) {
+      LOG(ERROR) << "Invalid channel to redirect to: \"" << channel << "\".";
+      return;
+    }
+    auto& entry = redirect_[tag];
+    entry.to = channel;
+    for (auto& [msg, body] : entry.pending_msgs) {
+      ForwardMessage(chan_it->second.producer, chan_it->second.send_raw, move(msg), move(body));
+    }
+    entry.pending_msgs.clear();
   }
 
-  void ForwardMessage(zmq::socket_t& socket, bool send_raw, zmq::message_t&& msg) {
+  void ForwardMessage(InprocChannel::Producer& producer, bool send_raw, zmq::message_t&& msg, zmq::message_t&& body) {
     MachineId machine_id = -1;
     ParseMachineId(machine_id, msg);
 
     auto env = std::make_unique<Envelope>();
     if (send_raw) {
-      env->set_raw(msg.to_string());
+      // Join the frames so that the raw message can be deserialized as a single buffer later
+      auto raw = env->mutable_raw();
+      raw->reserve(msg.size() + body.size());
+      raw->append(msg.data<char>(), msg.size());
+      raw->append(body.data<char>(), body.size());
     } else {
-      if (!DeserializeProto(*env, msg)) {
+      if (!DeserializeProto(*env, msg, body)) {
         LOG(ERROR) << "Malformed message";
         return;
       }
@@ -147,27 +170,27 @@ class BrokerThread : public Module {
 
     // This must be set AFTER deserializing otherwise it will be overwritten by the deserialization function
     env->set_from(machine_id);
-    SendEnvelope(socket, move(env));
+    SendEnvelope(producer, move(env));
   }
 
   zmq::socket_t external_socket_;
-  zmq::socket_t internal_socket_;
-  const string internal_endpoint_;
+  // Receives through the external socket if the protocol is "shm"
+  std::unique_ptr<ShmReceiver> shm_receiver_;
+  shared_ptr<InprocChannel> internal_channel_;
   const string external_endpoint_;
-  std::chrono::milliseconds poll_timeout_ms_;
-  vector<zmq::pollitem_t> poll_items_;
-  int recv_retries_;
+  Poller poller_;
 
   struct ChannelEntry {
-    ChannelEntry(zmq::socket_t&& socket, bool send_raw) : socket(std::move(socket)), send_raw(send_raw) {}
-    zmq::socket_t socket;
+    ChannelEntry(const shared_ptr<InprocChannel>& channel, bool send_raw) : producer(channel), send_raw(send_raw) {}
+    InprocChannel::Producer producer;
     const bool send_raw;
   };
   unordered_map<Channel, ChannelEntry> channels_;
 
   struct RedirectEntry {
     std::optional<Channel> to;
-    vector<zmq::message_t> pending_msgs;
+    // Pairs of the first frame and the separate proto frame of the messages
+    vector<pair<zmq::message_t, zmq::message_t>> pending_msgs;
   };
   unordered_map<uint64_t, RedirectEntry> redirect_;
 };
@@ -197,12 +220,13 @@ void Broker::StartInNewThreads() {
 
   auto cpus = config_->cpu_pinnings(ModuleId::BROKER);
   for (size_t i = 0; i < config_->broker_ports_size(); i++) {
-    auto internal_endpoint = MakeInProcChannelAddress(MakeChannel(i));
     auto external_endpoint =
         MakeRemoteAddress(config_->protocol(), config_->local_address(), config_->broker_ports(i), true /* binding */);
 
-    auto& t = threads_.emplace_back(MakeRunnerFor<BrokerThread>(context_, internal_endpoint, external_endpoint,
-                                                                channels_, poll_timeout_ms_, config_->broker_rcvbuf()));
+    auto& t = threads_.emplace_back(MakeRunnerFor<BrokerThread>(context_, MakeChannel(i), external_endpoint, channels_,
+                                                                poll_timeout_ms_, config_->broker_rcvbuf(),
+                                                                config_->protocol() == "shm",
+                                                                config_->polling_options(ModuleId::BROKER)));
 
     std::optional<uint32_t> cpu = {};
     if (i < cpus.size()) {
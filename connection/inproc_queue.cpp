@@ -0,0 +1,71 @@
+#include "connection/inproc_queue.h"
+
+#include <glog/logging.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <map>
+#include <mutex>
+
+namespace slog {
+
+PollableQueue::PollableQueue() : sleeping_(false) {
+  fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  CHECK_GE(fd_, 0) << "Cannot create eventfd: " << strerror(errno);
+}
+
+PollableQueue::~PollableQueue() { close(fd_); }
+
+bool PollableQueue::PrepareToSleep() {
+  sleeping_.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return empty();
+}
+
+void PollableQueue::FinishSleep(bool notified) {
+  sleeping_.store(false, std::memory_order_relaxed);
+  if (notified) {
+    uint64_t count;
+    (void)!read(fd_, &count, sizeof(count));
+  }
+}
+
+void PollableQueue::Wait(std::optional<std::chrono::milliseconds> timeout) {
+  if (!PrepareToSleep()) {
+    FinishSleep(false);
+    return;
+  }
+  pollfd item{fd_, POLLIN, 0};
+  int rc = poll(&item, 1, timeout.has_value() ? timeout->count() : -1);
+  FinishSleep(rc > 0);
+}
+
+void PollableQueue::WakeUp() {
+  uint64_t one = 1;
+  (void)!write(fd_, &one, sizeof(one));
+}
+
+std::shared_ptr<InprocChannel> GetInprocChannel(const zmq::context_t& context, Channel channel) {
+  static std::mutex mut;
+  static std::map<std::pair<const zmq::context_t*, Channel>, std::weak_ptr<InprocChannel>> channels;
+
+  std::lock_guard<std::mutex> guard(mut);
+  // Drop the channels that nobody uses anymore, e.g. those of contexts that are gone
+  for (auto it = channels.begin(); it != channels.end();) {
+    if (it->second.expired()) {
+      it = channels.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  auto& entry = channels[{&context, channel}];
+  auto res = entry.lock();
+  if (res == nullptr) {
+    res = std::make_shared<InprocChannel>();
+    entry = res;
+  }
+  return res;
+}
+
+}  // namespace slog
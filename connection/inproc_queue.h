@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <zmq.hpp>
+
+#include "common/mpsc_queue.h"
+#include "common/types.h"
+#include "connection/zmq_utils.h"
+
+namespace slog {
+
+/**
+ * Base of the queues that a Poller can sleep on. The consumer spins on the queue while it is busy and only
+ * announces that it is going to sleep before blocking in the poller. Producers only pay for a wake-up
+ * through an eventfd when the consumer is asleep.
+ */
+class PollableQueue {
+ public:
+  PollableQueue();
+  virtual ~PollableQueue();
+
+  PollableQueue(const PollableQueue&) = delete;
+  PollableQueue& operator=(const PollableQueue&) = delete;
+
+  int fd() const { return fd_; }
+
+  /**
+   * Called by the consumer before sleeping on the fd. Returns false if the queue is not empty, in which
+   * case the consumer must not sleep
+   */
+  bool PrepareToSleep();
+
+  /**
+   * Called by the consumer after sleeping on the fd
+   * @param notified Whether the fd was readable
+   */
+  void FinishSleep(bool notified);
+
+  /**
+   * Blocks the consumer until the queue is not empty or the timeout has passed
+   */
+  void Wait(std::optional<std::chrono::milliseconds> timeout = {});
+
+ protected:
+  virtual bool empty() const = 0;
+
+  // Called by the producers after adding an item
+  void Notify() {
+    // Pairs with the fence in PrepareToSleep so that either the consumer sees the new item or this sees
+    // that the consumer is sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+      WakeUp();
+    }
+  }
+
+ private:
+  void WakeUp();
+
+  int fd_;
+  std::atomic<bool> sleeping_;
+};
+
+/**
+ * A lock-free queue among modules in the same process. Each producer must get its own Producer
+ */
+template <typename T>
+class InprocQueue : public PollableQueue {
+ public:
+  class Producer {
+   public:
+    explicit Producer(const std::shared_ptr<InprocQueue>& queue) : queue_(queue), lane_(queue->queue_.NewLane()) {}
+
+    // Gives the lane back to the queue so that it can be reused by another producer
+    ~Producer() {
+      if (lane_ != nullptr) {
+        queue_->queue_.ReleaseLane(lane_);
+      }
+    }
+
+    Producer(const Producer&) = delete;
+    Producer& operator=(const Producer&) = delete;
+
+    Producer(Producer&& other) noexcept
+        : queue_(std::move(other.queue_)), lane_(std::exchange(other.lane_, nullptr)) {}
+
+    Producer& operator=(Producer&& other) noexcept {
+      if (this != &other) {
+        if (lane_ != nullptr) {
+          queue_->queue_.ReleaseLane(lane_);
+        }
+        queue_ = std::move(other.queue_);
+        lane_ = std::exchange(other.lane_, nullptr);
+      }
+      return *this;
+    }
+
+    void Push(T&& item) {
+      lane_->Push(std::move(item));
+      queue_->Notify();
+    }
+
+   private:
+    std::shared_ptr<InprocQueue> queue_;
+    typename MpscQueue<T>::Lane* lane_;
+  };
+
+  /**
+   * Must only be called by the consumer. Returns false if the queue is empty
+   */
+  bool Pop(T& item) { return queue_.Pop(item); }
+
+ protected:
+  bool empty() const final { return queue_.empty(); }
+
+ private:
+  MpscQueue<T> queue_;
+};
+
+/**
+ * The in-process counterpart of a channel, which carries envelopes from the senders and the brokers
+ * to the module listening on the channel
+ */
+using InprocChannel = InprocQueue<EnvelopePtr>;
+
+/**
+ * Returns the in-process channel of the given id among the modules sharing the given context. The channel
+ * is created if it does not exist and lives for as long as one of its users holds it
+ */
+std::shared_ptr<InprocChannel> GetInprocChannel(const zmq::context_t& context, Channel channel);
+
+inline void SendEnvelope(InprocChannel::Producer& producer, EnvelopePtr&& envelope) {
+  producer.Push(std::move(envelope));
+}
+
+inline EnvelopePtr RecvEnvelope(InprocChannel& channel, bool dont_wait = false) {
+  EnvelopePtr env;
+  while (!channel.Pop(env) && !dont_wait) {
+    channel.Wait();
+  }
+  return env;
+}
+
+}  // namespace slog
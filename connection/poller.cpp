@@ -1,5 +1,13 @@
 #include "connection/poller.h"
 
+#include <glog/logging.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "common/metrics.h"
+
 using namespace std::chrono;
 
 using std::optional;
@@ -7,7 +15,21 @@ using std::vector;
 
 namespace slog {
 
-Poller::Poller(optional<microseconds> timeout) : poll_timeout_(timeout), timed_callback_counter_(0) {}
+Poller::Poller(optional<microseconds> timeout, const internal::PollingOptions& polling)
+    : poll_timeout_(timeout),
+      timer_fd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      polling_policy_(polling),
+      num_spins_(0),
+      num_sleeps_(0),
+      sleep_time_(0),
+      work_time_(0),
+      round_start_(steady_clock::now()),
+      round_sleep_time_(0),
+      last_stats_flush_(round_start_) {
+  CHECK_GE(timer_fd_, 0) << "Cannot create timerfd: " << strerror(errno);
+}
+
+Poller::~Poller() { close(timer_fd_); }
 
 void Poller::PushSocket(zmq::socket_t& socket) {
   poll_items_.push_back({
@@ -16,60 +38,144 @@ void Poller::PushSocket(zmq::socket_t& socket) {
   });
 }
 
+void Poller::PushQueue(PollableQueue& queue) {
+  queues_.emplace_back(&queue, poll_items_.size());
+  poll_items_.push_back({
+      nullptr, queue.fd(), /* fd */
+      ZMQ_POLLIN, 0        /* revent */
+  });
+}
+
+void Poller::PushShmReceiver(ShmReceiver& receiver) {
+  shm_receivers_.push_back(&receiver);
+  PushSocket(receiver.socket());
+}
+
 bool Poller::NextEvent(bool dont_wait) {
   auto may_have_msg = true;
-  if (!dont_wait) {
+  if (dont_wait) {
+    num_spins_++;
+  } else {
     // Compute the time that we need to wait until the next event
     auto shortest_timeout = poll_timeout_;
     auto now = steady_clock::now();
-    if (!timed_callbacks_.empty()) {
-      const auto& next_ev_time = timed_callbacks_.begin()->first.first;
-      if (next_ev_time <= now) {
+    if (auto next_ev_time = timed_callbacks_.NextDeadline(); next_ev_time.has_value()) {
+      if (next_ev_time.value() <= now) {
         shortest_timeout = 0us;
-      } else if (!shortest_timeout.has_value() || next_ev_time - now < shortest_timeout.value()) {
-        shortest_timeout = duration_cast<microseconds>(next_ev_time - now);
+      } else {
+        // Round up so that the poller does not wake up right before the event is due
+        auto until_next_ev = ceil<microseconds>(next_ev_time.value() - now);
+        if (!shortest_timeout.has_value() || until_next_ev < shortest_timeout.value()) {
+          shortest_timeout = until_next_ev;
+        }
       }
     }
 
+    // Do not sleep if a queue or a ring received something after it was last checked
+    bool queue_has_msg = false;
+    for (auto [queue, _] : queues_) {
+      queue_has_msg |= !queue->PrepareToSleep();
+    }
+    for (auto receiver : shm_receivers_) {
+      queue_has_msg |= !receiver->PrepareToSleep();
+    }
+    if (queue_has_msg) {
+      shortest_timeout = 0us;
+    }
+
     int rc = 0;
-    // Wait until the next time event or some timeout.
-    if (shortest_timeout.has_value()) {
-      // By casting the timeout from microseconds to milliseconds, if it is below 1ms,
-      // the casting result will be 0 and thus poll becomes non-blocking. This is intended
-      // so that we spin wait instead of sleeping, making waiting more accurate.
+    if (!shortest_timeout.has_value()) {
+      // No timed event to wait, wait until there is a new message
+      rc = zmq::poll(poll_items_, -1);
+    } else if (shortest_timeout.value() % 1ms == 0us) {
       rc = zmq::poll(poll_items_, duration_cast<milliseconds>(shortest_timeout.value()));
     } else {
-      // No timed event to wait, wait until there is a new message
+      // Arming the timer also clears any expiration left over from an earlier wait
+      itimerspec spec{};
+      spec.it_value.tv_sec = shortest_timeout.value() / 1s;
+      spec.it_value.tv_nsec = (shortest_timeout.value() % 1s) / 1ns;
+      timerfd_settime(timer_fd_, 0, &spec, nullptr);
+      poll_items_.push_back({nullptr, timer_fd_, ZMQ_POLLIN, 0});
       rc = zmq::poll(poll_items_, -1);
+      if (poll_items_.back().revents & ZMQ_POLLIN) {
+        rc--;
+      }
+      poll_items_.pop_back();
     }
-    may_have_msg = rc > 0;
+    may_have_msg = rc > 0 || queue_has_msg;
+
+    for (auto [queue, i] : queues_) {
+      queue->FinishSleep(poll_items_[i].revents & ZMQ_POLLIN);
+    }
+    for (auto receiver : shm_receivers_) {
+      receiver->FinishSleep();
+    }
+
+    auto wake_up_time = steady_clock::now();
+    if (shortest_timeout == 0us) {
+      num_spins_++;
+    } else {
+      num_sleeps_++;
+      sleep_time_ += wake_up_time - now;
+      round_sleep_time_ += wake_up_time - now;
+    }
+    MaybeFlushStats(wake_up_time);
   }
 
   // Process and clean up triggered callbacks
   if (!timed_callbacks_.empty()) {
-    auto now = steady_clock::now();
-    auto it = timed_callbacks_.begin();
-    for (; it != timed_callbacks_.end(); it++) {
-      if (it->first.first > now) {
-        break;
-      }
-      it->second();
-    }
-    timed_callbacks_.erase(timed_callbacks_.begin(), it);
+    timed_callbacks_.RunExpired(steady_clock::now());
   }
 
   return may_have_msg;
 }
 
+bool Poller::NextRound() {
+  switch (polling_policy_.NextWait()) {
+    case PollingPolicy::Wait::SPIN:
+      return NextEvent(true /* dont_wait */);
+    case PollingPolicy::Wait::YIELD:
+      std::this_thread::yield();
+      return NextEvent(true /* dont_wait */);
+    case PollingPolicy::Wait::BLOCK:
+      break;
+  }
+  return NextEvent(false /* dont_wait */);
+}
+
+void Poller::FinishRound(bool did_work) {
+  auto now = steady_clock::now();
+  if (did_work) {
+    work_time_ += now - round_start_ - round_sleep_time_;
+  }
+  round_start_ = now;
+  round_sleep_time_ = steady_clock::duration(0);
+  polling_policy_.FinishRound(now, did_work);
+  MaybeFlushStats(now);
+}
+
 bool Poller::is_socket_ready(size_t i) const { return poll_items_[i].revents & ZMQ_POLLIN; }
 
 Poller::Handle Poller::AddTimedCallback(microseconds timeout, std::function<void()>&& cb) {
-  auto id = Handle(steady_clock::now() + timeout, timed_callback_counter_);
-  timed_callbacks_.emplace(id, move(cb));
-  timed_callback_counter_++;
-  return id;
+  return timed_callbacks_.Add(steady_clock::now() + timeout, std::move(cb));
 }
 
-void Poller::RemoveTimedCallback(const Poller::Handle& id) { timed_callbacks_.erase(id); }
+void Poller::RemoveTimedCallback(const Poller::Handle& id) { timed_callbacks_.Remove(id); }
+
+void Poller::MaybeFlushStats(steady_clock::time_point now) {
+  if (now - last_stats_flush_ < 1s) {
+    return;
+  }
+  if (per_thread_metrics_repo != nullptr) {
+    per_thread_metrics_repo->RecordPoller(num_spins_, num_sleeps_, duration_cast<microseconds>(sleep_time_).count(),
+                                          duration_cast<microseconds>(work_time_).count(),
+                                          duration_cast<microseconds>(now - last_stats_flush_).count());
+  }
+  num_spins_ = 0;
+  num_sleeps_ = 0;
+  sleep_time_ = steady_clock::duration(0);
+  work_time_ = steady_clock::duration(0);
+  last_stats_flush_ = now;
+}
 
 }  // namespace slog
\ No newline at end of file
@@ -1,36 +1,78 @@
 #pragma once
 
 #include <functional>
-#include <list>
-#include <map>
 #include <optional>
 #include <vector>
 #include <zmq.hpp>
 
+#include "common/timer_wheel.h"
+#include "connection/inproc_queue.h"
+#include "connection/polling_policy.h"
+#include "connection/shm_transport.h"
+
 namespace slog {
 
+/**
+ * Waits on sockets, in-process queues, and shared-memory rings, and runs timed callbacks. A wait whose timeout is
+ * not a whole number of milliseconds, which zmq::poll cannot express, sleeps on a timerfd polled along with
+ * the sockets so that sub-millisecond timeouts do not turn into busy spins.
+ */
 class Poller {
  public:
-  using Handle = std::pair<std::chrono::steady_clock::time_point, int>;
+  using Handle = TimerWheel::Handle;
+
+  Poller(std::optional<std::chrono::microseconds> timeout, const internal::PollingOptions& polling = {});
+  ~Poller();
 
-  Poller(std::optional<std::chrono::microseconds> timeout);
+  Poller(const Poller&) = delete;
+  Poller& operator=(const Poller&) = delete;
 
   // Returns true if it is possible that there is a message in one of the sockets
   // If dont_wait is set to true, this always return true
   bool NextEvent(bool dont_wait = false);
 
+  // Waits at the start of a round of a module loop by spinning, yielding, or blocking as the polling policy
+  // decides. Returns what NextEvent returns
+  bool NextRound();
+
+  // Ends a round of a module loop. did_work tells whether the round handled anything
+  void FinishRound(bool did_work);
+
   void PushSocket(zmq::socket_t& socket);
 
+  // Polls an in-process queue. Its position among the sockets is counted by is_socket_ready
+  void PushQueue(PollableQueue& queue);
+
+  // Polls the socket of a receiver of shared-memory rings. Its position is counted by is_socket_ready
+  void PushShmReceiver(ShmReceiver& receiver);
+
   bool is_socket_ready(size_t i) const;
 
   Handle AddTimedCallback(std::chrono::microseconds timeout, std::function<void()>&& cb);
   void RemoveTimedCallback(const Handle& id);
 
  private:
+  // Adds the spin, sleep, and work counts to the metrics of the current thread about once per second
+  void MaybeFlushStats(std::chrono::steady_clock::time_point now);
+
   std::optional<std::chrono::microseconds> poll_timeout_;
   std::vector<zmq::pollitem_t> poll_items_;
-  std::map<Handle, std::function<void()>> timed_callbacks_;
-  int timed_callback_counter_;
+  // Queues and their positions in poll_items_
+  std::vector<std::pair<PollableQueue*, size_t>> queues_;
+  std::vector<ShmReceiver*> shm_receivers_;
+  TimerWheel timed_callbacks_;
+  int timer_fd_;
+  PollingPolicy polling_policy_;
+
+  // Waits that did not block, which include the calls with dont_wait, and waits that blocked
+  uint64_t num_spins_;
+  uint64_t num_sleeps_;
+  std::chrono::steady_clock::duration sleep_time_;
+  // Time spent in the rounds that did work, not counting the time blocked in them
+  std::chrono::steady_clock::duration work_time_;
+  std::chrono::steady_clock::time_point round_start_;
+  std::chrono::steady_clock::duration round_sleep_time_;
+  std::chrono::steady_clock::time_point last_stats_flush_;
 };
 
 }  // namespace slog
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "connection/polling_policy.h"
+
+using namespace std::chrono;
+
+namespace slog {
+
+PollingPolicy::PollingPolicy(const internal::PollingOptions& options)
+    : mode_(options.mode()),
+      min_spin_time_(microseconds(options.min_spin_us())),
+      max_spin_time_(microseconds(std::max(options.min_spin_us(), options.max_spin_us()))),
+      last_round_(Clock::now()),
+      last_work_(last_round_),
+      avg_work_gap_(max_spin_time_) {
+  UpdateSpinTime();
+}
+
+PollingPolicy::Wait PollingPolicy::NextWait() const {
+  if (mode_ == internal::PollingMode::SPIN || last_round_ - last_work_ < spin_time_) {
+    return Wait::SPIN;
+  }
+  return mode_ == internal::PollingMode::SPIN_THEN_YIELD ? Wait::YIELD : Wait::BLOCK;
+}
+
+void PollingPolicy::FinishRound(Clock::time_point now, bool did_work) {
+  last_round_ = now;
+  if (!did_work) {
+    return;
+  }
+  // Weigh the latest gap by 1/8
+  avg_work_gap_ += (now - last_work_ - avg_work_gap_) / 8;
+  last_work_ = now;
+  UpdateSpinTime();
+}
+
+void PollingPolicy::UpdateSpinTime() {
+  auto expected = 2 * avg_work_gap_;
+  spin_time_ = expected > max_spin_time_ ? min_spin_time_ : std::max(expected, min_spin_time_);
+}
+
+}  // namespace slog
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+
+#include "proto/configuration.pb.h"
+
+namespace slog {
+
+/**
+ * Decides how a module loop waits for its next message. After each message the loop spins for a while
+ * because another message often follows shortly. How long it spins adapts to the average time between
+ * the messages: the loop spins long enough to catch the next message if that is expected within the
+ * upper bound, otherwise spinning would only steal cpu from other threads and it spins for the lower bound.
+ */
+class PollingPolicy {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Wait { SPIN, YIELD, BLOCK };
+
+  explicit PollingPolicy(const internal::PollingOptions& options);
+
+  /**
+   * How the next round of the loop should wait
+   */
+  Wait NextWait() const;
+
+  /**
+   * Called at the end of each round of the loop with the time it ended
+   */
+  void FinishRound(Clock::time_point now, bool did_work);
+
+  Clock::duration spin_time() const { return spin_time_; }
+
+ private:
+  void UpdateSpinTime();
+
+  const internal::PollingMode mode_;
+  const Clock::duration min_spin_time_;
+  const Clock::duration max_spin_time_;
+  Clock::duration spin_time_;
+
+  Clock::time_point last_round_;
+  Clock::time_point last_work_;
+  // Exponential moving average of the time between two rounds that did work
+  Clock::duration avg_work_gap_;
+};
+
+}  // namespace slog
@@ -1,15 +1,69 @@
 #include "sender.h"
 
 using std::move;
+using std::optional;
+using namespace std::chrono;
 
 namespace slog {
 
 Sender::Sender(const ConfigurationPtr& config, const std::shared_ptr<zmq::context_t>& context, bool is_long)
-    : config_(config), context_(context), is_long_(is_long) {}
+    : config_(config),
+      context_(context),
+      is_long_(is_long),
+      default_coalescing_delay_(0),
+      coalescing_max_bytes_(0) {}
+
+Sender::~Sender() { FlushCoalesced(true /* force */); }
+
+void Sender::EnableCoalescing(std::function<void(microseconds)>&& schedule_flush) {
+  const auto& options = config_->message_coalescing_options();
+  bool enabled = options.delay_us() > 0;
+  for (const auto& entry : options.channel_delays()) {
+    coalescing_delays_[entry.channel()] = microseconds(entry.delay_us());
+    enabled |= entry.delay_us() > 0;
+  }
+  if (!enabled) {
+    return;
+  }
+  default_coalescing_delay_ = microseconds(options.delay_us());
+  coalescing_max_bytes_ = options.max_bytes() == 0 ? 64 * 1024 : options.max_bytes();
+  schedule_flush_ = move(schedule_flush);
+}
+
+void Sender::FlushCoalesced(bool force) {
+  if (!schedule_flush_) {
+    return;
+  }
+  auto now = steady_clock::now();
+  next_flush_.reset();
+  for (auto& [_, remote] : machine_id_and_port_to_sockets_) {
+    if (remote->coalesced.empty()) {
+      continue;
+    }
+    if (force || remote->flush_deadline <= now) {
+      remote->SendCoalesced();
+    } else if (!next_flush_.has_value() || remote->flush_deadline < next_flush_.value()) {
+      next_flush_ = remote->flush_deadline;
+    }
+  }
+  if (next_flush_.has_value()) {
+    schedule_flush_(ceil<microseconds>(next_flush_.value() - now));
+  }
+}
 
 void Sender::Send(const internal::Envelope& envelope, MachineId to_machine_id, Channel to_channel) {
-  auto& socket = GetRemoteSocket(to_machine_id, to_channel);
-  SendSerializedProto(*socket, envelope, config_->local_machine_id(), to_channel);
+  auto& remote = GetRemoteSocket(to_machine_id, to_channel);
+  if (auto delay = GetCoalescingDelay(to_channel); delay.has_value()) {
+    bool was_empty = remote.coalesced.empty();
+    remote.coalesced.Add(envelope, config_->local_machine_id(), to_channel);
+    Coalesce(remote, was_empty, delay.value());
+    return;
+  }
+  // Send the held back messages first to keep the messages to the same socket in order
+  remote.SendCoalesced();
+  auto msg = SerializeProto(envelope);
+  SetAddress(msg, config_->local_machine_id(), to_channel);
+  remote.Send(move(msg));
 }
 
 void Sender::Send(EnvelopePtr&& envelope, MachineId to_machine_id, Channel to_channel) {
@@ -22,13 +76,9 @@ void Sender::Send(EnvelopePtr&& envelope, MachineId to_machine_id, Channel to_ch
 
 void Sender::Send(EnvelopePtr&& envelope, Channel to_channel) {
   // Lazily establish a new connection when necessary
-  auto it = local_channel_to_socket_.find(to_channel);
-  if (it == local_channel_to_socket_.end()) {
-    zmq::socket_t new_socket(*context_, ZMQ_PUSH);
-    new_socket.connect(MakeInProcChannelAddress(to_channel));
-    new_socket.set(zmq::sockopt::sndhwm, 0);
-    auto res = local_channel_to_socket_.insert_or_assign(to_channel, move(new_socket));
-    it = res.first;
+  auto it = local_channel_to_producer_.find(to_channel);
+  if (it == local_channel_to_producer_.end()) {
+    it = local_channel_to_producer_.try_emplace(to_channel, GetInprocChannel(*context_, to_channel)).first;
   }
   envelope->set_from(config_->local_machine_id());
   SendEnvelope(it->second, move(envelope));
@@ -36,36 +86,79 @@ void Sender::Send(EnvelopePtr&& envelope, Channel to_channel) {
 
 void Sender::Send(const internal::Envelope& envelope, const std::vector<MachineId>& to_machine_ids,
                   Channel to_channel) {
-  auto serialized = SerializeProto(envelope);
+  SharedSerializedProto serialized(envelope);
+  auto delay = GetCoalescingDelay(to_channel);
   for (auto dest : to_machine_ids) {
-    zmq::message_t copied;
-    copied.copy(serialized);
-    auto& socket = GetRemoteSocket(dest, to_channel);
-    SendAddressedBuffer(*socket, move(copied), config_->local_machine_id(), to_channel);
+    auto& remote = GetRemoteSocket(dest, to_channel);
+    if (delay.has_value()) {
+      bool was_empty = remote.coalesced.empty();
+      serialized.AddTo(remote.coalesced, config_->local_machine_id(), to_channel);
+      Coalesce(remote, was_empty, delay.value());
+    } else {
+      remote.SendCoalesced();
+      remote.Send(serialized.Header(config_->local_machine_id(), to_channel), serialized.Body());
+    }
   }
 }
 
 void Sender::Send(EnvelopePtr&& envelope, const std::vector<MachineId>& to_machine_ids, Channel to_channel) {
-  auto serialized = SerializeProto(*envelope);
+  std::vector<MachineId> remote_machine_ids;
+  remote_machine_ids.reserve(to_machine_ids.size());
   bool send_local = false;
   for (auto dest : to_machine_ids) {
     if (dest == config_->local_machine_id()) {
       send_local = true;
-      continue;
+    } else {
+      remote_machine_ids.push_back(dest);
     }
-    zmq::message_t copied;
-    copied.copy(serialized);
-    auto& socket = GetRemoteSocket(dest, to_channel);
-    SendAddressedBuffer(*socket, move(copied), config_->local_machine_id(), to_channel);
+  }
+  if (!remote_machine_ids.empty()) {
+    Send(*envelope, remote_machine_ids, to_channel);
   }
   if (send_local) {
     Send(std::move(envelope), to_channel);
   }
 }
 
-Sender::SocketPtr& Sender::GetRemoteSocket(MachineId machine_id, Channel channel) {
-  uint32_t port;
+optional<microseconds> Sender::GetCoalescingDelay(Channel channel) const {
+  if (!schedule_flush_) {
+    return {};
+  }
+  // All workers share the delay of kWorkerChannel and all tags share the delay of kMaxChannel
   if (channel >= kMaxChannel) {
+    channel = kMaxChannel;
+  } else if (channel >= kWorkerChannel) {
+    channel = kWorkerChannel;
+  }
+  auto it = coalescing_delays_.find(channel);
+  auto delay = it == coalescing_delays_.end() ? default_coalescing_delay_ : it->second;
+  if (delay == 0us) {
+    return {};
+  }
+  return delay;
+}
+
+void Sender::Coalesce(RemoteSocket& remote, bool was_empty, microseconds delay) {
+  if (remote.coalesced.size() >= coalescing_max_bytes_) {
+    remote.SendCoalesced();
+    return;
+  }
+  auto deadline = steady_clock::now() + delay;
+  if (!was_empty && remote.flush_deadline <= deadline) {
+    return;
+  }
+  remote.flush_deadline = deadline;
+  // A flush that is already scheduled earlier will reschedule for this deadline
+  if (!next_flush_.has_value() || deadline < next_flush_.value()) {
+    next_flush_ = deadline;
+    schedule_flush_(delay);
+  }
+}
+
+Sender::RemoteSocket& Sender::GetRemoteSocket(MachineId machine_id, Channel channel) {
+  uint32_t port;
+  // The remote reads to the workers and the messages to the tags go through the last broker thread
+  if (channel >= kWorkerChannel) {
     port = config_->broker_ports(config_->broker_ports_size() - 1);
   } else {
     switch (channel) {
@@ -86,17 +179,44 @@ Sender::SocketPtr& Sender::GetRemoteSocket(MachineId machine_id, Channel channel
   // Lazily establish a new connection when necessary
   auto id = std::make_pair(machine_id, port);
   auto ins = machine_id_and_port_to_sockets_.try_emplace(id, nullptr);
-  auto& socket = ins.first->second;
-  if (socket == nullptr) {
-    socket = std::make_unique<zmq::socket_t>(*context_, ZMQ_PUSH);
-    socket->set(zmq::sockopt::sndhwm, 0);
+  auto& remote = ins.first->second;
+  if (remote == nullptr) {
+    remote = std::make_unique<RemoteSocket>();
+    remote->socket = zmq::socket_t(*context_, ZMQ_PUSH);
+    remote->socket.set(zmq::sockopt::sndhwm, 0);
     if (is_long_) {
-      socket->set(zmq::sockopt::sndbuf, config_->long_sender_sndbuf());
+      remote->socket.set(zmq::sockopt::sndbuf, config_->long_sender_sndbuf());
     }
     auto endpoint = MakeRemoteAddress(config_->protocol(), config_->address(machine_id), port);
-    socket->connect(endpoint);
+    remote->socket.connect(endpoint);
+    if (config_->protocol() == "shm") {
+      remote->shm = std::make_unique<ShmWriter>(remote->socket, config_->shm_ring_size());
+    }
+  }
+  return *remote;
+}
+
+void Sender::RemoteSocket::Send(zmq::message_t&& msg) {
+  if (shm != nullptr) {
+    shm->Write(msg);
+  } else {
+    socket.send(msg, zmq::send_flags::dontwait);
+  }
+}
+
+void Sender::RemoteSocket::Send(zmq::message_t&& header, zmq::message_t&& body) {
+  if (shm != nullptr) {
+    shm->Write(header, body);
+  } else {
+    socket.send(header, zmq::send_flags::sndmore | zmq::send_flags::dontwait);
+    socket.send(body, zmq::send_flags::dontwait);
+  }
+}
+
+void Sender::RemoteSocket::SendCoalesced() {
+  if (!coalesced.empty()) {
+    Send(coalesced.Release());
   }
-  return socket;
 }
 
-}  // namespace slog
\ No newline at end of file
+}  // namespace slog
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <optional>
 #include <unordered_map>
 #include <zmq.hpp>
 
 #include "common/types.h"
 #include "connection/broker.h"
+#include "connection/inproc_queue.h"
+#include "connection/shm_transport.h"
 #include "connection/zmq_utils.h"
 #include "proto/internal.pb.h"
 
@@ -16,6 +21,20 @@ namespace slog {
 class Sender {
  public:
   Sender(const ConfigurationPtr& config, const std::shared_ptr<zmq::context_t>& context, bool is_long = false);
+  ~Sender();
+
+  /**
+   * Holds back the messages to remote machines for the delays in the message coalescing options so that
+   * the messages to the same machine are sent together. This is a no-op if coalescing is not configured.
+   * @param schedule_flush Called with a delay after which FlushCoalesced must be called
+   */
+  void EnableCoalescing(std::function<void(std::chrono::microseconds)>&& schedule_flush);
+
+  /**
+   * Sends the held back messages whose delay has passed
+   * @param force Send all held back messages regardless of their delay
+   */
+  void FlushCoalesced(bool force = false);
 
   /**
    * Send a request or response to a given channel of a given machine
@@ -43,7 +62,7 @@ class Sender {
 
   /**
    * Send a request or response to a given channel of a list of machines.
-   * Use this to serialize the message only once.
+   * Use this to serialize the message only once and share the serialized buffer among the destinations.
    * @param request_or_response Request or response to be sent
    * @param to_machine_ids Ids of the machines that this message is sent to
    * @param to_channel Channel on the machine that this message is sent to
@@ -53,7 +72,7 @@ class Sender {
   /**
    * Send a request or response to a given channel of a list of machines.
    * If local machine is among the destination, local send is used for that machine.
-   * Use this to serialize the message only once.
+   * Use this to serialize the message only once and share the serialized buffer among the destinations.
    * @param request_or_response Request or response to be sent
    * @param to_machine_ids Ids of the machines that this message is sent to
    * @param to_channel Channel on the machine that this message is sent to
@@ -62,8 +81,25 @@ class Sender {
 
  private:
   using MachineIdWithPort = std::pair<MachineId, int>;
-  using SocketPtr = std::unique_ptr<zmq::socket_t>;
-  SocketPtr& GetRemoteSocket(MachineId machine_id, Channel channel);
+  struct RemoteSocket {
+    // Sends the frames through the shared-memory ring if there is one, otherwise through the socket
+    void Send(zmq::message_t&& msg);
+    void Send(zmq::message_t&& header, zmq::message_t&& body);
+    void SendCoalesced();
+
+    zmq::socket_t socket;
+    // Only set if the protocol is "shm"
+    std::unique_ptr<ShmWriter> shm;
+    // Messages held back to be sent together
+    CoalescedMessage coalesced;
+    std::chrono::steady_clock::time_point flush_deadline;
+  };
+  using RemoteSocketPtr = std::unique_ptr<RemoteSocket>;
+  RemoteSocket& GetRemoteSocket(MachineId machine_id, Channel channel);
+
+  // Returns the delay that a message to the given channel can be held back for, or nothing if it must be sent now
+  std::optional<std::chrono::microseconds> GetCoalescingDelay(Channel channel) const;
+  void Coalesce(RemoteSocket& remote, bool was_empty, std::chrono::microseconds delay);
 
   ConfigurationPtr config_;
   // Keep a pointer to context here to make sure that the below sockets
@@ -71,8 +107,14 @@ class Sender {
   std::shared_ptr<zmq::context_t> context_;
   // Sockets of a long sender have a larger kernel buffer size
   bool is_long_;
-  std::map<MachineIdWithPort, SocketPtr> machine_id_and_port_to_sockets_;
-  std::unordered_map<Channel, zmq::socket_t> local_channel_to_socket_;
+  std::map<MachineIdWithPort, RemoteSocketPtr> machine_id_and_port_to_sockets_;
+  std::unordered_map<Channel, InprocChannel::Producer> local_channel_to_producer_;
+
+  std::function<void(std::chrono::microseconds)> schedule_flush_;
+  std::chrono::microseconds default_coalescing_delay_;
+  std::unordered_map<Channel, std::chrono::microseconds> coalescing_delays_;
+  size_t coalescing_max_bytes_;
+  std::optional<std::chrono::steady_clock::time_point> next_flush_;
 };
 
 }  // namespace slog
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "connection/shm_transport.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+
+using std::string;
+
+namespace slog {
+
+namespace {
+
+string NewRingName() {
+  static std::atomic<uint32_t> counter = 0;
+  return "/slog_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+}
+
+}  // namespace
+
+ShmWriter::ShmWriter(zmq::socket_t& socket, size_t capacity)
+    : socket_(socket),
+      name_(NewRingName()),
+      mapped_size_(sizeof(ShmRingHeader) + capacity),
+      tail_(0),
+      cached_head_(0) {
+  CHECK_GT(capacity, 0U);
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  CHECK_GE(fd, 0) << "Cannot create shared memory \"" << name_ << "\": " << strerror(errno);
+  CHECK_EQ(ftruncate(fd, mapped_size_), 0) << "Cannot resize shared memory \"" << name_ << "\": " << strerror(errno);
+  auto addr = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  CHECK(addr != MAP_FAILED) << "Cannot map shared memory \"" << name_ << "\": " << strerror(errno);
+  close(fd);
+
+  header_ = new (addr) ShmRingHeader();
+  header_->tail.store(0, std::memory_order_relaxed);
+  header_->head.store(0, std::memory_order_relaxed);
+  header_->sleeping.store(0, std::memory_order_relaxed);
+  header_->reader_closed.store(0, std::memory_order_relaxed);
+  header_->writer_closed.store(0, std::memory_order_relaxed);
+  header_->capacity = capacity;
+  data_ = static_cast<char*>(addr) + sizeof(ShmRingHeader);
+
+  // The receiver unlinks the name once it has mapped the ring. The ring is left behind if the receiver
+  // never shows up
+  zmq::message_t msg(kMessageHeaderSize + name_.size());
+  uint32_t type_id = kShmAttachTypeId;
+  uint32_t size = name_.size();
+  memcpy(msg.data<char>() + kMessageTypeIdOffset, &type_id, sizeof(type_id));
+  memcpy(msg.data<char>() + kMessageSizeOffset, &size, sizeof(size));
+  memcpy(msg.data<char>() + kMessageHeaderSize, name_.data(), name_.size());
+  SendAddressedBuffer(socket_, std::move(msg));
+}
+
+ShmWriter::~ShmWriter() {
+  header_->writer_closed.store(1, std::memory_order_release);
+  // Wake up the receiver so that it drops the ring
+  Publish();
+  munmap(header_, mapped_size_);
+}
+
+void ShmWriter::Write(const zmq::message_t& msg, const zmq::message_t& body) {
+  if (header_->reader_closed.load(std::memory_order_relaxed)) {
+    LOG_FIRST_N(WARNING, 1) << "Dropping messages to a closed shared-memory ring";
+    return;
+  }
+  uint32_t size = msg.size() + body.size();
+  if (WriteBytes(&size, sizeof(size)) && WriteBytes(msg.data(), msg.size())) {
+    WriteBytes(body.data(), body.size());
+  }
+  Publish();
+}
+
+bool ShmWriter::WriteBytes(const void* data, size_t size) {
+  auto src = static_cast<const char*>(data);
+  auto capacity = header_->capacity;
+  while (size > 0) {
+    if (tail_ - cached_head_ == capacity) {
+      cached_head_ = header_->head.load(std::memory_order_acquire);
+      if (tail_ - cached_head_ == capacity) {
+        if (header_->reader_closed.load(std::memory_order_relaxed)) {
+          return false;
+        }
+        // Let the receiver see what has been written so far so that it can make room
+        Publish();
+        std::this_thread::yield();
+        continue;
+      }
+    }
+    auto pos = tail_ % capacity;
+    auto n = std::min({size, capacity - (tail_ - cached_head_), capacity - pos});
+    memcpy(data_ + pos, src, n);
+    tail_ += n;
+    src += n;
+    size -= n;
+  }
+  return true;
+}
+
+void ShmWriter::Publish() {
+  header_->tail.store(tail_, std::memory_order_release);
+  // Pairs with the fence in ShmReceiver::PrepareToSleep so that either the receiver sees the new tail
+  // or this sees that the receiver is sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (header_->sleeping.load(std::memory_order_relaxed) &&
+      header_->sleeping.exchange(0, std::memory_order_relaxed)) {
+    zmq::message_t wake_up;
+    socket_.send(wake_up, zmq::send_flags::dontwait);
+  }
+}
+
+ShmReceiver::ShmReceiver(zmq::socket_t& socket) : socket_(socket), next_ring_(0) {}
+
+ShmReceiver::~ShmReceiver() = default;
+
+bool ShmReceiver::Recv(zmq::message_t& msg) {
+  // The socket only carries the names of new rings and the wake-ups, which are empty
+  for (zmq::message_t control; socket_.recv(control, zmq::recv_flags::dontwait);) {
+    uint32_t type_id = 0;
+    if (control.size() >= kMessageHeaderSize) {
+      memcpy(&type_id, control.data<char>() + kMessageTypeIdOffset, sizeof(type_id));
+    }
+    if (type_id == kShmAttachTypeId) {
+      Attach(string(control.data<char>() + kMessageHeaderSize, control.size() - kMessageHeaderSize));
+    } else if (control.size() > 0) {
+      LOG(ERROR) << "Unexpected message on a socket of shared-memory rings";
+    }
+  }
+
+  for (size_t n = rings_.size(); n > 0; n--) {
+    if (next_ring_ >= rings_.size()) {
+      next_ring_ = 0;
+    }
+    auto& ring = rings_[next_ring_];
+    if (ring->Read(msg)) {
+      next_ring_++;
+      return true;
+    }
+    if (ring->drained()) {
+      rings_.erase(rings_.begin() + next_ring_);
+    } else {
+      next_ring_++;
+    }
+  }
+  return false;
+}
+
+bool ShmReceiver::PrepareToSleep() {
+  for (auto& ring : rings_) {
+    ring->header->sleeping.store(1, std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (auto& ring : rings_) {
+    if (!ring->empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ShmReceiver::FinishSleep() {
+  for (auto& ring : rings_) {
+    ring->header->sleeping.store(0, std::memory_order_relaxed);
+  }
+}
+
+void ShmReceiver::Attach(const string& name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    LOG(ERROR) << "Cannot open shared memory \"" << name << "\": " << strerror(errno);
+    return;
+  }
+  // The name is no longer needed once the ring is mapped
+  shm_unlink(name.c_str());
+
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) > sizeof(ShmRingHeader)) {
+    addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "Cannot map shared memory \"" << name << "\"";
+    return;
+  }
+
+  auto ring = std::make_unique<Ring>();
+  ring->header = static_cast<ShmRingHeader*>(addr);
+  ring->data = static_cast<const char*>(addr) + sizeof(ShmRingHeader);
+  ring->mapped_size = st.st_size;
+  if (ring->header->capacity != st.st_size - sizeof(ShmRingHeader)) {
+    LOG(ERROR) << "Malformed shared memory \"" << name << "\"";
+    return;
+  }
+  rings_.push_back(std::move(ring));
+}
+
+ShmReceiver::Ring::~Ring() {
+  if (header != nullptr) {
+    header->reader_closed.store(1, std::memory_order_relaxed);
+    munmap(header, mapped_size);
+  }
+}
+
+bool ShmReceiver::Ring::empty() const { return header->tail.load(std::memory_order_acquire) == head; }
+
+bool ShmReceiver::Ring::drained() const {
+  // The flag is read first so that the final tail of the writer is seen
+  return header->writer_closed.load(std::memory_order_acquire) && !has_pending && empty();
+}
+
+bool ShmReceiver::Ring::Read(zmq::message_t& msg) {
+  auto tail = header->tail.load(std::memory_order_acquire);
+  if (!has_pending) {
+    uint32_t size;
+    if (tail - head < sizeof(size)) {
+      return false;
+    }
+    CopyOut(&size, sizeof(size));
+    pending.rebuild(size);
+    pending_filled = 0;
+    has_pending = true;
+  }
+  auto n = std::min<uint64_t>(tail - head, pending.size() - pending_filled);
+  CopyOut(pending.data<char>() + pending_filled, n);
+  pending_filled += n;
+  header->head.store(head, std::memory_order_release);
+  if (pending_filled < pending.size()) {
+    return false;
+  }
+  has_pending = false;
+  msg = std::move(pending);
+  return true;
+}
+
+void ShmReceiver::Ring::CopyOut(void* dst, size_t size) {
+  auto out = static_cast<char*>(dst);
+  auto capacity = header->capacity;
+  while (size > 0) {
+    auto pos = head % capacity;
+    auto n = std::min(size, capacity - pos);
+    memcpy(out, data + pos, n);
+    head += n;
+    out += n;
+    size -= n;
+  }
+}
+
+}  // namespace slog
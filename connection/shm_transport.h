@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+
+#include "connection/zmq_utils.h"
+
+namespace slog {
+
+/**
+ * Type id of the message that a ShmWriter sends to tell the receiver the name of its ring
+ */
+constexpr uint32_t kShmAttachTypeId = Fnv1aHash("slog.ShmAttach");
+
+/**
+ * Layout of the beginning of a shared-memory ring. The data of the ring follows right after
+ */
+struct ShmRingHeader {
+  // Bytes written so far. Only written by the writer
+  alignas(64) std::atomic<uint64_t> tail;
+  // Bytes read so far. Only written by the reader
+  alignas(64) std::atomic<uint64_t> head;
+  // Set by the reader before it sleeps on its socket. The writer clears it when it sends a wake-up
+  std::atomic<uint32_t> sleeping;
+  // Set by the reader when it goes away so that a blocked writer does not wait forever
+  std::atomic<uint32_t> reader_closed;
+  // Set by the writer when it goes away so that the reader unmaps the ring once it has read everything
+  std::atomic<uint32_t> writer_closed;
+  uint64_t capacity;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "The atomics in shared memory must be lock-free");
+
+/**
+ * The sending end of a shared-memory ring to a receiver on the same host. The messages are copied into the
+ * ring as a stream of length-prefixed buffers, so no syscall is made while the receiver is busy. The zmq
+ * socket to the receiver is only used to send the name of the ring once and to wake up the receiver when
+ * it is sleeping.
+ *
+ * A message larger than the ring is written in pieces as the receiver frees up space. The writer blocks
+ * while the ring is full. The ring is closed when the writer is destroyed and the receiver unmaps it after
+ * reading the rest of it.
+ */
+class ShmWriter {
+ public:
+  ShmWriter(zmq::socket_t& socket, size_t capacity);
+  ~ShmWriter();
+
+  ShmWriter(const ShmWriter&) = delete;
+  ShmWriter& operator=(const ShmWriter&) = delete;
+
+  /**
+   * Writes the frames of a message as a single buffer
+   */
+  void Write(const zmq::message_t& msg, const zmq::message_t& body = {});
+
+ private:
+  // Returns false if the receiver has gone away
+  bool WriteBytes(const void* data, size_t size);
+  // Makes the written bytes visible to the reader and wakes it up if needed
+  void Publish();
+
+  zmq::socket_t& socket_;
+  std::string name_;
+  ShmRingHeader* header_;
+  char* data_;
+  size_t mapped_size_;
+  // Local copies of the positions in the ring
+  uint64_t tail_;
+  uint64_t cached_head_;
+};
+
+/**
+ * The receiving end of the shared-memory rings of all writers sending to a bound pull socket
+ */
+class ShmReceiver {
+ public:
+  explicit ShmReceiver(zmq::socket_t& socket);
+  ~ShmReceiver();
+
+  ShmReceiver(const ShmReceiver&) = delete;
+  ShmReceiver& operator=(const ShmReceiver&) = delete;
+
+  zmq::socket_t& socket() { return socket_; }
+  size_t num_rings() const { return rings_.size(); }
+
+  /**
+   * Receives the next message from one of the rings without blocking. Returns false if there is none.
+   * The rings whose writers have gone away are dropped once they are drained
+   */
+  bool Recv(zmq::message_t& msg);
+
+  /**
+   * Called before sleeping on the socket. Returns false if a ring is not empty, in which case the caller
+   * must not sleep
+   */
+  bool PrepareToSleep();
+
+  /**
+   * Called after sleeping on the socket
+   */
+  void FinishSleep();
+
+ private:
+  struct Ring {
+    ~Ring();
+    bool empty() const;
+    // Returns true if the writer has gone away and everything it wrote has been read
+    bool drained() const;
+    bool Read(zmq::message_t& msg);
+    void CopyOut(void* dst, size_t size);
+
+    ShmRingHeader* header = nullptr;
+    const char* data = nullptr;
+    size_t mapped_size = 0;
+    uint64_t head = 0;
+    // The message being read and how much of it has been read
+    zmq::message_t pending;
+    size_t pending_filled = 0;
+    bool has_pending = false;
+  };
+
+  void Attach(const std::string& name);
+
+  zmq::socket_t& socket_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  size_t next_ring_;
+};
+
+}  // namespace slog
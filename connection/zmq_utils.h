@@ -1,22 +1,28 @@
 #pragma once
 
-#include <google/protobuf/any.pb.h>
+#include <google/protobuf/message.h>
 
+#include <cstring>
+#include <memory>
 #include <sstream>
+#include <string_view>
+#include <vector>
 #include <zmq.hpp>
 
+#include "common/shared_arena.h"
 #include "common/types.h"
 #include "proto/internal.pb.h"
 
 namespace slog {
 
-using EnvelopePtr = std::unique_ptr<internal::Envelope>;
+// The envelopes of the txns from other machines may be on a shared arena
+using EnvelopePtr = std::unique_ptr<internal::Envelope, MessageDeleter<internal::Envelope>>;
 
-inline std::string MakeInProcChannelAddress(Channel chan) { return "inproc://channel_" + std::to_string(chan); }
 inline std::string MakeRemoteAddress(const std::string& protocol, const std::string& addr, uint32_t port,
                                      bool binding = false) {
   std::stringstream endpoint;
-  endpoint << protocol << "://";
+  // The "shm" protocol still uses ipc sockets to set up and wake up its shared-memory rings
+  endpoint << (protocol == "shm" ? "ipc" : protocol) << "://";
   if (binding && protocol == "tcp") {
     endpoint << "*";
   } else {
@@ -48,31 +54,184 @@ inline EnvelopePtr RecvEnvelope(zmq::socket_t& socket, bool dont_wait = false) {
   return EnvelopePtr(*(msg.data<internal::Envelope*>()));
 }
 
-inline zmq::message_t SerializeProto(const google::protobuf::Message& proto) {
-  google::protobuf::Any any;
-  any.PackFrom(proto);
+/**
+ * A serialized message starts with a fixed header followed by the raw bytes of the proto:
+ * <sender machine id> <receiver channel> <proto type id> <proto size>
+ */
+const size_t kMessageTypeIdOffset = sizeof(MachineId) + sizeof(Channel);
+const size_t kMessageSizeOffset = kMessageTypeIdOffset + sizeof(uint32_t);
+const size_t kMessageHeaderSize = kMessageSizeOffset + sizeof(uint32_t);
 
-  auto header_sz = sizeof(MachineId) + sizeof(Channel);
-  zmq::message_t msg(header_sz + any.ByteSizeLong());
-  any.SerializeToArray(msg.data<char>() + header_sz, any.ByteSizeLong());
+constexpr uint32_t Fnv1aHash(std::string_view str) {
+  uint32_t hash = 2166136261U;
+  for (char c : str) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619U;
+  }
+  return hash;
+}
 
+/**
+ * Identifies the type of a proto on the wire with the FNV-1a hash of its full name
+ */
+inline uint32_t ProtoTypeId(const google::protobuf::Descriptor* descriptor) {
+  return Fnv1aHash(descriptor->full_name());
+}
+
+/**
+ * Type id of a message that carries many messages, see CoalescedMessage
+ */
+constexpr uint32_t kCoalescedTypeId = Fnv1aHash("slog.CoalescedMessage");
+
+inline zmq::message_t SerializeProto(const google::protobuf::Message& proto) {
+  uint32_t type_id = ProtoTypeId(proto.GetDescriptor());
+  uint32_t size = proto.ByteSizeLong();
+  zmq::message_t msg(kMessageHeaderSize + size);
+  auto data = msg.data<uint8_t>();
+  memcpy(data + kMessageTypeIdOffset, &type_id, sizeof(type_id));
+  memcpy(data + kMessageSizeOffset, &size, sizeof(size));
+  // Reuse the size computed above instead of traversing the proto again
+  proto.SerializeWithCachedSizesToArray(data + kMessageHeaderSize);
   return msg;
 }
 
-inline void SendAddressedBuffer(zmq::socket_t& socket, zmq::message_t&& msg, MachineId from_machine_id = -1,
-                                Channel to_chan = 0) {
+inline void SetAddress(zmq::message_t& msg, MachineId from_machine_id, Channel to_chan) {
   auto machine_id_data = msg.data<MachineId>();
   *machine_id_data = from_machine_id;
 
   auto channel_data = reinterpret_cast<Channel*>(machine_id_data + 1);
   *channel_data = to_chan;
+}
 
-  socket.send(msg, zmq::send_flags::dontwait);
+inline void SendAddressedBuffer(zmq::socket_t& socket, zmq::message_t&& msg, MachineId from_machine_id = -1,
+                                Channel to_chan = 0, zmq::send_flags flags = zmq::send_flags::dontwait) {
+  SetAddress(msg, from_machine_id, to_chan);
+  socket.send(msg, flags);
 }
 
 /**
- * Serializes and send proto message. The sent buffer contains
- * <sender machine id> <receiver channel> <proto>
+ * Messages to the same remote socket that are sent together in a single frame. The frame starts with a header
+ * whose type id is kCoalescedTypeId and whose size covers the rest of the frame, which is the complete
+ * messages laid back to back, each with its own header
+ */
+class CoalescedMessage {
+ public:
+  void Add(const google::protobuf::Message& proto, MachineId from_machine_id, Channel to_chan) {
+    uint32_t size = proto.ByteSizeLong();
+    auto data = Append(ProtoTypeId(proto.GetDescriptor()), size, from_machine_id, to_chan);
+    proto.SerializeWithCachedSizesToArray(data);
+  }
+
+  void Add(uint32_t type_id, const std::string& proto, MachineId from_machine_id, Channel to_chan) {
+    auto data = Append(type_id, proto.size(), from_machine_id, to_chan);
+    memcpy(data, proto.data(), proto.size());
+  }
+
+  bool empty() const { return num_messages_ == 0; }
+  size_t size() const { return buffer_ == nullptr ? 0 : buffer_->size(); }
+
+  /**
+   * Sends the buffered messages without copying them and clears the buffer. A lone message is sent
+   * without the coalescing header
+   */
+  void Send(zmq::socket_t& socket) {
+    if (empty()) {
+      return;
+    }
+    auto msg = Release();
+    socket.send(msg, zmq::send_flags::dontwait);
+  }
+
+  /**
+   * Moves the buffered messages into a frame without copying them and clears the buffer. Must not be empty
+   */
+  zmq::message_t Release() {
+    auto offset = num_messages_ == 1 ? kMessageHeaderSize : 0;
+    auto buffer = buffer_.release();
+    num_messages_ = 0;
+    return zmq::message_t(buffer->data() + offset, buffer->size() - offset, ReleaseBuffer, buffer);
+  }
+
+ private:
+  // Appends the header of a message and returns where its proto goes
+  uint8_t* Append(uint32_t type_id, uint32_t size, MachineId from_machine_id, Channel to_chan) {
+    if (buffer_ == nullptr) {
+      buffer_ = std::make_unique<std::string>();
+    }
+    if (buffer_->empty()) {
+      buffer_->resize(kMessageHeaderSize);
+      WriteHeader(0, kCoalescedTypeId, 0, from_machine_id, 0);
+    }
+    auto pos = buffer_->size();
+    buffer_->resize(pos + kMessageHeaderSize + size);
+    WriteHeader(pos, type_id, size, from_machine_id, to_chan);
+    uint32_t total_size = buffer_->size() - kMessageHeaderSize;
+    memcpy(buffer_->data() + kMessageSizeOffset, &total_size, sizeof(total_size));
+    num_messages_++;
+    return reinterpret_cast<uint8_t*>(buffer_->data() + pos + kMessageHeaderSize);
+  }
+
+  void WriteHeader(size_t pos, uint32_t type_id, uint32_t size, MachineId from_machine_id, Channel to_chan) {
+    auto header = buffer_->data() + pos;
+    memcpy(header, &from_machine_id, sizeof(from_machine_id));
+    memcpy(header + sizeof(MachineId), &to_chan, sizeof(to_chan));
+    memcpy(header + kMessageTypeIdOffset, &type_id, sizeof(type_id));
+    memcpy(header + kMessageSizeOffset, &size, sizeof(size));
+  }
+
+  static void ReleaseBuffer(void* /* data */, void* hint) { delete static_cast<std::string*>(hint); }
+
+  std::unique_ptr<std::string> buffer_;
+  size_t num_messages_ = 0;
+};
+
+/**
+ * A proto that is serialized once and sent to many destinations. The header is sent in its own frame
+ * so that the frames of the proto share a single reference-counted buffer instead of copying it
+ */
+class SharedSerializedProto {
+ public:
+  explicit SharedSerializedProto(const google::protobuf::Message& proto)
+      : type_id_(ProtoTypeId(proto.GetDescriptor())),
+        proto_(std::make_shared<const std::string>(proto.SerializeAsString())) {}
+
+  void Send(zmq::socket_t& socket, MachineId from_machine_id, Channel to_chan) const {
+    auto header = Header(from_machine_id, to_chan);
+    socket.send(header, zmq::send_flags::sndmore | zmq::send_flags::dontwait);
+    auto body = Body();
+    socket.send(body, zmq::send_flags::dontwait);
+  }
+
+  zmq::message_t Header(MachineId from_machine_id, Channel to_chan) const {
+    zmq::message_t header(kMessageHeaderSize);
+    uint32_t size = proto_->size();
+    memcpy(header.data<uint8_t>() + kMessageTypeIdOffset, &type_id_, sizeof(type_id_));
+    memcpy(header.data<uint8_t>() + kMessageSizeOffset, &size, sizeof(size));
+    SetAddress(header, from_machine_id, to_chan);
+    return header;
+  }
+
+  // Each frame holds a reference to the buffer, which is released by zmq once the frame is sent
+  zmq::message_t Body() const {
+    auto ref = new std::shared_ptr<const std::string>(proto_);
+    return zmq::message_t(const_cast<char*>(proto_->data()), proto_->size(), ReleaseBuffer, ref);
+  }
+
+  void AddTo(CoalescedMessage& coalesced, MachineId from_machine_id, Channel to_chan) const {
+    coalesced.Add(type_id_, *proto_, from_machine_id, to_chan);
+  }
+
+ private:
+  static void ReleaseBuffer(void* /* data */, void* hint) {
+    delete static_cast<std::shared_ptr<const std::string>*>(hint);
+  }
+
+  uint32_t type_id_;
+  std::shared_ptr<const std::string> proto_;
+};
+
+/**
+ * Serializes and send proto message. The sent buffer contains the header
+ * described above followed by the proto
  */
 inline void SendSerializedProto(zmq::socket_t& socket, const google::protobuf::Message& proto,
                                 MachineId from_machine_id = -1, Channel to_chan = 0) {
@@ -101,20 +260,25 @@ inline bool ParseChannel(Channel& chan, const zmq::message_t& msg) {
   return true;
 }
 
+/**
+ * Checks that a header describes a proto of type T and of the given size
+ */
+template <typename T>
+inline bool CheckHeader(const char* header, size_t proto_size) {
+  static const uint32_t kTypeId = ProtoTypeId(T::descriptor());
+  uint32_t type_id, size;
+  memcpy(&type_id, header + kMessageTypeIdOffset, sizeof(type_id));
+  memcpy(&size, header + kMessageSizeOffset, sizeof(size));
+  return type_id == kTypeId && size == proto_size;
+}
+
 template <typename T>
 inline bool DeserializeProto(T& out, const char* data, size_t size) {
-  google::protobuf::Any any;
-  auto header_sz = sizeof(MachineId) + sizeof(Channel);
-  if (size < header_sz) {
+  if (size < kMessageHeaderSize || !CheckHeader<T>(data, size - kMessageHeaderSize)) {
     return false;
   }
-  // Skip the machineid and channel part
-  auto proto_data = data + header_sz;
-  auto proto_size = size - header_sz;
-  if (!any.ParseFromArray(proto_data, proto_size)) {
-    return false;
-  }
-  return any.UnpackTo(&out);
+  // Skip the header
+  return out.ParseFromArray(data + kMessageHeaderSize, size - kMessageHeaderSize);
 }
 
 template <typename T>
@@ -122,6 +286,72 @@ inline bool DeserializeProto(T& out, const zmq::message_t& msg) {
   return DeserializeProto(out, msg.data<char>(), msg.size());
 }
 
+/**
+ * Deserializes a message received by RecvAddressedBuffer
+ */
+template <typename T>
+inline bool DeserializeProto(T& out, const zmq::message_t& msg, const zmq::message_t& body) {
+  // A message that is longer than the header is not split into two frames
+  if (msg.size() > kMessageHeaderSize) {
+    return body.size() == 0 && DeserializeProto(out, msg);
+  }
+  if (msg.size() < kMessageHeaderSize || !CheckHeader<T>(msg.data<char>(), body.size())) {
+    return false;
+  }
+  return out.ParseFromArray(body.data(), body.size());
+}
+
+/**
+ * Receives a message sent by either SendAddressedBuffer or SharedSerializedProto. The proto is put into
+ * body in the latter case
+ */
+inline bool RecvAddressedBuffer(zmq::socket_t& socket, zmq::message_t& msg, zmq::message_t& body,
+                                bool dont_wait = false) {
+  auto flag = dont_wait ? zmq::recv_flags::dontwait : zmq::recv_flags::none;
+  if (!socket.recv(msg, flag)) {
+    return false;
+  }
+  // The remaining frames of a multipart message arrive together with the first one
+  if (msg.more()) {
+    (void)socket.recv(body);
+  }
+  return true;
+}
+
+inline bool IsCoalescedMessage(const zmq::message_t& msg) {
+  uint32_t type_id = 0;
+  if (msg.size() >= kMessageHeaderSize) {
+    memcpy(&type_id, msg.data<char>() + kMessageTypeIdOffset, sizeof(type_id));
+  }
+  return type_id == kCoalescedTypeId;
+}
+
+/**
+ * Copies each message in a coalesced message into its own buffer. Returns false if the coalesced message
+ * is malformed
+ */
+inline bool SplitCoalescedMessage(const zmq::message_t& msg, std::vector<zmq::message_t>& messages) {
+  auto data = msg.data<char>();
+  uint32_t total_size;
+  memcpy(&total_size, data + kMessageSizeOffset, sizeof(total_size));
+  if (total_size != msg.size() - kMessageHeaderSize) {
+    return false;
+  }
+  for (size_t pos = kMessageHeaderSize; pos < msg.size();) {
+    uint32_t size;
+    if (msg.size() - pos < kMessageHeaderSize) {
+      return false;
+    }
+    memcpy(&size, data + pos + kMessageSizeOffset, sizeof(size));
+    if (msg.size() - pos - kMessageHeaderSize < size) {
+      return false;
+    }
+    messages.emplace_back(data + pos, kMessageHeaderSize + size);
+    pos += kMessageHeaderSize + size;
+  }
+  return true;
+}
+
 template <typename T>
 inline bool RecvDeserializedProto(zmq::socket_t& socket, T& out, bool dont_wait = false) {
   zmq::message_t msg;
@@ -140,9 +370,9 @@ inline bool RecvDeserializedProtoWithEmptyDelim(zmq::socket_t& socket, T& out, b
   return RecvDeserializedProto(socket, out, dont_wait);
 }
 
-inline EnvelopePtr DeserializeEnvelope(const zmq::message_t& msg) {
+inline EnvelopePtr DeserializeEnvelope(const zmq::message_t& msg, const zmq::message_t& body = {}) {
   auto env = std::make_unique<internal::Envelope>();
-  if (!DeserializeProto(*env, msg)) {
+  if (!DeserializeProto(*env, msg, body)) {
     return nullptr;
   }
   MachineId machine_id = -1;
@@ -10,10 +10,20 @@ void Execution::ApplyWrites(const Transaction& txn, const SharderPtr& sharder,
     if (!sharder->is_local_key(key) || value.type() == KeyType::READ) {
       continue;
     }
-    Record new_record;
+    // Overwrite the existing record in place, which avoids allocating a new buffer if its size does not change.
+    // Engines that copy the record on update get a new record built from the new value instead
+    if (storage->UpdatesInPlace()) {
+      auto updated = storage->Update(key, [&value](Record& record) {
+        record.SetMetadata(value.metadata());
+        record.SetValue(value.new_value());
+      });
+      if (updated) {
+        continue;
+      }
+    }
+    Record new_record(value.new_value());
     new_record.SetMetadata(value.metadata());
-    new_record.SetValue(value.new_value());
-    storage->Write(key, new_record);
+    storage->Write(Key(key), std::move(new_record));
   }
   for (const auto& key : txn.deleted_keys()) {
     storage->Delete(key);
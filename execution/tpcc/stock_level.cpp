@@ -17,13 +17,9 @@ StockLevelTxn::StockLevelTxn(const StorageAdapterPtr& storage_adapter, int w_id,
 bool StockLevelTxn::Read() {
   district_.Select({a_w_id_, a_d_id_}, {DistrictSchema::Column::NEXT_O_ID});
   auto o_id = MakeInt32Scalar();
-  auto ol_number = MakeInt8Scalar();
   for (int i = a_o_id_->value - 20; i < a_o_id_->value; i++) {
     o_id->value = i;
-    for (int j = 0; j < kLinePerOrder; j++) {
-      ol_number->value = j;
-      order_line_.Select({a_w_id_, a_d_id_, o_id, ol_number}, {OrderLineSchema::Column::I_ID});
-    }
+    order_line_.Scan({a_w_id_, a_d_id_, o_id}, 0, kLinePerOrder, {OrderLineSchema::Column::I_ID});
   }
   for (int i = 0; i < kTotalItems; i++) {
     stock_.Select({a_w_id_, a_i_ids_[i]}, {StockSchema::Column::QUANTITY});
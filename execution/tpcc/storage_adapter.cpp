@@ -2,6 +2,8 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+
 namespace slog {
 namespace tpcc {
 
@@ -10,15 +12,27 @@ KVStorageAdapter::KVStorageAdapter(const std::shared_ptr<Storage>& storage,
     : storage_(storage), metadata_initializer_(metadata_initializer) {}
 
 const std::string* KVStorageAdapter::Read(const std::string& key) {
-  Record r;
-  auto ok = storage_->Read(key, r);
-  if (!ok) {
+  auto r = storage_->ReadView(key);
+  if (!r) {
     return nullptr;
   }
-  buffer_.push_back(r.to_string());
+  buffer_.emplace_back(r->data(), r->size());
   return &buffer_.back();
 };
 
+bool KVStorageAdapter::Scan(const std::string& start, const std::string& end, size_t limit,
+                            std::vector<std::pair<std::string, const std::string*>>& result) {
+  std::vector<std::pair<Key, Record>> records;
+  if (!storage_->Scan(start, end, limit, records)) {
+    return false;
+  }
+  for (auto& [key, record] : records) {
+    buffer_.emplace_back(record.data(), record.size());
+    result.emplace_back(std::move(key), &buffer_.back());
+  }
+  return true;
+}
+
 bool KVStorageAdapter::Insert(const std::string& key, std::string&& value) {
   Record r(std::move(value));
   r.SetMetadata(metadata_initializer_->Compute(key));
@@ -45,6 +59,32 @@ const std::string* TxnStorageAdapter::Read(const std::string& key) {
   return &txn_.keys(it->second).value_entry().value();
 }
 
+bool TxnStorageAdapter::Scan(const std::string& start, const std::string& end, size_t limit,
+                             std::vector<std::pair<std::string, const std::string*>>& result) {
+  CheckIndexSize();
+  if (sorted_keys_.empty()) {
+    for (int i = 0; i < txn_.keys_size(); i++) {
+      sorted_keys_.emplace_back(txn_.keys(i).key(), i);
+    }
+    std::sort(sorted_keys_.begin(), sorted_keys_.end());
+  }
+  size_t count = 0;
+  auto it = std::lower_bound(sorted_keys_.begin(), sorted_keys_.end(), std::make_pair(std::string_view(start), -1));
+  for (; it != sorted_keys_.end() && count < limit; it++) {
+    if (!end.empty() && it->first >= end) {
+      break;
+    }
+    const auto& value = txn_.keys(it->second).value_entry().value();
+    // Skip the keys that do not exist in the storage
+    if (value.empty()) {
+      continue;
+    }
+    result.emplace_back(it->first, &value);
+    count++;
+  }
+  return true;
+}
+
 bool TxnStorageAdapter::Insert(const std::string& key, std::string&& value) {
   CheckIndexSize();
   auto it = key_index_.find(key);
@@ -87,6 +127,7 @@ bool TxnStorageAdapter::Delete(std::string&& key) {
   txn_.mutable_keys()->RemoveLast();
   txn_.mutable_deleted_keys()->Add(std::move(key));
   key_index_.erase(it);
+  sorted_keys_.clear();
   return true;
 }
 
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 #include "common/types.h"
 #include "proto/transaction.pb.h"
 #include "storage/metadata_initializer.h"
@@ -12,6 +17,10 @@ class StorageAdapter {
  public:
   virtual ~StorageAdapter() = default;
   virtual const std::string* Read(const std::string& key) = 0;
+  // Appends to result at most limit (key, value) pairs whose keys are in [start, end), in key order.
+  // Returns false if the adapter cannot scan
+  virtual bool Scan(const std::string& start, const std::string& end, size_t limit,
+                    std::vector<std::pair<std::string, const std::string*>>& result) = 0;
   // Returns true if insertion succeeds
   virtual bool Insert(const std::string& key, std::string&& value) = 0;
   // Returns true if key exists before updating
@@ -25,8 +34,10 @@ class KVStorageAdapter : public StorageAdapter {
  public:
   KVStorageAdapter(const std::shared_ptr<Storage>& storage,
                    const std::shared_ptr<MetadataInitializer>& metadata_initializer);
-  // This Read method is leaky. Only used for testing
+  // The Read and Scan methods are leaky. Only used for testing
   const std::string* Read(const std::string&) override;
+  bool Scan(const std::string& start, const std::string& end, size_t limit,
+            std::vector<std::pair<std::string, const std::string*>>& result) override;
   bool Insert(const std::string& key, std::string&& value) override;
   bool Update(const std::string&, std::function<void(std::string&)>&&) override {
     throw std::runtime_error("Update is unimplemented in KVStorageAdapter");
@@ -36,13 +47,16 @@ class KVStorageAdapter : public StorageAdapter {
  private:
   std::shared_ptr<Storage> storage_;
   std::shared_ptr<MetadataInitializer> metadata_initializer_;
-  std::vector<std::string> buffer_;
+  std::deque<std::string> buffer_;
 };
 
 class TxnStorageAdapter : public StorageAdapter {
  public:
   TxnStorageAdapter(Transaction& txn);
   const std::string* Read(const std::string& key) override;
+  // Only sees the keys of the transaction
+  bool Scan(const std::string& start, const std::string& end, size_t limit,
+            std::vector<std::pair<std::string, const std::string*>>& result) override;
   bool Insert(const std::string& key, std::string&& value) override;
   bool Update(const std::string& key, std::function<void(std::string&)>&& update_fn) override;
   bool Delete(std::string&& key) override;
@@ -51,6 +65,9 @@ class TxnStorageAdapter : public StorageAdapter {
   void CheckIndexSize();
   Transaction& txn_;
   std::unordered_map<std::string, int> key_index_;
+  // The keys sorted for scanning with their positions in the txn. Only built by the first scan since most
+  // txns never scan, and dropped when the positions change
+  std::vector<std::pair<std::string_view, int>> sorted_keys_;
 };
 
 class TxnKeyGenStorageAdapter : public StorageAdapter {
@@ -58,6 +75,11 @@ class TxnKeyGenStorageAdapter : public StorageAdapter {
   TxnKeyGenStorageAdapter(Transaction& txn);
 
   const std::string* Read(const std::string& key) override;
+  // The keys that exist within a range are unknown at this point so the caller has to read the keys one by one
+  bool Scan(const std::string&, const std::string&, size_t,
+            std::vector<std::pair<std::string, const std::string*>>&) override {
+    return false;
+  }
   bool Insert(const std::string& key, std::string&& value) override;
   bool Update(const std::string& key, std::function<void(std::string&)>&& update_fn) override;
   bool Delete(std::string&& key) override;
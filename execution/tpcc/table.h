@@ -5,6 +5,7 @@
 #include <array>
 #include <exception>
 #include <iostream>
+#include <limits>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -42,7 +43,11 @@ class Table {
       return {};
     }
 
-    auto encoded_columns = storage_value->data();
+    return MakeGroupedRow(pkey, storage_value->data(), columns);
+  }
+
+  std::vector<ScalarPtr> MakeGroupedRow(const std::vector<ScalarPtr>& pkey, const char* encoded_columns,
+                                        const std::vector<Column>& columns) {
     std::vector<ScalarPtr> result;
     result.reserve(columns.size());
 
@@ -106,6 +111,47 @@ class Table {
   }
 
  public:
+  /**
+   * Selects the rows whose primary key starts with prefix, which consists of all but the last primary key
+   * column, and whose last primary key column is in [from, to). The rows are returned in storage key order.
+   * Only tables with grouped columns can be scanned.
+   */
+  std::vector<std::vector<ScalarPtr>> Scan(const std::vector<ScalarPtr>& prefix, int64_t from, int64_t to,
+                                           const std::vector<Column>& columns = {}) {
+    CHECK(kGroupedColumns) << "Only tables with grouped columns can be scanned";
+    CHECK_EQ(prefix.size(), kPKeySize - 1) << "Prefix must contain all but the last primary key column";
+
+    const auto& last_type = Schema::ColumnTypes[kPKeySize - 1];
+    std::vector<ScalarPtr> pkey(prefix);
+    pkey.push_back(MakeIntScalar(last_type, from));
+
+    std::vector<std::vector<ScalarPtr>> rows;
+    // All storage keys sharing the prefix are within [start, end)
+    auto start = MakeStorageKey(pkey);
+    start.resize(start.size() - last_type->size());
+    auto end = PrefixSuccessor(start);
+    std::vector<std::pair<std::string, const std::string*>> entries;
+    if (storage_adapter_->Scan(start, end, std::numeric_limits<size_t>::max(), entries)) {
+      for (const auto& [key, value] : entries) {
+        pkey.back() = MakeScalar(last_type, reinterpret_cast<const void*>(key.data() + start.size()));
+        auto last = IntValue(pkey.back());
+        if (last >= from && last < to) {
+          rows.push_back(MakeGroupedRow(pkey, value->data(), columns));
+        }
+      }
+    } else {
+      // The adapter cannot scan (e.g. it only collects the keys of a transaction) so read every possible key
+      for (auto i = from; i < to; i++) {
+        pkey.back() = MakeIntScalar(last_type, i);
+        auto row = SelectGrouped(pkey, columns);
+        if (!row.empty()) {
+          rows.push_back(std::move(row));
+        }
+      }
+    }
+    return rows;
+  }
+
   bool Update(const std::vector<ScalarPtr>& pkey, const std::vector<Column>& columns,
               const std::vector<ScalarPtr>& values) {
     CHECK_EQ(columns.size(), values.size()) << "Number of values does not match number of columns";
@@ -262,6 +308,50 @@ class Table {
   }
 
  private:
+  // Returns the smallest string that is larger than all strings starting with prefix, or
+  // an empty string if there is no such string
+  inline static std::string PrefixSuccessor(std::string prefix) {
+    while (!prefix.empty() && static_cast<uint8_t>(prefix.back()) == 0xFF) {
+      prefix.pop_back();
+    }
+    if (!prefix.empty()) {
+      prefix.back()++;
+    }
+    return prefix;
+  }
+
+  inline static ScalarPtr MakeIntScalar(const std::shared_ptr<DataType>& type, int64_t value) {
+    switch (type->name()) {
+      case DataTypeName::INT8:
+        return MakeInt8Scalar(value);
+      case DataTypeName::INT16:
+        return MakeInt16Scalar(value);
+      case DataTypeName::INT32:
+        return MakeInt32Scalar(value);
+      case DataTypeName::INT64:
+        return MakeInt64Scalar(value);
+      default:
+        LOG(FATAL) << "Not an integer type: " << type->to_string();
+    }
+    return nullptr;
+  }
+
+  inline static int64_t IntValue(const ScalarPtr& scalar) {
+    switch (scalar->type->name()) {
+      case DataTypeName::INT8:
+        return UncheckedCast<Int8Scalar>(scalar)->value;
+      case DataTypeName::INT16:
+        return UncheckedCast<Int16Scalar>(scalar)->value;
+      case DataTypeName::INT32:
+        return UncheckedCast<Int32Scalar>(scalar)->value;
+      case DataTypeName::INT64:
+        return UncheckedCast<Int64Scalar>(scalar)->value;
+      default:
+        LOG(FATAL) << "Not an integer type: " << scalar->type->to_string();
+    }
+    return 0;
+  }
+
   inline static void ValidateType(const ScalarPtr& val, Column col) {
     const auto& value_type = val->type;
     const auto& col_type = Schema::ColumnTypes[static_cast<size_t>(col)];
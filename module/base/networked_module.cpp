@@ -18,6 +18,42 @@ namespace slog {
 
 using internal::Envelope;
 
+namespace {
+
+ModuleId ModuleOfChannel(Channel channel) {
+  switch (channel) {
+    case kServerChannel:
+      return ModuleId::SERVER;
+    case kForwarderChannel:
+      return ModuleId::FORWARDER;
+    case kSequencerChannel:
+    case kBatcherChannel:
+      return ModuleId::SEQUENCER;
+    case kMultiHomeOrdererChannel:
+      return ModuleId::MHORDERER;
+    case kClockSynchronizerChannel:
+      return ModuleId::CLOCK_SYNCHRONIZER;
+    case kSchedulerChannel:
+    case kDeadlockResolverChannel:
+      return ModuleId::SCHEDULER;
+    case kLocalPaxos:
+      return ModuleId::LOCALPAXOS;
+    case kGlobalPaxos:
+      return ModuleId::GLOBALPAXOS;
+    default:
+      break;
+  }
+  if (channel >= kLogManagerChannel && channel < kWorkerChannel) {
+    return ModuleId::LOG_MANAGER;
+  }
+  if (channel >= kWorkerChannel && channel < kMaxChannel) {
+    return ModuleId::WORKER;
+  }
+  return ModuleId::BROKER;
+}
+
+}  // namespace
+
 NetworkedModule::NetworkedModule(const std::shared_ptr<zmq::context_t>& context, const ConfigurationPtr& config,
                                  Channel channel, const MetricsRepositoryManagerPtr& metrics_manager,
                                  std::optional<std::chrono::milliseconds> poll_timeout, bool is_long_sender)
@@ -27,8 +63,11 @@ NetworkedModule::NetworkedModule(const std::shared_ptr<zmq::context_t>& context,
       port_(std::nullopt),
       metrics_manager_(metrics_manager),
       sender_(config, context, is_long_sender),
-      poller_(poll_timeout),
-      recv_retries_(0) {
+      poller_(poll_timeout, config->polling_options(ModuleOfChannel(channel))) {
+  sender_.EnableCoalescing([this](std::chrono::microseconds delay) {
+    NewTimedCallback(delay, [this] { sender_.FlushCoalesced(); });
+  });
+
   std::ostringstream os;
   os << "machine_id = " << MACHINE_ID_STR(config->local_machine_id());
   debug_info_ = os.str();
@@ -56,13 +95,13 @@ void NetworkedModule::AddCustomSocket(zmq::socket_t&& new_socket) {
 
 zmq::socket_t& NetworkedModule::GetCustomSocket(size_t i) { return custom_sockets_.at(i); }
 
+void NetworkedModule::AddCustomQueue(PollableQueue& queue) { poller_.PushQueue(queue); }
+
 void NetworkedModule::SetUp() {
   VLOG(1) << "Thread info (" << name() << "): " << debug_info_;
 
-  inproc_socket_ = zmq::socket_t(*context_, ZMQ_PULL);
-  inproc_socket_.bind(MakeInProcChannelAddress(channel_));
-  inproc_socket_.set(zmq::sockopt::rcvhwm, 0);
-  poller_.PushSocket(inproc_socket_);
+  inproc_channel_ = GetInprocChannel(*context_, channel_);
+  poller_.PushQueue(*inproc_channel_);
 
   if (port_.has_value()) {
     outproc_socket_ = zmq::socket_t(*context_, ZMQ_PULL);
@@ -70,43 +109,55 @@ void NetworkedModule::SetUp() {
     outproc_socket_.set(zmq::sockopt::rcvhwm, 0);
     outproc_socket_.set(zmq::sockopt::rcvbuf, config_->broker_rcvbuf());
     outproc_socket_.bind(addr);
-    poller_.PushSocket(outproc_socket_);
+    if (config_->protocol() == "shm") {
+      shm_receiver_ = make_unique<ShmReceiver>(outproc_socket_);
+      poller_.PushShmReceiver(*shm_receiver_);
+    } else {
+      poller_.PushSocket(outproc_socket_);
+    }
 
     LOG(INFO) << "Bound " << name() << " to \"" << addr << "\"";
   }
 
   if (metrics_manager_ != nullptr) {
-    metrics_manager_->RegisterCurrentThread();
+    metrics_manager_->RegisterCurrentThread(name());
   }
 
   Initialize();
 }
 
 bool NetworkedModule::Loop() {
-  if (!poller_.NextEvent(recv_retries_ > 0 /* dont_wait */)) {
+  if (!poller_.NextRound()) {
+    poller_.FinishRound(false /* did_work */);
     return false;
   }
 
-  if (OnEnvelopeReceived(RecvEnvelope(inproc_socket_, true /* dont_wait */))) {
-    recv_retries_ = kRecvRetries;
-  }
+  bool did_work = OnEnvelopeReceived(RecvEnvelope(*inproc_channel_, true /* dont_wait */));
 
   if (outproc_socket_.handle() != ZMQ_NULLPTR) {
-    if (zmq::message_t msg; outproc_socket_.recv(msg, zmq::recv_flags::dontwait)) {
-      auto env = DeserializeEnvelope(msg);
-      if (OnEnvelopeReceived(move(env))) {
-        recv_retries_ = kRecvRetries;
+    zmq::message_t msg, body;
+    if (shm_receiver_ != nullptr ? shm_receiver_->Recv(msg)
+                                 : RecvAddressedBuffer(outproc_socket_, msg, body, true /* dont_wait */)) {
+      if (IsCoalescedMessage(msg)) {
+        vector<zmq::message_t> messages;
+        if (!SplitCoalescedMessage(msg, messages)) {
+          LOG(ERROR) << "Malformed coalesced message";
+        }
+        for (const auto& m : messages) {
+          OnEnvelopeReceived(DeserializeEnvelope(m));
+        }
+        did_work = true;
+      } else if (OnEnvelopeReceived(DeserializeEnvelope(msg, body))) {
+        did_work = true;
       }
     }
   }
 
   if (OnCustomSocket()) {
-    recv_retries_ = kRecvRetries;
+    did_work = true;
   }
 
-  if (recv_retries_ > 0) {
-    recv_retries_--;
-  }
+  poller_.FinishRound(did_work);
 
   return false;
 }
@@ -117,6 +168,9 @@ bool NetworkedModule::OnEnvelopeReceived(EnvelopePtr&& wrapped_env) {
   }
   EnvelopePtr env;
   if (wrapped_env->type_case() == Envelope::TypeCase::kRaw) {
+    if (OnRawEnvelopeReceived(*wrapped_env)) {
+      return true;
+    }
     env.reset(new Envelope());
     if (DeserializeProto(*env, wrapped_env->raw().data(), wrapped_env->raw().size())) {
       env->set_from(wrapped_env->from());
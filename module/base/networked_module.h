@@ -7,6 +7,7 @@
 #include "common/metrics.h"
 #include "common/types.h"
 #include "connection/broker.h"
+#include "connection/inproc_queue.h"
 #include "connection/poller.h"
 #include "connection/sender.h"
 #include "connection/zmq_utils.h"
@@ -53,12 +54,21 @@ class NetworkedModule : public Module {
 
   virtual void OnInternalResponseReceived(EnvelopePtr&& /* env */) {}
 
+  /**
+   * Called with each envelope received on a raw channel before it is deserialized. Returns true if the
+   * envelope has been handled, otherwise it is deserialized and passed to the functions above
+   */
+  virtual bool OnRawEnvelopeReceived(const internal::Envelope& /* wrapped_env */) { return false; }
+
   // Returns true if useful work was done
   virtual bool OnCustomSocket() { return false; }
 
   void AddCustomSocket(zmq::socket_t&& new_socket);
   zmq::socket_t& GetCustomSocket(size_t i);
 
+  // Wakes up the module when the queue receives something. The queue must outlive the module
+  void AddCustomQueue(PollableQueue& queue);
+
   inline static EnvelopePtr NewEnvelope() { return std::make_unique<internal::Envelope>(); }
   void Send(const internal::Envelope& env, MachineId to_machine_id, Channel to_channel);
   void Send(EnvelopePtr&& env, MachineId to_machine_id, Channel to_channel);
@@ -86,12 +96,13 @@ class NetworkedModule : public Module {
   Channel channel_;
   std::optional<uint32_t> port_;
   MetricsRepositoryManagerPtr metrics_manager_;
-  zmq::socket_t inproc_socket_;
+  std::shared_ptr<InprocChannel> inproc_channel_;
   zmq::socket_t outproc_socket_;
+  // Receives through the outproc socket if the protocol is "shm"
+  std::unique_ptr<ShmReceiver> shm_receiver_;
   std::vector<zmq::socket_t> custom_sockets_;
   Sender sender_;
   Poller poller_;
-  int recv_retries_;
 
   std::string debug_info_;
 
@@ -97,6 +97,8 @@ void Forwarder::ProcessForwardTxn(EnvelopePtr&& env) {
   }
 
   bool need_remote_lookup = false;
+  std::vector<ValueEntry*> local_values;
+  local_keys_.clear();
   for (auto& kv : *txn->mutable_keys()) {
     const auto& key = kv.key();
     auto value = kv.mutable_value_entry();
@@ -106,17 +108,10 @@ void Forwarder::ProcessForwardTxn(EnvelopePtr&& env) {
       value->mutable_metadata()->set_master(0);
       value->mutable_metadata()->set_counter(0);
     }
-    // If this is a local partition, lookup the master info from the local storage
+    // If this is a local partition, lookup the master info from the local storage below
     else if (auto partition = sharder_->compute_partition(key); partition == config()->local_partition()) {
-      Metadata metadata;
-      if (lookup_master_index_->GetMasterMetadata(key, metadata)) {
-        value->mutable_metadata()->set_master(metadata.master);
-        value->mutable_metadata()->set_counter(metadata.counter);
-      } else {
-        auto new_metadata = metadata_initializer_->Compute(key);
-        value->mutable_metadata()->set_master(new_metadata.master);
-        value->mutable_metadata()->set_counter(new_metadata.counter);
-      }
+      local_keys_.push_back(&key);
+      local_values.push_back(value);
     }
     // Otherwise, add the key to the appropriate remote lookup master request
     else {
@@ -125,6 +120,15 @@ void Forwarder::ProcessForwardTxn(EnvelopePtr&& env) {
     }
   }
 
+  // Look up the local keys together so that their cache misses overlap
+  lookup_master_index_->MultiGetMasterMetadata(local_keys_, local_metadata_);
+  for (size_t i = 0; i < local_keys_.size(); i++) {
+    auto metadata =
+        local_metadata_[i].has_value() ? *local_metadata_[i] : metadata_initializer_->Compute(*local_keys_[i]);
+    local_values[i]->mutable_metadata()->set_master(metadata.master);
+    local_values[i]->mutable_metadata()->set_counter(metadata.counter);
+  }
+
   // If there is no need to look master info from remote partitions,
   // forward the txn immediately
   if (!need_remote_lookup) {
@@ -178,24 +182,28 @@ void Forwarder::ProcessLookUpMasterRequest(EnvelopePtr&& env) {
   auto results = lookup_response->mutable_lookup_results();
 
   lookup_response->mutable_txn_ids()->CopyFrom(lookup_master.txn_ids());
+  local_keys_.clear();
   for (int i = 0; i < lookup_master.keys_size(); i++) {
     const auto& key = lookup_master.keys(i);
-
     if (sharder_->is_local_key(key)) {
-      if (Metadata metadata; lookup_master_index_->GetMasterMetadata(key, metadata)) {
-        // If key exists, add the metadata of current key to the response
-        auto key_metadata = results->Add();
-        key_metadata->set_key(key);
-        key_metadata->mutable_metadata()->set_master(metadata.master);
-        key_metadata->mutable_metadata()->set_counter(metadata.counter);
-      } else {
-        // Otherwise, assign it to the default region for new key
-        auto key_metadata = results->Add();
-        key_metadata->set_key(key);
-        auto new_metadata = metadata_initializer_->Compute(key);
-        key_metadata->mutable_metadata()->set_master(new_metadata.master);
-        key_metadata->mutable_metadata()->set_counter(new_metadata.counter);
-      }
+      local_keys_.push_back(&key);
+    }
+  }
+
+  lookup_master_index_->MultiGetMasterMetadata(local_keys_, local_metadata_);
+  for (size_t i = 0; i < local_keys_.size(); i++) {
+    const auto& key = *local_keys_[i];
+    auto key_metadata = results->Add();
+    key_metadata->set_key(key);
+    if (local_metadata_[i].has_value()) {
+      // If key exists, add the metadata of current key to the response
+      key_metadata->mutable_metadata()->set_master(local_metadata_[i]->master);
+      key_metadata->mutable_metadata()->set_counter(local_metadata_[i]->counter);
+    } else {
+      // Otherwise, assign it to the default region for new key
+      auto new_metadata = metadata_initializer_->Compute(key);
+      key_metadata->mutable_metadata()->set_master(new_metadata.master);
+      key_metadata->mutable_metadata()->set_counter(new_metadata.counter);
     }
   }
   Send(lookup_env, env->from(), kForwarderChannel);
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <optional>
 #include <random>
 #include <unordered_map>
+#include <vector>
 
 #include "common/configuration.h"
 #include "common/metrics.h"
@@ -69,6 +71,9 @@ class Forwarder : public NetworkedModule {
   std::shared_ptr<MetadataInitializer> metadata_initializer_;
   std::unordered_map<TxnId, EnvelopePtr> pending_transactions_;
   std::vector<internal::Envelope> partitioned_lookup_request_;
+  // Reused buffers for looking up the metadata of local keys
+  std::vector<const Key*> local_keys_;
+  std::vector<std::optional<Metadata>> local_metadata_;
   int batch_size_;
   std::vector<RollingWindow<int64_t>> latencies_ns_;
   std::chrono::steady_clock::time_point batch_starting_time_;
@@ -29,6 +29,7 @@ using slog::kSchedulerChannel;
 using slog::MakeMachineId;
 using slog::MakeRunnerFor;
 using slog::per_thread_metrics_repo;
+using slog::WorkerOfTxn;
 using slog::internal::Request;
 using slog::internal::Response;
 
@@ -67,9 +68,11 @@ Scheduler::Scheduler(const shared_ptr<Broker>& broker, const shared_ptr<Storage>
                      const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
     : NetworkedModule(broker, {kSchedulerChannel, false /* is_raw */}, metrics_manager, poll_timeout),
       sccs_finder_(graph_, execution_horizon_),
-      current_worker_(0) {
+      finished_txns_(make_shared<slog::InprocQueue<TxnId>>()) {
   for (int i = 0; i < config()->num_workers(); i++) {
-    workers_.push_back(MakeRunnerFor<Worker>(i, broker, storage, metrics_manager, poll_timeout));
+    auto txns = make_shared<slog::InprocQueue<Transaction*>>();
+    worker_txns_.emplace_back(txns);
+    workers_.push_back(MakeRunnerFor<Worker>(i, txns, finished_txns_, broker, storage, metrics_manager, poll_timeout));
   }
 }
 
@@ -82,16 +85,10 @@ void Scheduler::Initialize() {
       cpu = cpus[i];
     }
     worker->StartInNewThread(cpu);
-
-    zmq::socket_t worker_socket(*context(), ZMQ_PAIR);
-    worker_socket.set(zmq::sockopt::rcvhwm, 0);
-    worker_socket.set(zmq::sockopt::sndhwm, 0);
-    worker_socket.bind(kSchedWorkerAddress + std::to_string(i));
-
-    AddCustomSocket(move(worker_socket));
-
     i++;
   }
+
+  AddCustomQueue(*finished_txns_);
 }
 
 void Scheduler::OnInternalRequestReceived(EnvelopePtr&& env) {
@@ -203,13 +200,11 @@ void Scheduler::DispatchSCCs(const vector<SCC>& sccs) {
       auto txn_it = txns_.find(txn_id);
       CHECK(txn_it != txns_.end()) << "Could not find transaction " << txn_id;
 
-      zmq::message_t msg(sizeof(Transaction*));
-      *msg.data<Transaction*>() = txn_it->second;
+      auto txn = txn_it->second;
       txns_.erase(txn_it);
 
-      int worker = current_worker_;
-      current_worker_ = (current_worker_ + 1) % workers_.size();
-      GetCustomSocket(worker).send(msg, zmq::send_flags::none);
+      auto worker = WorkerOfTxn(txn_id, workers_.size());
+      worker_txns_[worker].Push(move(txn));
     }
 
     if (per_thread_metrics_repo != nullptr && scc.size() > 1) {
@@ -221,19 +216,11 @@ void Scheduler::DispatchSCCs(const vector<SCC>& sccs) {
 // Handle responses from the workers
 bool Scheduler::OnCustomSocket() {
   bool has_msg = false;
-  bool stop = false;
-  while (!stop) {
-    stop = true;
-    for (size_t i = 0; i < workers_.size(); i++) {
-      if (zmq::message_t msg; GetCustomSocket(i).recv(msg, zmq::recv_flags::dontwait)) {
-        stop = false;
-        has_msg = true;
-        auto txn_id = *msg.data<TxnId>();
-        execution_horizon_.Add(txn_id);
-        graph_.erase(txn_id);
-      }
-    }
-  };
+  for (TxnId txn_id; finished_txns_->Pop(txn_id);) {
+    has_msg = true;
+    execution_horizon_.Add(txn_id);
+    graph_.erase(txn_id);
+  }
 
   return has_msg;
 }
@@ -70,10 +70,12 @@ class Scheduler : public slog::NetworkedModule {
   PendingIndex pending_txns_;
   std::unordered_map<TxnId, std::vector<EnvelopePtr>> pending_inquiries_;
 
+  std::vector<slog::InprocQueue<Transaction*>::Producer> worker_txns_;
+  std::shared_ptr<slog::InprocQueue<TxnId>> finished_txns_;
+
   // This must be defined at the end so that the workers exit before any resources
   // in the scheduler is destroyed
   std::vector<std::unique_ptr<slog::ModuleRunner>> workers_;
-  int current_worker_;
 };
 
 }  // namespace janus
\ No newline at end of file
@@ -25,10 +25,14 @@ using slog::internal::Request;
 using slog::internal::Response;
 using std::make_unique;
 
-Worker::Worker(int id, const std::shared_ptr<Broker>& broker, const std::shared_ptr<Storage>& storage,
-               const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
+Worker::Worker(int id, const std::shared_ptr<InprocQueue<Transaction*>>& txns,
+               const std::shared_ptr<InprocQueue<TxnId>>& finished_txns, const std::shared_ptr<Broker>& broker,
+               const std::shared_ptr<Storage>& storage, const MetricsRepositoryManagerPtr& metrics_manager,
+               std::chrono::milliseconds poll_timeout)
     : NetworkedModule(broker, kWorkerChannel + id, metrics_manager, poll_timeout),
       id_(id),
+      txns_(txns),
+      finished_txns_(finished_txns),
       storage_(storage),
       sharder_(slog::Sharder::MakeSharder(config())) {
   switch (config()->execution_type()) {
@@ -44,28 +48,25 @@ Worker::Worker(int id, const std::shared_ptr<Broker>& broker, const std::shared_
   }
 }
 
-void Worker::Initialize() {
-  zmq::socket_t sched_socket(*context(), ZMQ_PAIR);
-  sched_socket.set(zmq::sockopt::rcvhwm, 0);
-  sched_socket.set(zmq::sockopt::sndhwm, 0);
-  sched_socket.connect(kSchedWorkerAddress + std::to_string(id_));
-
-  AddCustomSocket(std::move(sched_socket));
-}
+void Worker::Initialize() { AddCustomQueue(*txns_); }
 
 void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
   CHECK_EQ(env->request().type_case(), Request::kRemoteReadResult) << "Invalid request for worker";
   auto& read_result = env->request().remote_read_result();
   auto txn_id = read_result.txn_id();
-  auto state_it = txn_states_.find(txn_id);
-  if (state_it == txn_states_.end()) {
-    LOG(WARNING) << "Transaction " << txn_id << " does not exist for remote read result";
+  if (txn_states_.find(txn_id) == txn_states_.end()) {
+    VLOG(3) << "Hold remote read result for txn " << txn_id << " until it is dispatched";
+    early_remote_reads_[txn_id].push_back(std::move(env));
     return;
   }
 
+  ApplyRemoteReads(txn_id, read_result);
+}
+
+void Worker::ApplyRemoteReads(TxnId txn_id, const slog::internal::RemoteReadResult& read_result) {
   VLOG(3) << "Got remote read result for txn " << txn_id;
 
-  auto& state = state_it->second;
+  auto& state = TxnState(txn_id);
   auto txn = state.txn;
 
   if (read_result.deadlocked()) {
@@ -96,9 +97,6 @@ void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
     if (state.phase == TransactionState::Phase::WAIT_REMOTE_READ) {
       state.phase = TransactionState::Phase::EXECUTE;
 
-      // Remove the redirection at broker for this txn
-      StopRedirection(txn_id);
-
       VLOG(3) << "Execute txn " << txn_id << " after receving all remote read results";
     } else {
       LOG(FATAL) << "Invalid phase";
@@ -109,14 +107,11 @@ void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
 }
 
 bool Worker::OnCustomSocket() {
-  auto& sched_socket = GetCustomSocket(0);
-
-  zmq::message_t msg;
-  if (!sched_socket.recv(msg, zmq::recv_flags::dontwait)) {
+  Transaction* txn;
+  if (!txns_->Pop(txn)) {
     return false;
   }
 
-  auto txn = *msg.data<Transaction*>();
   auto txn_id = txn->internal().id();
 
   RECORD(txn->mutable_internal(), TransactionEvent::ENTER_WORKER);
@@ -132,6 +127,19 @@ bool Worker::OnCustomSocket() {
 
   AdvanceTransaction(txn_id);
 
+  // Apply the remote reads that arrived before the txn
+  if (auto early_it = early_remote_reads_.find(txn_id); early_it != early_remote_reads_.end()) {
+    auto early_reads = std::move(early_it->second);
+    early_remote_reads_.erase(early_it);
+    for (auto& env : early_reads) {
+      if (txn_states_.find(txn_id) == txn_states_.end()) {
+        LOG(WARNING) << "Transaction " << txn_id << " does not exist for remote read result";
+        break;
+      }
+      ApplyRemoteReads(txn_id, env->request().remote_read_result());
+    }
+  }
+
   return true;
 }
 
@@ -169,8 +177,8 @@ void Worker::ReadLocalStorage(TxnId txn_id) {
       const auto& key = kv.key();
       if (sharder_->is_local_key(key)) {
         auto value = kv.mutable_value_entry();
-        if (Record record; storage_->Read(key, record)) {
-          value->set_value(record.to_string());
+        if (auto record = storage_->ReadView(key); record) {
+          value->set_value(record->data(), record->size());
         }
       }
     }
@@ -193,9 +201,6 @@ void Worker::ReadLocalStorage(TxnId txn_id) {
     VLOG(3) << "Execute txn " << txn_id << " without remote reads";
     state.phase = TransactionState::Phase::EXECUTE;
   } else {
-    // Establish a redirection at broker for this txn so that we can receive remote reads
-    StartRedirection(txn_id);
-
     VLOG(3) << "Defer executing txn " << txn_id << " until having enough remote reads";
     state.phase = TransactionState::Phase::WAIT_REMOTE_READ;
   }
@@ -242,9 +247,7 @@ void Worker::Finish(TxnId txn_id) {
   }
 
   // Notify the scheduler that we're done
-  zmq::message_t msg(sizeof(TxnId));
-  *msg.data<TxnId>() = txn_id;
-  GetCustomSocket(0).send(msg, zmq::send_flags::none);
+  finished_txns_.Push(TxnId(txn_id));
 
   // Done with this txn. Remove it from the state map
   txn_states_.erase(txn_id);
@@ -290,7 +293,8 @@ void Worker::BroadcastReads(TxnId txn_id) {
     }
   }
 
-  Send(env, destinations, txn_id);
+  // The txn is dispatched to the worker with the same id on every partition
+  Send(env, destinations, channel());
 }
 
 TransactionState& Worker::TxnState(TxnId txn_id) {
@@ -299,18 +303,4 @@ TransactionState& Worker::TxnState(TxnId txn_id) {
   return state_it->second;
 }
 
-void Worker::StartRedirection(TxnId txn_id) {
-  auto redirect_env = NewEnvelope();
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_tag(txn_id);
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_channel(channel());
-  Send(move(redirect_env), Broker::MakeChannel(config()->broker_ports_size() - 1));
-}
-
-void Worker::StopRedirection(TxnId txn_id) {
-  auto redirect_env = NewEnvelope();
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_tag(txn_id);
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_stop(true);
-  Send(move(redirect_env), Broker::MakeChannel(config()->broker_ports_size() - 1));
-}
-
 }  // namespace janus
\ No newline at end of file
@@ -21,13 +21,12 @@ namespace janus {
 using slog::Broker;
 using slog::EnvelopePtr;
 using slog::Execution;
+using slog::InprocQueue;
 using slog::MetricsRepositoryManagerPtr;
 using slog::Storage;
 using slog::Transaction;
 using slog::TxnId;
 
-const std::string kSchedWorkerAddress = "inproc://sched_worker";
-
 struct TransactionState {
   enum class Phase { READ_LOCAL_STORAGE, WAIT_REMOTE_READ, EXECUTE, FINISH };
 
@@ -45,8 +44,13 @@ struct TransactionState {
  */
 class Worker : public slog::NetworkedModule {
  public:
-  Worker(int id, const std::shared_ptr<Broker>& broker, const std::shared_ptr<Storage>& storage,
-         const MetricsRepositoryManagerPtr& metrics_manager,
+  /**
+   * @param txns Txns dispatched by the scheduler to this worker
+   * @param finished_txns Ids of the txns that the workers have finished, which are sent back to the scheduler
+   */
+  Worker(int id, const std::shared_ptr<InprocQueue<Transaction*>>& txns,
+         const std::shared_ptr<InprocQueue<TxnId>>& finished_txns, const std::shared_ptr<Broker>& broker,
+         const std::shared_ptr<Storage>& storage, const MetricsRepositoryManagerPtr& metrics_manager,
          std::chrono::milliseconds poll_timeout_ms = slog::kModuleTimeout);
 
   std::string name() const override { return "Worker-" + std::to_string(channel()); }
@@ -56,6 +60,7 @@ class Worker : public slog::NetworkedModule {
   /**
    * Applies remote read for transactions that are in the WAIT_REMOTE_READ phase.
    * When all remote reads are received, the transaction is moved to the EXECUTE phase.
+   * The remote reads of a transaction that has not been dispatched here yet are held until it is.
    */
   void OnInternalRequestReceived(EnvelopePtr&& env) final;
 
@@ -88,18 +93,21 @@ class Worker : public slog::NetworkedModule {
 
   void BroadcastReads(TxnId txn_id);
 
+  void ApplyRemoteReads(TxnId txn_id, const slog::internal::RemoteReadResult& read_result);
+
   // Precondition: txn_id must exists in txn states table
   TransactionState& TxnState(TxnId txn_id);
 
-  void StartRedirection(TxnId txn_id);
-  void StopRedirection(TxnId txn_id);
-
   int id_;
+  std::shared_ptr<InprocQueue<Transaction*>> txns_;
+  InprocQueue<TxnId>::Producer finished_txns_;
   std::shared_ptr<Storage> storage_;
   std::unique_ptr<Execution> execution_;
   const slog::SharderPtr sharder_;
 
   std::map<TxnId, TransactionState> txn_states_;
+  // Remote reads that arrive before their txns are dispatched to this worker
+  std::map<TxnId, std::vector<EnvelopePtr>> early_remote_reads_;
 };
 
 }  // namespace janus
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "common/constants.h"
 #include "common/json_utils.h"
 #include "common/proto_utils.h"
+#include "common/shared_arena.h"
 #include "proto/internal.pb.h"
 
 using std::shared_ptr;
@@ -91,17 +92,34 @@ LogManager::LogManager(int id, const std::vector<RegionId>& regions, const share
   }
 }
 
-void LogManager::OnInternalRequestReceived(EnvelopePtr&& env) {
-  auto request = env->mutable_request();
+void LogManager::OnInternalRequestReceived(EnvelopePtr&& env) { ProcessRequest(*env); }
+
+bool LogManager::OnRawEnvelopeReceived(const Envelope& wrapped_env) {
+  const auto& raw = wrapped_env.raw();
+  // Deserialize into an arena so that the batches and their txns are bump-allocated. The first block is
+  // sized after the message so that it usually holds the whole message
+  auto arena = NewSharedArena(2 * raw.size());
+  auto env = google::protobuf::Arena::CreateMessage<Envelope>(arena);
+  if (DeserializeProto(*env, raw.data(), raw.size())) {
+    env->set_from(wrapped_env.from());
+    ProcessRequest(*env);
+  }
+  // The batch taken from the envelope keeps the arena alive
+  UnrefSharedArena(arena);
+  return true;
+}
+
+void LogManager::ProcessRequest(Envelope& env) {
+  auto request = env.mutable_request();
   switch (request->type_case()) {
     case Request::kBatchReplicationAck:
-      ProcessBatchReplicationAck(std::move(env));
+      ProcessBatchReplicationAck(env);
       break;
     case Request::kForwardBatchData:
-      ProcessForwardBatchData(std::move(env));
+      ProcessForwardBatchData(env);
       break;
     case Request::kForwardBatchOrder:
-      ProcessForwardBatchOrder(std::move(env));
+      ProcessForwardBatchOrder(env);
       break;
     default:
       LOG(ERROR) << "Unexpected request type received: \"" << CASE_NAME(request->type_case(), Request) << "\"";
@@ -110,8 +128,8 @@ void LogManager::OnInternalRequestReceived(EnvelopePtr&& env) {
   AdvanceLog();
 }
 
-void LogManager::ProcessBatchReplicationAck(EnvelopePtr&& env) {
-  auto [from_region, from_replica, _] = UnpackMachineId(env->from());
+void LogManager::ProcessBatchReplicationAck(Envelope& env) {
+  auto [from_region, from_replica, _] = UnpackMachineId(env.from());
   auto local_region = config()->local_region();
   auto local_replica = config()->local_replica();
   bool first_time_region = from_region != local_region;
@@ -119,66 +137,73 @@ void LogManager::ProcessBatchReplicationAck(EnvelopePtr&& env) {
   // If this ack comes from another region, propagate the ack to
   // other replicas
   if (first_time_region) {
-    Send(*env, other_replicas_, MakeLogChannel(local_region));
+    Send(env, other_replicas_, MakeLogChannel(local_region));
   }
 
   // If this ack comes from another replica in the same region, propagate the ack to
   // other partitions
   if (first_time_replica) {
-    Send(*env, other_partitions_, MakeLogChannel(local_region));
+    Send(env, other_partitions_, MakeLogChannel(local_region));
   }
 
-  auto batch_id = env->request().batch_replication_ack().batch_id();
+  auto batch_id = env.request().batch_replication_ack().batch_id();
   single_home_logs_[local_region].AckReplication(batch_id);
 }
 
-void LogManager::ProcessForwardBatchData(EnvelopePtr&& env) {
+void LogManager::ProcessForwardBatchData(Envelope& env) {
   auto local_region = config()->local_region();
   auto local_replica = config()->local_replica();
   auto local_partition = config()->local_partition();
-  auto forward_batch_data = env->mutable_request()->mutable_forward_batch_data();
+  auto forward_batch_data = env.mutable_request()->mutable_forward_batch_data();
+  auto batch_data = forward_batch_data->mutable_batch_data();
   MachineId generator = forward_batch_data->generator();
   auto generator_position = forward_batch_data->generator_position();
   auto generator_home = GET_REGION_ID(generator);
-  auto [from_region, from_replica, from_partition] = UnpackMachineId(env->from());
+  auto [from_region, from_replica, from_partition] = UnpackMachineId(env.from());
   bool first_time_region = from_region != local_region;
   bool first_time_replica = first_time_region || from_replica != local_replica;
 
   if (first_time_region) {
     // If this batch comes from a different region, distribute it to other local replicas
-    Send(*env, other_replicas_, MakeLogChannel(generator_home));
+    Send(env, other_replicas_, MakeLogChannel(generator_home));
   }
 
-  BatchPtr my_batch;
   if (first_time_replica) {
     // If this is the first time the batch reaches our replica, distribute the batch partitions
     // to the local partitions
 
-    CHECK_EQ(forward_batch_data->batch_data_size(), config()->num_partitions());
-    PartitionId p = config()->num_partitions() - 1;
-    while (!forward_batch_data->mutable_batch_data()->empty()) {
-      auto batch_partition = forward_batch_data->mutable_batch_data()->ReleaseLast();
-      if (p == local_partition) {
-        my_batch = BatchPtr(batch_partition);
-      } else {
-        auto new_env = NewEnvelope();
-        auto new_forward_batch = new_env->mutable_request()->mutable_forward_batch_data();
-        new_forward_batch->set_generator(generator);
-        new_forward_batch->set_generator_position(generator_position);
-        new_forward_batch->mutable_batch_data()->AddAllocated(batch_partition);
-        Send(*new_env, MakeMachineId(local_region, local_replica, p), MakeLogChannel(generator_home));
+    CHECK_EQ(batch_data->size(), config()->num_partitions());
+    for (int p = 0; p < batch_data->size(); p++) {
+      if (static_cast<PartitionId>(p) == local_partition) {
+        continue;
       }
-      p--;
+      Envelope new_env;
+      auto new_forward_batch = new_env.mutable_request()->mutable_forward_batch_data();
+      new_forward_batch->set_generator(generator);
+      new_forward_batch->set_generator_position(generator_position);
+      // Lend the batch partition to the new envelope only for serialization
+      new_forward_batch->mutable_batch_data()->UnsafeArenaAddAllocated(batch_data->Mutable(p));
+      Send(new_env, MakeMachineId(local_region, local_replica, p), MakeLogChannel(generator_home));
+      new_forward_batch->mutable_batch_data()->UnsafeArenaReleaseLast();
     }
+    batch_data->SwapElements(local_partition, batch_data->size() - 1);
+  }
+
+  // The batch of this partition is now the last one. If the batch comes from the same region and replica,
+  // it is the only one
+  BatchPtr my_batch;
+  if (auto arena = forward_batch_data->GetArena(); arena != nullptr) {
+    // Take the batch without copying it off the arena
+    RefSharedArena(arena);
+    my_batch = BatchPtr(batch_data->UnsafeArenaReleaseLast());
   } else {
-    // If the batch comes from the same region and replica, no need to distribute further
-    my_batch = BatchPtr(forward_batch_data->mutable_batch_data()->ReleaseLast());
+    my_batch = BatchPtr(batch_data->ReleaseLast());
   }
 
   RECORD(my_batch.get(), TransactionEvent::ENTER_LOG_MANAGER_IN_BATCH);
 
   VLOG(1) << "Received data for batch " << TXN_ID_STR(my_batch->id()) << " (home = " << (int)generator_home << ") from "
-          << MACHINE_ID_STR(env->from()) << ". Number of txns: " << my_batch->transactions_size()
+          << MACHINE_ID_STR(env.from()) << ". Number of txns: " << my_batch->transactions_size()
           << ". First time region: " << first_time_region << ". First time replica: " << first_time_replica;
 
   if (generator_home == local_region) {
@@ -190,9 +215,9 @@ void LogManager::ProcessForwardBatchData(EnvelopePtr&& env) {
   single_home_logs_[generator_home].AddBatch(move(my_batch));
 }
 
-void LogManager::ProcessForwardBatchOrder(EnvelopePtr&& env) {
-  auto forward_batch_order = env->mutable_request()->mutable_forward_batch_order();
-  auto [from_region, from_replica, from_partition] = UnpackMachineId(env->from());
+void LogManager::ProcessForwardBatchOrder(Envelope& env) {
+  auto forward_batch_order = env.mutable_request()->mutable_forward_batch_order();
+  auto [from_region, from_replica, from_partition] = UnpackMachineId(env.from());
   auto local_region = config()->local_region();
   auto local_replica = config()->local_replica();
   auto local_partition = config()->local_partition();
@@ -207,7 +232,7 @@ void LogManager::ProcessForwardBatchOrder(EnvelopePtr&& env) {
       // If the current replica is not the leader replica and this partition learns about the
       // order directly from Paxos, distribute the order to other partitions in the same replica
       if (GET_REPLICA_ID(order.leader()) != local_replica && from_partition == local_partition) {
-        Send(*env, other_partitions_, MakeLogChannel(local_region));
+        Send(env, other_partitions_, MakeLogChannel(local_region));
       }
       break;
     }
@@ -222,19 +247,19 @@ void LogManager::ProcessForwardBatchOrder(EnvelopePtr&& env) {
       // If this is the first time this order reaches the current region,
       // send it to other replicas
       if (first_time_region) {
-        Send(*env, other_replicas_, tag);
+        Send(env, other_replicas_, tag);
         // Ack back if needed
         if (batch_order.need_ack()) {
           Envelope env_ack;
           env_ack.mutable_request()->mutable_batch_replication_ack()->set_batch_id(batch_id);
-          Send(env_ack, env->from(), tag);
+          Send(env_ack, env.from(), tag);
         }
       }
 
       // If this is the first time this order reaches the current replica,
       // send it to other partitions
       if (first_time_replica) {
-        Send(*env, other_partitions_, tag);
+        Send(env, other_partitions_, tag);
       }
 
       VLOG(1) << "Received remote batch order " << TXN_ID_STR(batch_id) << " (home = " << home << ") from ["
@@ -324,9 +349,11 @@ void LogManager::EmitBatch(BatchPtr&& batch) {
   auto transactions = Unbatch(batch.get());
   for (auto txn : transactions) {
     RECORD(txn->mutable_internal(), TransactionEvent::EXIT_LOG_MANAGER);
-    auto env = NewEnvelope();
-    auto forward_txn = env->mutable_request()->mutable_forward_txn();
-    forward_txn->set_allocated_txn(txn);
+    // A txn on a shared arena is put in an envelope on the same arena so that it is not copied. The
+    // reference of the txn to the arena is handed over to the envelope
+    EnvelopePtr env(txn->GetArena() == nullptr ? new Envelope()
+                                               : google::protobuf::Arena::CreateMessage<Envelope>(txn->GetArena()));
+    env->mutable_request()->mutable_forward_txn()->set_allocated_txn(txn);
     Send(move(env), kSchedulerChannel);
   }
 }
@@ -60,10 +60,13 @@ class LogManager : public NetworkedModule {
  protected:
   void OnInternalRequestReceived(EnvelopePtr&& env) final;
 
+  bool OnRawEnvelopeReceived(const internal::Envelope& wrapped_env) final;
+
  private:
-  void ProcessBatchReplicationAck(EnvelopePtr&& env);
-  void ProcessForwardBatchData(EnvelopePtr&& env);
-  void ProcessForwardBatchOrder(EnvelopePtr&& env);
+  void ProcessRequest(internal::Envelope& env);
+  void ProcessBatchReplicationAck(internal::Envelope& env);
+  void ProcessForwardBatchData(internal::Envelope& env);
+  void ProcessForwardBatchOrder(internal::Envelope& env);
   void AdvanceLog();
   void EmitBatch(BatchPtr&& batch);
 
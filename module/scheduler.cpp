@@ -28,6 +28,7 @@
 
 #include "common/json_utils.h"
 #include "common/proto_utils.h"
+#include "common/shared_arena.h"
 #include "common/types.h"
 #include "proto/internal.pb.h"
 
@@ -44,10 +45,16 @@ using internal::Response;
 Scheduler::Scheduler(const shared_ptr<Broker>& broker, const shared_ptr<Storage>& storage,
                      const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
     : NetworkedModule(broker, {kSchedulerChannel, false /* is_raw */}, metrics_manager, poll_timeout),
-      current_worker_(0),
-      global_log_counter_(0) {
+      storage_(storage),
+      finished_txns_(make_shared<InprocQueue<TxnId>>()),
+      prefetched_txns_(make_shared<InprocQueue<TxnId>>()),
+      prefetched_txns_producer_(make_shared<PrefetchedTxns>(prefetched_txns_)),
+      global_log_counter_(0),
+      advertised_credits_(0) {
   for (int i = 0; i < config()->num_workers(); i++) {
-    workers_.push_back(MakeRunnerFor<Worker>(i, broker, storage, metrics_manager, poll_timeout));
+    auto txns = make_shared<InprocQueue<DispatchedTxn>>();
+    worker_txns_.emplace_back(txns);
+    workers_.push_back(MakeRunnerFor<Worker>(i, txns, finished_txns_, broker, storage, metrics_manager, poll_timeout));
   }
 
 #if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
@@ -74,16 +81,27 @@ void Scheduler::Initialize() {
       cpu = cpus[i];
     }
     worker->StartInNewThread(cpu);
+    i++;
+  }
 
-    zmq::socket_t worker_socket(*context(), ZMQ_PAIR);
-    worker_socket.set(zmq::sockopt::rcvhwm, 0);
-    worker_socket.set(zmq::sockopt::sndhwm, 0);
-    worker_socket.bind(kSchedWorkerAddress + std::to_string(i));
+  AddCustomQueue(*finished_txns_);
+  AddCustomQueue(*prefetched_txns_);
 
-    AddCustomSocket(move(worker_socket));
+  if (config()->max_inflight_txns() > 0) {
+    AdvertiseCredits();
+  }
+}
 
-    i++;
+void Scheduler::AdvertiseCredits() {
+  auto max_txns = config()->max_inflight_txns();
+  uint32_t credits = active_txns_.size() < max_txns ? max_txns - active_txns_.size() : 0;
+  if (credits != advertised_credits_) {
+    auto env = NewEnvelope();
+    env->mutable_request()->mutable_scheduler_credits()->set_credits(credits);
+    Send(move(env), config()->all_machine_ids(), kServerChannel);
+    advertised_credits_ = credits;
   }
+  NewTimedCallback(config()->credit_interval(), [this] { AdvertiseCredits(); });
 }
 
 void Scheduler::OnInternalRequestReceived(EnvelopePtr&& env) {
@@ -115,58 +133,67 @@ void Scheduler::OnInternalRequestReceived(EnvelopePtr&& env) {
   }
 }
 
-// Handle responses from the workers
+// Handle responses from the workers and the storage
 bool Scheduler::OnCustomSocket() {
   bool has_msg = false;
-  bool stop = false;
-  while (!stop) {
-    stop = true;
-    for (size_t i = 0; i < workers_.size(); i++) {
-      if (zmq::message_t msg; GetCustomSocket(i).recv(msg, zmq::recv_flags::dontwait)) {
-        stop = false;
-        has_msg = true;
-        auto txn_id = *msg.data<TxnId>();
-        // Release locks held by this txn then dispatch the txns that become ready thanks to this release.
-        auto unblocked_txns = lock_manager_.ReleaseLocks(txn_id);
-        VLOG(3) << "Released locks of txn " << TXN_ID_STR(txn_id);
-
-        for (auto unblocked_txn : unblocked_txns) {
+  for (TxnId txn_id; prefetched_txns_->Pop(txn_id);) {
+    has_msg = true;
+    // The txn may have been aborted and cleaned up in the meantime
+    auto it = active_txns_.find(txn_id);
+    if (it == active_txns_.end()) {
+      continue;
+    }
+    auto& txn_holder = it->second;
+    txn_holder.DecNumPendingPrefetches();
+    if (!txn_holder.is_prefetching()) {
+      if (auto held = txn_holder.ReleaseHeldDispatch(); held.has_value()) {
+        Dispatch(txn_id, held->first /* deadlocked */, held->second /* is_fast */);
+      }
+    }
+  }
+
+  for (TxnId txn_id; finished_txns_->Pop(txn_id);) {
+    has_msg = true;
+    // Release locks held by this txn then dispatch the txns that become ready thanks to this release.
+    auto unblocked_txns = lock_manager_.ReleaseLocks(txn_id);
+    VLOG(3) << "Released locks of txn " << TXN_ID_STR(txn_id);
+
+    for (auto unblocked_txn : unblocked_txns) {
 #ifdef LOCK_MANAGER_DDR
-          auto it = active_txns_.find(unblocked_txn.first);
-          DCHECK(it != active_txns_.end());
-          Dispatch(unblocked_txn.first, unblocked_txn.second /* deadlocked */, false /* is_fast */);
+      auto it = active_txns_.find(unblocked_txn.first);
+      DCHECK(it != active_txns_.end());
+      Dispatch(unblocked_txn.first, unblocked_txn.second /* deadlocked */, false /* is_fast */);
 #else
-          Dispatch(unblocked_txn, false /* deadlocked */, false /* is_fast */);
+      Dispatch(unblocked_txn, false /* deadlocked */, false /* is_fast */);
 #endif
-        }
+    }
 
-        auto it = active_txns_.find(txn_id);
-        CHECK(it != active_txns_.end());
-        auto& txn_holder = it->second;
+    auto it = active_txns_.find(txn_id);
+    CHECK(it != active_txns_.end());
+    auto& txn_holder = it->second;
 
 #if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
-        auto remaster_result = txn_holder.remaster_result();
-        // If a remaster transaction, trigger any unblocked txns
-        if (remaster_result.has_value()) {
-          ProcessRemasterResult(remaster_manager_.RemasterOccured(remaster_result->first, remaster_result->second));
-        }
+    auto remaster_result = txn_holder.remaster_result();
+    // If a remaster transaction, trigger any unblocked txns
+    if (remaster_result.has_value()) {
+      ProcessRemasterResult(remaster_manager_.RemasterOccured(remaster_result->first, remaster_result->second));
+    }
 #endif /* defined(REMASTER_PROTOCOL_SIMPLE) || \
           defined(REMASTER_PROTOCOL_PER_KEY) */
 
-        txn_holder.SetDone();
+    txn_holder.SetDone();
 
-        if (txn_holder.is_ready_for_gc()) {
-          active_txns_.erase(it);
-        }
-      }
+    if (txn_holder.is_ready_for_gc()) {
+      active_txns_.erase(it);
     }
-  };
+  }
 
   return has_msg;
 }
 
 void Scheduler::ProcessTransaction(EnvelopePtr&& env) {
-  auto txn = env->mutable_request()->mutable_forward_txn()->release_txn();
+  // The txn may be on a shared arena so it is released without being copied off the arena
+  auto txn = RetainArena(env->mutable_request()->mutable_forward_txn()->unsafe_arena_release_txn());
   auto txn_id = txn->internal().id();
   auto ins = active_txns_.try_emplace(txn_id, config(), txn);
   auto holder_it = ins.first;
@@ -182,6 +209,7 @@ void Scheduler::ProcessTransaction(EnvelopePtr&& env) {
   } else {
     if (!holder.AddLockOnlyTxn(txn)) {
       LOG(ERROR) << "Already received txn: (" << TXN_ID_STR(txn_id) << ", " << txn->internal().home() << ")";
+      DeleteMessage(txn);
       return;
     }
 
@@ -206,6 +234,20 @@ void Scheduler::ProcessTransaction(EnvelopePtr&& env) {
     return;
   }
 
+  // Let the storage bring the records into memory while the txn waits for its locks. The txn is held back
+  // from the workers until they are loaded
+  prefetch_keys_.clear();
+  for (const auto& kv : txn->keys()) {
+    prefetch_keys_.push_back(&kv.key());
+  }
+  auto done = [prefetched = prefetched_txns_producer_, txn_id] {
+    std::lock_guard<std::mutex> guard(prefetched->mut);
+    prefetched->producer.Push(TxnId(txn_id));
+  };
+  if (storage_->Prefetch(prefetch_keys_, done)) {
+    holder.IncNumPendingPrefetches();
+  }
+
 #if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
   SendToRemasterManager(*txn);
 #else
@@ -283,6 +325,11 @@ void Scheduler::Dispatch(TxnId txn_id, bool deadlocked, bool is_fast) {
 
   CHECK(txn_holder.dispatchable()) << "Can no longer dispatch txn " << txn_holder.txn_id()
                                    << " (deadlocked = " << deadlocked << ")";
+  if (txn_holder.is_prefetching()) {
+    VLOG(3) << "Txn " << TXN_ID_STR(txn_id) << " waits for its records to be prefetched";
+    txn_holder.HoldDispatch(deadlocked, is_fast);
+    return;
+  }
   // If we did not detect a deadlock in the first dispatch, there is still a second chance to dispatch after a deadlock
   // is found. There will be no other chance to dispatch after that.
   if (deadlocked) {
@@ -300,18 +347,9 @@ void Scheduler::Dispatch(TxnId txn_id, bool deadlocked, bool is_fast) {
       RECORD(txn_holder.txn().mutable_internal(), TransactionEvent::DISPATCHED_SLOW);
     }
   }
-  auto data = std::make_pair(&txn_holder, deadlocked);
-  zmq::message_t msg(sizeof(data));
-  *msg.data<decltype(data)>() = data;
-
-  int worker = current_worker_;
-  current_worker_ = (current_worker_ + 1) % workers_.size();
-  // If this txn was dispatched to a worker before, dispatch to the same worker again
-  if (txn_holder.worker().has_value()) {
-    worker = txn_holder.worker().value();
-  }
-  txn_holder.SetWorker(worker);
-  GetCustomSocket(worker).send(msg, zmq::send_flags::none);
+  // This also dispatches a txn to the same worker again after a deadlock
+  auto worker = WorkerOfTxn(txn_id, workers_.size());
+  worker_txns_[worker].Push(DispatchedTxn(&txn_holder, deadlocked));
 
   VLOG(3) << "Dispatched txn " << TXN_ID_STR(txn_id) << " (deadlocked = " << deadlocked << ")";
 }
@@ -376,6 +414,7 @@ void Scheduler::TriggerPreDispatchAbort(TxnId txn_id, const std::string& abort_r
  *      ...
  *    ],
  *    ...<stats from lock manager>...
+ *    ...<stats from storage>...
  * }
  */
 void Scheduler::ProcessStatsRequest(const internal::StatsRequest& stats_request) {
@@ -417,6 +456,8 @@ void Scheduler::ProcessStatsRequest(const internal::StatsRequest& stats_request)
   // Add stats from the lock manager
   lock_manager_.GetStats(stats, level);
 
+  storage_->GetStats(stats, level);
+
   // Write JSON object to a buffer and send back to the server
   rapidjson::StringBuffer buf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
@@ -2,6 +2,7 @@
 
 #include <glog/logging.h>
 
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -92,6 +93,9 @@ class Scheduler : public NetworkedModule {
 
   void MaybeCleanUpTxn(TxnId txn_id);
 
+  // Tells the servers how many more txns can be taken when that changes, then schedules the next advertisement
+  void AdvertiseCredits();
+
 #if defined(REMASTER_PROTOCOL_SIMPLE)
   SimpleRemasterManager remaster_manager_;
 #elif defined(REMASTER_PROTOCOL_PER_KEY)
@@ -107,14 +111,32 @@ class Scheduler : public NetworkedModule {
   RMALockManager lock_manager_;
 #endif
 
+  std::shared_ptr<Storage> storage_;
+  std::vector<const Key*> prefetch_keys_;
+
   std::unordered_map<TxnId, TxnHolder> active_txns_;
 
+  std::vector<InprocQueue<DispatchedTxn>::Producer> worker_txns_;
+  std::shared_ptr<InprocQueue<TxnId>> finished_txns_;
+
+  // The I/O threads of the storage report the txns whose records are prefetched through here. They share
+  // one producer and may still report after the scheduler is gone
+  struct PrefetchedTxns {
+    explicit PrefetchedTxns(const std::shared_ptr<InprocQueue<TxnId>>& queue) : producer(queue) {}
+
+    std::mutex mut;
+    InprocQueue<TxnId>::Producer producer;
+  };
+  std::shared_ptr<InprocQueue<TxnId>> prefetched_txns_;
+  std::shared_ptr<PrefetchedTxns> prefetched_txns_producer_;
+
   // This must be defined at the end so that the workers exit before any resources
   // in the scheduler is destroyed
   std::vector<std::unique_ptr<ModuleRunner>> workers_;
-  int current_worker_;
 
   int64_t global_log_counter_;
+  // The servers have nothing to borrow until the first advertisement
+  uint32_t advertised_credits_;
 };
 
 }  // namespace slog
\ No newline at end of file
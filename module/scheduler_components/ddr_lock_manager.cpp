@@ -538,8 +538,7 @@ AcquireLocksResult DDRLockManager::AcquireLocks(const Transaction& txn) {
     }
     ++num_relevant_locks;
 
-    auto key_region = MakeKeyRegion(kv.key(), home);
-    auto& lock_queue_tail = lock_table_[key_region];
+    auto& lock_queue_tail = lock_table_.GetOrCreate(kv.key(), home);
 
     switch (kv.value_entry().type()) {
       case KeyType::READ: {
@@ -678,14 +677,14 @@ void DDRLockManager::GetStats(rapidjson::Document& stats, uint32_t level) const
   if (level >= 2) {
     // Collect data from lock tables
     rapidjson::Value lock_table(rapidjson::kArrayType);
-    for (const auto& [key, lock_state] : lock_table_) {
+    lock_table_.ForEach([&](const KeyRegion& key, const LockQueueTail& lock_state) {
       rapidjson::Value entry(rapidjson::kArrayType);
       rapidjson::Value key_json(key.c_str(), alloc);
       entry.PushBack(key_json, alloc)
           .PushBack(lock_state.write_lock_requester().value_or(0), alloc)
           .PushBack(ToJsonArray(lock_state.read_lock_requesters(), alloc), alloc);
       lock_table.PushBack(move(entry), alloc);
-    }
+    });
     stats.AddMember(StringRef(LOCK_TABLE), move(lock_table), alloc);
   }
 }
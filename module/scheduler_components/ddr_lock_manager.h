@@ -21,6 +21,7 @@
 #include "common/spin_latch.h"
 #include "common/types.h"
 #include "module/base/networked_module.h"
+#include "module/scheduler_components/key_region_map.h"
 #include "module/scheduler_components/txn_holder.h"
 
 namespace slog {
@@ -154,7 +155,7 @@ class DDRLockManager {
     bool is_ready() const { return num_waiting_for == 0 && unarrived_lock_requests == 0; }
   };
 
-  std::unordered_map<KeyRegion, LockQueueTail> lock_table_;
+  KeyRegionMap<LockQueueTail> lock_table_;
   std::unordered_map<TxnId, TxnInfo> txn_info_;
   mutable SpinLatch txn_info_latch_;
 
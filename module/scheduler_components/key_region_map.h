@@ -0,0 +1,75 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "common/types.h"
+
+namespace slog {
+
+/**
+ * Maps the key regions of a lock table, i.e. keys paired with their masters, to their lock states. The
+ * key regions of numeric keys, which are all the keys of the simple partitionings, are kept as a pair of
+ * integers so that a lookup neither builds the textual "key:master" string nor hashes it. Other keys use
+ * the textual form. References to the values stay valid until the map is destroyed.
+ */
+template <typename Value>
+class KeyRegionMap {
+ public:
+  /**
+   * Sizes the map for n key regions. The integer and the textual parts are only sized once they get their
+   * first key region so that a workload using only one of them does not pay for the other
+   */
+  void reserve(size_t n) { reserve_ = n; }
+
+  /**
+   * Returns the value of the key region of key and master, inserting a default one if there is none
+   */
+  Value& GetOrCreate(const Key& key, uint32_t master) {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      if (int_regions_.empty()) {
+        int_regions_.reserve(reserve_);
+      }
+      return int_regions_[IntKeyRegion{id, master}];
+    }
+    if (regions_.empty()) {
+      regions_.reserve(reserve_);
+    }
+    return regions_[MakeKeyRegion(key, master)];
+  }
+
+  size_t size() const { return int_regions_.size() + regions_.size(); }
+
+  /**
+   * Calls fn(key_region, value) on every key region, in the textual form. This is meant for printing
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    for (const auto& [region, value] : int_regions_) {
+      fn(MakeKeyRegion(std::to_string(region.id), region.master), value);
+    }
+    for (const auto& [region, value] : regions_) {
+      fn(region, value);
+    }
+  }
+
+ private:
+  struct IntKeyRegion {
+    uint64_t id;
+    uint32_t master;
+
+    bool operator==(const IntKeyRegion& other) const { return id == other.id && master == other.master; }
+  };
+
+  struct IntKeyRegionHash {
+    size_t operator()(const IntKeyRegion& region) const {
+      // Masters are region ids, which fit in the top bits left unused by realistic numbers of keys
+      return IntKeyHash{}(region.id ^ (static_cast<uint64_t>(region.master) << 48));
+    }
+  };
+
+  std::unordered_map<IntKeyRegion, Value, IntKeyRegionHash> int_regions_;
+  std::unordered_map<KeyRegion, Value> regions_;
+  size_t reserve_ = 0;
+};
+
+}  // namespace slog
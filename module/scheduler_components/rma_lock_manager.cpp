@@ -123,12 +123,11 @@ AcquireLocksResult RMALockManager::AcquireLocks(const Transaction& txn) {
       continue;
     }
 
-    auto key_region = MakeKeyRegion(kv.key(), home);
-    txn_info.keys.push_back(key_region);
+    auto& lock_state = lock_table_.GetOrCreate(kv.key(), home);
+    txn_info.lock_states.push_back(&lock_state);
 
-    auto& lock_state = lock_table_[key_region];
-
-    DCHECK(!lock_state.Contains(txn_id)) << "Txn requested lock twice: " << txn_id << ", " << key_region;
+    DCHECK(!lock_state.Contains(txn_id)) << "Txn requested lock twice: " << txn_id << ", "
+                                         << MakeKeyRegion(kv.key(), home);
 
     auto before_mode = lock_state.mode;
     switch (kv.value_entry().type()) {
@@ -163,12 +162,8 @@ vector<TxnId> RMALockManager::ReleaseLocks(TxnId txn_id) {
     return result;
   }
   auto& info = info_it->second;
-  for (const auto& key_region : info.keys) {
-    auto lock_state_it = lock_table_.find(key_region);
-    if (lock_state_it == lock_table_.end()) {
-      continue;
-    }
-    auto& lock_state = lock_state_it->second;
+  for (auto lock_state_ptr : info.lock_states) {
+    auto& lock_state = *lock_state_ptr;
     auto old_mode = lock_state.mode;
     auto new_grantees = lock_state.Release(txn_id);
     // Prevent the lock table from growing too big
@@ -238,9 +233,9 @@ void RMALockManager::GetStats(rapidjson::Document& stats, uint32_t level) const
   if (level >= 2) {
     // Collect data from lock tables
     rapidjson::Value lock_table(rapidjson::kArrayType);
-    for (const auto& [key, lock_state] : lock_table_) {
+    lock_table_.ForEach([&](const KeyRegion& key, const LockState& lock_state) {
       if (lock_state.mode == LockMode::UNLOCKED) {
-        continue;
+        return;
       }
       rapidjson::Value entry(rapidjson::kArrayType);
       rapidjson::Value key_json(key.c_str(), alloc);
@@ -252,7 +247,7 @@ void RMALockManager::GetStats(rapidjson::Document& stats, uint32_t level) const
                         lock_state.GetWaiters(), [](const auto& v) { return static_cast<uint32_t>(v); }, alloc),
                     alloc);
       lock_table.PushBack(move(entry), alloc);
-    }
+    });
     stats.AddMember(StringRef(LOCK_TABLE), move(lock_table), alloc);
   }
 }
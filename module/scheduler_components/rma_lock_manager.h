@@ -15,6 +15,7 @@
 #include "common/constants.h"
 #include "common/json_utils.h"
 #include "common/types.h"
+#include "module/scheduler_components/key_region_map.h"
 #include "module/scheduler_components/txn_holder.h"
 
 using std::list;
@@ -99,15 +100,16 @@ class RMALockManager {
 
  private:
   struct TxnInfo {
-    TxnInfo(int num_keys) : num_waiting_for(num_keys) { keys.reserve(num_keys); }
+    TxnInfo(int num_keys) : num_waiting_for(num_keys) { lock_states.reserve(num_keys); }
 
     bool is_ready() const { return num_waiting_for == 0; }
 
     int num_waiting_for;
-    std::vector<Key> keys;
+    // The lock states are never removed from the lock table so they can be released without a lookup
+    std::vector<LockState*> lock_states;
   };
   unordered_map<TxnId, TxnInfo> txn_info_;
-  unordered_map<KeyRegion, LockState> lock_table_;
+  KeyRegionMap<LockState> lock_table_;
   uint32_t num_locked_keys_ = 0;
 };
 
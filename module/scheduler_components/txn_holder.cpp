@@ -13,7 +13,7 @@ TxnHolder::TxnHolder(const ConfigurationPtr& config, Transaction* txn)
       num_lo_txns_(0),
       expected_num_lo_txns_(txn->internal().involved_regions_size()),
       num_dispatches_(0),
-      worker_(std::nullopt) {
+      num_pending_prefetches_(0) {
   lo_txns_[main_txn_idx_].reset(txn);
   ++num_lo_txns_;
 }
@@ -61,12 +61,10 @@ Transaction* TxnHolder::FinalizeAndRelease() {
   for (auto& lo_txn : lo_txns_) {
     if (lo_txn != nullptr && lo_txn != main_txn) {
       auto internal = lo_txn->mutable_internal();
-      // Only transfer the events after the cutoff point to the main txn
+      // Only transfer the events after the cutoff point to the main txn. The events are copied because
+      // the txns may be on different arenas
       for (int i = cutoff; i < internal->events_size(); i++) {
-        main_internal->mutable_events()->AddAllocated(internal->mutable_events(i));
-      }
-      while (internal->events_size() > cutoff) {
-        internal->mutable_events()->ReleaseLast();
+        *main_internal->add_events() = internal->events(i);
       }
       lo_txn.reset();
     }
@@ -3,16 +3,18 @@
 #include <glog/logging.h>
 
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "common/configuration.h"
 #include "common/proto_utils.h"
+#include "common/shared_arena.h"
 #include "common/types.h"
 #include "proto/transaction.pb.h"
 
 namespace slog {
 
-using EnvelopePtr = std::unique_ptr<internal::Envelope>;
+using EnvelopePtr = std::unique_ptr<internal::Envelope, MessageDeleter<internal::Envelope>>;
 
 class TxnHolder {
  public:
@@ -20,6 +22,10 @@ class TxnHolder {
 
   bool AddLockOnlyTxn(Transaction* txn);
 
+  /**
+   * Merges the events of the lock-only txns into the main txn and releases the main txn, which must be
+   * freed with DeleteMessage
+   */
   Transaction* FinalizeAndRelease();
 
   TxnId txn_id() const { return txn_id_; }
@@ -44,17 +50,32 @@ class TxnHolder {
   void IncNumDispatches() { num_dispatches_++; }
   int num_dispatches() const { return num_dispatches_; }
 
+  // The txn is not dispatched while the storage is loading its records into memory
+  void IncNumPendingPrefetches() { num_pending_prefetches_++; }
+  void DecNumPendingPrefetches() { num_pending_prefetches_--; }
+  bool is_prefetching() const { return num_pending_prefetches_ > 0; }
+
+  /**
+   * Holds back a dispatch until the prefetches finish. Holding a deadlocked dispatch makes the held one
+   * deadlocked too
+   */
+  void HoldDispatch(bool deadlocked, bool is_fast) {
+    if (held_dispatch_.has_value()) {
+      deadlocked = deadlocked || held_dispatch_->first;
+    }
+    held_dispatch_.emplace(deadlocked, is_fast);
+  }
+  std::optional<pair<bool, bool>> ReleaseHeldDispatch() { return std::exchange(held_dispatch_, std::nullopt); }
+
   bool is_ready_for_gc() const { return done_ && num_lo_txns_ == expected_num_lo_txns_; }
   int num_lock_only_txns() const { return num_lo_txns_; }
   int expected_num_lock_only_txns() const { return expected_num_lo_txns_; }
 
-  void SetWorker(int worker) { worker_ = worker; }
-  std::optional<int> worker() const { return worker_; }
-
  private:
   TxnId txn_id_;
   size_t main_txn_idx_;
-  std::vector<std::unique_ptr<Transaction>> lo_txns_;
+  // The txns may be on shared arenas
+  std::vector<std::unique_ptr<Transaction, MessageDeleter<Transaction>>> lo_txns_;
   std::optional<pair<Key, uint32_t>> remaster_result_;
   bool dispatchable_;
   bool aborting_;
@@ -62,7 +83,9 @@ class TxnHolder {
   int num_lo_txns_;
   int expected_num_lo_txns_;
   int num_dispatches_;
-  std::optional<int> worker_;
+  int num_pending_prefetches_;
+  // Whether the held dispatch is deadlocked and fast
+  std::optional<pair<bool, bool>> held_dispatch_;
 };
 
 }  // namespace slog
\ No newline at end of file
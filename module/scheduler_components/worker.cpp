@@ -9,14 +9,13 @@
 #include <thread>
 
 #include "common/proto_utils.h"
+#include "common/shared_arena.h"
 
 using std::make_pair;
 
 namespace slog {
 
 namespace {
-uint64_t MakeTag(const RunId& run_id) { return run_id.first * 10 + run_id.second; }
-
 inline std::ostream& operator<<(std::ostream& os, const RunId& run_id) {
   os << "(" << TXN_ID_STR(run_id.first) << ", " << run_id.second << ")";
   return os;
@@ -28,9 +27,15 @@ using internal::Request;
 using internal::Response;
 using std::make_unique;
 
-Worker::Worker(int id, const std::shared_ptr<Broker>& broker, const std::shared_ptr<Storage>& storage,
-               const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
-    : NetworkedModule(broker, kWorkerChannel + id, metrics_manager, poll_timeout), id_(id), storage_(storage) {
+Worker::Worker(int id, const std::shared_ptr<InprocQueue<DispatchedTxn>>& txns,
+               const std::shared_ptr<InprocQueue<TxnId>>& finished_txns, const std::shared_ptr<Broker>& broker,
+               const std::shared_ptr<Storage>& storage, const MetricsRepositoryManagerPtr& metrics_manager,
+               std::chrono::milliseconds poll_timeout)
+    : NetworkedModule(broker, kWorkerChannel + id, metrics_manager, poll_timeout),
+      id_(id),
+      txns_(txns),
+      finished_txns_(finished_txns),
+      storage_(storage) {
   switch (config()->execution_type()) {
     case internal::ExecutionType::KEY_VALUE:
       execution_ = make_unique<KeyValueExecution>(Sharder::MakeSharder(config()), storage);
@@ -44,28 +49,30 @@ Worker::Worker(int id, const std::shared_ptr<Broker>& broker, const std::shared_
   }
 }
 
-void Worker::Initialize() {
-  zmq::socket_t sched_socket(*context(), ZMQ_PAIR);
-  sched_socket.set(zmq::sockopt::rcvhwm, 0);
-  sched_socket.set(zmq::sockopt::sndhwm, 0);
-  sched_socket.connect(kSchedWorkerAddress + std::to_string(id_));
-
-  AddCustomSocket(std::move(sched_socket));
-}
+void Worker::Initialize() { AddCustomQueue(*txns_); }
 
 void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
   CHECK_EQ(env->request().type_case(), Request::kRemoteReadResult) << "Invalid request for worker";
   auto& read_result = env->request().remote_read_result();
   auto run_id = make_pair(read_result.txn_id(), read_result.deadlocked());
-  auto state_it = txn_states_.find(run_id);
-  if (state_it == txn_states_.end()) {
-    LOG(WARNING) << "Transaction " << run_id << " does not exist for remote read result";
+  if (txn_states_.find(run_id) == txn_states_.end()) {
+    // The first dispatch of a txn no longer needs its reads once the txn is dispatched again after a deadlock
+    if (!run_id.second && txn_states_.find(make_pair(run_id.first, true)) != txn_states_.end()) {
+      VLOG(3) << "Dropped remote read result for replaced txn " << run_id;
+      return;
+    }
+    VLOG(3) << "Hold remote read result for txn " << run_id << " until it is dispatched";
+    early_remote_reads_[run_id].push_back(std::move(env));
     return;
   }
 
+  ApplyRemoteReads(run_id, read_result);
+}
+
+void Worker::ApplyRemoteReads(const RunId& run_id, const internal::RemoteReadResult& read_result) {
   VLOG(3) << "Got remote read result for txn " << run_id;
 
-  auto& state = state_it->second;
+  auto& state = TxnState(run_id);
   auto& txn = state.txn_holder->txn();
 
   if (read_result.deadlocked()) {
@@ -96,9 +103,6 @@ void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
     if (state.phase == TransactionState::Phase::WAIT_REMOTE_READ) {
       state.phase = TransactionState::Phase::EXECUTE;
 
-      // Remove the redirection at broker for this txn
-      StopRedirection(run_id);
-
       VLOG(3) << "Execute txn " << run_id << " after receving all remote read results";
     } else {
       LOG(FATAL) << "Invalid phase";
@@ -109,22 +113,19 @@ void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
 }
 
 bool Worker::OnCustomSocket() {
-  auto& sched_socket = GetCustomSocket(0);
-
-  zmq::message_t msg;
-  if (!sched_socket.recv(msg, zmq::recv_flags::dontwait)) {
+  DispatchedTxn dispatched_txn;
+  if (!txns_->Pop(dispatched_txn)) {
     return false;
   }
 
-  auto [txn_holder, deadlocked] = *msg.data<std::pair<TxnHolder*, bool>>();
+  auto [txn_holder, deadlocked] = dispatched_txn;
   auto& txn = txn_holder->txn();
   auto run_id = std::make_pair(txn.internal().id(), deadlocked);
   if (deadlocked) {
     auto old_run_id = std::make_pair(txn.internal().id(), false);
     // Clean up any transaction state created before the deadlock was detected
-    if (txn_states_.erase(old_run_id)) {
-      StopRedirection(old_run_id);
-    }
+    txn_states_.erase(old_run_id);
+    early_remote_reads_.erase(old_run_id);
   }
 
   RECORD(txn.mutable_internal(), TransactionEvent::ENTER_WORKER);
@@ -141,6 +142,19 @@ bool Worker::OnCustomSocket() {
 
   AdvanceTransaction(run_id);
 
+  // Apply the remote reads that arrived before the txn
+  if (auto early_it = early_remote_reads_.find(run_id); early_it != early_remote_reads_.end()) {
+    auto early_reads = std::move(early_it->second);
+    early_remote_reads_.erase(early_it);
+    for (auto& env : early_reads) {
+      if (txn_states_.find(run_id) == txn_states_.end()) {
+        LOG(WARNING) << "Transaction " << run_id << " does not exist for remote read result";
+        break;
+      }
+      ApplyRemoteReads(run_id, env->request().remote_read_result());
+    }
+  }
+
   return true;
 }
 
@@ -197,24 +211,31 @@ void Worker::ReadLocalStorage(const RunId& run_id) {
 
     // We don't need to check if keys are in partition here since the assumption is that
     // the out-of-partition keys have already been removed
-    for (auto& kv : *(txn.mutable_keys())) {
-      const auto& key = kv.key();
-      auto value = kv.mutable_value_entry();
-      if (Record record; storage_->Read(key, record)) {
+    auto keys = txn.mutable_keys();
+    read_keys_.clear();
+    for (const auto& kv : *keys) {
+      read_keys_.push_back(&kv.key());
+    }
+    // The keys are read together so that their cache misses overlap
+    storage_->MultiRead(read_keys_, [&](size_t i, const Record* record) {
+      if (txn.status() == TransactionStatus::ABORTED) {
+        return;
+      }
+      auto value = (*keys)[i].mutable_value_entry();
+      if (record != nullptr) {
         // Check whether the stored master metadata matches with the information
         // stored in the transaction
-        if (value->metadata().master() != record.metadata().master) {
+        if (value->metadata().master() != record->metadata().master) {
           txn.set_status(TransactionStatus::ABORTED);
           txn.set_abort_reason("outdated master");
-          break;
+          return;
         }
-        value->set_value(record.to_string());
+        value->set_value(record->data(), record->size());
       } else if (txn.program_case() == Transaction::kRemaster) {
         txn.set_status(TransactionStatus::ABORTED);
-        txn.set_abort_reason("remaster non-existent key " + key);
-        break;
+        txn.set_abort_reason("remaster non-existent key " + *read_keys_[i]);
       }
-    }
+    });
   }
 
   VLOG(3) << "Broadcasting local reads to other partitions";
@@ -238,9 +259,6 @@ void Worker::ReadLocalStorage(const RunId& run_id) {
     VLOG(3) << "Execute txn " << run_id << " without remote reads";
     state.phase = TransactionState::Phase::EXECUTE;
   } else {
-    // Establish a redirection at broker for this txn so that we can receive remote reads
-    StartRedirection(run_id);
-
     VLOG(3) << "Defer executing txn " << run_id << " until having enough remote reads";
     state.phase = TransactionState::Phase::WAIT_REMOTE_READ;
   }
@@ -253,7 +271,10 @@ void Worker::Execute(const RunId& run_id) {
   switch (txn.program_case()) {
     case Transaction::kCode: {
       if (txn.status() != TransactionStatus::ABORTED) {
+        // Snapshot reads see either all or none of the writes of the txn
+        storage_->BeginWriteBatch();
         execution_->Execute(txn);
+        storage_->EndWriteBatch();
       }
 
       if (txn.status() == TransactionStatus::ABORTED) {
@@ -267,11 +288,15 @@ void Worker::Execute(const RunId& run_id) {
       txn.set_status(TransactionStatus::COMMITTED);
       auto it = txn.keys().begin();
       const auto& key = it->key();
-      Record record;
-      storage_->Read(key, record);
       auto new_counter = it->value_entry().metadata().counter() + 1;
-      record.SetMetadata(Metadata(txn.remaster().new_master(), new_counter));
-      storage_->Write(key, record);
+      Metadata new_metadata(txn.remaster().new_master(), new_counter);
+      storage_->BeginWriteBatch();
+      if (!storage_->Update(key, [&new_metadata](Record& record) { record.SetMetadata(new_metadata); })) {
+        Record record;
+        record.SetMetadata(new_metadata);
+        storage_->Write(key, std::move(record));
+      }
+      storage_->EndWriteBatch();
 
       state.txn_holder->SetRemasterResult(key, new_counter);
       break;
@@ -298,16 +323,15 @@ void Worker::Finish(const RunId& run_id) {
     Envelope env;
     auto finished_sub_txn = env.mutable_request()->mutable_finished_subtxn();
     finished_sub_txn->set_partition(config()->local_partition());
-    finished_sub_txn->set_allocated_txn(txn);
+    // Lend the txn to the envelope only for serialization so that a txn on an arena is not copied
+    finished_sub_txn->unsafe_arena_set_allocated_txn(txn);
     Send(env, txn->internal().coordinating_server(), kServerChannel);
-  } else {
-    delete txn;
+    finished_sub_txn->unsafe_arena_release_txn();
   }
+  DeleteMessage(txn);
 
   // Notify the scheduler that we're done
-  zmq::message_t msg(sizeof(TxnId));
-  *msg.data<TxnId>() = run_id.first;
-  GetCustomSocket(0).send(msg, zmq::send_flags::none);
+  finished_txns_.Push(TxnId(run_id.first));
 
   // Done with this txn. Remove it from the state map
   txn_states_.erase(run_id);
@@ -360,7 +384,8 @@ void Worker::BroadcastReads(const RunId& run_id) {
     }
   }
 
-  Send(env, destinations, MakeTag(run_id));
+  // The txn is dispatched to the worker with the same id on every partition
+  Send(env, destinations, channel());
 }
 
 TransactionState& Worker::TxnState(const RunId& run_id) {
@@ -369,18 +394,4 @@ TransactionState& Worker::TxnState(const RunId& run_id) {
   return state_it->second;
 }
 
-void Worker::StartRedirection(const RunId& run_id) {
-  auto redirect_env = NewEnvelope();
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_tag(MakeTag(run_id));
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_channel(channel());
-  Send(move(redirect_env), Broker::MakeChannel(config()->broker_ports_size() - 1));
-}
-
-void Worker::StopRedirection(const RunId& run_id) {
-  auto redirect_env = NewEnvelope();
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_tag(MakeTag(run_id));
-  redirect_env->mutable_request()->mutable_broker_redirect()->set_stop(true);
-  Send(move(redirect_env), Broker::MakeChannel(config()->broker_ports_size() - 1));
-}
-
 }  // namespace slog
\ No newline at end of file
@@ -20,7 +20,8 @@ namespace slog {
 
 using RunId = pair<TxnId, bool>;
 
-const std::string kSchedWorkerAddress = "inproc://sched_worker";
+// A txn dispatched by the scheduler and whether it is dispatched after a deadlock is resolved
+using DispatchedTxn = std::pair<TxnHolder*, bool>;
 
 struct TransactionState {
   enum class Phase { READ_LOCAL_STORAGE, WAIT_REMOTE_READ, EXECUTE, FINISH };
@@ -40,8 +41,13 @@ struct TransactionState {
  */
 class Worker : public NetworkedModule {
  public:
-  Worker(int id, const std::shared_ptr<Broker>& broker, const std::shared_ptr<Storage>& storage,
-         const MetricsRepositoryManagerPtr& metrics_manager,
+  /**
+   * @param txns Txns dispatched by the scheduler to this worker
+   * @param finished_txns Ids of the txns that the workers have finished, which are sent back to the scheduler
+   */
+  Worker(int id, const std::shared_ptr<InprocQueue<DispatchedTxn>>& txns,
+         const std::shared_ptr<InprocQueue<TxnId>>& finished_txns, const std::shared_ptr<Broker>& broker,
+         const std::shared_ptr<Storage>& storage, const MetricsRepositoryManagerPtr& metrics_manager,
          std::chrono::milliseconds poll_timeout_ms = kModuleTimeout);
 
   std::string name() const override { return "Worker-" + std::to_string(channel()); }
@@ -51,6 +57,7 @@ class Worker : public NetworkedModule {
   /**
    * Applies remote read for transactions that are in the WAIT_REMOTE_READ phase.
    * When all remote reads are received, the transaction is moved to the EXECUTE phase.
+   * The remote reads of a transaction that has not been dispatched here yet are held until it is.
    */
   void OnInternalRequestReceived(EnvelopePtr&& env) final;
 
@@ -83,17 +90,22 @@ class Worker : public NetworkedModule {
 
   void BroadcastReads(const RunId& run_id);
 
+  void ApplyRemoteReads(const RunId& run_id, const internal::RemoteReadResult& read_result);
+
   // Precondition: txn_id must exists in txn states table
   TransactionState& TxnState(const RunId& run_id);
 
-  void StartRedirection(const RunId& run_id);
-  void StopRedirection(const RunId& run_id);
-
   int id_;
+  std::shared_ptr<InprocQueue<DispatchedTxn>> txns_;
+  InprocQueue<TxnId>::Producer finished_txns_;
   std::shared_ptr<Storage> storage_;
   std::unique_ptr<Execution> execution_;
 
   std::map<RunId, TransactionState> txn_states_;
+  // Remote reads that arrive before their txns are dispatched to this worker
+  std::map<RunId, std::vector<EnvelopePtr>> early_remote_reads_;
+  // Reused buffer for the keys read from the local storage
+  std::vector<const Key*> read_keys_;
 };
 
 }  // namespace slog
\ No newline at end of file
@@ -268,8 +268,8 @@ void Batcher::ProcessStatsRequest(const internal::StatsRequest& stats_request) {
   auto& alloc = stats.GetAllocator();
 
   if (process_future_txn_callback_handle_.has_value()) {
-    stats.AddMember(StringRef(SEQ_PROCESS_FUTURE_TXN_CALLBACK_ID), process_future_txn_callback_handle_.value().second,
-                    alloc);
+    stats.AddMember(StringRef(SEQ_PROCESS_FUTURE_TXN_CALLBACK_ID),
+                    static_cast<int64_t>(process_future_txn_callback_handle_.value()), alloc);
   } else {
     stats.AddMember(StringRef(SEQ_PROCESS_FUTURE_TXN_CALLBACK_ID), -1, alloc);
   }
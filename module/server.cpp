@@ -52,11 +52,21 @@ Transaction* Server::FinishedTransaction::ReleaseTxn() {
   return req_->mutable_request()->mutable_finished_subtxn()->release_txn();
 }
 
-Server::Server(const std::shared_ptr<Broker>& broker, const MetricsRepositoryManagerPtr& metrics_manager,
-               std::chrono::milliseconds poll_timeout)
+Server::Server(const std::shared_ptr<Broker>& broker,
+               const std::shared_ptr<MultiVersionStorage>& multi_version_storage,
+               const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
     : NetworkedModule(broker, kServerChannel, metrics_manager, poll_timeout),
+      multi_version_storage_(multi_version_storage),
+      sharder_(Sharder::MakeSharder(config())),
       rate_limiter_(config()->tps_limit()),
-      txn_id_counter_(0) {}
+      txn_id_counter_(0),
+      credits_(0),
+      borrowed_credits_(0) {
+  if (auto max_txns = config()->max_inflight_txns(); max_txns > 0) {
+    auto num_servers = config()->all_machine_ids().size();
+    credits_ = std::max<uint32_t>(max_txns / num_servers, 1);
+  }
+}
 
 /***********************************************
                 Initialization
@@ -118,7 +128,7 @@ bool Server::OnCustomSocket() {
       txn_internal->set_id(txn_id);
       txn_internal->set_coordinating_server(config()->local_machine_id());
 
-      if (!rate_limiter_.Request()) {
+      if (!rate_limiter_.Request() || !TakeCredit(txn_id)) {
         txn->set_status(TransactionStatus::ABORTED);
         txn->set_abort_code(AbortCode::RATE_LIMITED);
         SendTxnToClient(txn);
@@ -142,6 +152,10 @@ bool Server::OnCustomSocket() {
 
       PreprocessTxn(txn);
 
+      if (request.txn().read_only() && ProcessReadOnlyTxn(txn)) {
+        break;
+      }
+
       RECORD(txn_internal, TransactionEvent::EXIT_SERVER_TO_FORWARDER);
 
       // Send to forwarder
@@ -210,12 +224,80 @@ void Server::OnInternalRequestReceived(EnvelopePtr&& env) {
     case internal::Request::kFinishedSubtxn:
       ProcessFinishedSubtxn(move(env));
       break;
+    case internal::Request::kSchedulerCredits:
+      BorrowCredits(env->from(), env->request().scheduler_credits().credits());
+      break;
     default:
       LOG(ERROR) << "Unexpected request type received: \"" << CASE_NAME(env->request().type_case(), internal::Request)
                  << "\"";
   }
 }
 
+bool Server::TakeCredit(TxnId txn_id) {
+  if (config()->max_inflight_txns() == 0) {
+    return true;
+  }
+  if (credits_ > 0) {
+    credits_--;
+    pending_responses_.at(txn_id).holds_credit = true;
+    return true;
+  }
+  if (borrowed_credits_ > 0) {
+    borrowed_credits_--;
+    return true;
+  }
+  return false;
+}
+
+void Server::BorrowCredits(MachineId scheduler, uint32_t credits) {
+  scheduler_credits_[scheduler] = credits;
+  uint32_t min_credits = credits;
+  for (auto [_, c] : scheduler_credits_) {
+    min_credits = std::min(min_credits, c);
+  }
+  // The room left at the fullest scheduler is split among all servers, rounded up so that a server that has
+  // used up its own credits can still make progress while there is room. What a server does not borrow before
+  // the next advertisement is lost, and a txn admitted with a borrowed credit shows up in the later
+  // advertisements once it reaches the schedulers
+  auto num_servers = config()->all_machine_ids().size();
+  borrowed_credits_ = (min_credits + num_servers - 1) / num_servers;
+}
+
+bool Server::ProcessReadOnlyTxn(Transaction* txn) {
+  if (multi_version_storage_ == nullptr || !txn->has_code()) {
+    return false;
+  }
+  for (const auto& kv : txn->keys()) {
+    if (kv.value_entry().type() != KeyType::READ || !sharder_->is_local_key(kv.key())) {
+      return false;
+    }
+  }
+  for (const auto& proc : txn->code().procedures()) {
+    if (!proc.args().empty() && proc.args(0) != "GET") {
+      return false;
+    }
+  }
+
+  // The snapshot is released right away so it holds back garbage collection only for the duration of the reads
+  auto position = multi_version_storage_->AcquireSnapshot();
+  Record record;
+  for (auto& kv : *txn->mutable_keys()) {
+    auto value = kv.mutable_value_entry();
+    if (multi_version_storage_->ReadSnapshot(kv.key(), position, record)) {
+      value->set_value(record.data(), record.size());
+      value->mutable_metadata()->set_master(record.metadata().master);
+      value->mutable_metadata()->set_counter(record.metadata().counter);
+    }
+  }
+  multi_version_storage_->ReleaseSnapshot(position);
+
+  auto txn_internal = txn->mutable_internal();
+  txn_internal->add_involved_partitions(config()->local_partition());
+  txn->set_status(TransactionStatus::COMMITTED);
+  SendTxnToClient(txn);
+  return true;
+}
+
 void Server::ProcessFinishedSubtxn(EnvelopePtr&& env) {
   auto finished_subtxn = env->mutable_request()->mutable_finished_subtxn();
   auto txn = finished_subtxn->mutable_txn();
@@ -315,7 +397,11 @@ void Server::SendResponseToClient(TxnId txn_id, api::Response&& res) {
   // Send the actual message
   SendSerializedProtoWithEmptyDelim(socket, res);
 
-  pending_responses_.erase(txn_id);
+  // The txn is no longer in flight whether it finished or was aborted early
+  if (it->second.holds_credit) {
+    credits_++;
+  }
+  pending_responses_.erase(it);
 }
 
 TxnId Server::NextTxnId() {
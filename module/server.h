@@ -13,11 +13,13 @@
 #include "common/configuration.h"
 #include "common/proto_utils.h"
 #include "common/rate_limiter.h"
+#include "common/sharder.h"
 #include "common/types.h"
 #include "connection/broker.h"
 #include "module/base/networked_module.h"
 #include "proto/api.pb.h"
 #include "storage/lookup_master_index.h"
+#include "storage/multi_version_storage.h"
 
 namespace slog {
 
@@ -29,11 +31,13 @@ namespace slog {
  * OUTPUT: For external TransactionRequest, it forwards the txn internally
  *         to appropriate modules and waits for internal responses before
  *         responding back to the client with an external TransactionResponse.
+ *         If a multi-version storage is given, read-only txns accessing only
+ *         the local partition are served from a snapshot of it instead.
  */
 class Server : public NetworkedModule {
  public:
-  Server(const std::shared_ptr<Broker>& broker, const MetricsRepositoryManagerPtr& metrics_manager,
-         std::chrono::milliseconds poll_timeout = kModuleTimeout);
+  Server(const std::shared_ptr<Broker>& broker, const std::shared_ptr<MultiVersionStorage>& multi_version_storage,
+         const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout = kModuleTimeout);
 
   std::string name() const override { return "Server"; }
 
@@ -54,6 +58,8 @@ class Server : public NetworkedModule {
   bool OnCustomSocket() final;
 
  private:
+  // Returns false if the txn cannot be served from a snapshot
+  bool ProcessReadOnlyTxn(Transaction* txn);
   void ProcessFinishedSubtxn(EnvelopePtr&& req);
   void ProcessStatsRequest(const internal::StatsRequest& stats_request);
 
@@ -62,12 +68,27 @@ class Server : public NetworkedModule {
 
   TxnId NextTxnId();
 
+  // Returns false if this server has neither a credit of its own nor a borrowed one left. A txn admitted with
+  // a credit of this server holds it until its response is sent
+  bool TakeCredit(TxnId txn_id);
+  // Records the room advertised by a scheduler and lends this server its share of the smallest room
+  void BorrowCredits(MachineId scheduler, uint32_t credits);
+
+  std::shared_ptr<MultiVersionStorage> multi_version_storage_;
+  SharderPtr sharder_;
   RateLimiter rate_limiter_;
   TxnId txn_id_counter_;
+  // Number of txns that can still be admitted before some of those in flight finish
+  uint32_t credits_;
+  // Latest room for more txns advertised by the scheduler of each machine
+  std::unordered_map<MachineId, uint32_t> scheduler_credits_;
+  // Number of txns that can be admitted beyond this server's own credits until the next advertisement
+  uint32_t borrowed_credits_;
 
   struct PendingResponse {
     zmq::message_t identity;
     uint32_t stream_id;
+    bool holds_credit = false;
 
     explicit PendingResponse(zmq::message_t&& identity, uint32_t stream_id)
         : identity(std::move(identity)), stream_id(stream_id) {}
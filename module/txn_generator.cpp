@@ -22,7 +22,7 @@ void ConnectToServers(const ConfigurationPtr& config, zmq::socket_t& socket, Reg
   socket.set(zmq::sockopt::rcvhwm, 0);
   for (int p = 0; p < config->num_partitions(); p++) {
     std::ostringstream endpoint_s;
-    if (config->protocol() == "ipc") {
+    if (config->protocol() == "ipc" || config->protocol() == "shm") {
       endpoint_s << "tcp://localhost:" << config->server_port();
     } else {
       endpoint_s << "tcp://" << config->address(region, rep, p) << ":" << config->server_port();
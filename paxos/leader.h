@@ -4,6 +4,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "common/shared_arena.h"
 #include "common/types.h"
 #include "proto/internal.pb.h"
 
@@ -15,7 +16,7 @@ using std::vector;
 
 namespace slog {
 
-using EnvelopePtr = unique_ptr<internal::Envelope>;
+using EnvelopePtr = unique_ptr<internal::Envelope, MessageDeleter<internal::Envelope>>;
 
 class SimulatedMultiPaxos;
 
@@ -83,6 +83,9 @@ void ExecuteTxn(const char* txn_file) {
 
   api::Request req;
   req.mutable_txn()->set_allocated_txn(txn);
+  if (d.HasMember("read_only")) {
+    req.mutable_txn()->set_read_only(d["read_only"].GetBool());
+  }
 
   LOG(INFO) << "Request size in bytes: " << req.ByteSizeLong();
   // 3. Send to the server
@@ -166,7 +169,7 @@ void PrintForwarderStats(const rapidjson::Document& stats, uint64_t level) {
 void PrintSequencerStats(const rapidjson::Document& stats, uint64_t level) {
   cout << "Batch size: " << stats[SEQ_BATCH_SIZE].GetInt() << "\n";
   cout << "Num future txns: " << stats[SEQ_NUM_FUTURE_TXNS].GetInt() << "\n";
-  cout << "Process future txn callback id: " << stats[SEQ_PROCESS_FUTURE_TXN_CALLBACK_ID].GetInt() << "\n";
+  cout << "Process future txn callback id: " << stats[SEQ_PROCESS_FUTURE_TXN_CALLBACK_ID].GetInt64() << "\n";
   if (level > 0) {
     cout << "Future txns:\n";
     TRUNCATED_FOR_EACH(entry, stats[SEQ_FUTURE_TXNS].GetArray()) {
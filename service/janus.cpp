@@ -54,11 +54,13 @@ int main(int argc, char* argv[]) {
   auto metrics_manager = make_shared<slog::MetricsRepositoryManager>(config_name, config);
 
   // Create and initialize storage layer
-  auto [storage, metadata_initializer] = slog::MakeStorage(config, FLAGS_data_dir);
+  auto [storage, lookup_master_index, metadata_initializer, multi_version_storage] =
+      slog::MakeStorage(config, FLAGS_data_dir);
 
   vector<pair<unique_ptr<slog::ModuleRunner>, slog::ModuleId>> modules;
   // clang-format off
-  modules.emplace_back(MakeRunnerFor<slog::Server>(broker, metrics_manager),
+  // Janus does not group the writes of a txn into a batch so its snapshots are not consistent
+  modules.emplace_back(MakeRunnerFor<slog::Server>(broker, nullptr, metrics_manager),
                        slog::ModuleId::SERVER);
   modules.emplace_back(MakeRunnerFor<janus::Coordinator>(broker->context(), broker->config(), metrics_manager),
                        slog::ModuleId::FORWARDER);
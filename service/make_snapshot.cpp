@@ -0,0 +1,49 @@
+#include <memory>
+
+#include "common/configuration.h"
+#include "service/service_utils.h"
+#include "storage/durable_storage.h"
+#include "storage/init.h"
+#include "storage/mem_only_storage.h"
+#include "storage/snapshot.h"
+
+DEFINE_string(config, "slog.conf", "Path to the configuration file");
+DEFINE_string(address, "", "Address of a machine in the partition to take the snapshot of");
+DEFINE_string(data_dir, "", "Directory containing intial data");
+DEFINE_bool(from_durable, false,
+            "Take the snapshot of the state that the partition persisted in the directory of the durable storage "
+            "instead of its initial data");
+DEFINE_string(output, "", "Path of the snapshot file");
+
+using namespace slog;
+
+int main(int argc, char* argv[]) {
+  InitializeService(&argc, &argv);
+
+  CHECK(!FLAGS_address.empty()) << "Address must not be empty";
+  CHECK(!FLAGS_output.empty()) << "Output path must not be empty";
+  auto config = Configuration::FromFile(FLAGS_config, FLAGS_address);
+
+  SnapshotWriter writer(FLAGS_output);
+  auto add = [&writer](const Key& key, const Record& record) { writer.Add(key, record); };
+
+  if (FLAGS_from_durable) {
+    const auto& options = config->durable_storage_options();
+    CHECK(!options.dir().empty()) << "Directory of the durable storage is not specified";
+    auto dir = options.dir() + "/" + std::to_string(config->local_machine_id());
+    // The storage is never started so the directory is only read. If the partition is running, this is the
+    // state group committed so far
+    LOG(INFO) << "Loading the durable state of partition " << config->local_partition() << "...";
+    DurableStorage storage(dir, std::chrono::milliseconds(1), std::chrono::seconds(0));
+    CHECK(storage.Recover()) << "No durable state found in \"" << dir << "\"";
+    storage.ForEach(add);
+  } else {
+    LOG(INFO) << "Populating partition " << config->local_partition() << "...";
+    auto storage = std::make_shared<MemOnlyStorage>();
+    PopulateStorage(storage, MakeMetadataInitializer(config), config, FLAGS_data_dir);
+    storage->ForEach(add);
+  }
+
+  writer.Finish();
+  return 0;
+}
@@ -78,9 +78,8 @@ int main(int argc, char* argv[]) {
     transactions.push_back(txn);
   }
 
-  // Prepare the socket that receives the results of the txns
-  zmq::socket_t result_socket(*broker->context(), ZMQ_PULL);
-  result_socket.bind(MakeInProcChannelAddress(kServerChannel));
+  // Prepare the channel that receives the results of the txns
+  auto result_channel = GetInprocChannel(*broker->context(), kServerChannel);
 
   auto start_time = std::chrono::steady_clock::now();
 
@@ -100,7 +99,7 @@ int main(int argc, char* argv[]) {
   vector<TxnInfo> results;
   results.reserve(FLAGS_txns);
   for (size_t i = 0; i < transactions.size(); i++) {
-    auto wrapped_env = RecvEnvelope(result_socket);
+    auto wrapped_env = RecvEnvelope(*result_channel);
     EnvelopePtr env;
     env.reset(new slog::internal::Envelope());
     if (DeserializeProto(*env, wrapped_env->raw().data(), wrapped_env->raw().size())) {
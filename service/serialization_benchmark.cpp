@@ -0,0 +1,197 @@
+#include <google/protobuf/any.pb.h>
+
+#include <chrono>
+#include <iomanip>
+#include <new>
+#include <vector>
+
+#include "common/batch_log.h"
+#include "common/proto_utils.h"
+#include "common/shared_arena.h"
+#include "common/string_utils.h"
+#include "connection/zmq_utils.h"
+#include "module/scheduler_components/txn_holder.h"
+#include "service/service_utils.h"
+
+DEFINE_string(txns_per_batch, "1,10,100", "Comma-separated list of numbers of txns in each ForwardBatchData");
+DEFINE_string(reads_per_result, "1,10,100", "Comma-separated list of numbers of reads in each RemoteReadResult");
+DEFINE_uint32(keys_per_txn, 10, "Number of keys in each txn");
+DEFINE_uint32(value_size, 100, "Size of each read value in bytes");
+DEFINE_uint32(duration, 2, "Duration in seconds of each run");
+DEFINE_bool(allocations, false,
+            "Instead of measuring throughput, count the heap allocations per txn from the deserialization of a batch "
+            "in the log manager to the release of its txns after the workers finish them");
+
+using namespace slog;
+using namespace std::chrono;
+
+using internal::Envelope;
+using std::string;
+using std::vector;
+
+// Counts the heap allocations for --allocations
+static uint64_t num_allocations = 0;
+
+void* operator new(size_t size) {
+  num_allocations++;
+  if (void* ptr = malloc(size); ptr != nullptr) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+namespace {
+
+// The previous framing, which wraps the envelope in an Any, as the baseline
+zmq::message_t SerializeAny(const Envelope& env) {
+  google::protobuf::Any any;
+  any.PackFrom(env);
+  auto header_sz = sizeof(MachineId) + sizeof(Channel);
+  zmq::message_t msg(header_sz + any.ByteSizeLong());
+  any.SerializeToArray(msg.data<char>() + header_sz, any.ByteSizeLong());
+  return msg;
+}
+
+bool DeserializeAny(Envelope& env, const zmq::message_t& msg) {
+  google::protobuf::Any any;
+  auto header_sz = sizeof(MachineId) + sizeof(Channel);
+  if (msg.size() < header_sz || !any.ParseFromArray(msg.data<char>() + header_sz, msg.size() - header_sz)) {
+    return false;
+  }
+  return any.UnpackTo(&env);
+}
+
+Envelope MakeForwardBatchData(uint32_t num_txns) {
+  Envelope env;
+  auto batch = env.mutable_request()->mutable_forward_batch_data()->add_batch_data();
+  batch->set_id(1000);
+  batch->set_transaction_type(TransactionType::SINGLE_HOME);
+  for (uint32_t i = 0; i < num_txns; i++) {
+    vector<KeyMetadata> keys;
+    vector<vector<string>> code;
+    for (uint32_t k = 0; k < FLAGS_keys_per_txn; k++) {
+      auto key = std::to_string(i * FLAGS_keys_per_txn + k);
+      keys.emplace_back(key, k % 2 == 0 ? KeyType::READ : KeyType::WRITE, 0);
+      code.push_back(k % 2 == 0 ? vector<string>{"GET", key} : vector<string>{"SET", key, "value"});
+    }
+    auto txn = MakeTransaction(keys, code);
+    txn->mutable_internal()->set_home(0);
+    txn->mutable_internal()->add_involved_regions(0);
+    batch->mutable_transactions()->AddAllocated(txn);
+  }
+  return env;
+}
+
+Envelope MakeRemoteReadResult(uint32_t num_reads) {
+  Envelope env;
+  auto result = env.mutable_request()->mutable_remote_read_result();
+  result->set_txn_id(1000);
+  result->set_partition(1);
+  for (uint32_t i = 0; i < num_reads; i++) {
+    auto entry = result->add_reads();
+    entry->set_key(std::to_string(i));
+    entry->mutable_value_entry()->set_value(string(FLAGS_value_size, 'a'));
+    entry->mutable_value_entry()->set_type(KeyType::READ);
+  }
+  return env;
+}
+
+template <typename SerializeFn, typename DeserializeFn>
+void RunBenchmark(const string& name, const Envelope& env, SerializeFn&& serialize, DeserializeFn&& deserialize) {
+  uint64_t num_ops = 0;
+  size_t msg_size = 0;
+  auto start = steady_clock::now();
+  auto end = start + seconds(FLAGS_duration);
+  while (steady_clock::now() < end) {
+    // Check the clock every few messages to keep it out of the measurement
+    for (int i = 0; i < 100; i++) {
+      auto msg = serialize(env);
+      msg_size = msg.size();
+      Envelope parsed;
+      CHECK(deserialize(parsed, msg));
+    }
+    num_ops += 100;
+  }
+  auto elapsed = duration<double>(steady_clock::now() - start).count();
+  LOG(INFO) << std::setw(32) << name << " size = " << std::setw(7) << msg_size
+            << " B  round trips = " << std::fixed << std::setprecision(3) << num_ops / elapsed / 1000 << " K/s  ("
+            << std::setprecision(1) << num_ops * msg_size / elapsed / 1000000 << " MB/s)";
+}
+
+void RunBoth(const string& name, const Envelope& env) {
+  RunBenchmark(name + " (any)", env, SerializeAny, DeserializeAny);
+  RunBenchmark(name + " (raw)", env, [](const Envelope& env) { return SerializeProto(env); },
+               [](Envelope& env, const zmq::message_t& msg) { return DeserializeProto(env, msg); });
+}
+
+// Follows the txns of a batch through the same steps as the log manager, scheduler, and workers
+uint64_t CountAllocationsPerTxn(const Envelope& env, bool use_arena) {
+  auto msg = SerializeProto(env);
+  internal::Configuration config_proto;
+  config_proto.add_broker_ports(1);
+  config_proto.set_server_port(2);
+  config_proto.set_forwarder_port(3);
+  config_proto.set_sequencer_port(4);
+  config_proto.set_num_partitions(1);
+  config_proto.add_regions()->add_addresses("");
+  auto config = std::make_shared<Configuration>(config_proto, "");
+  uint64_t before = num_allocations;
+
+  Envelope* received;
+  google::protobuf::Arena* arena = nullptr;
+  if (use_arena) {
+    arena = NewSharedArena(2 * msg.size());
+    received = google::protobuf::Arena::CreateMessage<Envelope>(arena);
+  } else {
+    received = new Envelope();
+  }
+  CHECK(DeserializeProto(*received, msg));
+  auto batch_data = received->mutable_request()->mutable_forward_batch_data()->mutable_batch_data();
+  BatchPtr batch;
+  if (use_arena) {
+    RefSharedArena(arena);
+    batch = BatchPtr(batch_data->UnsafeArenaReleaseLast());
+    UnrefSharedArena(arena);
+  } else {
+    batch = BatchPtr(batch_data->ReleaseLast());
+    delete received;
+  }
+
+  auto txns = Unbatch(batch.get());
+  auto num_txns = txns.size();
+  batch.reset();
+  for (auto txn : txns) {
+    auto forward_env = std::make_unique<Envelope>();
+    forward_env->mutable_request()->mutable_forward_txn()->unsafe_arena_set_allocated_txn(txn);
+    TxnHolder holder(config, forward_env->mutable_request()->mutable_forward_txn()->unsafe_arena_release_txn());
+    DeleteMessage(holder.FinalizeAndRelease());
+  }
+  return (num_allocations - before) / std::max<size_t>(num_txns, 1);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  InitializeService(&argc, &argv);
+
+  if (FLAGS_allocations) {
+    for (const auto& n : Split(FLAGS_txns_per_batch, ",")) {
+      auto env = MakeForwardBatchData(std::stoul(n));
+      LOG(INFO) << "ForwardBatchData txns=" << n << " allocations per txn: heap = "
+                << CountAllocationsPerTxn(env, false) << ", arena = " << CountAllocationsPerTxn(env, true);
+    }
+    return 0;
+  }
+
+  for (const auto& n : Split(FLAGS_txns_per_batch, ",")) {
+    RunBoth("ForwardBatchData txns=" + n, MakeForwardBatchData(std::stoul(n)));
+  }
+  for (const auto& n : Split(FLAGS_reads_per_result, ",")) {
+    RunBoth("RemoteReadResult reads=" + n, MakeRemoteReadResult(std::stoul(n)));
+  }
+  return 0;
+}
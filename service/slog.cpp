@@ -22,6 +22,7 @@
 DEFINE_string(config, "slog.conf", "Path to the configuration file");
 DEFINE_string(address, "", "Address of the local machine");
 DEFINE_string(data_dir, "", "Directory containing intial data");
+DEFINE_string(snapshot, "", "Path to a snapshot of the local partition to start from instead of the initial data");
 
 using slog::Broker;
 using slog::ConfigurationPtr;
@@ -78,17 +79,18 @@ int main(int argc, char* argv[]) {
   }
 
   // Create and initialize storage layer
-  auto [storage, metadata_initializer] = slog::MakeStorage(config, FLAGS_data_dir);
+  auto [storage, lookup_master_index, metadata_initializer, multi_version_storage] =
+      slog::MakeStorage(config, FLAGS_data_dir, FLAGS_snapshot);
 
   vector<pair<unique_ptr<slog::ModuleRunner>, slog::ModuleId>> modules;
   // clang-format off
-  modules.emplace_back(MakeRunnerFor<slog::Server>(broker, metrics_manager),
+  modules.emplace_back(MakeRunnerFor<slog::Server>(broker, multi_version_storage, metrics_manager),
                        slog::ModuleId::SERVER);
   modules.emplace_back(MakeRunnerFor<slog::MultiHomeOrderer>(broker, metrics_manager),
                        slog::ModuleId::MHORDERER);
   modules.emplace_back(MakeRunnerFor<slog::LocalPaxos>(broker),
                        slog::ModuleId::LOCALPAXOS);
-  modules.emplace_back(MakeRunnerFor<slog::Forwarder>(broker->context(), broker->config(), storage,
+  modules.emplace_back(MakeRunnerFor<slog::Forwarder>(broker->context(), broker->config(), lookup_master_index,
                                                       metadata_initializer, metrics_manager),
                        slog::ModuleId::FORWARDER);
   modules.emplace_back(MakeRunnerFor<slog::Sequencer>(broker->context(), broker->config(), metrics_manager),
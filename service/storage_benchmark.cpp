@@ -0,0 +1,165 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/concurrent_hash_map.h"
+#include "common/string_utils.h"
+#include "common/types.h"
+#include "service/service_utils.h"
+
+DEFINE_string(maps, "latched,optimistic,flat", "Comma-separated list of maps to benchmark (latched, optimistic, flat)");
+DEFINE_string(threads, "1,2,4,8", "Comma-separated list of numbers of concurrent threads");
+DEFINE_uint32(records, 1000000, "Number of records");
+DEFINE_uint32(record_size, 100, "Size of a record in bytes");
+DEFINE_uint32(hot_records, 0, "If non-zero, all operations target only this many records");
+DEFINE_double(read_pct, 95, "Percent of operations that are reads");
+DEFINE_uint32(duration, 3, "Duration in seconds of each run");
+DEFINE_string(keys_per_txn, "",
+              "If set, compare reading this comma-separated list of numbers of keys per transaction one at a time "
+              "against reading them with MultiGet, instead of running the mixed workload");
+
+using namespace slog;
+using namespace std::chrono;
+
+using std::string;
+using std::vector;
+
+template <typename MapType>
+void RunBenchmark(const string& name) {
+  MapType map;
+  string value(FLAGS_record_size, 'a');
+  for (uint32_t i = 0; i < FLAGS_records; i++) {
+    map.InsertOrUpdate(std::to_string(i), Record(value));
+  }
+
+  auto num_keys = FLAGS_hot_records > 0 ? std::min(FLAGS_hot_records, FLAGS_records) : FLAGS_records;
+  vector<Key> keys;
+  keys.reserve(num_keys);
+  for (uint32_t i = 0; i < num_keys; i++) {
+    keys.push_back(std::to_string(i));
+  }
+
+  for (auto num_threads_str : Split(FLAGS_threads, ",")) {
+    auto num_threads = std::stoul(num_threads_str);
+    std::atomic<bool> running = true;
+    std::atomic<uint64_t> total_ops = 0;
+
+    auto Run = [&](int seed) {
+      std::mt19937 rg(seed);
+      std::uniform_int_distribution<size_t> key_dist(0, keys.size() - 1);
+      std::uniform_real_distribution<double> pct_dist(0, 100);
+      Record record;
+      uint64_t ops = 0;
+      while (running.load(std::memory_order_relaxed)) {
+        const auto& key = keys[key_dist(rg)];
+        if (pct_dist(rg) < FLAGS_read_pct) {
+          map.Get(record, key);
+        } else {
+          map.InsertOrUpdate(key, Record(value));
+        }
+        ops++;
+      }
+      total_ops += ops;
+    };
+
+    vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back(Run, i);
+    }
+    std::this_thread::sleep_for(seconds(FLAGS_duration));
+    running = false;
+    for (auto& t : threads) {
+      t.join();
+    }
+
+    LOG(INFO) << std::setw(12) << name << " threads = " << std::setw(3) << num_threads
+              << " throughput = " << std::fixed << std::setprecision(3)
+              << total_ops.load() / 1000000.0 / FLAGS_duration << " Mops/s";
+  }
+}
+
+template <typename MapType>
+void RunMultiGetBenchmark(const string& name) {
+  MapType map;
+  string value(FLAGS_record_size, 'a');
+  vector<Key> keys;
+  keys.reserve(FLAGS_records);
+  for (uint32_t i = 0; i < FLAGS_records; i++) {
+    keys.push_back(std::to_string(i));
+    map.InsertOrUpdate(keys.back(), Record(value));
+  }
+
+  for (auto keys_per_txn_str : Split(FLAGS_keys_per_txn, ",")) {
+    auto keys_per_txn = std::stoul(keys_per_txn_str);
+    for (bool multi_get : {false, true}) {
+      std::mt19937 rg(0);
+      std::uniform_int_distribution<size_t> key_dist(0, keys.size() - 1);
+      vector<const Key*> txn_keys(keys_per_txn);
+      string result;
+      uint64_t txns = 0;
+      auto start = steady_clock::now();
+      auto end = start + seconds(FLAGS_duration);
+      while (steady_clock::now() < end) {
+        // Check the time once in a while to keep it out of the measurement
+        for (int t = 0; t < 100; t++) {
+          for (auto& key : txn_keys) {
+            key = &keys[key_dist(rg)];
+          }
+          // Copy the values out like the worker does
+          if (multi_get) {
+            map.MultiGet(txn_keys, [&result](size_t, const Record* record) {
+              if (record != nullptr) {
+                result.assign(record->data(), record->size());
+              }
+            });
+          } else {
+            for (auto key : txn_keys) {
+              if (auto record = map.GetView(*key); record) {
+                result.assign(record->data(), record->size());
+              }
+            }
+          }
+          txns++;
+        }
+      }
+      auto elapsed = duration<double>(steady_clock::now() - start).count();
+
+      LOG(INFO) << std::setw(12) << name << " keys/txn = " << std::setw(4) << keys_per_txn << std::setw(10)
+                << (multi_get ? "MultiGet" : "Get") << " throughput = " << std::fixed << std::setprecision(3)
+                << txns * keys_per_txn / 1000000.0 / elapsed << " Mkeys/s";
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  InitializeService(&argc, &argv);
+
+  LOG(INFO) << "Records = " << FLAGS_records << ", record size = " << FLAGS_record_size
+            << " bytes, hot records = " << FLAGS_hot_records << ", read = " << FLAGS_read_pct << "%";
+
+  for (const auto& map : Split(FLAGS_maps, ",")) {
+    if (!FLAGS_keys_per_txn.empty()) {
+      if (map == "latched") {
+        RunMultiGetBenchmark<ConcurrentHashMap<Key, Record>>(map);
+      } else if (map == "optimistic") {
+        RunMultiGetBenchmark<OptimisticConcurrentHashMap<Key, Record>>(map);
+      } else if (map == "flat") {
+        RunMultiGetBenchmark<FlatConcurrentHashMap<Key, Record>>(map);
+      } else {
+        LOG(FATAL) << "Unknown map: " << map;
+      }
+    } else if (map == "latched") {
+      RunBenchmark<ConcurrentHashMap<Key, Record>>(map);
+    } else if (map == "optimistic") {
+      RunBenchmark<OptimisticConcurrentHashMap<Key, Record>>(map);
+    } else if (map == "flat") {
+      RunBenchmark<FlatConcurrentHashMap<Key, Record>>(map);
+    } else {
+      LOG(FATAL) << "Unknown map: " << map;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,450 @@
+#include "storage/durable_storage.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace slog {
+
+using std::string;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+constexpr char kCheckpointMagic[] = "SLOGCKPT";
+constexpr size_t kCheckpointMagicSize = sizeof(kCheckpointMagic) - 1;
+constexpr char kSegmentPrefix[] = "wal-";
+constexpr char kSegmentSuffix[] = ".log";
+// Size of the buffer filled before writing to a checkpoint file
+constexpr size_t kCheckpointBufferSize = 4 * 1024 * 1024;
+// Each entry starts with its payload size and the checksum of its payload
+constexpr size_t kEntryHeaderSize = 2 * sizeof(uint32_t);
+
+uint32_t Checksum(const char* data, size_t size) {
+  // FNV-1a
+  uint32_t h = 2166136261U;
+  for (size_t i = 0; i < size; i++) {
+    h ^= static_cast<uint8_t>(data[i]);
+    h *= 16777619U;
+  }
+  return h;
+}
+
+template <typename T>
+void PutFixed(string& buffer, T value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool GetFixed(const char*& pos, const char* end, T& value) {
+  if (end - pos < static_cast<ptrdiff_t>(sizeof(T))) {
+    return false;
+  }
+  memcpy(&value, pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+void WriteAll(int fd, const string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    auto res = write(fd, data.data() + written, data.size() - written);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(FATAL) << "Error while writing to storage file: " << strerror(errno);
+    }
+    written += res;
+  }
+}
+
+void SyncDir(const string& dir) {
+  auto fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0 || fsync(fd) < 0) {
+    LOG(FATAL) << "Error while syncing directory \"" << dir << "\": " << strerror(errno);
+  }
+  close(fd);
+}
+
+/**
+ * Reads the entries written by DurableStorage::AppendEntry from a file
+ */
+class EntryReader {
+ public:
+  EntryReader(const string& path) : file_(fopen(path.c_str(), "rb")) {}
+  ~EntryReader() {
+    if (file_ != nullptr) {
+      fclose(file_);
+    }
+  }
+
+  bool is_open() const { return file_ != nullptr; }
+
+  bool ReadRaw(char* data, size_t size) { return fread(data, 1, size, file_) == size; }
+
+  /**
+   * Returns false at the end of the file or at an incomplete or corrupted entry,
+   * which is what the entry being written looks like after a crash
+   */
+  template <typename EntryType>
+  bool Next(EntryType& type, Key& key, Record& record) {
+    char header[kEntryHeaderSize];
+    if (!ReadRaw(header, kEntryHeaderSize)) {
+      return false;
+    }
+    uint32_t size, checksum;
+    memcpy(&size, header, sizeof(uint32_t));
+    memcpy(&checksum, header + sizeof(uint32_t), sizeof(uint32_t));
+    payload_.resize(size);
+    if (!ReadRaw(payload_.data(), size) || Checksum(payload_.data(), size) != checksum) {
+      return false;
+    }
+
+    const char* pos = payload_.data();
+    const char* end = pos + size;
+    uint8_t raw_type;
+    uint32_t key_size;
+    if (!GetFixed(pos, end, raw_type) || !GetFixed(pos, end, key_size) ||
+        static_cast<size_t>(end - pos) < key_size) {
+      return false;
+    }
+    type = static_cast<EntryType>(raw_type);
+    key.assign(pos, key_size);
+    pos += key_size;
+    if (type != EntryType::PUT) {
+      return true;
+    }
+
+    uint32_t master, counter, value_size;
+    if (!GetFixed(pos, end, master) || !GetFixed(pos, end, counter) || !GetFixed(pos, end, value_size) ||
+        static_cast<size_t>(end - pos) != value_size) {
+      return false;
+    }
+    record.SetValue(pos, value_size);
+    record.SetMetadata(Metadata(master, counter));
+    return true;
+  }
+
+ private:
+  FILE* file_;
+  string payload_;
+};
+
+}  // namespace
+
+DurableStorage::DurableStorage(const string& dir, milliseconds group_commit_interval, seconds checkpoint_interval)
+    : dir_(dir),
+      group_commit_interval_(group_commit_interval),
+      checkpoint_interval_(checkpoint_interval),
+      logging_(false),
+      segment_fd_(-1),
+      segment_id_(0),
+      stop_(false) {
+  // Create every directory on the path
+  for (auto pos = dir_.find('/', 1); pos != string::npos; pos = dir_.find('/', pos + 1)) {
+    mkdir(dir_.substr(0, pos).c_str(), 0755);
+  }
+  if (mkdir(dir_.c_str(), 0755) < 0 && errno != EEXIST) {
+    LOG(FATAL) << "Cannot create storage directory \"" << dir_ << "\": " << strerror(errno);
+  }
+}
+
+DurableStorage::~DurableStorage() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(stop_mut_);
+      stop_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+  }
+  if (segment_fd_ >= 0) {
+    Flush();
+    close(segment_fd_);
+  }
+}
+
+bool DurableStorage::Recover() {
+  bool found_state = false;
+  uint64_t first_segment = 0;
+  size_t num_records = 0;
+
+  EntryReader checkpoint(CheckpointPath());
+  if (checkpoint.is_open()) {
+    char magic[kCheckpointMagicSize];
+    CHECK(checkpoint.ReadRaw(magic, kCheckpointMagicSize) &&
+          memcmp(magic, kCheckpointMagic, kCheckpointMagicSize) == 0)
+        << "Invalid checkpoint file \"" << CheckpointPath() << "\"";
+    CHECK(checkpoint.ReadRaw(reinterpret_cast<char*>(&first_segment), sizeof(first_segment)))
+        << "Invalid checkpoint file \"" << CheckpointPath() << "\"";
+
+    EntryType type;
+    Key key;
+    Record record;
+    // A checkpoint file only appears after it is completely written so it must end with an END entry
+    for (;;) {
+      CHECK(checkpoint.Next(type, key, record)) << "Corrupted checkpoint file \"" << CheckpointPath() << "\"";
+      if (type == EntryType::END) {
+        break;
+      }
+      records_.Write(std::move(key), std::move(record));
+      num_records++;
+    }
+    found_state = true;
+    LOG(INFO) << "Loaded " << num_records << " records from checkpoint \"" << CheckpointPath() << "\"";
+  }
+
+  std::vector<uint64_t> segments;
+  if (auto dir = opendir(dir_.c_str()); dir != nullptr) {
+    auto prefix_len = strlen(kSegmentPrefix);
+    while (auto entry = readdir(dir)) {
+      string name(entry->d_name);
+      if (name.compare(0, prefix_len, kSegmentPrefix) == 0 && name.size() > prefix_len + strlen(kSegmentSuffix)) {
+        segments.push_back(std::stoull(name.substr(prefix_len)));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(segments.begin(), segments.end());
+
+  size_t num_entries = 0;
+  size_t num_segments = 0;
+  for (auto id : segments) {
+    segment_id_ = std::max(segment_id_, id);
+    if (id < first_segment) {
+      continue;
+    }
+    found_state = true;
+    num_segments++;
+    EntryReader segment(SegmentPath(id));
+    EntryType type;
+    Key key;
+    Record record;
+    while (segment.Next(type, key, record)) {
+      if (type == EntryType::PUT) {
+        records_.Write(key, record);
+      } else if (type == EntryType::DELETE) {
+        records_.Delete(key);
+      }
+      num_entries++;
+    }
+  }
+  // The next segment must come after the ones read by this checkpoint
+  if (first_segment > 0) {
+    segment_id_ = std::max(segment_id_, first_segment - 1);
+  }
+
+  if (found_state) {
+    LOG(INFO) << "Replayed " << num_entries << " log entries from " << num_segments << " log segments";
+  }
+  return found_state;
+}
+
+void DurableStorage::Start() {
+  {
+    std::lock_guard<std::mutex> guard(file_mut_);
+    OpenSegment(segment_id_ + 1);
+  }
+  logging_ = true;
+  thread_ = std::thread(&DurableStorage::Run, this);
+}
+
+void DurableStorage::Checkpoint() {
+  std::lock_guard<std::mutex> checkpoint_guard(checkpoint_mut_);
+
+  uint64_t first_segment;
+  segment_latch_.WLock();
+  {
+    std::lock_guard<std::mutex> guard(file_mut_);
+    if (segment_fd_ >= 0) {
+      FlushLocked();
+      close(segment_fd_);
+      OpenSegment(segment_id_ + 1);
+      first_segment = segment_id_;
+    } else {
+      // Logging has not started
+      first_segment = segment_id_ + 1;
+    }
+  }
+  segment_latch_.WUnlock();
+
+  auto start_time = steady_clock::now();
+  auto tmp_path = CheckpointPath() + ".tmp";
+  auto fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG(FATAL) << "Cannot create checkpoint file \"" << tmp_path << "\": " << strerror(errno);
+  }
+
+  string buffer(kCheckpointMagic, kCheckpointMagicSize);
+  PutFixed(buffer, first_segment);
+  size_t num_records = 0;
+  // The records are copied into the buffer under the latch of their segment but written to the file after
+  // the latch is released so that the disk does not hold up the writers
+  records_.ForEach(
+      [&](const Key& key, const Record& record) {
+        AppendEntry(buffer, EntryType::PUT, key, &record);
+        num_records++;
+      },
+      [&] {
+        if (buffer.size() >= kCheckpointBufferSize) {
+          WriteAll(fd, buffer);
+          buffer.clear();
+        }
+      });
+  AppendEntry(buffer, EntryType::END, "", nullptr);
+  WriteAll(fd, buffer);
+  if (fsync(fd) < 0) {
+    LOG(FATAL) << "Error while syncing checkpoint file: " << strerror(errno);
+  }
+  close(fd);
+
+  if (rename(tmp_path.c_str(), CheckpointPath().c_str()) < 0) {
+    LOG(FATAL) << "Cannot rename checkpoint file: " << strerror(errno);
+  }
+  SyncDir(dir_);
+
+  // The new checkpoint no longer needs the segments before the one it started
+  for (uint64_t id = first_segment - 1; id > 0; id--) {
+    if (unlink(SegmentPath(id).c_str()) < 0) {
+      break;
+    }
+  }
+
+  auto elapsed = std::chrono::duration_cast<milliseconds>(steady_clock::now() - start_time);
+  LOG(INFO) << "Checkpointed " << num_records << " records in " << elapsed.count() << " ms";
+}
+
+void DurableStorage::Flush() {
+  std::lock_guard<std::mutex> guard(file_mut_);
+  FlushLocked();
+}
+
+void DurableStorage::FlushLocked() {
+  {
+    std::lock_guard<std::mutex> guard(buffer_mut_);
+    // Swapping keeps the capacity of both buffers so neither needs to grow again
+    flush_buffer_.swap(buffer_);
+  }
+  if (flush_buffer_.empty() || segment_fd_ < 0) {
+    return;
+  }
+  WriteAll(segment_fd_, flush_buffer_);
+  if (fdatasync(segment_fd_) < 0) {
+    LOG(FATAL) << "Error while syncing log segment: " << strerror(errno);
+  }
+  flush_buffer_.clear();
+}
+
+bool DurableStorage::Write(const Key& key, const Record& record) {
+  segment_latch_.RLock();
+  Log(EntryType::PUT, key, &record);
+  auto res = records_.Write(key, record);
+  segment_latch_.RUnlock();
+  return res;
+}
+
+bool DurableStorage::Write(const Key& key, Record&& record) {
+  segment_latch_.RLock();
+  Log(EntryType::PUT, key, &record);
+  auto res = records_.Write(key, std::move(record));
+  segment_latch_.RUnlock();
+  return res;
+}
+
+bool DurableStorage::Write(Key&& key, Record&& record) {
+  segment_latch_.RLock();
+  Log(EntryType::PUT, key, &record);
+  auto res = records_.Write(std::move(key), std::move(record));
+  segment_latch_.RUnlock();
+  return res;
+}
+
+bool DurableStorage::Update(const Key& key, const std::function<void(Record&)>& update_fn) {
+  segment_latch_.RLock();
+  // Logging while the record is latched keeps the log entries of the key in the same order as the updates
+  auto res = records_.Update(key, [&](Record& record) {
+    update_fn(record);
+    Log(EntryType::PUT, key, &record);
+  });
+  segment_latch_.RUnlock();
+  return res;
+}
+
+bool DurableStorage::Delete(const Key& key) {
+  segment_latch_.RLock();
+  Log(EntryType::DELETE, key, nullptr);
+  auto res = records_.Delete(key);
+  segment_latch_.RUnlock();
+  return res;
+}
+
+void DurableStorage::AppendEntry(string& buffer, EntryType type, const Key& key, const Record* record) {
+  auto header_pos = buffer.size();
+  buffer.resize(header_pos + kEntryHeaderSize);
+  PutFixed(buffer, static_cast<uint8_t>(type));
+  PutFixed(buffer, static_cast<uint32_t>(key.size()));
+  buffer.append(key);
+  if (type == EntryType::PUT) {
+    PutFixed(buffer, record->metadata().master);
+    PutFixed(buffer, record->metadata().counter);
+    PutFixed(buffer, static_cast<uint32_t>(record->size()));
+    buffer.append(record->data(), record->size());
+  }
+  auto payload_pos = header_pos + kEntryHeaderSize;
+  uint32_t size = buffer.size() - payload_pos;
+  uint32_t checksum = Checksum(buffer.data() + payload_pos, size);
+  memcpy(buffer.data() + header_pos, &size, sizeof(uint32_t));
+  memcpy(buffer.data() + header_pos + sizeof(uint32_t), &checksum, sizeof(uint32_t));
+}
+
+string DurableStorage::SegmentPath(uint64_t id) const {
+  return dir_ + "/" + kSegmentPrefix + std::to_string(id) + kSegmentSuffix;
+}
+
+string DurableStorage::CheckpointPath() const { return dir_ + "/checkpoint"; }
+
+void DurableStorage::OpenSegment(uint64_t id) {
+  auto path = SegmentPath(id);
+  segment_fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (segment_fd_ < 0) {
+    LOG(FATAL) << "Cannot create log segment \"" << path << "\": " << strerror(errno);
+  }
+  segment_id_ = id;
+  SyncDir(dir_);
+}
+
+void DurableStorage::Log(EntryType type, const Key& key, const Record* record) {
+  if (!logging_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(buffer_mut_);
+  AppendEntry(buffer_, type, key, record);
+}
+
+void DurableStorage::Run() {
+  auto next_checkpoint = steady_clock::now() + checkpoint_interval_;
+  std::unique_lock<std::mutex> lock(stop_mut_);
+  while (!stop_) {
+    stop_cv_.wait_for(lock, group_commit_interval_);
+    lock.unlock();
+
+    Flush();
+    if (checkpoint_interval_.count() > 0 && steady_clock::now() >= next_checkpoint) {
+      Checkpoint();
+      next_checkpoint = steady_clock::now() + checkpoint_interval_;
+    }
+
+    lock.lock();
+  }
+}
+
+}  // namespace slog
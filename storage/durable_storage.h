@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common/rwlatch.h"
+#include "storage/mem_only_storage.h"
+
+namespace slog {
+
+/**
+ * A storage that keeps all records in memory, like MemOnlyStorage, and persists them in a local
+ * directory with a write-ahead log and checkpoints.
+ *
+ * Every write is appended to a log buffer in memory. A background thread writes the buffer to the
+ * current log segment and syncs it to disk every group commit interval, so the cost of a sync is
+ * shared by all writes in that interval. A checkpoint starts a new log segment and then dumps every
+ * record into a checkpoint file while the writes go on (fuzzy checkpoint). A log entry contains the
+ * full record of a key, so replaying the segments from the one started by the last checkpoint on
+ * top of that checkpoint restores the latest state. Older segments are deleted after a checkpoint.
+ *
+ * Writes that have not been group committed are lost in a crash.
+ *
+ * This makes a restart warm, not a crash recovery of the deployment. The log records no position in the
+ * deterministic log and every partition group commits on its own schedule, so after a crash each partition
+ * may lose a different tail of writes, and a multi-partition txn may survive on some of its partitions only.
+ * Even on one partition, a crash can leave part of a txn in place since the fuzzy checkpoint may contain
+ * writes of a txn whose log entries were not group committed. Nothing tells the log managers where to
+ * resume either. The recovered records are only consistent if the deployment was shut down cleanly.
+ *
+ * Reads and writes of different keys may come from any thread, also while the background thread is
+ * taking a checkpoint. A write is logged before it is applied, so two overlapping writes of the same key
+ * could be replayed in another order than they were applied and must not happen.
+ */
+class DurableStorage : public Storage, public LookupMasterIndex {
+ public:
+  DurableStorage(const std::string& dir, std::chrono::milliseconds group_commit_interval,
+                 std::chrono::seconds checkpoint_interval);
+  ~DurableStorage();
+
+  /**
+   * Loads the last checkpoint and replays the log after it. Returns false if there is no local state.
+   * See the class comment for what the recovered state is after a crash
+   */
+  bool Recover();
+
+  /**
+   * Starts logging writes and starts the background thread doing group commits and periodic
+   * checkpoints. Writes made before this call are only persisted by the next checkpoint.
+   */
+  void Start();
+
+  void Checkpoint();
+
+  /**
+   * Writes the log buffer to the current log segment and syncs it to disk
+   */
+  void Flush();
+
+  bool Read(const Key& key, Record& result) const final { return records_.Read(key, result); }
+
+  RecordView ReadView(const Key& key) const final { return records_.ReadView(key); }
+
+  void MultiRead(const std::vector<const Key*>& keys,
+                 const std::function<void(size_t, const Record*)>& fn) const final {
+    records_.MultiRead(keys, fn);
+  }
+
+  bool Write(const Key& key, const Record& record) final;
+
+  bool Write(const Key& key, Record&& record) final;
+
+  bool Write(Key&& key, Record&& record) final;
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final;
+
+  bool UpdatesInPlace() const final { return records_.UpdatesInPlace(); }
+
+  bool Delete(const Key& key) final;
+
+  void Reserve(size_t n) final { records_.Reserve(n); }
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
+    return records_.GetMasterMetadata(key, metadata);
+  }
+
+  void MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                              std::vector<std::optional<Metadata>>& metadata) const final {
+    records_.MultiGetMasterMetadata(keys, metadata);
+  }
+
+  /**
+   * Calls fn(key, record) on every record. This is not a consistent snapshot if there are concurrent writes
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    records_.ForEach(std::forward<Fn>(fn));
+  }
+
+ private:
+  enum class EntryType : uint8_t { PUT, DELETE, END };
+
+  static void AppendEntry(std::string& buffer, EntryType type, const Key& key, const Record* record);
+
+  std::string SegmentPath(uint64_t id) const;
+  std::string CheckpointPath() const;
+  void OpenSegment(uint64_t id);
+  void Log(EntryType type, const Key& key, const Record* record);
+  // Must hold file_mut_
+  void FlushLocked();
+  void Run();
+
+  std::string dir_;
+  std::chrono::milliseconds group_commit_interval_;
+  std::chrono::seconds checkpoint_interval_;
+
+  MemOnlyStorage records_;
+
+  // Writers hold this latch in shared mode while applying and logging a write. A checkpoint holds it
+  // exclusively when switching to a new log segment, so every write logged in an older segment has
+  // already been applied by the time the checkpoint starts dumping the records
+  bustub::ReaderWriterLatch segment_latch_;
+
+  std::atomic<bool> logging_;
+  std::mutex buffer_mut_;
+  std::string buffer_;
+
+  // Guards the files below and the buffer being flushed
+  std::mutex file_mut_;
+  std::string flush_buffer_;
+  int segment_fd_;
+  uint64_t segment_id_;
+
+  std::mutex checkpoint_mut_;
+
+  std::thread thread_;
+  std::mutex stop_mut_;
+  std::condition_variable stop_cv_;
+  bool stop_;
+};
+
+}  // namespace slog
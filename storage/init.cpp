@@ -1,6 +1,5 @@
 #include "storage/init.h"
 
-#include <fcntl.h>
 #include <glog/logging.h>
 
 #include <condition_variable>
@@ -11,6 +10,15 @@
 #include "common/sharder.h"
 #include "execution/tpcc/load_tables.h"
 #include "proto/offline_data.pb.h"
+#include "storage/durable_storage.h"
+#include "storage/int_key_storage.h"
+#include "storage/lazy_data_storage.h"
+#include "storage/master_metadata_index.h"
+#include "storage/mem_only_storage.h"
+#include "storage/multi_version_storage.h"
+#include "storage/ordered_storage.h"
+#include "storage/snapshot_storage.h"
+#include "storage/tiered_storage.h"
 
 namespace slog {
 
@@ -19,6 +27,8 @@ using std::shared_ptr;
 using std::string;
 
 const int kDataGenThreads = 3;
+// Number of datums in each chunk of a data file that is loaded by a single thread
+const uint32_t kLoadDataChunkSize = 10000;
 
 static void GenerateSimpleData(shared_ptr<Storage> storage, const shared_ptr<MetadataInitializer>& metadata_initializer,
                                const ConfigurationPtr& config);
@@ -29,30 +39,203 @@ static void GenerateTPCCData(shared_ptr<Storage> storage, const shared_ptr<Metad
                              const ConfigurationPtr& config);
 static void LoadData(Storage& storage, const ConfigurationPtr& config, const string& data_dir);
 
-std::pair<shared_ptr<MemOnlyStorage>, shared_ptr<MetadataInitializer>> MakeStorage(const ConfigurationPtr& config,
-                                                                                   const string& data_dir) {
-  auto storage = std::make_shared<MemOnlyStorage>();
-  shared_ptr<MetadataInitializer> metadata_initializer;
+static void LoadSnapshot(Storage& storage, const string& snapshot_path);
+
+std::tuple<shared_ptr<Storage>, shared_ptr<LookupMasterIndex>, shared_ptr<MetadataInitializer>,
+           shared_ptr<MultiVersionStorage>>
+MakeStorage(const ConfigurationPtr& config, const string& data_dir, const string& snapshot_path) {
+  shared_ptr<Storage> storage;
+  shared_ptr<LookupMasterIndex> lookup_master_index;
+  shared_ptr<DurableStorage> durable_storage;
+  shared_ptr<MultiVersionStorage> multi_version_storage;
+  // Whether the data was restored from local state, in which case it is not generated or loaded again
+  bool recovered = false;
+  // Whether the engine serves the initial data directly from the snapshot
+  bool mapped = false;
+  switch (config->storage_type()) {
+    case internal::StorageType::ORDERED: {
+      auto ordered_storage = make_shared<OrderedStorage>();
+      storage = ordered_storage;
+      lookup_master_index = ordered_storage;
+      break;
+    }
+    case internal::StorageType::DURABLE: {
+      const auto& options = config->durable_storage_options();
+      CHECK(!options.dir().empty()) << "Directory of the durable storage is not specified";
+      auto dir = options.dir() + "/" + std::to_string(config->local_machine_id());
+      durable_storage =
+          make_shared<DurableStorage>(dir, std::chrono::milliseconds(std::max(options.group_commit_interval(), 1U)),
+                                      std::chrono::seconds(options.checkpoint_interval()));
+      recovered = durable_storage->Recover();
+      if (recovered) {
+        LOG(WARNING) << "Restarted from the local state of the durable storage. The partitions are not "
+                        "recovered to a common point in the log, so this state is only consistent after a clean "
+                        "shutdown";
+      }
+      storage = durable_storage;
+      lookup_master_index = durable_storage;
+      break;
+    }
+    case internal::StorageType::TIERED: {
+      const auto& options = config->tiered_storage_options();
+      CHECK(!options.dir().empty()) << "Directory of the tiered storage is not specified";
+      CHECK_GT(options.memory_limit(), 0U) << "Memory limit of the tiered storage is not specified";
+      auto dir = options.dir() + "/" + std::to_string(config->local_machine_id());
+      auto eviction_interval = options.eviction_interval() > 0 ? options.eviction_interval() : 100U;
+      auto num_io_threads = options.num_io_threads() > 0 ? options.num_io_threads() : 4U;
+      auto tiered_storage = make_shared<TieredStorage>(dir, options.memory_limit(),
+                                                       std::chrono::milliseconds(eviction_interval), num_io_threads);
+      storage = tiered_storage;
+      lookup_master_index = tiered_storage;
+      break;
+    }
+    case internal::StorageType::LATCHED_HASH: {
+      auto latched_storage = make_shared<LatchedMemOnlyStorage>();
+      storage = latched_storage;
+      lookup_master_index = latched_storage;
+      break;
+    }
+    case internal::StorageType::MULTI_VERSION: {
+      multi_version_storage = make_shared<MultiVersionStorage>();
+      storage = multi_version_storage;
+      lookup_master_index = multi_version_storage;
+      break;
+    }
+    default: {
+      if (!snapshot_path.empty()) {
+        auto snapshot_storage = make_shared<SnapshotStorage>(snapshot_path);
+        storage = snapshot_storage;
+        lookup_master_index = snapshot_storage;
+        mapped = true;
+        break;
+      }
+      auto partitioning = config->proto_config().partitioning_case();
+      if (partitioning == internal::Configuration::kSimplePartitioning ||
+          partitioning == internal::Configuration::kSimplePartitioning2) {
+        // All keys of these workloads are numbers
+        auto int_key_storage = make_shared<IntKeyMemOnlyStorage>();
+        storage = int_key_storage;
+        lookup_master_index = int_key_storage;
+        break;
+      }
+      auto mem_only_storage = make_shared<MemOnlyStorage>();
+      storage = mem_only_storage;
+      lookup_master_index = mem_only_storage;
+      break;
+    }
+  }
+
+  if (config->master_metadata_index()) {
+    if (mapped) {
+      // Looking up the metadata in a snapshot already skips the values
+      LOG(WARNING) << "Master metadata index is not used when serving from a snapshot";
+    } else {
+      auto indexed_storage = make_shared<MasterMetadataIndexedStorage>(storage);
+      if (recovered) {
+        durable_storage->ForEach(
+            [&](const Key& key, const Record& record) { indexed_storage->AddToIndex(key, record.metadata()); });
+      }
+      storage = indexed_storage;
+      lookup_master_index = indexed_storage;
+    }
+  }
+
+  auto metadata_initializer = MakeMetadataInitializer(config);
+  // Whether the initial records are derived from the keys on access instead of generated here
+  bool lazy = false;
+  if (config->lazy_data()) {
+    auto partitioning = config->proto_config().partitioning_case();
+    if (!snapshot_path.empty()) {
+      LOG(WARNING) << "Lazy data is not used when starting from a snapshot";
+    } else if (multi_version_storage != nullptr) {
+      // Snapshot reads go directly to the versions so they would not see the derived records
+      LOG(WARNING) << "Lazy data is not supported by the MULTI_VERSION storage type";
+    } else if (durable_storage != nullptr) {
+      // The tombstones of deleted initial records only live in memory so a restart would bring the records back
+      LOG(WARNING) << "Lazy data is not supported by the DURABLE storage type";
+    } else if (partitioning == internal::Configuration::kSimplePartitioning ||
+               partitioning == internal::Configuration::kSimplePartitioning2) {
+      uint64_t num_records;
+      uint32_t record_size;
+      if (partitioning == internal::Configuration::kSimplePartitioning) {
+        num_records = config->proto_config().simple_partitioning().num_records();
+        record_size = config->proto_config().simple_partitioning().record_size_bytes();
+      } else {
+        num_records = config->proto_config().simple_partitioning2().num_records();
+        record_size = config->proto_config().simple_partitioning2().record_size_bytes();
+      }
+      auto lazy_data_storage = make_shared<LazyDataStorage>(storage, lookup_master_index, Sharder::MakeSharder(config),
+                                                            metadata_initializer, num_records, record_size);
+      storage = lazy_data_storage;
+      lookup_master_index = lazy_data_storage;
+      lazy = true;
+      LOG(INFO) << "Initial records are derived from their keys on access";
+    } else {
+      LOG(WARNING) << "Lazy data is only supported by the simple partitionings";
+    }
+  }
+
+  if (!recovered && !mapped && !lazy) {
+    if (!snapshot_path.empty()) {
+      // Engines that cannot serve from the snapshot still skip the data generation by copying from it
+      LoadSnapshot(*storage, snapshot_path);
+    } else {
+      PopulateStorage(storage, metadata_initializer, config, data_dir);
+    }
+  }
+
+  if (durable_storage != nullptr) {
+    // Persist the initial data so that it does not have to be generated or loaded again after a restart
+    if (!recovered) {
+      durable_storage->Checkpoint();
+    }
+    durable_storage->Start();
+  }
+
+  return {storage, lookup_master_index, metadata_initializer, multi_version_storage};
+}
+
+shared_ptr<MetadataInitializer> MakeMetadataInitializer(const ConfigurationPtr& config) {
+  switch (config->proto_config().partitioning_case()) {
+    case internal::Configuration::kSimplePartitioning:
+      return make_shared<SimpleMetadataInitializer>(config->num_regions(), config->num_partitions());
+    case internal::Configuration::kSimplePartitioning2:
+      return make_shared<SimpleMetadataInitializer2>(config->num_regions(), config->num_partitions());
+    case internal::Configuration::kTpccPartitioning:
+      return make_shared<tpcc::TPCCMetadataInitializer>(config->num_regions(), config->num_partitions());
+    default:
+      return make_shared<ConstantMetadataInitializer>(0);
+  }
+}
+
+void PopulateStorage(const shared_ptr<Storage>& storage, const shared_ptr<MetadataInitializer>& metadata_initializer,
+                     const ConfigurationPtr& config, const string& data_dir) {
   switch (config->proto_config().partitioning_case()) {
     case internal::Configuration::kSimplePartitioning:
-      metadata_initializer = make_shared<SimpleMetadataInitializer>(config->num_regions(), config->num_partitions());
       GenerateSimpleData(storage, metadata_initializer, config);
       break;
     case internal::Configuration::kSimplePartitioning2:
-      metadata_initializer = make_shared<SimpleMetadataInitializer2>(config->num_regions(), config->num_partitions());
       GenerateSimpleData2(storage, metadata_initializer, config);
       break;
     case internal::Configuration::kTpccPartitioning:
-      metadata_initializer =
-          make_shared<tpcc::TPCCMetadataInitializer>(config->num_regions(), config->num_partitions());
       GenerateTPCCData(storage, metadata_initializer, config);
       break;
     default:
-      metadata_initializer = make_shared<ConstantMetadataInitializer>(0);
       LoadData(*storage, config, data_dir);
       break;
   }
-  return {storage, metadata_initializer};
+}
+
+void LoadSnapshot(Storage& storage, const string& snapshot_path) {
+  Snapshot snapshot(snapshot_path);
+  LOG(INFO) << "Loading " << snapshot.size() << " records from snapshot...";
+  storage.Reserve(snapshot.size());
+  snapshot.ForEach([&storage](const Snapshot::Entry& entry) {
+    Record record;
+    record.SetValue(entry.value.data(), entry.value.size());
+    record.SetMetadata(entry.metadata);
+    storage.Write(Key(entry.key), std::move(record));
+  });
 }
 
 void LoadData(Storage& storage, const ConfigurationPtr& config, const string& data_dir) {
@@ -63,37 +246,58 @@ void LoadData(Storage& storage, const ConfigurationPtr& config, const string& da
 
   auto data_file = data_dir + "/" + std::to_string(config->local_partition()) + ".dat";
 
-  auto fd = open(data_file.c_str(), O_RDONLY);
-  if (fd < 0) {
+  OfflineDataChunkReader reader(data_file, kLoadDataChunkSize);
+  if (!reader.is_open()) {
     LOG(ERROR) << "Error while loading \"" << data_file << "\": " << strerror(errno)
                << ". Starting with an empty storage.";
     return;
   }
 
-  OfflineDataReader reader(fd);
-  LOG(INFO) << "Loading " << reader.GetNumDatums() << " datums...";
+  auto num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+  LOG(INFO) << "Loading " << reader.GetNumDatums() << " datums using " << num_threads << " threads...";
+  storage.Reserve(reader.GetNumDatums());
 
   auto sharder = Sharder::MakeSharder(config);
 
   VLOG(1) << "First 10 datums are: ";
-  int c = 10;
-  while (reader.HasNextDatum()) {
-    auto datum = reader.GetNextDatum();
-    if (c > 0) {
-      VLOG(1) << datum.key() << " " << datum.record() << " " << datum.master();
-      c--;
-    }
+  if (VLOG_IS_ON(1) && reader.GetNumChunks() > 0) {
+    int c = 10;
+    reader.ForEachDatum(0, [&c](const Datum& datum) {
+      if (c > 0) {
+        VLOG(1) << datum.key() << " " << datum.record() << " " << datum.master();
+        c--;
+      }
+    });
+  }
 
-    CHECK(sharder->is_local_key(datum.key()))
-        << "Key " << datum.key() << " does not belong to partition " << config->local_partition();
+  auto start_time = std::chrono::steady_clock::now();
+  // Each thread parses and writes a whole chunk at a time. Chunks are small enough to balance the load
+  std::atomic<size_t> next_chunk = 0;
+  auto LoadFn = [&]() {
+    for (auto chunk = next_chunk++; chunk < reader.GetNumChunks(); chunk = next_chunk++) {
+      reader.ForEachDatum(chunk, [&](Datum& datum) {
+        CHECK(sharder->is_local_key(datum.key()))
+            << "Key " << datum.key() << " does not belong to partition " << config->local_partition();
 
-    CHECK_LT(datum.master(), config->num_regions()) << "Master number exceeds number of regions";
+        CHECK_LT(datum.master(), config->num_regions()) << "Master number exceeds number of regions";
 
-    // Write to storage
-    Record record(datum.record(), datum.master());
-    storage.Write(datum.key(), record);
+        // Write to storage
+        Record record(datum.record(), datum.master());
+        storage.Write(std::move(*datum.mutable_key()), std::move(record));
+      });
+    }
+  };
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < num_threads; i++) {
+    threads.emplace_back(LoadFn);
+  }
+  for (auto& t : threads) {
+    t.join();
   }
-  close(fd);
+
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  LOG(INFO) << "Loaded " << reader.GetNumDatums() << " datums in " << elapsed << " s ("
+            << static_cast<uint64_t>(reader.GetNumDatums() / std::max(elapsed, 1e-9)) << " records/s)";
 }
 
 void GenerateSimpleData(shared_ptr<Storage> storage, const shared_ptr<MetadataInitializer>& metadata_initializer,
@@ -108,6 +312,7 @@ void GenerateSimpleData(shared_ptr<Storage> storage, const shared_ptr<MetadataIn
 
   LOG(INFO) << "Generating ~" << num_records / num_partitions << " records using " << kDataGenThreads << " threads. "
             << "Record size = " << simple_partitioning.record_size_bytes() << " bytes";
+  storage->Reserve(num_records / num_partitions + 1);
 
   std::atomic<uint64_t> counter = 0;
   std::atomic<size_t> num_done = 0;
@@ -115,7 +320,7 @@ void GenerateSimpleData(shared_ptr<Storage> storage, const shared_ptr<MetadataIn
     for (uint64_t key = from_key; key < to_key; key += num_partitions) {
       Record record(value);
       record.SetMetadata(metadata_initializer->Compute(std::to_string(key)));
-      storage->Write(std::to_string(key), record);
+      storage->Write(std::to_string(key), std::move(record));
       counter++;
     }
     num_done++;
@@ -158,6 +363,7 @@ void GenerateSimpleData2(shared_ptr<Storage> storage, const shared_ptr<MetadataI
 
   LOG(INFO) << "Generating ~" << num_records / num_partitions << " records using " << kDataGenThreads << " threads. "
             << "Record size = " << simple_partitioning.record_size_bytes() << " bytes";
+  storage->Reserve(num_records / num_partitions + 1);
 
   std::atomic<uint64_t> counter = 0;
   std::atomic<size_t> num_done = 0;
@@ -167,7 +373,7 @@ void GenerateSimpleData2(shared_ptr<Storage> storage, const shared_ptr<MetadataI
       if (key_partition == partition) {
         Record record(value);
         record.SetMetadata(metadata_initializer->Compute(std::to_string(key)));
-        storage->Write(std::to_string(key), record);
+        storage->Write(std::to_string(key), std::move(record));
         counter++;
       }
     }
@@ -1,12 +1,34 @@
 #pragma once
 
+#include <tuple>
+
 #include "common/configuration.h"
 #include "execution/tpcc/metadata_initializer.h"
-#include "storage/mem_only_storage.h"
+#include "storage/lookup_master_index.h"
+#include "storage/multi_version_storage.h"
+#include "storage/storage.h"
 
 namespace slog {
 
-std::pair<std::shared_ptr<MemOnlyStorage>, std::shared_ptr<MetadataInitializer>> MakeStorage(
-    const ConfigurationPtr& config, const std::string& data_dir);
+/**
+ * Creates the storage engine specified in the config and populates it with the initial data.
+ * The returned storage and lookup master index point to the same engine. If a snapshot is given,
+ * the initial data is taken from it instead of being generated or loaded from data_dir. The
+ * default hash engine then serves the snapshot in place without loading it into memory. The returned
+ * multi-version storage is the same engine if it keeps multiple versions, and null otherwise.
+ */
+std::tuple<std::shared_ptr<Storage>, std::shared_ptr<LookupMasterIndex>, std::shared_ptr<MetadataInitializer>,
+           std::shared_ptr<MultiVersionStorage>>
+MakeStorage(const ConfigurationPtr& config, const std::string& data_dir, const std::string& snapshot_path = "");
+
+std::shared_ptr<MetadataInitializer> MakeMetadataInitializer(const ConfigurationPtr& config);
+
+/**
+ * Generates the initial data of the local partition, or loads it from data_dir if the data is
+ * not generated, and writes it to the storage
+ */
+void PopulateStorage(const std::shared_ptr<Storage>& storage,
+                     const std::shared_ptr<MetadataInitializer>& metadata_initializer, const ConfigurationPtr& config,
+                     const std::string& data_dir);
 
 }  // namespace slog
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "common/concurrent_hash_map.h"
+#include "storage/mem_only_storage.h"
+
+namespace slog {
+
+/**
+ * An in-memory storage for workloads whose keys are decimal numbers, such as the ones generated with simple
+ * partitioning. Numeric keys are stored as 64-bit integers, which saves the memory of a string per record
+ * and makes hashing and comparing keys cheaper. Any other key, including a number with leading zeros, is
+ * kept in a regular MemOnlyStorage so that every key is still supported.
+ */
+class IntKeyMemOnlyStorage : public Storage, public LookupMasterIndex {
+ public:
+  bool Read(const Key& key, Record& result) const final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      return table_.Get(result, id);
+    }
+    return other_keys_.Read(key, result);
+  }
+
+  RecordView ReadView(const Key& key) const final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      return table_.GetView(id);
+    }
+    return other_keys_.ReadView(key);
+  }
+
+  void MultiRead(const std::vector<const Key*>& keys,
+                 const std::function<void(size_t, const Record*)>& fn) const final {
+    MultiVisit(keys, fn);
+  }
+
+  bool Write(const Key& key, const Record& record) final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      return table_.InsertOrUpdate(id, record);
+    }
+    return other_keys_.Write(key, record);
+  }
+
+  bool Write(const Key& key, Record&& record) final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      return table_.InsertOrUpdate(std::move(id), std::move(record));
+    }
+    return other_keys_.Write(key, std::move(record));
+  }
+
+  bool Write(Key&& key, Record&& record) final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      return table_.InsertOrUpdate(std::move(id), std::move(record));
+    }
+    return other_keys_.Write(std::move(key), std::move(record));
+  }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      return table_.Update(id, update_fn);
+    }
+    return other_keys_.Update(key, update_fn);
+  }
+
+  bool UpdatesInPlace() const final { return decltype(table_)::kUpdatesInPlace && other_keys_.UpdatesInPlace(); }
+
+  bool Delete(const Key& key) final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      return table_.Erase(id);
+    }
+    return other_keys_.Delete(key);
+  }
+
+  void Reserve(size_t n) final { table_.Reserve(n); }
+
+  /**
+   * Calls fn(key, record) on every record. This is not a consistent snapshot if there are concurrent writes
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    table_.ForEach([&fn](uint64_t id, const Record& record) { fn(std::to_string(id), record); });
+    other_keys_.ForEach(fn);
+  }
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
+    if (uint64_t id; ParseIntKey(key, id)) {
+      auto rec = table_.GetView(id);
+      if (!rec) {
+        return false;
+      }
+      metadata = rec->metadata();
+      return true;
+    }
+    return other_keys_.GetMasterMetadata(key, metadata);
+  }
+
+  void MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                              std::vector<std::optional<Metadata>>& metadata) const final {
+    metadata.resize(keys.size());
+    MultiVisit(keys, [&metadata](size_t i, const Record* record) {
+      if (record != nullptr) {
+        metadata[i] = record->metadata();
+      } else {
+        metadata[i].reset();
+      }
+    });
+  }
+
+ private:
+  // Looks up the numeric keys together and the other keys one by one
+  template <typename Fn>
+  void MultiVisit(const std::vector<const Key*>& keys, Fn&& fn) const {
+    // The storage is shared by several threads so the buffers are per thread. They are reused across calls so
+    // that a lookup does not allocate. fn must not access the storage, so the calls do not nest
+    thread_local std::vector<uint64_t> ids;
+    thread_local std::vector<size_t> positions;
+    thread_local std::vector<const uint64_t*> id_ptrs;
+    ids.clear();
+    positions.clear();
+    id_ptrs.clear();
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (uint64_t id; ParseIntKey(*keys[i], id)) {
+        ids.push_back(id);
+        positions.push_back(i);
+      } else {
+        auto record = other_keys_.ReadView(*keys[i]);
+        fn(i, record.get());
+      }
+    }
+    for (const auto& id : ids) {
+      id_ptrs.push_back(&id);
+    }
+    table_.MultiGet(id_ptrs, [&](size_t j, const Record* record) { fn(positions[j], record); });
+  }
+
+#ifdef STORAGE_LAYOUT_FLAT
+  FlatConcurrentHashMap<uint64_t, Record, IntKeyHash> table_;
+#else
+  OptimisticConcurrentHashMap<uint64_t, Record, IntKeyHash> table_;
+#endif
+  MemOnlyStorage other_keys_;
+};
+
+}  // namespace slog
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <memory>
+
+#include "common/sharder.h"
+#include "storage/lookup_master_index.h"
+#include "storage/metadata_initializer.h"
+#include "storage/storage.h"
+#include "storage/tombstone_overlay.h"
+
+namespace slog {
+
+/**
+ * Wraps a storage and serves the initial records of the simple partitionings without generating them up
+ * front. The initial records are the numeric keys below num_records that belong to the local partition.
+ * Their values and metadata are derived from the keys in the same way as the eager data generation, so
+ * they only take up memory once they are written. The wrapped storage only holds the written records,
+ * which take precedence over the derived ones, and deleted initial records are remembered as tombstones
+ * (see storage/tombstone_overlay.h for how this may be used concurrently). The tombstones are only kept in
+ * memory, so this cannot wrap a storage that persists its records.
+ */
+class LazyDataStorage : public Storage, public LookupMasterIndex {
+ public:
+  LazyDataStorage(const std::shared_ptr<Storage>& storage, const std::shared_ptr<LookupMasterIndex>& index,
+                  const SharderPtr& sharder, const std::shared_ptr<MetadataInitializer>& metadata_initializer,
+                  uint64_t num_records, uint32_t record_size)
+      : storage_(storage),
+        index_(index),
+        sharder_(sharder),
+        metadata_initializer_(metadata_initializer),
+        num_records_(num_records),
+        value_(record_size, 'a') {}
+
+  bool Read(const Key& key, Record& result) const final {
+    if (storage_->Read(key, result)) {
+      return true;
+    }
+    if (!IsInitialKey(key)) {
+      return false;
+    }
+    result = MakeInitialRecord(key);
+    return true;
+  }
+
+  RecordView ReadView(const Key& key) const final {
+    if (auto view = storage_->ReadView(key); view) {
+      return view;
+    }
+    if (!IsInitialKey(key)) {
+      return {};
+    }
+    return RecordView::Owned(std::make_unique<Record>(MakeInitialRecord(key)));
+  }
+
+  void MultiRead(const std::vector<const Key*>& keys,
+                 const std::function<void(size_t, const Record*)>& fn) const final {
+    storage_->MultiRead(keys, [&](size_t i, const Record* record) {
+      if (record == nullptr && IsInitialKey(*keys[i])) {
+        auto initial_record = MakeInitialRecord(*keys[i]);
+        fn(i, &initial_record);
+      } else {
+        fn(i, record);
+      }
+    });
+  }
+
+  bool Write(const Key& key, const Record& record) final {
+    return storage_->Write(key, record) || tombstones_.ExistedInBase(key, InInitialData(key));
+  }
+
+  bool Write(const Key& key, Record&& record) final {
+    return storage_->Write(key, std::move(record)) || tombstones_.ExistedInBase(key, InInitialData(key));
+  }
+
+  bool Write(Key&& key, Record&& record) final {
+    Key key_copy(key);
+    return storage_->Write(std::move(key), std::move(record)) ||
+           tombstones_.ExistedInBase(key_copy, InInitialData(key_copy));
+  }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final {
+    if (storage_->Update(key, update_fn)) {
+      return true;
+    }
+    // Materialize the initial record on its first update
+    if (!IsInitialKey(key)) {
+      return false;
+    }
+    auto record = MakeInitialRecord(key);
+    update_fn(record);
+    storage_->Write(key, std::move(record));
+    return true;
+  }
+
+  bool UpdatesInPlace() const final { return storage_->UpdatesInPlace(); }
+
+  bool Delete(const Key& key) final { return tombstones_.Delete(*storage_, key, InInitialData(key)); }
+
+  void BeginWriteBatch() final { storage_->BeginWriteBatch(); }
+
+  void EndWriteBatch() final { storage_->EndWriteBatch(); }
+
+  bool Prefetch(const std::vector<const Key*>& keys, const std::function<void()>& done) final {
+    return storage_->Prefetch(keys, done);
+  }
+
+  void GetStats(rapidjson::Document& stats, uint32_t level) const final { storage_->GetStats(stats, level); }
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
+    if (index_->GetMasterMetadata(key, metadata)) {
+      return true;
+    }
+    if (!IsInitialKey(key)) {
+      return false;
+    }
+    metadata = metadata_initializer_->Compute(key);
+    return true;
+  }
+
+  void MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                              std::vector<std::optional<Metadata>>& metadata) const final {
+    index_->MultiGetMasterMetadata(keys, metadata);
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (!metadata[i].has_value() && IsInitialKey(*keys[i])) {
+        metadata[i] = metadata_initializer_->Compute(*keys[i]);
+      }
+    }
+  }
+
+ private:
+  // Returns whether key is an initial record, deleted or not
+  bool InInitialData(const Key& key) const {
+    uint64_t id;
+    return ParseIntKey(key, id) && id < num_records_ && sharder_->is_local_key(key);
+  }
+
+  // Returns whether key is an initial record that has not been deleted
+  bool IsInitialKey(const Key& key) const { return InInitialData(key) && !tombstones_.IsDeleted(key); }
+
+  Record MakeInitialRecord(const Key& key) const {
+    Record record(value_);
+    record.SetMetadata(metadata_initializer_->Compute(key));
+    return record;
+  }
+
+  std::shared_ptr<Storage> storage_;
+  std::shared_ptr<LookupMasterIndex> index_;
+  SharderPtr sharder_;
+  std::shared_ptr<MetadataInitializer> metadata_initializer_;
+  uint64_t num_records_;
+  Value value_;
+  // Initial records that have been deleted
+  TombstoneOverlay tombstones_;
+};
+
+}  // namespace slog
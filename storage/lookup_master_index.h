@@ -1,5 +1,8 @@
 #pragma once
 
+#include <optional>
+#include <vector>
+
 #include "common/types.h"
 
 namespace slog {
@@ -7,6 +10,19 @@ namespace slog {
 class LookupMasterIndex {
  public:
   virtual bool GetMasterMetadata(const Key& key, Metadata& metadata) const = 0;
+  // Looks up the metadata of every keys[i] into metadata[i], which is empty if the key does not exist.
+  // Indices that can do so look up the keys together so that the cache misses of different keys overlap
+  virtual void MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                                      std::vector<std::optional<Metadata>>& metadata) const {
+    metadata.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (Metadata m; GetMasterMetadata(*keys[i], m)) {
+        metadata[i] = m;
+      } else {
+        metadata[i].reset();
+      }
+    }
+  }
 };
 
 }  // namespace slog
\ No newline at end of file
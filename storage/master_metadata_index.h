@@ -0,0 +1,233 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>
+
+#include "common/concurrent_hash_map.h"
+#include "storage/lookup_master_index.h"
+#include "storage/storage.h"
+
+namespace slog {
+
+/**
+ * Wraps a storage and keeps a separate index from every key to the master metadata of its record. The
+ * forwarder looks up the masters of the keys of every transaction, so this index keeps those lookups
+ * away from the value bytes: its entries are small, hence more of them stay in the cache, and reading
+ * them never takes a latch. The index is maintained by every write, including the ones that remaster.
+ *
+ * The index does not keep a copy of the keys. Its entries are keyed by a hash of the key and hold a
+ * second, independent hash that tells apart the keys that are not stored. If two stored keys share the
+ * first hash, their entry only counts them and their lookups read the metadata from the records instead.
+ *
+ * Lookups can run concurrently with writes from any thread. Writes to the same key must be ordered by the
+ * caller, which the lock manager already does, since the index is updated after the wrapped storage.
+ * Writes to different keys may run concurrently.
+ */
+template <typename HashFn = std::hash<Key>>
+class MasterMetadataIndexedStorageT : public Storage, public LookupMasterIndex {
+ public:
+  explicit MasterMetadataIndexedStorageT(const std::shared_ptr<Storage>& storage) : storage_(storage) {}
+
+  bool Read(const Key& key, Record& result) const final { return storage_->Read(key, result); }
+
+  RecordView ReadView(const Key& key) const final { return storage_->ReadView(key); }
+
+  void MultiRead(const std::vector<const Key*>& keys,
+                 const std::function<void(size_t, const Record*)>& fn) const final {
+    storage_->MultiRead(keys, fn);
+  }
+
+  bool Scan(const Key& start, const Key& end, size_t limit, std::vector<std::pair<Key, Record>>& result) const final {
+    return storage_->Scan(start, end, limit, result);
+  }
+
+  bool Write(const Key& key, const Record& record) final {
+    auto existed = storage_->Write(key, record);
+    IndexWrite(key, record.metadata(), existed);
+    return existed;
+  }
+
+  bool Write(const Key& key, Record&& record) final {
+    auto metadata = record.metadata();
+    auto existed = storage_->Write(key, std::move(record));
+    IndexWrite(key, metadata, existed);
+    return existed;
+  }
+
+  bool Write(Key&& key, Record&& record) final {
+    auto hash = HashFn{}(key);
+    auto fingerprint = Fingerprint(key);
+    auto metadata = record.metadata();
+    auto existed = storage_->Write(std::move(key), std::move(record));
+    IndexWrite(hash, fingerprint, metadata, existed);
+    return existed;
+  }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final {
+    Metadata old_metadata, new_metadata;
+    auto res = storage_->Update(key, [&](Record& record) {
+      old_metadata = record.metadata();
+      update_fn(record);
+      new_metadata = record.metadata();
+    });
+    // Most updates only change the value
+    if (res && (new_metadata.master != old_metadata.master || new_metadata.counter != old_metadata.counter)) {
+      IndexWrite(key, new_metadata, true);
+    }
+    return res;
+  }
+
+  bool UpdatesInPlace() const final { return storage_->UpdatesInPlace(); }
+
+  bool Delete(const Key& key) final {
+    auto existed = storage_->Delete(key);
+    if (existed) {
+      auto hash = HashFn{}(key);
+      std::lock_guard<std::mutex> guard(StripeOf(hash));
+      Entry entry;
+      if (index_.Get(entry, hash)) {
+        if (entry.num_keys <= 1) {
+          index_.Erase(hash);
+        } else {
+          entry.num_keys--;
+          index_.InsertOrUpdate(hash, entry);
+        }
+      }
+    }
+    return existed;
+  }
+
+  void Reserve(size_t n) final {
+    index_.Reserve(n);
+    storage_->Reserve(n);
+  }
+
+  void BeginWriteBatch() final { storage_->BeginWriteBatch(); }
+
+  void EndWriteBatch() final { storage_->EndWriteBatch(); }
+
+  bool Prefetch(const std::vector<const Key*>& keys, const std::function<void()>& done) final {
+    return storage_->Prefetch(keys, done);
+  }
+
+  void GetStats(rapidjson::Document& stats, uint32_t level) const final { storage_->GetStats(stats, level); }
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
+    Entry entry;
+    if (!index_.Get(entry, HashFn{}(key))) {
+      return false;
+    }
+    if (entry.collided) {
+      return ReadMetadata(key, metadata);
+    }
+    if (entry.fingerprint != Fingerprint(key)) {
+      return false;
+    }
+    metadata = entry.metadata;
+    return true;
+  }
+
+  void MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                              std::vector<std::optional<Metadata>>& metadata) const final {
+    // Reused across calls so that a lookup does not allocate
+    thread_local std::vector<uint64_t> hashes;
+    thread_local std::vector<const uint64_t*> hash_ptrs;
+    thread_local std::vector<size_t> collided;
+    hashes.resize(keys.size());
+    hash_ptrs.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      hashes[i] = HashFn{}(*keys[i]);
+      hash_ptrs[i] = &hashes[i];
+    }
+    collided.clear();
+
+    metadata.resize(keys.size());
+    index_.MultiGet(hash_ptrs, [&](size_t i, const Entry* entry) {
+      if (entry != nullptr && entry->collided) {
+        collided.push_back(i);
+      } else if (entry != nullptr && entry->fingerprint == Fingerprint(*keys[i])) {
+        metadata[i] = entry->metadata;
+      } else {
+        metadata[i].reset();
+      }
+    });
+    for (auto i : collided) {
+      Metadata m;
+      if (ReadMetadata(*keys[i], m)) {
+        metadata[i] = m;
+      } else {
+        metadata[i].reset();
+      }
+    }
+  }
+
+  /**
+   * Adds a record that is already in the wrapped storage to the index
+   */
+  void AddToIndex(const Key& key, const Metadata& metadata) { IndexWrite(key, metadata, false); }
+
+ private:
+  struct Entry {
+    uint64_t fingerprint;
+    Metadata metadata;
+    // Number of stored keys with the hash of this entry
+    uint32_t num_keys;
+    // Set once a second key with the same hash is stored. The fingerprint and the metadata are then stale
+    // until the entry is erased
+    bool collided;
+  };
+
+  static uint64_t Fingerprint(const Key& key) {
+    // FNV-1a, which is independent from the hash of the map
+    uint64_t h = 14695981039346656037ULL;
+    for (auto c : key) {
+      h ^= static_cast<uint8_t>(c);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  void IndexWrite(const Key& key, const Metadata& metadata, bool existed) {
+    IndexWrite(HashFn{}(key), Fingerprint(key), metadata, existed);
+  }
+
+  void IndexWrite(uint64_t hash, uint64_t fingerprint, const Metadata& metadata, bool existed) {
+    // The entry of an existing key is only shared if it has collided, in which case the metadata is not read
+    // from it, so the update does not need to be ordered with the writes of the other keys
+    if (existed && index_.Update(hash, [&metadata](Entry& entry) { entry.metadata = metadata; })) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(StripeOf(hash));
+    Entry entry;
+    if (index_.Get(entry, hash)) {
+      entry.num_keys++;
+      entry.collided = true;
+    } else {
+      entry = {fingerprint, metadata, 1, false};
+    }
+    index_.InsertOrUpdate(hash, entry);
+  }
+
+  bool ReadMetadata(const Key& key, Metadata& metadata) const {
+    auto record = storage_->ReadView(key);
+    if (!record) {
+      return false;
+    }
+    metadata = record->metadata();
+    return true;
+  }
+
+  // Orders the writes that add or remove keys sharing the same entry
+  std::mutex& StripeOf(uint64_t hash) { return stripes_[hash % kNumStripes]; }
+
+  static constexpr size_t kNumStripes = 64;
+
+  std::shared_ptr<Storage> storage_;
+  OptimisticConcurrentHashMap<uint64_t, Entry> index_;
+  std::array<std::mutex, kNumStripes> stripes_;
+};
+
+using MasterMetadataIndexedStorage = MasterMetadataIndexedStorageT<>;
+
+}  // namespace slog
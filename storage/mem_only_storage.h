@@ -6,25 +6,81 @@
 
 namespace slog {
 
-class MemOnlyStorage : public Storage, public LookupMasterIndex {
+template <typename Table>
+class MemOnlyStorageT : public Storage, public LookupMasterIndex {
  public:
   bool Read(const Key& key, Record& result) const final { return table_.Get(result, key); }
 
+  RecordView ReadView(const Key& key) const final { return table_.GetView(key); }
+
+  void MultiRead(const std::vector<const Key*>& keys,
+                 const std::function<void(size_t, const Record*)>& fn) const final {
+    table_.MultiGet(keys, fn);
+  }
+
   bool Write(const Key& key, const Record& record) final { return table_.InsertOrUpdate(key, record); }
 
+  bool Write(const Key& key, Record&& record) final { return table_.InsertOrUpdate(Key(key), std::move(record)); }
+
+  bool Write(Key&& key, Record&& record) final { return table_.InsertOrUpdate(std::move(key), std::move(record)); }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final {
+    return table_.Update(key, update_fn);
+  }
+
+  bool UpdatesInPlace() const final { return Table::kUpdatesInPlace; }
+
   bool Delete(const Key& key) final { return table_.Erase(key); }
 
+  void Reserve(size_t n) final { table_.Reserve(n); }
+
+  /**
+   * Calls fn(key, record) on every record. This is not a consistent snapshot if there are concurrent writes
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    table_.ForEach(std::forward<Fn>(fn));
+  }
+
+  template <typename Fn, typename SegmentDoneFn>
+  void ForEach(Fn&& fn, SegmentDoneFn&& segment_done) const {
+    table_.ForEach(std::forward<Fn>(fn), std::forward<SegmentDoneFn>(segment_done));
+  }
+
   bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
-    Record rec;
-    if (!table_.Get(rec, key)) {
+    auto rec = table_.GetView(key);
+    if (!rec) {
       return false;
     }
-    metadata = rec.metadata();
+    metadata = rec->metadata();
     return true;
   }
 
+  void MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                              std::vector<std::optional<Metadata>>& metadata) const final {
+    metadata.resize(keys.size());
+    table_.MultiGet(keys, [&metadata](size_t i, const Record* record) {
+      if (record != nullptr) {
+        metadata[i] = record->metadata();
+      } else {
+        metadata[i].reset();
+      }
+    });
+  }
+
  private:
-  ConcurrentHashMap<Key, Record> table_;
+  Table table_;
 };
 
-}  // namespace slog
\ No newline at end of file
+#ifdef STORAGE_LAYOUT_FLAT
+using MemOnlyStorage = MemOnlyStorageT<FlatConcurrentHashMap<Key, Record>>;
+#else
+// Reads never take a latch so that workers and the forwarder do not contend on hot keys
+using MemOnlyStorage = MemOnlyStorageT<OptimisticConcurrentHashMap<Key, Record>>;
+#endif
+
+// Readers take the segment latch so that an update overwrites a value of the same size in place instead
+// of copying the record
+using LatchedMemOnlyStorage = MemOnlyStorageT<ConcurrentHashMap<Key, Record>>;
+
+}  // namespace slog
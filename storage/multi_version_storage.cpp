@@ -0,0 +1,273 @@
+#include "storage/multi_version_storage.h"
+
+#include <glog/logging.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace slog {
+
+namespace {
+
+// The write batch of the calling thread
+struct WriteBatch {
+  const MultiVersionStorage* owner = nullptr;
+  uint64_t position = 0;
+  size_t writer = 0;
+};
+thread_local WriteBatch current_batch;
+
+// Writer slot of the calling thread in each storage, keyed by the storage id. Ids are never reused so the
+// entries of destroyed storages are never looked up again
+thread_local std::unordered_map<uint64_t, size_t> writer_slots;
+
+std::atomic<uint64_t> next_storage_id(0);
+
+}  // namespace
+
+MultiVersionStorage::MultiVersionStorage(std::chrono::milliseconds gc_interval)
+    : id_(next_storage_id.fetch_add(1, std::memory_order_relaxed)),
+      last_position_(0),
+      writers_(new Writer[kMaxWriters]),
+      num_writers_(0),
+      stable_position_(0),
+      gc_position_(0),
+      gc_interval_(gc_interval),
+      stop_(false) {
+  gc_thread_ = std::thread(&MultiVersionStorage::RunGarbageCollector, this);
+}
+
+MultiVersionStorage::~MultiVersionStorage() {
+  {
+    std::lock_guard<std::mutex> guard(stop_mut_);
+    stop_ = true;
+  }
+  stop_cv_.notify_one();
+  gc_thread_.join();
+}
+
+bool MultiVersionStorage::Read(const Key& key, Record& result) const {
+  auto view = ReadView(key);
+  if (!view) {
+    return false;
+  }
+  result = *view;
+  return true;
+}
+
+RecordView MultiVersionStorage::ReadView(const Key& key) const {
+  auto head = versions_.GetView(key);
+  if (!head || !(*head)->record) {
+    return {};
+  }
+  // The latest version is owned by the table entry, which is only freed after the epoch is exited
+  EpochManager::Instance().Enter();
+  return RecordView::EpochPinned(&*(*head)->record);
+}
+
+void MultiVersionStorage::MultiRead(const std::vector<const Key*>& keys,
+                                    const std::function<void(size_t, const Record*)>& fn) const {
+  versions_.MultiGet(keys, [&fn](size_t i, const VersionPtr* head) {
+    fn(i, head != nullptr && (*head)->record ? &*(*head)->record : nullptr);
+  });
+}
+
+bool MultiVersionStorage::Update(const Key& key, const std::function<void(Record&)>& update_fn) {
+  VersionPtr head;
+  if (!versions_.Get(head, key) || !head->record) {
+    return false;
+  }
+  // Snapshots may be reading the current version so the update is applied to a new one
+  Record record(*head->record);
+  update_fn(record);
+  Install(key, std::move(record));
+  return true;
+}
+
+bool MultiVersionStorage::Install(const Key& key, std::optional<Record>&& record) {
+  // Writes outside of a batch are made visible on their own
+  bool in_batch = current_batch.owner == this;
+  if (!in_batch) {
+    BeginWriteBatch();
+  }
+
+  VersionPtr head;
+  versions_.Get(head, key);
+  bool existed = head != nullptr && head->record.has_value();
+  // A batch writing the same key more than once only keeps its last write
+  auto next = head;
+  if (head != nullptr && head->position == current_batch.position) {
+    next = std::atomic_load(&head->next);
+  }
+  auto new_head = std::make_shared<Version>(current_batch.position, std::move(record), next);
+
+  Trim(new_head, gc_position_.load(std::memory_order_acquire));
+  versions_.InsertOrUpdate(key, new_head);
+
+  if (!in_batch) {
+    EndWriteBatch();
+  }
+  return existed;
+}
+
+bool MultiVersionStorage::Trim(const VersionPtr& head, uint64_t gc_position) {
+  // Only the latest version at or below the gc position is visible to the snapshots so the older ones
+  // are cut off. A deleted version at that point is not needed either. The versions are held while
+  // walking since the sweep may cut the chain at the same time
+  VersionPtr prev;
+  for (auto v = head; v != nullptr; prev = v, v = std::atomic_load(&v->next)) {
+    if (v->position <= gc_position) {
+      if (v->record) {
+        std::atomic_store(&v->next, VersionPtr());
+      } else if (prev != nullptr) {
+        std::atomic_store(&prev->next, VersionPtr());
+      } else {
+        return true;
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+void MultiVersionStorage::BeginWriteBatch() {
+  CHECK(current_batch.owner == nullptr) << "Write batches cannot be nested";
+  auto writer = WriterSlot();
+  auto& slot = writers_[writer].position;
+  // A lower bound of the position is announced before the position is taken so that the stable position
+  // computed by another thread that sees the new last position cannot pass this batch
+  slot.store(last_position_.load() + 1);
+  auto position = last_position_.fetch_add(1) + 1;
+  slot.store(position);
+  current_batch = {this, position, writer};
+}
+
+void MultiVersionStorage::EndWriteBatch() {
+  CHECK(current_batch.owner == this) << "No write batch to end";
+  writers_[current_batch.writer].position.store(0);
+  current_batch.owner = nullptr;
+  AdvanceStablePosition();
+}
+
+size_t MultiVersionStorage::WriterSlot() {
+  auto it = writer_slots.find(id_);
+  if (it != writer_slots.end()) {
+    return it->second;
+  }
+  std::lock_guard<std::mutex> guard(mut_);
+  auto writer = num_writers_.load(std::memory_order_relaxed);
+  CHECK_LT(writer, kMaxWriters) << "Too many threads writing to the storage";
+  num_writers_.store(writer + 1, std::memory_order_release);
+  writer_slots.emplace(id_, writer);
+  return writer;
+}
+
+void MultiVersionStorage::AdvanceStablePosition() {
+  auto stable_position = last_position_.load();
+  auto num_writers = num_writers_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < num_writers; i++) {
+    auto position = writers_[i].position.load();
+    if (position != 0) {
+      stable_position = std::min(stable_position, position - 1);
+    }
+  }
+  // Threads finishing their batches at the same time may compute their stable positions out of order
+  auto current = stable_position_.load(std::memory_order_relaxed);
+  while (current < stable_position &&
+         !stable_position_.compare_exchange_weak(current, stable_position, std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+  }
+}
+
+void MultiVersionStorage::AdvanceGcPositionLocked() {
+  auto stable_position = stable_position_.load(std::memory_order_acquire);
+  auto gc_position = snapshots_.empty() ? stable_position : std::min(stable_position, *snapshots_.begin());
+  gc_position_.store(gc_position, std::memory_order_release);
+}
+
+void MultiVersionStorage::CollectGarbage() {
+  uint64_t gc_position;
+  {
+    std::lock_guard<std::mutex> guard(mut_);
+    AdvanceGcPositionLocked();
+    gc_position = gc_position_.load(std::memory_order_relaxed);
+  }
+
+  std::vector<Key> deleted;
+  versions_.ForEach([gc_position, &deleted](const Key& key, const VersionPtr& head) {
+    if (Trim(head, gc_position)) {
+      deleted.push_back(key);
+    }
+  });
+  // The keys may have been written again since they were visited
+  for (const auto& key : deleted) {
+    versions_.EraseIf(key, [gc_position](const VersionPtr& head) {
+      return !head->record && head->position <= gc_position;
+    });
+  }
+}
+
+void MultiVersionStorage::RunGarbageCollector() {
+  std::unique_lock<std::mutex> lock(stop_mut_);
+  while (!stop_) {
+    stop_cv_.wait_for(lock, gc_interval_);
+    lock.unlock();
+    CollectGarbage();
+    lock.lock();
+  }
+}
+
+bool MultiVersionStorage::GetMasterMetadata(const Key& key, Metadata& metadata) const {
+  auto head = versions_.GetView(key);
+  if (!head || !(*head)->record) {
+    return false;
+  }
+  metadata = (*head)->record->metadata();
+  return true;
+}
+
+void MultiVersionStorage::MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                                                 std::vector<std::optional<Metadata>>& metadata) const {
+  metadata.resize(keys.size());
+  versions_.MultiGet(keys, [&metadata](size_t i, const VersionPtr* head) {
+    if (head != nullptr && (*head)->record) {
+      metadata[i] = (*head)->record->metadata();
+    } else {
+      metadata[i].reset();
+    }
+  });
+}
+
+uint64_t MultiVersionStorage::AcquireSnapshot() {
+  std::lock_guard<std::mutex> guard(mut_);
+  // The gc position is only advanced under the lock and never above the stable position so it does not
+  // change here
+  auto position = stable_position_.load(std::memory_order_acquire);
+  snapshots_.insert(position);
+  return position;
+}
+
+void MultiVersionStorage::ReleaseSnapshot(uint64_t position) {
+  std::lock_guard<std::mutex> guard(mut_);
+  auto it = snapshots_.find(position);
+  CHECK(it != snapshots_.end()) << "Unknown snapshot at position " << position;
+  snapshots_.erase(it);
+  AdvanceGcPositionLocked();
+}
+
+bool MultiVersionStorage::ReadSnapshot(const Key& key, uint64_t position, Record& result) const {
+  VersionPtr v;
+  if (!versions_.Get(v, key)) {
+    return false;
+  }
+  while (v != nullptr && v->position > position) {
+    v = std::atomic_load(&v->next);
+  }
+  if (v == nullptr || !v->record) {
+    return false;
+  }
+  result = *v->record;
+  return true;
+}
+
+}  // namespace slog
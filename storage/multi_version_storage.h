@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+
+#include "common/concurrent_hash_map.h"
+#include "storage/lookup_master_index.h"
+#include "storage/storage.h"
+
+namespace slog {
+
+/**
+ * A storage that keeps, for every key, a chain of its recent versions so that read-only transactions can
+ * read a consistent snapshot without being ordered or locked.
+ *
+ * Every write batch, which is the writes of one transaction, is given the next position in the commit order
+ * of this partition and its writes install versions tagged with that position. Writes to the same key are
+ * ordered by the lock manager, so a transaction that depends on another one always gets a later position.
+ * The stable position is the highest position at and below which every batch has finished, hence a
+ * snapshot at that position never sees a partially applied transaction.
+ *
+ * A version is garbage collected once a newer version of the same key is visible to every active
+ * snapshot. This happens when the key is written again and, for keys that are not written anymore, in a
+ * periodic sweep that also drops the keys whose latest version is a deletion.
+ *
+ * Each thread has at most one write batch in progress and the batches of different threads may run
+ * concurrently. Two batches writing the same key must not overlap, and the one that starts first must
+ * install its version first, which holds for the workers since they write only while holding the locks of
+ * their txns. Snapshots can be acquired, read and released from any thread.
+ */
+class MultiVersionStorage : public Storage, public LookupMasterIndex {
+ public:
+  MultiVersionStorage(std::chrono::milliseconds gc_interval = std::chrono::milliseconds(100));
+
+  ~MultiVersionStorage();
+
+  bool Read(const Key& key, Record& result) const final;
+
+  RecordView ReadView(const Key& key) const final;
+
+  void MultiRead(const std::vector<const Key*>& keys,
+                 const std::function<void(size_t, const Record*)>& fn) const final;
+
+  bool Write(const Key& key, const Record& record) final { return Install(key, Record(record)); }
+
+  bool Write(const Key& key, Record&& record) final { return Install(key, std::move(record)); }
+
+  bool Write(Key&& key, Record&& record) final { return Install(key, std::move(record)); }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final;
+
+  bool Delete(const Key& key) final { return Install(key, std::nullopt); }
+
+  void Reserve(size_t n) final { versions_.Reserve(n); }
+
+  void BeginWriteBatch() final;
+
+  void EndWriteBatch() final;
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final;
+
+  void MultiGetMasterMetadata(const std::vector<const Key*>& keys,
+                              std::vector<std::optional<Metadata>>& metadata) const final;
+
+  /**
+   * Returns the stable position and keeps the versions visible at it from being garbage collected
+   * until ReleaseSnapshot is called with the returned position
+   */
+  uint64_t AcquireSnapshot();
+
+  void ReleaseSnapshot(uint64_t position);
+
+  /**
+   * Reads the latest version of key at or below the given position, which must be held by AcquireSnapshot
+   */
+  bool ReadSnapshot(const Key& key, uint64_t position, Record& result) const;
+
+  uint64_t stable_position() const { return stable_position_.load(std::memory_order_acquire); }
+
+  /**
+   * Drops the versions and the deleted keys that are no longer visible to any snapshot. This runs
+   * periodically in the background
+   */
+  void CollectGarbage();
+
+ private:
+  struct Version {
+    Version(uint64_t position, std::optional<Record>&& record, const std::shared_ptr<Version>& next)
+        : position(position), record(std::move(record)), next(next) {}
+
+    const uint64_t position;
+    // Empty if the key is deleted in this version
+    const std::optional<Record> record;
+    // The previous version. Garbage collection cuts the chain so this is only accessed with
+    // std::atomic_load and std::atomic_store
+    std::shared_ptr<Version> next;
+  };
+  using VersionPtr = std::shared_ptr<Version>;
+
+  // Installs a new version of key and returns whether the key existed
+  bool Install(const Key& key, std::optional<Record>&& record);
+
+  // Cuts off the versions in the chain that are not visible at or after the gc position. Returns true if
+  // the whole chain, including the head, is not visible anymore
+  static bool Trim(const VersionPtr& head, uint64_t gc_position);
+
+  // Returns the index of the writer slot of the calling thread, registering it on first use
+  size_t WriterSlot();
+
+  void AdvanceStablePosition();
+
+  // Must hold mut_
+  void AdvanceGcPositionLocked();
+
+  void RunGarbageCollector();
+
+  static constexpr size_t kMaxWriters = 256;
+
+  // Position of the write batch in progress of a thread, or 0 if there is none. Each slot is written only
+  // by the thread that owns it
+  struct alignas(64) Writer {
+    std::atomic<uint64_t> position{0};
+  };
+
+  // Identifies this storage in the thread-local writer slot registry
+  const uint64_t id_;
+
+  OptimisticConcurrentHashMap<Key, VersionPtr> versions_;
+
+  std::atomic<uint64_t> last_position_;
+  std::unique_ptr<Writer[]> writers_;
+  std::atomic<size_t> num_writers_;
+  std::atomic<uint64_t> stable_position_;
+
+  // Guards the snapshots, the registration of writers and the updates of the gc position
+  std::mutex mut_;
+  // Positions held by the active snapshots
+  std::multiset<uint64_t> snapshots_;
+  // Versions at or below this position that are shadowed by a newer version at or below it are not
+  // visible to any snapshot
+  std::atomic<uint64_t> gc_position_;
+
+  const std::chrono::milliseconds gc_interval_;
+  std::mutex stop_mut_;
+  std::condition_variable stop_cv_;
+  bool stop_;
+  std::thread gc_thread_;
+};
+
+}  // namespace slog
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/concurrent_skip_list.h"
+#include "storage/lookup_master_index.h"
+#include "storage/storage.h"
+
+namespace slog {
+
+/**
+ * An in-memory storage that keeps the records sorted by the bytes of their keys so that it can
+ * serve range scans. Reads and scans do not take any latch. Writes are serialized.
+ */
+class OrderedStorage : public Storage, public LookupMasterIndex {
+ public:
+  bool Read(const Key& key, Record& result) const final { return table_.Get(result, key); }
+
+  RecordView ReadView(const Key& key) const final { return table_.GetView(key); }
+
+  bool Scan(const Key& start, const Key& end, size_t limit, std::vector<std::pair<Key, Record>>& result) const final {
+    // The records already in result do not count toward the limit
+    auto first = result.size();
+    table_.Scan(start, [&](const Key& key, const Record& record) {
+      if (result.size() - first >= limit || (!end.empty() && key >= end)) {
+        return false;
+      }
+      result.emplace_back(key, record);
+      return true;
+    });
+    return true;
+  }
+
+  bool Write(const Key& key, const Record& record) final { return table_.InsertOrUpdate(key, record); }
+
+  bool Write(const Key& key, Record&& record) final { return table_.InsertOrUpdate(Key(key), std::move(record)); }
+
+  bool Write(Key&& key, Record&& record) final { return table_.InsertOrUpdate(std::move(key), std::move(record)); }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final {
+    return table_.Update(key, update_fn);
+  }
+
+  bool Delete(const Key& key) final { return table_.Erase(key); }
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
+    auto rec = table_.GetView(key);
+    if (!rec) {
+      return false;
+    }
+    metadata = rec->metadata();
+    return true;
+  }
+
+ private:
+  ConcurrentSkipList<Key, Record> table_;
+};
+
+}  // namespace slog
@@ -0,0 +1,206 @@
+#include "storage/snapshot.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace slog {
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+constexpr char kSnapshotMagic[] = "SLOGSNAP";
+constexpr size_t kSnapshotMagicSize = sizeof(kSnapshotMagic) - 1;
+
+struct Header {
+  char magic[kSnapshotMagicSize];
+  uint64_t num_records;
+  uint64_t data_offset;
+  uint64_t index_offset;
+  uint64_t num_buckets;
+};
+
+struct Slot {
+  uint64_t hash;
+  uint64_t offset;
+};
+
+struct EntryHeader {
+  uint32_t key_size;
+  uint32_t value_size;
+  uint32_t master;
+  uint32_t counter;
+};
+
+// Size of the buffer filled before writing to the snapshot file
+constexpr size_t kWriteBufferSize = 4 * 1024 * 1024;
+
+uint64_t Hash(string_view key) {
+  // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for (auto c : key) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+void WriteAll(int fd, const char* data, size_t size, off_t offset) {
+  size_t written = 0;
+  while (written < size) {
+    auto res = pwrite(fd, data + written, size - written, offset + written);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(FATAL) << "Error while writing snapshot: " << strerror(errno);
+    }
+    written += res;
+  }
+}
+
+}  // namespace
+
+Snapshot::Snapshot(const string& path) {
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(FATAL) << "Cannot open snapshot \"" << path << "\": " << strerror(errno);
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG(FATAL) << "Cannot stat snapshot \"" << path << "\": " << strerror(errno);
+  }
+  file_size_ = st.st_size;
+  CHECK_GE(file_size_, sizeof(Header)) << "Invalid snapshot \"" << path << "\"";
+
+  auto addr = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    LOG(FATAL) << "Cannot map snapshot \"" << path << "\": " << strerror(errno);
+  }
+  close(fd);
+  data_ = static_cast<const char*>(addr);
+
+  Header header;
+  memcpy(&header, data_, sizeof(Header));
+  CHECK(memcmp(header.magic, kSnapshotMagic, kSnapshotMagicSize) == 0) << "Invalid snapshot \"" << path << "\"";
+  CHECK(header.data_offset <= header.index_offset && header.index_offset <= file_size_ &&
+        (file_size_ - header.index_offset) / sizeof(Slot) == header.num_buckets &&
+        (header.num_buckets & (header.num_buckets - 1)) == 0)
+      << "Corrupted snapshot \"" << path << "\"";
+  num_records_ = header.num_records;
+  data_offset_ = header.data_offset;
+  index_offset_ = header.index_offset;
+  bucket_mask_ = header.num_buckets - 1;
+
+  // Lookups jump around the whole file so reading ahead only wastes memory
+  madvise(addr, file_size_, MADV_RANDOM);
+
+  LOG(INFO) << "Mapped snapshot \"" << path << "\" with " << num_records_ << " records";
+}
+
+Snapshot::~Snapshot() { munmap(const_cast<char*>(data_), file_size_); }
+
+bool Snapshot::Find(string_view key, Entry& entry) const {
+  auto hash = Hash(key);
+  auto slots = data_ + index_offset_;
+  for (auto i = hash & bucket_mask_;; i = (i + 1) & bucket_mask_) {
+    Slot slot;
+    memcpy(&slot, slots + i * sizeof(Slot), sizeof(Slot));
+    if (slot.offset == 0) {
+      return false;
+    }
+    if (slot.hash == hash) {
+      GetEntry(slot.offset, entry);
+      if (entry.key == key) {
+        return true;
+      }
+    }
+  }
+}
+
+uint64_t Snapshot::GetEntry(uint64_t offset, Entry& entry) const {
+  EntryHeader header;
+  memcpy(&header, data_ + offset, sizeof(EntryHeader));
+  auto key = data_ + offset + sizeof(EntryHeader);
+  entry.key = string_view(key, header.key_size);
+  entry.value = string_view(key + header.key_size, header.value_size);
+  entry.metadata = Metadata(header.master, header.counter);
+  return offset + sizeof(EntryHeader) + header.key_size + header.value_size;
+}
+
+SnapshotWriter::SnapshotWriter(const string& path) : path_(path), tmp_path_(path + ".tmp"), offset_(sizeof(Header)) {
+  fd_ = open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    LOG(FATAL) << "Cannot create snapshot \"" << tmp_path_ << "\": " << strerror(errno);
+  }
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  if (fd_ >= 0) {
+    close(fd_);
+    unlink(tmp_path_.c_str());
+  }
+}
+
+void SnapshotWriter::Add(string_view key, const Record& record) {
+  EntryHeader header{static_cast<uint32_t>(key.size()), static_cast<uint32_t>(record.size()),
+                     record.metadata().master, record.metadata().counter};
+  index_.emplace_back(Hash(key), offset_ + buffer_.size());
+  buffer_.append(reinterpret_cast<const char*>(&header), sizeof(EntryHeader));
+  buffer_.append(key);
+  buffer_.append(record.data(), record.size());
+  if (buffer_.size() >= kWriteBufferSize) {
+    FlushBuffer();
+  }
+}
+
+void SnapshotWriter::Finish() {
+  FlushBuffer();
+
+  // Keep the load factor at most 0.5 so that probe sequences stay short
+  uint64_t num_buckets = 2;
+  while (num_buckets < 2 * index_.size()) {
+    num_buckets *= 2;
+  }
+  std::vector<Slot> slots(num_buckets, Slot{0, 0});
+  for (auto [hash, offset] : index_) {
+    auto i = hash & (num_buckets - 1);
+    while (slots[i].offset != 0) {
+      i = (i + 1) & (num_buckets - 1);
+    }
+    slots[i] = Slot{hash, offset};
+  }
+
+  Header header;
+  memcpy(header.magic, kSnapshotMagic, kSnapshotMagicSize);
+  header.num_records = index_.size();
+  header.data_offset = sizeof(Header);
+  header.index_offset = offset_;
+  header.num_buckets = num_buckets;
+  WriteAll(fd_, reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(Slot), offset_);
+  WriteAll(fd_, reinterpret_cast<const char*>(&header), sizeof(Header), 0);
+
+  if (fsync(fd_) < 0) {
+    LOG(FATAL) << "Error while syncing snapshot: " << strerror(errno);
+  }
+  close(fd_);
+  fd_ = -1;
+  if (rename(tmp_path_.c_str(), path_.c_str()) < 0) {
+    LOG(FATAL) << "Cannot rename snapshot to \"" << path_ << "\": " << strerror(errno);
+  }
+  LOG(INFO) << "Wrote " << index_.size() << " records to snapshot \"" << path_ << "\"";
+}
+
+void SnapshotWriter::FlushBuffer() {
+  WriteAll(fd_, buffer_.data(), buffer_.size(), offset_);
+  offset_ += buffer_.size();
+  buffer_.clear();
+}
+
+}  // namespace slog
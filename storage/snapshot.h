@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/types.h"
+
+namespace slog {
+
+/**
+ * A snapshot is a read-only file of records that is memory-mapped and read in place. It is laid out as
+ *
+ *   [header][data region][index region]
+ *
+ * The data region holds the records one after another, each as
+ *
+ *   [u32 key size][u32 value size][u32 master][u32 counter][key][value]
+ *
+ * The index region is an open-addressing hash table with linear probing. Each slot is a pair of
+ * [u64 key hash][u64 offset of the record in the file], where an offset of 0 marks an empty slot.
+ * Keys are hashed with FNV-1a so that the layout does not depend on the standard library.
+ */
+class Snapshot {
+ public:
+  struct Entry {
+    std::string_view key;
+    std::string_view value;
+    Metadata metadata;
+  };
+
+  /**
+   * Maps the snapshot at the given path. Only the pages touched by reads are loaded from disk
+   */
+  explicit Snapshot(const std::string& path);
+  ~Snapshot();
+
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+
+  bool Find(std::string_view key, Entry& entry) const;
+
+  /**
+   * Calls fn(entry) on every record in the order they were added to the snapshot
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    Entry entry;
+    for (auto offset = data_offset_; offset < index_offset_;) {
+      offset = GetEntry(offset, entry);
+      fn(entry);
+    }
+  }
+
+  size_t size() const { return num_records_; }
+
+ private:
+  // Fills entry with the record at the given offset and returns the offset of the next record
+  uint64_t GetEntry(uint64_t offset, Entry& entry) const;
+
+  const char* data_;
+  size_t file_size_;
+  uint64_t num_records_;
+  uint64_t data_offset_;
+  uint64_t index_offset_;
+  uint64_t bucket_mask_;
+};
+
+/**
+ * Writes a snapshot. The records are streamed to a temporary file, which is renamed to the given path
+ * once the index is written, so a snapshot file is never partially written.
+ */
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(const std::string& path);
+  ~SnapshotWriter();
+
+  /**
+   * Keys must be unique
+   */
+  void Add(std::string_view key, const Record& record);
+
+  void Finish();
+
+ private:
+  void FlushBuffer();
+
+  std::string path_;
+  std::string tmp_path_;
+  int fd_;
+  std::string buffer_;
+  uint64_t offset_;
+  // Hash and offset of every record added so far
+  std::vector<std::pair<uint64_t, uint64_t>> index_;
+};
+
+}  // namespace slog
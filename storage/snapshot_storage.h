@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+
+#include "storage/mem_only_storage.h"
+#include "storage/snapshot.h"
+#include "storage/tombstone_overlay.h"
+
+namespace slog {
+
+/**
+ * A storage that serves the initial records directly from a memory-mapped snapshot (see storage/snapshot.h)
+ * so that it is ready as soon as the snapshot is mapped. The snapshot is never modified. Written records
+ * are copied into an in-memory overlay, which takes precedence over the snapshot, and deleted snapshot
+ * records are remembered as tombstones (see storage/tombstone_overlay.h for how this may be used
+ * concurrently). The first update of a key copies its snapshot record into the overlay.
+ */
+class SnapshotStorage : public Storage, public LookupMasterIndex {
+ public:
+  explicit SnapshotStorage(const std::string& snapshot_path) : snapshot_(snapshot_path) {}
+
+  bool Read(const Key& key, Record& result) const final {
+    if (overlay_.Read(key, result)) {
+      return true;
+    }
+    Snapshot::Entry entry;
+    if (!FindInSnapshot(key, entry)) {
+      return false;
+    }
+    result.SetValue(entry.value.data(), entry.value.size());
+    result.SetMetadata(entry.metadata);
+    return true;
+  }
+
+  RecordView ReadView(const Key& key) const final {
+    if (auto view = overlay_.ReadView(key); view) {
+      return view;
+    }
+    // Snapshot records are not stored as Record objects so a view of them has to own a copy
+    return Storage::ReadView(key);
+  }
+
+  bool Write(const Key& key, const Record& record) final {
+    return overlay_.Write(key, record) || tombstones_.ExistedInBase(key, InSnapshot(key));
+  }
+
+  bool Write(const Key& key, Record&& record) final {
+    return overlay_.Write(key, std::move(record)) || tombstones_.ExistedInBase(key, InSnapshot(key));
+  }
+
+  bool Write(Key&& key, Record&& record) final {
+    Key key_copy(key);
+    return overlay_.Write(std::move(key), std::move(record)) ||
+           tombstones_.ExistedInBase(key_copy, InSnapshot(key_copy));
+  }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final {
+    if (overlay_.Update(key, update_fn)) {
+      return true;
+    }
+    // Copy the snapshot record into the overlay on its first update
+    Snapshot::Entry entry;
+    if (!FindInSnapshot(key, entry)) {
+      return false;
+    }
+    Record record(std::string(entry.value), entry.metadata.master, entry.metadata.counter);
+    update_fn(record);
+    overlay_.Write(key, std::move(record));
+    return true;
+  }
+
+  bool UpdatesInPlace() const final { return overlay_.UpdatesInPlace(); }
+
+  bool Delete(const Key& key) final { return tombstones_.Delete(overlay_, key, InSnapshot(key)); }
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
+    if (overlay_.GetMasterMetadata(key, metadata)) {
+      return true;
+    }
+    Snapshot::Entry entry;
+    if (!FindInSnapshot(key, entry)) {
+      return false;
+    }
+    metadata = entry.metadata;
+    return true;
+  }
+
+ private:
+  // Returns whether the snapshot has a record of key, deleted or not
+  bool InSnapshot(const Key& key) const {
+    Snapshot::Entry entry;
+    return snapshot_.Find(key, entry);
+  }
+
+  bool FindInSnapshot(const Key& key, Snapshot::Entry& entry) const {
+    return snapshot_.Find(key, entry) && !tombstones_.IsDeleted(key);
+  }
+
+  Snapshot snapshot_;
+  MemOnlyStorage overlay_;
+  // Snapshot records that have been deleted
+  TombstoneOverlay tombstones_;
+};
+
+}  // namespace slog
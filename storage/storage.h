@@ -1,17 +1,74 @@
 #pragma once
 
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "common/pinned_view.h"
 #include "common/types.h"
+#include "rapidjson/fwd.h"
 
 namespace slog {
 
+using RecordView = PinnedView<Record>;
+
 class Storage {
  public:
   virtual ~Storage() = default;
   virtual bool Read(const Key& key, Record& result) const = 0;
+  // Returns a view of the record without copying its value. The view is empty if key does not exist.
+  // Engines that cannot lend out their records fall back to a private copy
+  virtual RecordView ReadView(const Key& key) const {
+    auto record = std::make_unique<Record>();
+    if (!Read(key, *record)) {
+      return {};
+    }
+    return RecordView::Owned(std::move(record));
+  }
+  // Calls fn(i, record) for every keys[i], with a null record if the key does not exist. The record
+  // is only valid during the call and fn must not access the storage. Engines that can do so look up the keys
+  // together so that the cache misses of different keys overlap
+  virtual void MultiRead(const std::vector<const Key*>& keys,
+                         const std::function<void(size_t, const Record*)>& fn) const {
+    for (size_t i = 0; i < keys.size(); i++) {
+      auto record = ReadView(*keys[i]);
+      fn(i, record.get());
+    }
+  }
+  // Appends to result at most limit records whose keys are in [start, end), in key order. An empty end
+  // means that there is no upper bound. Returns false if the engine does not keep its keys ordered
+  virtual bool Scan(const Key&, const Key&, size_t, std::vector<std::pair<Key, Record>>&) const { return false; }
   // Returns true if key exists
   virtual bool Write(const Key& key, const Record& record) = 0;
   virtual bool Write(const Key& key, Record&& record) { return Write(key, record); };
+  virtual bool Write(Key&& key, Record&& record) { return Write(key, std::move(record)); }
+  // Applies update_fn to the record of key. Engines that can modify their records in place do so
+  // without copying the record. Returns true if key exists
+  virtual bool Update(const Key& key, const std::function<void(Record&)>& update_fn) {
+    Record record;
+    if (!Read(key, record)) {
+      return false;
+    }
+    update_fn(record);
+    Write(key, std::move(record));
+    return true;
+  }
+  // Returns true if Update modifies records in place. Otherwise an update copies the record, which costs more
+  // than writing a new record built from the new value
+  virtual bool UpdatesInPlace() const { return false; }
   virtual bool Delete(const Key& key) = 0;
+  // Hints that about n records are going to be written so that the engine can size itself up front
+  virtual void Reserve(size_t) {}
+  // The writes made by the calling thread between these two calls, such as those of one transaction, become
+  // visible to snapshot reads together. Engines without snapshot reads ignore them
+  virtual void BeginWriteBatch() {}
+  virtual void EndWriteBatch() {}
+  // Hints that the records of keys are going to be read soon. Engines that keep some records on disk load them
+  // in the background so that the reads do not wait for the disk. Returns false if there is nothing to load.
+  // Otherwise, done is called from a background thread once the records are in memory
+  virtual bool Prefetch(const std::vector<const Key*>&, const std::function<void()>&) { return false; }
+  // Adds the statistics of the engine to stats
+  virtual void GetStats(rapidjson::Document&, uint32_t) const {}
 };
 
-}  // namespace slog
\ No newline at end of file
+}  // namespace slog
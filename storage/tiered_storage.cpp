@@ -0,0 +1,385 @@
+#include "storage/tiered_storage.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "common/constants.h"
+#include "common/json_utils.h"
+
+namespace slog {
+
+using std::string;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+// Size of the buffer filled before writing the spilled values to the file
+constexpr size_t kSpillBufferSize = 4 * 1024 * 1024;
+
+int64_t NowMicros() { return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count(); }
+
+}  // namespace
+
+TieredStorage::TieredStorage(const string& dir, uint64_t memory_limit, milliseconds eviction_interval,
+                             uint32_t num_io_threads)
+    : eviction_interval_(eviction_interval),
+      memory_limit_(memory_limit),
+      file_size_(0),
+      hot_bytes_(0),
+      clock_(1),
+      hits_(0),
+      misses_(0),
+      prefetches_(0),
+      evictions_(0),
+      prefetch_lead_time_sum_(0),
+      prefetch_lead_time_count_(0),
+      stop_(false) {
+  // Create every directory on the path
+  for (auto pos = dir.find('/', 1); pos != string::npos; pos = dir.find('/', pos + 1)) {
+    mkdir(dir.substr(0, pos).c_str(), 0755);
+  }
+  if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+    LOG(FATAL) << "Cannot create storage directory \"" << dir << "\": " << strerror(errno);
+  }
+  // The spilled values are only meaningful to the current process
+  auto path = dir + "/values.dat";
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    LOG(FATAL) << "Cannot open \"" << path << "\": " << strerror(errno);
+  }
+
+  evictor_ = std::thread(&TieredStorage::RunEvictor, this);
+  // Loads of different keys go to the disk in parallel
+  for (uint32_t i = 0; i < std::max(num_io_threads, 1U); i++) {
+    prefetchers_.emplace_back(&TieredStorage::RunPrefetcher, this);
+  }
+}
+
+TieredStorage::~TieredStorage() {
+  {
+    std::scoped_lock lock(stop_mut_, prefetch_mut_);
+    stop_ = true;
+  }
+  stop_cv_.notify_one();
+  prefetch_cv_.notify_all();
+  evictor_.join();
+  for (auto& prefetcher : prefetchers_) {
+    prefetcher.join();
+  }
+  close(fd_);
+}
+
+bool TieredStorage::Read(const Key& key, Record& result) const {
+  auto view = ReadView(key);
+  if (!view) {
+    return false;
+  }
+  result = *view;
+  return true;
+}
+
+RecordView TieredStorage::ReadView(const Key& key) const {
+  auto slot = records_.GetView(key);
+  if (!slot) {
+    return {};
+  }
+  if (slot->value != nullptr) {
+    RecordHit(*slot);
+    // The value is owned by the table entry, which is only freed after the epoch is exited
+    EpochManager::Instance().Enter();
+    return RecordView::EpochPinned(slot->value.get());
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  Slot spilled(*slot);
+  slot.Release();
+  return RecordView::Owned(std::make_unique<Record>(Load(spilled)));
+}
+
+void TieredStorage::RecordHit(const Slot& slot) const {
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  auto clock = clock_.load(std::memory_order_relaxed);
+  if (slot.last_read.load(std::memory_order_relaxed) != clock) {
+    slot.last_read.store(clock, std::memory_order_relaxed);
+  }
+  if (slot.prefetched_at.load(std::memory_order_relaxed) != 0) {
+    if (auto prefetched_at = slot.prefetched_at.exchange(0, std::memory_order_relaxed); prefetched_at != 0) {
+      prefetch_lead_time_sum_.fetch_add(NowMicros() - prefetched_at, std::memory_order_relaxed);
+      prefetch_lead_time_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+bool TieredStorage::Put(const Key& key, std::shared_ptr<const Record>&& record) {
+  int64_t added = record->size();
+  auto update_slot = [&](Slot& slot) {
+    if (slot.value != nullptr) {
+      added -= slot.value->size();
+    }
+    slot.metadata = record->metadata();
+    slot.value = record;
+    slot.last_read.store(clock_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    slot.prefetched_at.store(0, std::memory_order_relaxed);
+  };
+  bool existed = records_.Update(key, update_slot);
+  if (!existed) {
+    Slot slot;
+    update_slot(slot);
+    records_.InsertOrUpdate(key, slot);
+  }
+  hot_bytes_.fetch_add(added, std::memory_order_relaxed);
+  return existed;
+}
+
+bool TieredStorage::Update(const Key& key, const std::function<void(Record&)>& update_fn) {
+  Slot slot;
+  if (!records_.Get(slot, key)) {
+    return false;
+  }
+  // Readers may be looking at the current value so the update is applied to a copy
+  auto record = slot.value != nullptr ? Record(*slot.value) : Load(slot);
+  update_fn(record);
+  Put(key, std::make_shared<Record>(std::move(record)));
+  return true;
+}
+
+bool TieredStorage::Delete(const Key& key) {
+  // The key is erased in one step so that no reader or prefetch sees a slot without its value in between.
+  // Taking the size of the value under the latch keeps the memory usage exact when racing with the evictor
+  int64_t freed = 0;
+  auto existed = records_.EraseIf(key, [&freed](const Slot& slot) {
+    if (slot.value != nullptr) {
+      freed = slot.value->size();
+    }
+    return true;
+  });
+  if (existed) {
+    hot_bytes_.fetch_sub(freed, std::memory_order_relaxed);
+  }
+  return existed;
+}
+
+bool TieredStorage::GetMasterMetadata(const Key& key, Metadata& metadata) const {
+  auto slot = records_.GetView(key);
+  if (!slot) {
+    return false;
+  }
+  metadata = slot->metadata;
+  return true;
+}
+
+Record TieredStorage::Load(const Slot& slot) const {
+  string buffer(slot.size, '\0');
+  size_t read = 0;
+  while (read < buffer.size()) {
+    auto res = pread(fd_, buffer.data() + read, buffer.size() - read, slot.offset + read);
+    if (res < 0 && errno == EINTR) {
+      continue;
+    }
+    CHECK_GT(res, 0) << "Error while reading spilled value: " << strerror(errno);
+    read += res;
+  }
+  Record record;
+  record.SetValue(buffer);
+  record.SetMetadata(slot.metadata);
+  return record;
+}
+
+bool TieredStorage::Prefetch(const std::vector<const Key*>& keys, const std::function<void()>& done) {
+  std::vector<const Key*> spilled;
+  for (auto key : keys) {
+    auto slot = records_.GetView(*key);
+    if (slot && slot->value == nullptr) {
+      spilled.push_back(key);
+    }
+  }
+  if (spilled.empty()) {
+    return false;
+  }
+  auto request = std::make_shared<PrefetchRequest>(spilled.size(), done);
+  {
+    std::lock_guard<std::mutex> guard(prefetch_mut_);
+    for (auto key : spilled) {
+      prefetch_queue_.emplace_back(*key, request);
+    }
+  }
+  prefetch_cv_.notify_all();
+  return true;
+}
+
+void TieredStorage::Promote(const Key& key) {
+  Slot slot;
+  if (!records_.Get(slot, key) || slot.value != nullptr) {
+    return;
+  }
+  std::shared_ptr<const Record> record = std::make_shared<Record>(Load(slot));
+  auto now = NowMicros();
+  bool promoted = false;
+  records_.Update(key, [&](Slot& current) {
+    // Skip if the value has been written or loaded in the meantime
+    if (current.value == nullptr && current.offset == slot.offset) {
+      current.value = record;
+      // Keep the value from being evicted again before it is read
+      current.last_read.store(clock_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      current.prefetched_at.store(now, std::memory_order_relaxed);
+      promoted = true;
+    }
+  });
+  if (promoted) {
+    hot_bytes_.fetch_add(record->size(), std::memory_order_relaxed);
+    prefetches_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void TieredStorage::Evict() {
+  std::lock_guard<std::mutex> guard(evict_mut_);
+
+  // Values read since the previous round have the current tick
+  auto clock = clock_.fetch_add(1, std::memory_order_relaxed);
+  auto limit = static_cast<int64_t>(memory_limit_);
+  auto hot_bytes = hot_bytes_.load(std::memory_order_relaxed);
+  if (hot_bytes <= limit) {
+    return;
+  }
+  auto to_free = hot_bytes - limit / 10 * 9;
+
+  struct Victim {
+    Key key;
+    std::shared_ptr<const Record> value;
+  };
+  std::vector<Victim> victims;
+  int64_t selected = 0;
+  // The first pass picks the values that have not been read since the previous round and the second
+  // pass picks from the rest
+  for (int pass = 0; pass < 2 && selected < to_free; pass++) {
+    records_.ForEach([&](const Key& key, const Slot& slot) {
+      if (selected >= to_free || slot.value == nullptr) {
+        return;
+      }
+      bool recent = slot.last_read.load(std::memory_order_relaxed) >= clock;
+      if (recent != (pass == 1)) {
+        return;
+      }
+      selected += slot.value->size();
+      victims.push_back({key, slot.value});
+    });
+  }
+
+  // The values are written to the file before their slots point there, so readers never see a slot
+  // pointing past the written part of the file
+  string buffer;
+  std::vector<uint64_t> offsets;
+  size_t first = 0;
+  auto spill = [&](size_t end) {
+    size_t written = 0;
+    while (written < buffer.size()) {
+      auto res = pwrite(fd_, buffer.data() + written, buffer.size() - written, file_size_ + written);
+      if (res < 0 && errno == EINTR) {
+        continue;
+      }
+      CHECK_GE(res, 0) << "Error while spilling values: " << strerror(errno);
+      written += res;
+    }
+    file_size_ += buffer.size();
+    buffer.clear();
+
+    for (size_t i = first; i < end; i++) {
+      auto& victim = victims[i];
+      bool evicted = false;
+      records_.Update(victim.key, [&](Slot& slot) {
+        // Skip if the value has been overwritten in the meantime
+        if (slot.value == victim.value) {
+          slot.value.reset();
+          slot.offset = offsets[i - first];
+          slot.size = victim.value->size();
+          evicted = true;
+        }
+      });
+      if (evicted) {
+        hot_bytes_.fetch_sub(victim.value->size(), std::memory_order_relaxed);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    offsets.clear();
+    first = end;
+  };
+  for (size_t i = 0; i < victims.size(); i++) {
+    offsets.push_back(file_size_ + buffer.size());
+    buffer.append(victims[i].value->data(), victims[i].value->size());
+    if (buffer.size() >= kSpillBufferSize) {
+      spill(i + 1);
+    }
+  }
+  spill(victims.size());
+
+  VLOG(1) << "Spilled " << victims.size() << " values. Values in memory: " << hot_bytes_.load() << " bytes";
+}
+
+TieredStorage::Stats TieredStorage::stats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.prefetches = prefetches_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  stats.hot_bytes = std::max<int64_t>(hot_bytes_.load(std::memory_order_relaxed), 0);
+  auto lead_time_count = prefetch_lead_time_count_.load(std::memory_order_relaxed);
+  stats.avg_prefetch_lead_time_us = 0;
+  if (lead_time_count > 0) {
+    stats.avg_prefetch_lead_time_us =
+        static_cast<double>(prefetch_lead_time_sum_.load(std::memory_order_relaxed)) / lead_time_count;
+  }
+  return stats;
+}
+
+void TieredStorage::GetStats(rapidjson::Document& stats, uint32_t) const {
+  using rapidjson::StringRef;
+
+  auto s = this->stats();
+  auto& alloc = stats.GetAllocator();
+  stats.AddMember(StringRef(STORAGE_HITS), s.hits, alloc)
+      .AddMember(StringRef(STORAGE_MISSES), s.misses, alloc)
+      .AddMember(StringRef(STORAGE_PREFETCHES), s.prefetches, alloc)
+      .AddMember(StringRef(STORAGE_EVICTIONS), s.evictions, alloc)
+      .AddMember(StringRef(STORAGE_HOT_BYTES), s.hot_bytes, alloc)
+      .AddMember(StringRef(STORAGE_AVG_PREFETCH_LEAD_TIME_US), s.avg_prefetch_lead_time_us, alloc);
+}
+
+void TieredStorage::RunEvictor() {
+  std::unique_lock<std::mutex> lock(stop_mut_);
+  while (!stop_) {
+    stop_cv_.wait_for(lock, eviction_interval_);
+    lock.unlock();
+    Evict();
+    lock.lock();
+  }
+}
+
+void TieredStorage::RunPrefetcher() {
+  std::unique_lock<std::mutex> lock(prefetch_mut_);
+  while (true) {
+    prefetch_cv_.wait(lock, [this] { return stop_ || !prefetch_queue_.empty(); });
+    if (stop_) {
+      break;
+    }
+    // One key at a time so that the I/O threads share the loads of a big request
+    auto [key, request] = std::move(prefetch_queue_.front());
+    prefetch_queue_.pop_front();
+    lock.unlock();
+    // A key written or deleted in the meantime is skipped, which also leaves nothing to wait for
+    Promote(key);
+    if (request->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      request->done();
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace slog
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/concurrent_hash_map.h"
+#include "storage/lookup_master_index.h"
+#include "storage/storage.h"
+
+namespace slog {
+
+/**
+ * A storage for data sets larger than memory. Every key and its master metadata stay in a hash table, but
+ * when the values in memory exceed the memory limit, a background thread spills the values of the least
+ * recently read records to an append-only file.
+ *
+ * Since the scheduler knows the keys of a txn long before the txn reaches a worker, it calls Prefetch with
+ * them and a pool of I/O threads loads the spilled values back into memory in the meantime, then tells the
+ * scheduler that the txn can be dispatched. A read of a spilled value that has not been prefetched reads
+ * the file directly.
+ *
+ * Recency is tracked with a clock that ticks every eviction round: a value is first chosen for eviction
+ * if it has not been read since the previous round. The file is never compacted, so overwriting a spilled
+ * value leaves its old bytes behind.
+ *
+ * Any thread may read, write or prefetch. The evictor and the I/O threads run alongside them but only
+ * swap a value for its location in the file or back, and only if the slot still holds what they read, so
+ * they never undo a write. Writes to the same key from different threads are applied in the order they
+ * reach the table.
+ */
+class TieredStorage : public Storage, public LookupMasterIndex {
+ public:
+  TieredStorage(const std::string& dir, uint64_t memory_limit, std::chrono::milliseconds eviction_interval,
+                uint32_t num_io_threads = 4);
+  ~TieredStorage();
+
+  bool Read(const Key& key, Record& result) const final;
+
+  RecordView ReadView(const Key& key) const final;
+
+  bool Write(const Key& key, const Record& record) final { return Put(key, std::make_shared<Record>(record)); }
+
+  bool Write(const Key& key, Record&& record) final { return Put(key, std::make_shared<Record>(std::move(record))); }
+
+  bool Update(const Key& key, const std::function<void(Record&)>& update_fn) final;
+
+  bool Delete(const Key& key) final;
+
+  void Reserve(size_t n) final { records_.Reserve(n); }
+
+  bool Prefetch(const std::vector<const Key*>& keys, const std::function<void()>& done) final;
+
+  void GetStats(rapidjson::Document& stats, uint32_t level) const final;
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final;
+
+  /**
+   * Spills the least recently read values until the values in memory take up at most 90% of the memory
+   * limit. This is called periodically by the background thread
+   */
+  void Evict();
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t prefetches;
+    uint64_t evictions;
+    uint64_t hot_bytes;
+    // Average time from the end of a prefetch to the first read of the prefetched value
+    double avg_prefetch_lead_time_us;
+  };
+  Stats stats() const;
+
+ private:
+  struct Slot {
+    Slot() = default;
+    Slot(const Slot& other)
+        : metadata(other.metadata),
+          value(other.value),
+          offset(other.offset),
+          size(other.size),
+          last_read(other.last_read.load(std::memory_order_relaxed)),
+          prefetched_at(other.prefetched_at.load(std::memory_order_relaxed)) {}
+    Slot& operator=(const Slot& other) {
+      metadata = other.metadata;
+      value = other.value;
+      offset = other.offset;
+      size = other.size;
+      last_read.store(other.last_read.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      prefetched_at.store(other.prefetched_at.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      return *this;
+    }
+
+    Metadata metadata;
+    // Null if the value is spilled. The record is never modified once it is in a slot
+    std::shared_ptr<const Record> value;
+    // Location of the value in the file if it is spilled
+    uint64_t offset = 0;
+    uint32_t size = 0;
+    // Clock tick of the last read
+    mutable std::atomic<uint32_t> last_read{0};
+    // Time in us when the value was loaded by a prefetch, or 0 if it has been read since then
+    mutable std::atomic<int64_t> prefetched_at{0};
+  };
+
+  // The spilled values of one call to Prefetch
+  struct PrefetchRequest {
+    PrefetchRequest(size_t remaining, const std::function<void()>& done) : remaining(remaining), done(done) {}
+
+    std::atomic<size_t> remaining;
+    std::function<void()> done;
+  };
+
+  bool Put(const Key& key, std::shared_ptr<const Record>&& record);
+  // Reads a spilled value from the file
+  Record Load(const Slot& slot) const;
+  // Loads the spilled value of key into memory
+  void Promote(const Key& key);
+  void RecordHit(const Slot& slot) const;
+  void RunEvictor();
+  void RunPrefetcher();
+
+  std::chrono::milliseconds eviction_interval_;
+  uint64_t memory_limit_;
+  int fd_;
+  // Guards the end of the file, which only grows by eviction
+  std::mutex evict_mut_;
+  uint64_t file_size_;
+
+  OptimisticConcurrentHashMap<Key, Slot> records_;
+  std::atomic<int64_t> hot_bytes_;
+  std::atomic<uint32_t> clock_;
+
+  std::mutex prefetch_mut_;
+  std::condition_variable prefetch_cv_;
+  std::deque<std::pair<Key, std::shared_ptr<PrefetchRequest>>> prefetch_queue_;
+
+  mutable std::atomic<uint64_t> hits_;
+  mutable std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> prefetches_;
+  std::atomic<uint64_t> evictions_;
+  mutable std::atomic<int64_t> prefetch_lead_time_sum_;
+  mutable std::atomic<uint64_t> prefetch_lead_time_count_;
+
+  std::mutex stop_mut_;
+  std::condition_variable stop_cv_;
+  bool stop_;
+  std::thread evictor_;
+  std::vector<std::thread> prefetchers_;
+};
+
+}  // namespace slog
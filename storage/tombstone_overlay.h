@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common/concurrent_hash_map.h"
+#include "storage/storage.h"
+
+namespace slog {
+
+/**
+ * Remembers which records of a read-only base have been deleted, for storages that keep their written records
+ * in a writable storage laid over such a base, e.g. the initial records derived from their keys or a mapped
+ * snapshot. Records in the writable storage take precedence over those of the base, and a base record with a
+ * tombstone is treated as missing. The tombstones are only kept in memory.
+ *
+ * Reads may run alongside writes from any thread. A reader looks in the writable storage first and falls back
+ * to the base only when the key has no tombstone. A tombstone is kept when its key is written again because
+ * erasing it would let a reader that missed the key just before the write fall back to the deleted base
+ * record, so there is at most one tombstone for each base record. Deleting a key changes both the writable
+ * storage and the tombstones, so two writes of the same key must not overlap. Writes of different keys may run
+ * in parallel.
+ */
+class TombstoneOverlay {
+ public:
+  bool IsDeleted(const Key& key) const {
+    bool deleted;
+    return deleted_.Get(deleted, key);
+  }
+
+  /**
+   * Deletes key from the writable storage. in_base tells whether the base has a record of key, deleted or not.
+   * The tombstone is inserted before the record leaves the writable storage so that a concurrent reader never
+   * falls back to the deleted base record. Returns whether the key existed
+   */
+  bool Delete(Storage& storage, const Key& key, bool in_base) {
+    if (!in_base) {
+      return storage.Delete(key);
+    }
+    bool was_deleted = deleted_.InsertOrUpdate(key, true);
+    bool in_storage = storage.Delete(key);
+    return !was_deleted || in_storage;
+  }
+
+  /**
+   * Called after writing a key that was not in the writable storage. in_base tells whether the base has a
+   * record of key, deleted or not. Returns whether the key existed before the write
+   */
+  bool ExistedInBase(const Key& key, bool in_base) const { return in_base && !IsDeleted(key); }
+
+ private:
+  OptimisticConcurrentHashMap<Key, bool> deleted_;
+};
+
+}  // namespace slog
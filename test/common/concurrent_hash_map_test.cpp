@@ -7,8 +7,15 @@
 using namespace std;
 using namespace slog;
 
-TEST(ConcurrentHashMapTest, SerialBasicOperations) {
-  ConcurrentHashMap<string, string> map;
+template <typename MapType>
+class ConcurrentHashMapTest : public ::testing::Test {};
+
+using MapTypes = ::testing::Types<ConcurrentHashMap<string, string>, OptimisticConcurrentHashMap<string, string>,
+                                  FlatConcurrentHashMap<string, string>>;
+TYPED_TEST_SUITE(ConcurrentHashMapTest, MapTypes);
+
+TYPED_TEST(ConcurrentHashMapTest, SerialBasicOperations) {
+  TypeParam map;
   string result;
   ASSERT_FALSE(map.Get(result, "test"));
   ASSERT_FALSE(map.Erase("test"));
@@ -38,8 +45,8 @@ TEST(ConcurrentHashMapTest, SerialBasicOperations) {
   }
 }
 
-TEST(ConcurrentHashMapTest, TriggerRehash) {
-  ConcurrentHashMap<string, string> map;
+TYPED_TEST(ConcurrentHashMapTest, TriggerRehash) {
+  TypeParam map;
   string result;
 
   for (size_t i = 0; i < 10000; i++) {
@@ -60,10 +67,183 @@ TEST(ConcurrentHashMapTest, TriggerRehash) {
   }
 }
 
-TEST(ConcurrentHashMapTest, TwoReadersOneWriter) {
+TYPED_TEST(ConcurrentHashMapTest, Reserve) {
+  TypeParam map;
+  string result;
+
+  map.Reserve(10000);
+  for (size_t i = 0; i < 10000; i++) {
+    ASSERT_FALSE(map.InsertOrUpdate(to_string(i), "foo" + to_string(i)));
+  }
+  // Reserving less than the current size keeps all entries
+  map.Reserve(10);
+  for (size_t i = 0; i < 10000; i++) {
+    ASSERT_TRUE(map.Get(result, to_string(i))) << "Failed at i = " << i;
+    ASSERT_EQ(result, "foo" + to_string(i)) << "Failed at i = " << i;
+  }
+}
+
+TYPED_TEST(ConcurrentHashMapTest, ForEachVisitsEachEntryOnce) {
+  TypeParam map;
+  vector<int> seen(5000);
+
+  // Stop at an arbitrary size so that some segments are in the middle of growing
+  for (size_t i = 0; i < seen.size(); i++) {
+    map.InsertOrUpdate(to_string(i), to_string(i));
+  }
+  map.ForEach([&](const string& key, const string& value) {
+    ASSERT_EQ(key, value);
+    seen[stoi(key)]++;
+  });
+  for (size_t i = 0; i < seen.size(); i++) {
+    ASSERT_EQ(seen[i], 1) << "Failed at i = " << i;
+  }
+}
+
+TYPED_TEST(ConcurrentHashMapTest, ForEachCallsSegmentDoneWithoutLatch) {
+  TypeParam map;
+  for (size_t i = 0; i < 5000; i++) {
+    map.InsertOrUpdate(to_string(i), to_string(i));
+  }
+  size_t visited = 0;
+  size_t visited_at_segment_done = 0;
+  map.ForEach([&](const string&, const string&) { visited++; },
+              [&] {
+                ASSERT_GT(visited, visited_at_segment_done);
+                visited_at_segment_done = visited;
+                // Would deadlock if the latch of the visited segment were still held
+                map.InsertOrUpdate("0", "0");
+              });
+  ASSERT_EQ(visited_at_segment_done, 5000U);
+}
+
+TYPED_TEST(ConcurrentHashMapTest, MultiGet) {
+  TypeParam map;
+  for (size_t i = 0; i < 100; i++) {
+    map.InsertOrUpdate(to_string(i), "foo" + to_string(i));
+  }
+
+  // Span more than one batch and include missing and repeated keys
+  vector<string> keys;
+  for (size_t i = 0; i < 50; i++) {
+    keys.push_back(to_string(i * 3));
+  }
+  keys.push_back("7");
+  vector<const string*> key_ptrs;
+  for (const auto& key : keys) {
+    key_ptrs.push_back(&key);
+  }
+
+  vector<int> seen(keys.size());
+  map.MultiGet(key_ptrs, [&](size_t i, const string* value) {
+    seen[i]++;
+    if (stoi(keys[i]) < 100) {
+      ASSERT_NE(value, nullptr);
+      ASSERT_EQ(*value, "foo" + keys[i]);
+    } else {
+      ASSERT_EQ(value, nullptr);
+    }
+  });
+  for (size_t i = 0; i < seen.size(); i++) {
+    ASSERT_EQ(seen[i], 1) << "Failed at i = " << i;
+  }
+}
+
+TYPED_TEST(ConcurrentHashMapTest, GetView) {
+  TypeParam map;
+  ASSERT_FALSE(map.GetView("test"));
+
+  map.InsertOrUpdate("test", "foo");
+  {
+    auto view = map.GetView("test");
+    ASSERT_TRUE(view);
+    ASSERT_EQ(*view, "foo");
+  }
+
+  // Moving the view must not release the pin twice
+  auto view = map.GetView("test");
+  auto moved_view = std::move(view);
+  ASSERT_FALSE(view);
+  ASSERT_EQ(*moved_view, "foo");
+  moved_view.Release();
+
+  map.InsertOrUpdate("test", "bar");
+  ASSERT_EQ(*map.GetView("test"), "bar");
+}
+
+TYPED_TEST(ConcurrentHashMapTest, EraseAndReinsert) {
+  TypeParam map;
+  string result;
+
+  for (int round = 0; round < 5; round++) {
+    for (size_t i = 0; i < 1000; i++) {
+      ASSERT_FALSE(map.InsertOrUpdate(to_string(i), to_string(round)));
+    }
+    for (size_t i = 0; i < 1000; i += 2) {
+      ASSERT_TRUE(map.Erase(to_string(i)));
+    }
+    for (size_t i = 0; i < 1000; i++) {
+      ASSERT_EQ(map.Get(result, to_string(i)), i % 2 == 1) << "Failed at i = " << i;
+    }
+    for (size_t i = 1; i < 1000; i += 2) {
+      ASSERT_TRUE(map.Erase(to_string(i)));
+    }
+  }
+}
+
+TYPED_TEST(ConcurrentHashMapTest, EraseIf) {
+  TypeParam map;
+  string result;
+
+  ASSERT_FALSE(map.EraseIf("test", [](const string&) { return true; }));
+  map.InsertOrUpdate("test", "foo");
+  ASSERT_FALSE(map.EraseIf("test", [](const string& value) { return value == "bar"; }));
+  ASSERT_TRUE(map.Get(result, "test"));
+  ASSERT_TRUE(map.EraseIf("test", [](const string& value) { return value == "foo"; }));
+  ASSERT_FALSE(map.Get(result, "test"));
+}
+
+TYPED_TEST(ConcurrentHashMapTest, Update) {
+  TypeParam map;
+  string result;
+
+  ASSERT_FALSE(map.Update("test", [](string& value) { value = "foo"; }));
+  ASSERT_FALSE(map.Get(result, "test"));
+
+  map.InsertOrUpdate("test", "foo");
+  ASSERT_TRUE(map.Update("test", [](string& value) { value[0] = 'b'; }));
+  ASSERT_TRUE(map.Get(result, "test"));
+  ASSERT_EQ(result, "boo");
+
+  ASSERT_TRUE(map.Update("test", [](string& value) { value += "st"; }));
+  ASSERT_TRUE(map.Get(result, "test"));
+  ASSERT_EQ(result, "boost");
+}
+
+TYPED_TEST(ConcurrentHashMapTest, MoveInsertOrUpdate) {
+  TypeParam map;
+  string result;
+  // Long enough to not fit in the small string buffer
+  string value(100, 'a');
+  string key = "test";
+
+  ASSERT_FALSE(map.InsertOrUpdate(std::move(key), std::move(value)));
+  ASSERT_TRUE(map.Get(result, "test"));
+  ASSERT_EQ(result, string(100, 'a'));
+
+  string new_value(100, 'b');
+  auto data = new_value.data();
+  ASSERT_TRUE(map.InsertOrUpdate("test", std::move(new_value)));
+  auto view = map.GetView("test");
+  ASSERT_EQ(*view, string(100, 'b'));
+  // The buffer of the value is moved into the map instead of being copied
+  ASSERT_EQ(view->data(), data);
+}
+
+TYPED_TEST(ConcurrentHashMapTest, TwoReadersOneWriter) {
   uint32_t N = 500000;
   string key = "foo";
-  ConcurrentHashMap<string, string> map;
+  TypeParam map;
 
   auto Updates = [&]() {
     for (size_t i = 0; i < N; i++) {
@@ -91,9 +271,9 @@ TEST(ConcurrentHashMapTest, TwoReadersOneWriter) {
   r2.join();
 }
 
-TEST(ConcurrentHashMapTest, TwoWritersDifferentKeys) {
+TYPED_TEST(ConcurrentHashMapTest, TwoWritersDifferentKeys) {
   int N = 500000;
-  ConcurrentHashMap<string, string> map;
+  TypeParam map;
 
   auto Updates = [&](int start) {
     for (int i = start; i < N; i += 2) {
@@ -113,10 +293,10 @@ TEST(ConcurrentHashMapTest, TwoWritersDifferentKeys) {
   }
 }
 
-TEST(ConcurrentHashMapTest, TwoWritersSameKey) {
+TYPED_TEST(ConcurrentHashMapTest, TwoWritersSameKey) {
   int N = 500000;
   string key = "foo";
-  ConcurrentHashMap<string, string> map;
+  TypeParam map;
 
   auto Updates = [&]() {
     for (int i = 0; i < N; i += 1) {
@@ -134,9 +314,9 @@ TEST(ConcurrentHashMapTest, TwoWritersSameKey) {
   ASSERT_EQ(result, to_string(N - 1));
 }
 
-TEST(ConcurrentHashMapTest, OneWriterOneEraser) {
+TYPED_TEST(ConcurrentHashMapTest, OneWriterOneEraser) {
   int N = 100000;
-  ConcurrentHashMap<string, string> map;
+  TypeParam map;
 
   auto Updates = [&]() {
     for (int i = 0; i < N; i++) {
@@ -161,4 +341,39 @@ TEST(ConcurrentHashMapTest, OneWriterOneEraser) {
       ASSERT_EQ(result, to_string(i));
     }
   }
-}
\ No newline at end of file
+}
+
+TYPED_TEST(ConcurrentHashMapTest, ReadersDuringRehash) {
+  int N = 200000;
+  TypeParam map;
+  atomic<bool> done = false;
+
+  auto Inserts = [&]() {
+    for (int i = 0; i < N; i++) {
+      map.InsertOrUpdate(to_string(i), to_string(i));
+    }
+    done = true;
+  };
+
+  // Keys that are already inserted must stay visible while their segment is rehashed
+  auto Gets = [&]() {
+    string result;
+    int i = 0;
+    while (!done) {
+      if (map.Get(result, to_string(i))) {
+        ASSERT_EQ(result, to_string(i));
+        ASSERT_TRUE(map.Get(result, "0"));
+        ASSERT_EQ(result, "0");
+        i++;
+      }
+    }
+  };
+
+  ASSERT_FALSE(map.InsertOrUpdate("0", "0"));
+  thread w(Inserts);
+  thread r1(Gets);
+  thread r2(Gets);
+  w.join();
+  r1.join();
+  r2.join();
+}
@@ -0,0 +1,103 @@
+#include "common/concurrent_skip_list.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace std;
+using namespace slog;
+
+TEST(ConcurrentSkipListTest, SerialBasicOperations) {
+  ConcurrentSkipList<string, string> list;
+  string result;
+  ASSERT_FALSE(list.Get(result, "test"));
+  ASSERT_FALSE(list.Erase("test"));
+  ASSERT_FALSE(list.Update("test", [](string&) {}));
+
+  for (size_t i = 0; i < 100; i++) {
+    ASSERT_FALSE(list.InsertOrUpdate(to_string(i), "foo" + to_string(i)));
+  }
+  ASSERT_EQ(list.size(), 100U);
+  for (size_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(list.Get(result, to_string(i)));
+    ASSERT_EQ(result, "foo" + to_string(i));
+  }
+
+  ASSERT_TRUE(list.InsertOrUpdate("0", "bar"));
+  ASSERT_EQ(*list.GetView("0"), "bar");
+  ASSERT_TRUE(list.Update("0", [](string& value) { value += "bar"; }));
+  ASSERT_EQ(*list.GetView("0"), "barbar");
+
+  for (size_t i = 0; i < 100; i += 2) {
+    ASSERT_TRUE(list.Erase(to_string(i)));
+  }
+  ASSERT_EQ(list.size(), 50U);
+  for (size_t i = 0; i < 100; i++) {
+    ASSERT_EQ(list.Get(result, to_string(i)), i % 2 == 1);
+  }
+}
+
+TEST(ConcurrentSkipListTest, Scan) {
+  ConcurrentSkipList<int, int> list;
+  for (int i = 0; i < 1000; i += 3) {
+    list.InsertOrUpdate(i, i * 10);
+  }
+
+  vector<int> keys;
+  list.Scan(100, [&](int key, int value) {
+    EXPECT_EQ(value, key * 10);
+    if (key >= 130) {
+      return false;
+    }
+    keys.push_back(key);
+    return true;
+  });
+  ASSERT_EQ(keys, vector<int>({102, 105, 108, 111, 114, 117, 120, 123, 126, 129}));
+
+  keys.clear();
+  list.Scan(998, [&](int key, int) {
+    keys.push_back(key);
+    return true;
+  });
+  ASSERT_EQ(keys, vector<int>({999}));
+}
+
+TEST(ConcurrentSkipListTest, ScansDuringWrites) {
+  ConcurrentSkipList<int, int> list;
+  const int kNumKeys = 2000;
+  for (int i = 0; i < kNumKeys; i += 2) {
+    list.InsertOrUpdate(i, i);
+  }
+
+  std::atomic<bool> done = false;
+  auto Scanner = [&]() {
+    while (!done) {
+      int prev = -1;
+      int even = 0;
+      list.Scan(0, [&](int key, int value) {
+        EXPECT_GT(key, prev);
+        EXPECT_EQ(key, value);
+        even += key % 2 == 0;
+        prev = key;
+        return true;
+      });
+      // Even keys are never erased
+      ASSERT_EQ(even, kNumKeys / 2);
+    }
+  };
+  thread scanner1(Scanner), scanner2(Scanner);
+  for (int round = 0; round < 10; round++) {
+    for (int i = 1; i < kNumKeys; i += 2) {
+      list.InsertOrUpdate(i, i);
+    }
+    for (int i = 0; i < kNumKeys; i += 2) {
+      list.Update(i, [](int&) {});
+    }
+    for (int i = 1; i < kNumKeys; i += 2) {
+      list.Erase(i);
+    }
+  }
+  done = true;
+  scanner1.join();
+  scanner2.join();
+}
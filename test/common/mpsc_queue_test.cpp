@@ -0,0 +1,109 @@
+#include "common/mpsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace slog;
+
+TEST(SpscQueueTest, PushAndPopAcrossSegments) {
+  SpscQueue<unique_ptr<int>, 4> queue;
+  ASSERT_TRUE(queue.empty());
+  for (int i = 0; i < 10; i++) {
+    queue.Push(make_unique<int>(i));
+  }
+  ASSERT_FALSE(queue.empty());
+  for (int i = 0; i < 10; i++) {
+    unique_ptr<int> item;
+    ASSERT_TRUE(queue.Pop(item));
+    ASSERT_EQ(*item, i);
+  }
+  unique_ptr<int> item;
+  ASSERT_FALSE(queue.Pop(item));
+  ASSERT_TRUE(queue.empty());
+
+  // Items left in the queue are destroyed with it
+  queue.Push(make_unique<int>(10));
+}
+
+TEST(SpscQueueTest, ConcurrentProducerAndConsumer) {
+  const int kNumItems = 100000;
+  SpscQueue<int, 16> queue;
+  thread producer([&] {
+    for (int i = 0; i < kNumItems; i++) {
+      queue.Push(int(i));
+    }
+  });
+  for (int i = 0; i < kNumItems; i++) {
+    int item;
+    while (!queue.Pop(item)) {
+    }
+    ASSERT_EQ(item, i);
+  }
+  producer.join();
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(MpscQueueTest, ConcurrentProducers) {
+  const int kNumProducers = 4;
+  const int kNumItems = 50000;
+  MpscQueue<pair<int, int>> queue;
+  vector<thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    auto lane = queue.NewLane();
+    producers.emplace_back([lane, p] {
+      for (int i = 0; i < kNumItems; i++) {
+        lane->Push(make_pair(p, i));
+      }
+    });
+  }
+
+  // The items of each producer come out in order
+  vector<int> next(kNumProducers, 0);
+  for (int i = 0; i < kNumProducers * kNumItems; i++) {
+    pair<int, int> item;
+    while (!queue.Pop(item)) {
+    }
+    ASSERT_EQ(item.second, next[item.first]++);
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(MpscQueueTest, ReuseReleasedLanes) {
+  MpscQueue<int, 4> queue;
+  // Many more producers come and go than there are lanes
+  int next = 0;
+  for (int i = 0; i < 1000; i++) {
+    auto lane = queue.NewLane();
+    lane->Push(int(i));
+    queue.ReleaseLane(lane);
+    // The items of a released lane are still taken
+    int item;
+    ASSERT_TRUE(queue.Pop(item));
+    ASSERT_EQ(item, next++);
+    // The consumer finds the lane drained and frees it
+    ASSERT_FALSE(queue.Pop(item));
+  }
+  ASSERT_TRUE(queue.empty());
+
+  // A lane is not reused until its items are taken
+  auto lane1 = queue.NewLane();
+  lane1->Push(1);
+  queue.ReleaseLane(lane1);
+  auto lane2 = queue.NewLane();
+  ASSERT_NE(lane1, lane2);
+  lane2->Push(2);
+  vector<int> items(2);
+  ASSERT_TRUE(queue.Pop(items[0]));
+  ASSERT_TRUE(queue.Pop(items[1]));
+  sort(items.begin(), items.end());
+  ASSERT_EQ(items, vector<int>({1, 2}));
+  ASSERT_TRUE(queue.empty());
+}
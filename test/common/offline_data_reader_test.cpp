@@ -0,0 +1,94 @@
+#include "common/offline_data_reader.h"
+
+#include <fcntl.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace slog;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::FileOutputStream;
+
+class OfflineDataChunkReaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/offline_data_reader_test_XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    path_ = path;
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+  // Writes a data file in the same format as the offline data generator
+  void WriteDataFile(uint32_t num_datums) {
+    auto fd = open(path_.c_str(), O_WRONLY | O_TRUNC);
+    ASSERT_GE(fd, 0);
+    {
+      FileOutputStream raw_output(fd);
+      CodedOutputStream output(&raw_output);
+      output.WriteVarint32(num_datums);
+      for (uint32_t i = 0; i < num_datums; i++) {
+        Datum datum;
+        datum.set_key("key" + std::to_string(i));
+        // Vary the size so that some size prefixes take more than one byte
+        datum.set_record(std::string(i % 300, 'a'));
+        datum.set_master(i % 3);
+        output.WriteVarint32(datum.ByteSizeLong());
+        datum.SerializeToCodedStream(&output);
+      }
+    }
+    close(fd);
+  }
+
+  std::string path_;
+};
+
+TEST_F(OfflineDataChunkReaderTest, ReadAllChunks) {
+  WriteDataFile(1000);
+  OfflineDataChunkReader reader(path_, 64);
+  ASSERT_TRUE(reader.is_open());
+  ASSERT_EQ(reader.GetNumDatums(), 1000U);
+  ASSERT_EQ(reader.GetNumChunks(), 16U);
+
+  std::atomic<size_t> next_chunk = 0;
+  std::vector<std::atomic<int>> seen(1000);
+  auto ReadFn = [&]() {
+    for (auto chunk = next_chunk++; chunk < reader.GetNumChunks(); chunk = next_chunk++) {
+      reader.ForEachDatum(chunk, [&](const Datum& datum) {
+        auto i = std::stoi(datum.key().substr(3));
+        ASSERT_EQ(datum.record(), std::string(i % 300, 'a'));
+        ASSERT_EQ(datum.master(), static_cast<uint32_t>(i % 3));
+        seen[i]++;
+      });
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back(ReadFn);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (auto& s : seen) {
+    ASSERT_EQ(s.load(), 1);
+  }
+}
+
+TEST_F(OfflineDataChunkReaderTest, NoDatum) {
+  WriteDataFile(0);
+  OfflineDataChunkReader reader(path_, 64);
+  ASSERT_TRUE(reader.is_open());
+  ASSERT_EQ(reader.GetNumDatums(), 0U);
+  ASSERT_EQ(reader.GetNumChunks(), 0U);
+}
+
+TEST_F(OfflineDataChunkReaderTest, MissingFile) {
+  OfflineDataChunkReader reader(path_ + "_missing", 64);
+  ASSERT_FALSE(reader.is_open());
+}
@@ -0,0 +1,71 @@
+#include "common/shared_arena.h"
+
+#include <gtest/gtest.h>
+
+#include "common/batch_log.h"
+#include "common/proto_utils.h"
+
+using namespace std;
+using namespace slog;
+
+using google::protobuf::Arena;
+using internal::Batch;
+
+namespace {
+
+Batch* MakeBatchOnArena(Arena* arena, int num_txns) {
+  auto batch = Arena::CreateMessage<Batch>(arena);
+  batch->set_id(100);
+  batch->add_events()->set_event(TransactionEvent::ENTER_LOG_MANAGER_IN_BATCH);
+  for (int i = 0; i < num_txns; i++) {
+    auto txn = batch->add_transactions();
+    txn->mutable_internal()->set_id(i);
+    auto entry = txn->add_keys();
+    entry->set_key("key" + to_string(i));
+    entry->mutable_value_entry()->set_value(string(100, 'a'));
+  }
+  return batch;
+}
+
+}  // namespace
+
+TEST(SharedArenaTest, TxnsOutliveBatch) {
+  auto arena = NewSharedArena();
+  BatchPtr batch(MakeBatchOnArena(arena, 3));
+  auto txns = Unbatch(batch.get());
+  batch.reset();
+
+  ASSERT_EQ(txns.size(), 3U);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(txns[i]->GetArena(), arena);
+    ASSERT_EQ(txns[i]->internal().id(), static_cast<TxnId>(i));
+    ASSERT_EQ(txns[i]->keys(0).value_entry().value(), string(100, 'a'));
+    // The events of the batch are transferred to the txns
+    ASSERT_EQ(txns[i]->internal().events_size(), 1);
+  }
+  // The arena is freed with the last txn
+  DeleteMessage(txns[1]);
+  DeleteMessage(txns[0]);
+  ASSERT_EQ(txns[2]->keys(0).key(), "key2");
+  DeleteMessage(txns[2]);
+}
+
+TEST(SharedArenaTest, MixHeapAndArenaMessages) {
+  auto arena = NewSharedArena(4096);
+  BatchPtr arena_batch(MakeBatchOnArena(arena, 1));
+  BatchPtr heap_batch = make_unique<Batch>();
+  heap_batch->add_transactions()->mutable_internal()->set_id(5);
+
+  auto arena_txns = Unbatch(arena_batch.get());
+  auto heap_txns = Unbatch(heap_batch.get());
+  ASSERT_EQ(heap_txns[0]->GetArena(), nullptr);
+
+  // A heap envelope can carry a txn on an arena without copying it
+  internal::Envelope env;
+  env.mutable_request()->mutable_forward_txn()->unsafe_arena_set_allocated_txn(arena_txns[0]);
+  auto txn = env.mutable_request()->mutable_forward_txn()->unsafe_arena_release_txn();
+  ASSERT_EQ(txn, arena_txns[0]);
+
+  DeleteMessage(txn);
+  DeleteMessage(heap_txns[0]);
+}
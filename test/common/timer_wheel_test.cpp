@@ -0,0 +1,123 @@
+#include "common/timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "connection/poller.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace slog;
+
+namespace {
+const auto kStart = TimerWheel::Clock::time_point(1h);
+}
+
+TEST(TimerWheelTest, RunInOrder) {
+  TimerWheel wheel(kStart);
+  vector<int> fired;
+  wheel.Add(kStart + 30us, [&] { fired.push_back(3); });
+  wheel.Add(kStart + 10us, [&] { fired.push_back(1); });
+  wheel.Add(kStart + 20us, [&] { fired.push_back(2); });
+  wheel.Add(kStart + 20us, [&] { fired.push_back(4); });
+
+  ASSERT_EQ(wheel.NextDeadline(), kStart + 10us);
+  ASSERT_EQ(wheel.RunExpired(kStart + 9us), 0U);
+  ASSERT_EQ(wheel.RunExpired(kStart + 25us), 3U);
+  ASSERT_EQ(fired, vector<int>({1, 2, 4}));
+  ASSERT_EQ(wheel.NextDeadline(), kStart + 30us);
+  ASSERT_EQ(wheel.RunExpired(kStart + 30us), 1U);
+  ASSERT_EQ(fired, vector<int>({1, 2, 4, 3}));
+  ASSERT_TRUE(wheel.empty());
+  ASSERT_FALSE(wheel.NextDeadline().has_value());
+}
+
+TEST(TimerWheelTest, Remove) {
+  TimerWheel wheel(kStart);
+  int fired = 0;
+  auto h1 = wheel.Add(kStart + 10us, [&] { fired += 1; });
+  auto h2 = wheel.Add(kStart + 10s, [&] { fired += 10; });
+  wheel.Add(kStart + 10s, [&] { fired += 100; });
+
+  ASSERT_TRUE(wheel.Remove(h1));
+  ASSERT_FALSE(wheel.Remove(h1));
+  ASSERT_TRUE(wheel.Remove(h2));
+  ASSERT_EQ(wheel.RunExpired(kStart + 20s), 1U);
+  ASSERT_EQ(fired, 100);
+}
+
+TEST(TimerWheelTest, CallbacksChangeWheel) {
+  TimerWheel wheel(kStart);
+  vector<int> fired;
+  TimerWheel::Handle h2;
+  wheel.Add(kStart + 10us, [&] {
+    fired.push_back(1);
+    wheel.Remove(h2);
+    // Already due but left for the next run
+    wheel.Add(kStart, [&] { fired.push_back(3); });
+  });
+  h2 = wheel.Add(kStart + 10us, [&] { fired.push_back(2); });
+
+  ASSERT_EQ(wheel.RunExpired(kStart + 10us), 1U);
+  ASSERT_EQ(fired, vector<int>({1}));
+  ASSERT_EQ(wheel.NextDeadline(), kStart + 10us);
+  ASSERT_EQ(wheel.RunExpired(kStart + 10us), 1U);
+  ASSERT_EQ(fired, vector<int>({1, 3}));
+}
+
+TEST(TimerWheelTest, NeverEarlyAcrossLevels) {
+  TimerWheel wheel(kStart);
+  std::mt19937 rg(0);
+  std::uniform_int_distribution<int64_t> dist(0, 3600'000'000'000);
+  vector<TimerWheel::Clock::time_point> deadlines;
+  vector<pair<TimerWheel::Clock::time_point, int>> fired;
+  auto now = kStart;
+  // Follow the deadlines given by the wheel like a poller would
+  auto run_next = [&] {
+    auto next = wheel.NextDeadline();
+    if (!next.has_value()) {
+      return false;
+    }
+    now = max(now, next.value());
+    wheel.RunExpired(now);
+    return true;
+  };
+  for (int i = 0; i < 2000; i++) {
+    // Spread the deadlines across all levels, some with nanoseconds to round up
+    auto deadline = now + nanoseconds(dist(rg) >> (rg() % 42));
+    deadlines.push_back(deadline);
+    wheel.Add(deadline, [&fired, &now, i] { fired.emplace_back(now, i); });
+    if (i % 10 == 9) {
+      run_next();
+    }
+  }
+  while (run_next()) {
+  }
+
+  ASSERT_EQ(fired.size(), deadlines.size());
+  for (size_t i = 0; i < fired.size(); i++) {
+    auto [time, id] = fired[i];
+    ASSERT_GE(time, deadlines[id]);
+    ASSERT_LT(time - deadlines[id], 1us);
+    if (i > 0) {
+      ASSERT_GE(time, fired[i - 1].first);
+    }
+  }
+}
+
+TEST(TimerWheelTest, PollerSleepsUntilSubMillisecondCallback) {
+  Poller poller(std::nullopt);
+  bool fired = false;
+  auto start = steady_clock::now();
+  poller.AddTimedCallback(300us, [&] { fired = true; });
+
+  // A spinning poller would take many more rounds
+  int rounds = 0;
+  while (!fired) {
+    poller.NextEvent();
+    rounds++;
+  }
+  ASSERT_GE(steady_clock::now() - start, 300us);
+  ASSERT_LE(rounds, 3);
+}
@@ -7,6 +7,7 @@
 #include "common/constants.h"
 #include "common/proto_utils.h"
 #include "connection/broker.h"
+#include "connection/inproc_queue.h"
 #include "connection/sender.h"
 #include "connection/zmq_utils.h"
 #include "proto/internal.pb.h"
@@ -18,10 +19,8 @@ using internal::Envelope;
 using internal::Request;
 using internal::Response;
 
-zmq::socket_t MakePullSocket(zmq::context_t& context, Channel chan) {
-  zmq::socket_t socket(context, ZMQ_PULL);
-  socket.bind(MakeInProcChannelAddress(chan));
-  return socket;
+shared_ptr<InprocChannel> MakeInprocChannel(zmq::context_t& context, Channel chan) {
+  return GetInprocChannel(context, chan);
 }
 
 EnvelopePtr MakePing(int64_t time) {
@@ -59,7 +58,7 @@ TEST(BrokerAndSenderTest, PingPong) {
     broker->AddChannel(Broker::ChannelOption(PING, false /* is_raw */));
     broker->StartInNewThreads();
 
-    auto recv_socket = MakePullSocket(*broker->context(), PING);
+    auto recv_channel = MakeInprocChannel(*broker->context(), PING);
 
     Sender sender(broker->config(), broker->context());
     // Send ping
@@ -67,7 +66,7 @@ TEST(BrokerAndSenderTest, PingPong) {
     sender.Send(*ping_req, MakeMachineId(0, 0, 1), PONG);
 
     // Wait for pong
-    auto res = RecvEnvelope(recv_socket);
+    auto res = RecvEnvelope(*recv_channel);
     ASSERT_TRUE(res != nullptr);
     ASSERT_TRUE(res->has_response());
     ASSERT_EQ(99, res->response().pong().src_time());
@@ -79,12 +78,12 @@ TEST(BrokerAndSenderTest, PingPong) {
     broker->AddChannel(Broker::ChannelOption(PONG, false /* is_raw */));
     broker->StartInNewThreads();
 
-    auto socket = MakePullSocket(*broker->context(), PONG);
+    auto channel = MakeInprocChannel(*broker->context(), PONG);
 
     Sender sender(broker->config(), broker->context());
 
     // Wait for ping
-    auto req = RecvEnvelope(socket);
+    auto req = RecvEnvelope(*channel);
     ASSERT_TRUE(req != nullptr);
     ASSERT_TRUE(req->has_request());
     ASSERT_EQ(99, req->request().ping().src_time());
@@ -110,23 +109,23 @@ TEST(BrokerTest, LocalPingPong) {
 
   auto ping = thread([&]() {
     Sender sender(broker->config(), broker->context());
-    auto socket = MakePullSocket(*broker->context(), PING);
+    auto channel = MakeInprocChannel(*broker->context(), PING);
 
     // Send ping
     sender.Send(MakePing(99), PONG);
 
     // Wait for pong
-    auto res = RecvEnvelope(socket);
+    auto res = RecvEnvelope(*channel);
     ASSERT_TRUE(res != nullptr);
     ASSERT_EQ(99, res->response().pong().src_time());
   });
 
   auto pong = thread([&]() {
     Sender sender(broker->config(), broker->context());
-    auto socket = MakePullSocket(*broker->context(), PONG);
+    auto channel = MakeInprocChannel(*broker->context(), PONG);
 
     // Wait for ping
-    auto req = RecvEnvelope(socket);
+    auto req = RecvEnvelope(*channel);
     ASSERT_TRUE(req != nullptr);
     ASSERT_EQ(99, req->request().ping().src_time());
 
@@ -149,7 +148,7 @@ TEST(BrokerTest, MultiSend) {
     broker->AddChannel(Broker::ChannelOption(PING, false /* is_raw */));
     broker->StartInNewThreads();
 
-    auto socket = MakePullSocket(*broker->context(), PING);
+    auto channel = MakeInprocChannel(*broker->context(), PING);
 
     Sender sender(broker->config(), broker->context());
     // Send ping
@@ -162,7 +161,7 @@ TEST(BrokerTest, MultiSend) {
 
     // Wait for pongs
     for (int i = 0; i < NUM_PONGS; i++) {
-      auto res = RecvEnvelope(socket);
+      auto res = RecvEnvelope(*channel);
       ASSERT_TRUE(res != nullptr);
       ASSERT_TRUE(res->has_response());
       ASSERT_EQ(99, res->response().pong().src_time());
@@ -176,12 +175,12 @@ TEST(BrokerTest, MultiSend) {
       broker->AddChannel(Broker::ChannelOption(PONG, false /* is_raw */));
       broker->StartInNewThreads();
 
-      auto socket = MakePullSocket(*broker->context(), PONG);
+      auto channel = MakeInprocChannel(*broker->context(), PONG);
 
       Sender sender(broker->config(), broker->context());
 
       // Wait for ping
-      auto req = RecvEnvelope(socket);
+      auto req = RecvEnvelope(*channel);
       ASSERT_TRUE(req != nullptr);
       ASSERT_TRUE(req->has_request());
       ASSERT_EQ(99, req->request().ping().src_time());
@@ -208,7 +207,7 @@ TEST(BrokerTest, CreateRedirection) {
 
   // Initialize ping machine
   auto ping_broker = Broker::New(configs[0], kTestModuleTimeout);
-  auto ping_socket = MakePullSocket(*ping_broker->context(), PING);
+  auto ping_channel = MakeInprocChannel(*ping_broker->context(), PING);
   ping_broker->AddChannel(Broker::ChannelOption(PING, false /* is_raw */));
   ping_broker->StartInNewThreads();
   Sender ping_sender(ping_broker->config(), ping_broker->context());
@@ -226,7 +225,7 @@ TEST(BrokerTest, CreateRedirection) {
 
   // Initialize pong machine
   auto pong_broker = Broker::New(configs[1], kTestModuleTimeout);
-  auto pong_socket = MakePullSocket(*pong_broker->context(), PONG);
+  auto pong_channel = MakeInprocChannel(*pong_broker->context(), PONG);
   pong_broker->AddChannel(Broker::ChannelOption(PONG, false /* is_raw */));
   pong_broker->StartInNewThreads();
   Sender pong_sender(pong_broker->config(), pong_broker->context());
@@ -240,7 +239,7 @@ TEST(BrokerTest, CreateRedirection) {
   // The pong machine does not know which channel to forward to yet at this point
   // so the message will be queued up at the broker
   this_thread::sleep_for(5ms);
-  ASSERT_EQ(RecvEnvelope(pong_socket, true), nullptr);
+  ASSERT_EQ(RecvEnvelope(*pong_channel, true), nullptr);
 
   // Establish a redirection from TAG to the PONG channel at the pong machine
   {
@@ -253,7 +252,7 @@ TEST(BrokerTest, CreateRedirection) {
 
   // Now we can receive the ping message
   {
-    auto ping_req = RecvEnvelope(pong_socket);
+    auto ping_req = RecvEnvelope(*pong_channel);
     ASSERT_TRUE(ping_req != nullptr);
     ASSERT_TRUE(ping_req->has_request());
     ASSERT_EQ(99, ping_req->request().ping().src_time());
@@ -268,7 +267,7 @@ TEST(BrokerTest, CreateRedirection) {
   // We should be able to receive pong here since we already establish a redirection at
   // the beginning for the ping machine
   {
-    auto pong_res = RecvEnvelope(ping_socket);
+    auto pong_res = RecvEnvelope(*ping_channel);
     ASSERT_TRUE(pong_res != nullptr);
     ASSERT_TRUE(pong_res->has_response());
     ASSERT_EQ(99, pong_res->response().pong().src_time());
@@ -283,14 +282,14 @@ TEST(BrokerTest, RemoveRedirection) {
 
   // Initialize ping machine
   auto ping_broker = Broker::New(configs[0], kTestModuleTimeout);
-  auto ping_socket = MakePullSocket(*ping_broker->context(), PING);
+  auto ping_channel = MakeInprocChannel(*ping_broker->context(), PING);
   ping_broker->AddChannel(Broker::ChannelOption(PING, false /* is_raw */));
   ping_broker->StartInNewThreads();
   Sender ping_sender(ping_broker->config(), ping_broker->context());
 
   // Initialize pong machine
   auto pong_broker = Broker::New(configs[1], kTestModuleTimeout);
-  auto pong_socket = MakePullSocket(*pong_broker->context(), PONG);
+  auto pong_channel = MakeInprocChannel(*pong_broker->context(), PONG);
   pong_broker->AddChannel(Broker::ChannelOption(PONG, false /* is_raw */));
   pong_broker->StartInNewThreads();
   Sender pong_sender(pong_broker->config(), pong_broker->context());
@@ -312,7 +311,7 @@ TEST(BrokerTest, RemoveRedirection) {
 
   // Now we can the ping message here
   {
-    auto ping_req = RecvEnvelope(pong_socket);
+    auto ping_req = RecvEnvelope(*pong_channel);
     ASSERT_TRUE(ping_req != nullptr);
     ASSERT_TRUE(ping_req->has_request());
     ASSERT_EQ(99, ping_req->request().ping().src_time());
@@ -338,5 +337,91 @@ TEST(BrokerTest, RemoveRedirection) {
   // pong broker removes the redirection, making the assertion to fail. However,
   // it should be unlikely due to the sleep.
   this_thread::sleep_for(5ms);
-  ASSERT_EQ(RecvEnvelope(pong_socket, true), nullptr);
-}
\ No newline at end of file
+  ASSERT_EQ(RecvEnvelope(*pong_channel, true), nullptr);
+}
+
+TEST(BrokerTest, CoalescedMessages) {
+  const Channel PING = 8;
+  const Channel PONG = 9;
+  internal::Configuration common_config;
+  common_config.mutable_message_coalescing()->set_delay_us(1000000);
+  auto pong_delay = common_config.mutable_message_coalescing()->add_channel_delays();
+  pong_delay->set_channel(PONG);
+  pong_delay->set_delay_us(0);
+  ConfigVec configs = MakeTestConfigurations("coalesced", 1, 1, 1, common_config);
+
+  auto broker = Broker::New(configs[0], kTestModuleTimeout);
+  auto ping_channel = MakeInprocChannel(*broker->context(), PING);
+  auto pong_channel = MakeInprocChannel(*broker->context(), PONG);
+  broker->AddChannel(Broker::ChannelOption(PING, false /* is_raw */));
+  broker->AddChannel(Broker::ChannelOption(PONG, true /* is_raw */));
+  broker->StartInNewThreads();
+
+  Sender sender(broker->config(), broker->context());
+  vector<chrono::microseconds> scheduled_flushes;
+  sender.EnableCoalescing([&](chrono::microseconds delay) { scheduled_flushes.push_back(delay); });
+
+  // The pings are held back
+  for (int i = 0; i < 3; i++) {
+    sender.Send(*MakePing(i), configs[0]->local_machine_id(), PING);
+  }
+  ASSERT_EQ(scheduled_flushes.size(), 1U);
+  ASSERT_GT(scheduled_flushes[0], 0us);
+  this_thread::sleep_for(5ms);
+  ASSERT_EQ(RecvEnvelope(*ping_channel, true), nullptr);
+
+  // The pong opts out of coalescing so it is sent right away together with the pings before it
+  sender.Send(*MakePong(99), configs[0]->local_machine_id(), PONG);
+  for (int i = 0; i < 3; i++) {
+    auto ping = RecvEnvelope(*ping_channel);
+    ASSERT_TRUE(ping != nullptr);
+    ASSERT_EQ(ping->from(), configs[0]->local_machine_id());
+    ASSERT_EQ(ping->request().ping().src_time(), i);
+  }
+  auto raw_pong = RecvEnvelope(*pong_channel);
+  ASSERT_TRUE(raw_pong != nullptr);
+  Envelope pong;
+  ASSERT_TRUE(DeserializeProto(pong, raw_pong->raw().data(), raw_pong->raw().size()));
+  ASSERT_EQ(pong.response().pong().src_time(), 99);
+
+  // Flushing sends the held back messages
+  sender.Send(*MakePing(3), configs[0]->local_machine_id(), PING);
+  sender.FlushCoalesced(true /* force */);
+  auto ping = RecvEnvelope(*ping_channel);
+  ASSERT_TRUE(ping != nullptr);
+  ASSERT_EQ(ping->request().ping().src_time(), 3);
+}
+
+TEST(BrokerTest, SharedMemory) {
+  const Channel PING = 8;
+  internal::Configuration common_config;
+  common_config.set_protocol("shm");
+  // Smaller than some of the messages below
+  common_config.set_shm_ring_size(1024);
+  ConfigVec configs = MakeTestConfigurations("shm", 1, 1, 2, common_config);
+
+  auto broker = Broker::New(configs[1], kTestModuleTimeout);
+  auto ping_channel = MakeInprocChannel(*broker->context(), PING);
+  broker->AddChannel(Broker::ChannelOption(PING, false /* is_raw */));
+  broker->StartInNewThreads();
+
+  auto sender_broker = Broker::New(configs[0], kTestModuleTimeout);
+  Sender sender(sender_broker->config(), sender_broker->context());
+  auto to_machine_id = configs[1]->local_machine_id();
+  for (int i = 0; i < 10; i++) {
+    Envelope env;
+    env.set_raw(string(i * 300, 'a' + i));
+    if (i % 2 == 0) {
+      sender.Send(env, to_machine_id, PING);
+    } else {
+      sender.Send(env, vector<MachineId>{to_machine_id}, PING);
+    }
+  }
+
+  for (int i = 0; i < 10; i++) {
+    auto env = RecvEnvelope(*ping_channel);
+    ASSERT_TRUE(env != nullptr);
+    ASSERT_EQ(env->from(), configs[0]->local_machine_id());
+    ASSERT_EQ(env->raw(), string(i * 300, 'a' + i));
+  }
+}
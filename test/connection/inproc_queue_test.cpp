@@ -0,0 +1,72 @@
+#include "connection/inproc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "connection/poller.h"
+
+using namespace std;
+using namespace slog;
+
+TEST(InprocQueueTest, WakeUpSleepingPoller) {
+  auto queue = make_shared<InprocQueue<int>>();
+  Poller poller(std::nullopt);
+  poller.PushQueue(*queue);
+
+  thread producer([queue] {
+    InprocQueue<int>::Producer producer(queue);
+    this_thread::sleep_for(20ms);
+    producer.Push(1);
+  });
+
+  // Blocks without a timeout until the producer pushes
+  ASSERT_TRUE(poller.NextEvent());
+  int item;
+  ASSERT_TRUE(queue->Pop(item));
+  ASSERT_EQ(item, 1);
+  producer.join();
+}
+
+TEST(InprocQueueTest, DoNotSleepOnNonEmptyQueue) {
+  auto queue = make_shared<InprocQueue<int>>();
+  InprocQueue<int>::Producer producer(queue);
+  producer.Push(1);
+
+  Poller poller(std::nullopt);
+  poller.PushQueue(*queue);
+  ASSERT_TRUE(poller.NextEvent());
+  int item;
+  ASSERT_TRUE(queue->Pop(item));
+  ASSERT_FALSE(queue->Pop(item));
+}
+
+TEST(InprocQueueTest, ChannelsAreSharedWithinContext) {
+  zmq::context_t context1, context2;
+  auto channel = GetInprocChannel(context1, 1);
+  ASSERT_EQ(channel, GetInprocChannel(context1, 1));
+  ASSERT_NE(channel, GetInprocChannel(context1, 2));
+  ASSERT_NE(channel, GetInprocChannel(context2, 1));
+
+  InprocChannel::Producer producer(GetInprocChannel(context1, 1));
+  auto env = make_unique<internal::Envelope>();
+  env->mutable_request()->mutable_ping()->set_src_time(99);
+  SendEnvelope(producer, move(env));
+  auto received = RecvEnvelope(*channel);
+  ASSERT_NE(received, nullptr);
+  ASSERT_EQ(received->request().ping().src_time(), 99);
+  ASSERT_EQ(RecvEnvelope(*channel, true /* dont_wait */), nullptr);
+}
+
+TEST(InprocQueueTest, ProducersGiveBackTheirLanes) {
+  auto queue = make_shared<InprocQueue<int>>();
+  // More producers than there are lanes come and go
+  for (int i = 0; i < 1000; i++) {
+    InprocQueue<int>::Producer producer(queue);
+    producer.Push(int(i));
+    int item;
+    ASSERT_TRUE(queue->Pop(item));
+    ASSERT_EQ(item, i);
+    ASSERT_FALSE(queue->Pop(item));
+  }
+}
@@ -0,0 +1,64 @@
+#include "connection/polling_policy.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace std::chrono;
+using namespace slog;
+
+namespace {
+
+internal::PollingOptions MakeOptions(internal::PollingMode mode, uint32_t min_spin_us, uint32_t max_spin_us) {
+  internal::PollingOptions options;
+  options.set_mode(mode);
+  options.set_min_spin_us(min_spin_us);
+  options.set_max_spin_us(max_spin_us);
+  return options;
+}
+
+// Feeds the policy with rounds that did work at the given interval and returns the time of the last one
+PollingPolicy::Clock::time_point WorkEvery(PollingPolicy& policy, microseconds gap, int rounds) {
+  auto now = PollingPolicy::Clock::now();
+  for (int i = 0; i < rounds; i++) {
+    now += gap;
+    policy.FinishRound(now, true /* did_work */);
+  }
+  return now;
+}
+
+}  // namespace
+
+TEST(PollingPolicyTest, SpinLongEnoughForFrequentMessages) {
+  PollingPolicy policy(MakeOptions(internal::PollingMode::SPIN_THEN_BLOCK, 10, 1000));
+  auto last_work = WorkEvery(policy, 100us, 100);
+  ASSERT_GE(policy.spin_time(), 190us);
+  ASSERT_LE(policy.spin_time(), 210us);
+
+  policy.FinishRound(last_work + 150us, false /* did_work */);
+  ASSERT_EQ(policy.NextWait(), PollingPolicy::Wait::SPIN);
+  policy.FinishRound(last_work + 250us, false /* did_work */);
+  ASSERT_EQ(policy.NextWait(), PollingPolicy::Wait::BLOCK);
+}
+
+TEST(PollingPolicyTest, BarelySpinForSparseMessages) {
+  PollingPolicy policy(MakeOptions(internal::PollingMode::SPIN_THEN_BLOCK, 10, 1000));
+  auto last_work = WorkEvery(policy, 5ms, 100);
+  ASSERT_EQ(policy.spin_time(), 10us);
+
+  policy.FinishRound(last_work + 5us, false /* did_work */);
+  ASSERT_EQ(policy.NextWait(), PollingPolicy::Wait::SPIN);
+  policy.FinishRound(last_work + 20us, false /* did_work */);
+  ASSERT_EQ(policy.NextWait(), PollingPolicy::Wait::BLOCK);
+}
+
+TEST(PollingPolicyTest, Modes) {
+  PollingPolicy spin(MakeOptions(internal::PollingMode::SPIN, 0, 100));
+  PollingPolicy spin_then_yield(MakeOptions(internal::PollingMode::SPIN_THEN_YIELD, 0, 100));
+  auto last_work = WorkEvery(spin, 10ms, 10);
+  WorkEvery(spin_then_yield, 10ms, 10);
+
+  spin.FinishRound(last_work + 1s, false /* did_work */);
+  ASSERT_EQ(spin.NextWait(), PollingPolicy::Wait::SPIN);
+  spin_then_yield.FinishRound(last_work + 1s, false /* did_work */);
+  ASSERT_EQ(spin_then_yield.NextWait(), PollingPolicy::Wait::YIELD);
+}
@@ -0,0 +1,104 @@
+#include "connection/shm_transport.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "connection/poller.h"
+
+using namespace std;
+using namespace slog;
+
+namespace {
+
+zmq::message_t MakeMessage(size_t size, char c) {
+  zmq::message_t msg(size);
+  memset(msg.data(), c, size);
+  return msg;
+}
+
+class ShmTransportTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    pull_ = zmq::socket_t(context_, ZMQ_PULL);
+    pull_.bind("inproc://shm_test");
+    push_ = zmq::socket_t(context_, ZMQ_PUSH);
+    push_.connect("inproc://shm_test");
+  }
+
+  zmq::context_t context_;
+  zmq::socket_t pull_;
+  zmq::socket_t push_;
+};
+
+}  // namespace
+
+TEST_F(ShmTransportTest, WriteAndRecvAcrossWrapAround) {
+  ShmWriter writer(push_, 64);
+  ShmReceiver receiver(pull_);
+  zmq::message_t msg;
+  ASSERT_FALSE(receiver.Recv(msg));
+
+  for (int i = 0; i < 20; i++) {
+    // Each message with its length takes more than half of the ring
+    writer.Write(MakeMessage(10, 'a' + i), MakeMessage(20, 'A' + i));
+    ASSERT_TRUE(receiver.Recv(msg));
+    ASSERT_EQ(msg.to_string(), string(10, 'a' + i) + string(20, 'A' + i));
+    ASSERT_FALSE(receiver.Recv(msg));
+  }
+}
+
+TEST_F(ShmTransportTest, MessagesLargerThanRing) {
+  ShmReceiver receiver(pull_);
+  thread writer_thread([this] {
+    ShmWriter writer(push_, 64);
+    for (int i = 0; i < 10; i++) {
+      writer.Write(MakeMessage(1000, 'a' + i));
+    }
+  });
+
+  for (int i = 0; i < 10;) {
+    if (zmq::message_t msg; receiver.Recv(msg)) {
+      ASSERT_EQ(msg.to_string(), string(1000, 'a' + i));
+      i++;
+    }
+  }
+  writer_thread.join();
+}
+
+TEST_F(ShmTransportTest, WakeUpSleepingReceiver) {
+  ShmWriter writer(push_, 1024);
+  ShmReceiver receiver(pull_);
+  Poller poller(std::nullopt);
+  poller.PushShmReceiver(receiver);
+
+  // Attach the ring
+  zmq::message_t msg;
+  ASSERT_FALSE(receiver.Recv(msg));
+
+  thread writer_thread([&writer] {
+    this_thread::sleep_for(20ms);
+    writer.Write(MakeMessage(10, 'a'));
+  });
+
+  // Blocks without a timeout until the writer wakes it up
+  ASSERT_TRUE(poller.NextEvent());
+  writer_thread.join();
+  ASSERT_TRUE(receiver.Recv(msg));
+  ASSERT_EQ(msg.to_string(), string(10, 'a'));
+}
+
+TEST_F(ShmTransportTest, DropRingAfterWriterGoesAway) {
+  ShmReceiver receiver(pull_);
+  {
+    ShmWriter writer(push_, 64);
+    writer.Write(MakeMessage(10, 'a'));
+  }
+  // What was written before the writer went away is still received
+  zmq::message_t msg;
+  ASSERT_TRUE(receiver.Recv(msg));
+  ASSERT_EQ(msg.to_string(), string(10, 'a'));
+  ASSERT_EQ(receiver.num_rings(), 1U);
+  ASSERT_FALSE(receiver.Recv(msg));
+  ASSERT_EQ(receiver.num_rings(), 0U);
+}
@@ -116,4 +116,105 @@ TEST(ZmqUtilsTest, FailedParsing) {
   ASSERT_FALSE(ParseChannel(chan, msg));
   Request req;
   ASSERT_FALSE(DeserializeProto(req, msg));
-}
\ No newline at end of file
+}
+
+TEST(ZmqUtilsTest, RejectTruncatedProto) {
+  Request req;
+  req.mutable_ping()->set_src_time(99);
+  auto msg = SerializeProto(req);
+
+  Request req2;
+  ASSERT_TRUE(DeserializeProto(req2, msg));
+  ASSERT_EQ(req2.ping().src_time(), 99);
+  zmq::message_t truncated(msg.data(), msg.size() - 1);
+  ASSERT_FALSE(DeserializeProto(req2, truncated));
+}
+
+TEST(ZmqUtilsTest, SendSharedProtoToManySockets) {
+  zmq::context_t context(1);
+
+  vector<zmq::socket_t> pushes, pulls;
+  for (int i = 0; i < 2; i++) {
+    auto endpoint = "inproc://test" + to_string(i);
+    pushes.emplace_back(context, ZMQ_PUSH).bind(endpoint);
+    pulls.emplace_back(context, ZMQ_PULL).connect(endpoint);
+  }
+
+  internal::Envelope env;
+  env.mutable_request()->mutable_ping()->set_src_time(99);
+  {
+    SharedSerializedProto serialized(env);
+    for (int i = 0; i < 2; i++) {
+      serialized.Send(pushes[i], i + 1, 9);
+    }
+  }
+
+  for (int i = 0; i < 2; i++) {
+    zmq::message_t msg, body;
+    ASSERT_TRUE(RecvAddressedBuffer(pulls[i], msg, body));
+    Channel channel;
+    ASSERT_TRUE(ParseChannel(channel, msg));
+    ASSERT_EQ(channel, 9);
+    auto received = DeserializeEnvelope(msg, body);
+    ASSERT_NE(received, nullptr);
+    ASSERT_EQ(received->from(), i + 1);
+    ASSERT_EQ(received->request().ping().src_time(), 99);
+
+    // A shared proto is not mistaken for a proto of another type
+    Response res;
+    ASSERT_FALSE(DeserializeProto(res, msg, body));
+  }
+}
+
+TEST(ZmqUtilsTest, SendAndSplitCoalescedMessage) {
+  zmq::context_t context(1);
+
+  zmq::socket_t push(context, ZMQ_PUSH);
+  push.bind("inproc://test");
+  zmq::socket_t pull(context, ZMQ_PULL);
+  pull.connect("inproc://test");
+
+  internal::Envelope env1, env2;
+  env1.mutable_request()->mutable_ping()->set_src_time(1);
+  env2.mutable_response()->mutable_pong()->set_src_time(2);
+  CoalescedMessage coalesced;
+  coalesced.Add(env1, 3, 8);
+  SharedSerializedProto(env2).AddTo(coalesced, 3, 9);
+  coalesced.Send(push);
+  ASSERT_TRUE(coalesced.empty());
+
+  zmq::message_t msg;
+  ASSERT_TRUE(pull.recv(msg));
+  ASSERT_TRUE(IsCoalescedMessage(msg));
+  vector<zmq::message_t> messages;
+  ASSERT_TRUE(SplitCoalescedMessage(msg, messages));
+  ASSERT_EQ(messages.size(), 2U);
+
+  Channel channel;
+  ASSERT_TRUE(ParseChannel(channel, messages[0]));
+  ASSERT_EQ(channel, 8);
+  auto received = DeserializeEnvelope(messages[0]);
+  ASSERT_NE(received, nullptr);
+  ASSERT_EQ(received->from(), 3);
+  ASSERT_EQ(received->request().ping().src_time(), 1);
+
+  ASSERT_TRUE(ParseChannel(channel, messages[1]));
+  ASSERT_EQ(channel, 9);
+  received = DeserializeEnvelope(messages[1]);
+  ASSERT_NE(received, nullptr);
+  ASSERT_EQ(received->response().pong().src_time(), 2);
+
+  // A truncated coalesced message is rejected
+  zmq::message_t truncated(msg.data(), msg.size() - 1);
+  messages.clear();
+  ASSERT_FALSE(SplitCoalescedMessage(truncated, messages));
+
+  // A lone message is sent as is
+  coalesced.Add(env1, 3, 8);
+  coalesced.Send(push);
+  ASSERT_TRUE(pull.recv(msg));
+  ASSERT_FALSE(IsCoalescedMessage(msg));
+  internal::Envelope env3;
+  ASSERT_TRUE(DeserializeProto(env3, msg));
+  ASSERT_EQ(env3.request().ping().src_time(), 1);
+}
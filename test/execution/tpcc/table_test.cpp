@@ -7,6 +7,7 @@
 #include "common/proto_utils.h"
 #include "execution/tpcc/metadata_initializer.h"
 #include "storage/mem_only_storage.h"
+#include "storage/ordered_storage.h"
 
 using namespace std;
 using namespace slog;
@@ -264,4 +265,68 @@ TEST_F(GroupedTableTest, Delete) {
     ASSERT_TRUE(ScalarListsEqual(res, data[i]));
   }
   ASSERT_TRUE(txn_table->Select({data[0].begin(), data[0].begin() + ItemSchema::kPKeySize}).empty());
-}
\ No newline at end of file
+}
+class ScanTableTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() {
+    if (GetParam()) {
+      storage = std::make_shared<OrderedStorage>();
+    } else {
+      storage = std::make_shared<MemOnlyStorage>();
+    }
+    auto metadata_initializer = std::make_shared<TPCCMetadataInitializer>(2, 1);
+    auto storage_adapter = std::make_shared<KVStorageAdapter>(storage, metadata_initializer);
+    table = std::make_unique<Table<OrderLineSchema>>(storage_adapter);
+    // Order 256 and order 1 have the same lowest byte
+    for (int o_id : {1, 2, 256}) {
+      for (int number = 1; number <= 3; number++) {
+        table->Insert({MakeInt32Scalar(1), MakeInt8Scalar(1), MakeInt32Scalar(o_id), MakeInt8Scalar(number),
+                       MakeInt32Scalar(o_id * 100 + number), MakeInt32Scalar(1), MakeInt64Scalar(0),
+                       MakeInt8Scalar(1), MakeInt32Scalar(o_id), MakeFixedTextScalar<24>("------------------------")});
+      }
+    }
+  }
+
+  std::shared_ptr<Storage> storage;
+  std::unique_ptr<Table<OrderLineSchema>> table;
+};
+
+TEST_P(ScanTableTest, ScanOrderLines) {
+  auto rows = table->Scan({MakeInt32Scalar(1), MakeInt8Scalar(1), MakeInt32Scalar(1)}, 1, 16,
+                          {OrderLineSchema::Column::NUMBER, OrderLineSchema::Column::I_ID});
+  ASSERT_EQ(rows.size(), 3U);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(ScalarListsEqual(rows[i], {MakeInt8Scalar(i + 1), MakeInt32Scalar(101 + i)}));
+  }
+
+  rows = table->Scan({MakeInt32Scalar(1), MakeInt8Scalar(1), MakeInt32Scalar(256)}, 2, 3,
+                     {OrderLineSchema::Column::I_ID});
+  ASSERT_EQ(rows.size(), 1U);
+  ASSERT_TRUE(ScalarListsEqual(rows[0], {MakeInt32Scalar(25602)}));
+
+  ASSERT_TRUE(table->Scan({MakeInt32Scalar(1), MakeInt8Scalar(1), MakeInt32Scalar(3)}, 1, 16).empty());
+}
+
+TEST_P(ScanTableTest, ScanTxnKeys) {
+  Transaction txn;
+  // Declare the keys of the order lines of order 2 and a line that does not exist
+  for (int number = 1; number <= 4; number++) {
+    auto key = Table<OrderLineSchema>::MakeStorageKey(
+        {MakeInt32Scalar(1), MakeInt8Scalar(1), MakeInt32Scalar(2), MakeInt8Scalar(number)});
+    Record record;
+    auto entry = txn.mutable_keys()->Add();
+    entry->set_key(key);
+    if (storage->Read(key, record)) {
+      entry->mutable_value_entry()->set_value(record.to_string());
+    }
+  }
+  Table<OrderLineSchema> txn_table(std::make_shared<TxnStorageAdapter>(txn));
+  auto rows = txn_table.Scan({MakeInt32Scalar(1), MakeInt8Scalar(1), MakeInt32Scalar(2)}, 1, 16,
+                             {OrderLineSchema::Column::I_ID});
+  ASSERT_EQ(rows.size(), 3U);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(ScalarListsEqual(rows[i], {MakeInt32Scalar(201 + i)}));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllStorages, ScanTableTest, ::testing::Bool());
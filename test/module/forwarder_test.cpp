@@ -49,29 +49,18 @@ class ForwarderTest : public ::testing::Test {
 
   Transaction* ReceiveOnSequencerChannel(vector<size_t> machines) {
     CHECK(!machines.empty());
-    // machine, inproc, pollitem
-    std::vector<std::pair<size_t, bool>> info;
-    std::vector<zmq::pollitem_t> poll_items;
-    for (auto m : machines) {
-      info.emplace_back(m, true);
-      poll_items.push_back(test_slogs[m]->GetPollItemForOutputSocket(kSequencerChannel, true));
-      info.emplace_back(m, false);
-      poll_items.push_back(test_slogs[m]->GetPollItemForOutputSocket(kSequencerChannel, false));
-    }
-    auto rc = zmq::poll(poll_items);
-    if (rc <= 0) return nullptr;
-    for (size_t i = 0; i < poll_items.size(); i++) {
-      if (poll_items[i].revents & ZMQ_POLLIN) {
-        auto [m, inproc] = info[i];
-        auto req_env = test_slogs[m]->ReceiveFromOutputSocket(kSequencerChannel, inproc);
-        if (req_env == nullptr) {
-          return nullptr;
+    // The inproc channels and the outproc sockets cannot be polled together so check them in turn
+    for (;;) {
+      for (auto m : machines) {
+        for (bool inproc : {true, false}) {
+          auto req_env = test_slogs[m]->ReceiveFromOutputSocket(kSequencerChannel, inproc, true /* dont_wait */);
+          if (req_env != nullptr) {
+            return ExtractTxn(req_env);
+          }
         }
-        return ExtractTxn(req_env);
       }
+      this_thread::sleep_for(1ms);
     }
-
-    return nullptr;
   }
 
   Transaction* ReceiveOnOrdererChannel(size_t machine) {
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "common/proto_utils.h"
+#include "common/shared_arena.h"
 #include "test/test_utils.h"
 
 using namespace std;
@@ -158,7 +159,7 @@ class LogManagerTest : public ::testing::Test {
     if (req_env->request().type_case() != internal::Request::kForwardTxn) {
       return nullptr;
     }
-    return req_env->mutable_request()->mutable_forward_txn()->release_txn();
+    return RetainArena(req_env->mutable_request()->mutable_forward_txn()->unsafe_arena_release_txn());
   }
 
   unordered_map<MachineId, unique_ptr<Sender>> senders_;
@@ -222,8 +223,8 @@ TEST_F(LogManagerTest, BatchDataBeforeBatchOrder) {
       auto txn2 = ReceiveTxn(id);
       ASSERT_EQ(*txn1, *expected_txn_1);
       ASSERT_EQ(*txn2, *expected_txn_2);
-      delete txn1;
-      delete txn2;
+      DeleteMessage(txn1);
+      DeleteMessage(txn2);
     }
 }
 
@@ -275,8 +276,8 @@ TEST_F(LogManagerTest, BatchOrderBeforeBatchData) {
       auto txn2 = ReceiveTxn(id);
       ASSERT_EQ(*txn1, *expected_txn_1);
       ASSERT_EQ(*txn2, *expected_txn_2);
-      delete txn1;
-      delete txn2;
+      DeleteMessage(txn1);
+      DeleteMessage(txn2);
     }
 
   delete batch;
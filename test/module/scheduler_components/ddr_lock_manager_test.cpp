@@ -215,7 +215,7 @@ TEST(DDRLockManagerTest, LongChain) {
 
 class DDRLockManagerWithResolverTest : public ::testing::Test {
   std::vector<std::shared_ptr<Broker>> brokers_;
-  std::vector<zmq::socket_t> signal_sockets_;
+  std::vector<std::shared_ptr<InprocChannel>> signal_channels_;
 
  protected:
   std::deque<DDRLockManager> lock_managers;
@@ -227,8 +227,7 @@ class DDRLockManagerWithResolverTest : public ::testing::Test {
 
     for (auto config : configs) {
       auto broker = brokers_.emplace_back(Broker::New(config, kTestModuleTimeout));
-      auto& signal_socket = signal_sockets_.emplace_back(*broker->context(), ZMQ_PULL);
-      signal_socket.bind(MakeInProcChannelAddress(kSchedulerChannel));
+      signal_channels_.push_back(GetInprocChannel(*broker->context(), kSchedulerChannel));
       auto& lm = lock_managers.emplace_back();
       // When ddr_interval = 0, we want to manually control when the deadlock resolver
       // runs, so we set poll_timeout to empty so that we can synchronously wait for
@@ -250,7 +249,7 @@ class DDRLockManagerWithResolverTest : public ::testing::Test {
   }
 
   bool HasSignalFromResolver(int i, bool dont_wait = true) {
-    auto env = RecvEnvelope(signal_sockets_[i], dont_wait);
+    auto env = RecvEnvelope(*signal_channels_[i], dont_wait);
     return env != nullptr;
   }
 };
@@ -0,0 +1,43 @@
+#include "module/scheduler_components/key_region_map.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+using namespace std;
+using namespace slog;
+
+TEST(KeyRegionMapTest, NumericAndOtherKeys) {
+  KeyRegionMap<int> map;
+  map.reserve(100);
+  map.GetOrCreate("123", 1) = 1;
+  map.GetOrCreate("123", 2) = 2;
+  map.GetOrCreate("124", 1) = 3;
+  // Not canonical numbers so they are different keys from 123
+  map.GetOrCreate("0123", 1) = 4;
+  map.GetOrCreate("abc", 1) = 5;
+  ASSERT_EQ(map.size(), 5U);
+
+  ASSERT_EQ(map.GetOrCreate("123", 1), 1);
+  ASSERT_EQ(map.GetOrCreate("123", 2), 2);
+  ASSERT_EQ(map.GetOrCreate("0123", 1), 4);
+  ASSERT_EQ(map.GetOrCreate("abc", 2), 0);
+  ASSERT_EQ(map.size(), 6U);
+
+  std::map<KeyRegion, int> regions;
+  map.ForEach([&regions](const KeyRegion& region, int value) { regions[region] = value; });
+  std::map<KeyRegion, int> expected{{"123:1", 1}, {"123:2", 2}, {"124:1", 3},
+                                    {"0123:1", 4}, {"abc:1", 5}, {"abc:2", 0}};
+  ASSERT_EQ(regions, expected);
+}
+
+TEST(KeyRegionMapTest, ReferencesStayValid) {
+  KeyRegionMap<int> map;
+  auto& value = map.GetOrCreate("1", 0);
+  value = 42;
+  for (int i = 2; i < 10000; i++) {
+    map.GetOrCreate(to_string(i), 0);
+  }
+  ASSERT_EQ(&map.GetOrCreate("1", 0), &value);
+  ASSERT_EQ(value, 42);
+}
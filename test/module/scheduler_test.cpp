@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <thread>
 #include <vector>
 
 #include "common/proto_utils.h"
@@ -389,6 +390,85 @@ TEST_F(SchedulerTest, AbortMultiHomeMultiPartition2Active) {
   ASSERT_EQ(output_txn.status(), TransactionStatus::ABORTED);
 }
 
+class SchedulerTestWithMultipleWorkers : public SchedulerTest {
+ protected:
+  ConfigVec MakeConfigs() final {
+    internal::Configuration add_on;
+    add_on.set_num_workers(2);
+    return MakeTestConfigurations("scheduler", kNumRegions, 1, kNumPartitions, add_on);
+  }
+};
+
+TEST_F(SchedulerTestWithMultipleWorkers, RemoteReadsArriveBeforeTransaction) {
+  auto txn = MakeTestTransaction(test_slogs[0]->config(), 1001,
+                                 {{"B", KeyType::WRITE, {{0, 1}}}, {"C", KeyType::WRITE, {{0, 1}}}},
+                                 {{"COPY", "C", "B"}, {"COPY", "B", "C"}});
+  auto sharder = Sharder::MakeSharder(test_slogs[0]->config());
+  auto send_to_partition = [&](PartitionId p) {
+    internal::Envelope env;
+    env.mutable_request()->mutable_forward_txn()->set_allocated_txn(GeneratePartitionedTxn(sharder, txn, p));
+    sender[0]->Send(env, p, kSchedulerChannel);
+  };
+
+  // The worker on partition 2 must hold on to the reads from partition 1 until the txn shows up
+  send_to_partition(1);
+  this_thread::sleep_for(50ms);
+  send_to_partition(2);
+  delete txn;
+
+  auto output_txn = ReceiveMultipleAndMerge(0, 2);
+  LOG(INFO) << output_txn;
+  ASSERT_EQ(output_txn.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(TxnValueEntry(output_txn, "B").new_value(), "valueC");
+  ASSERT_EQ(TxnValueEntry(output_txn, "C").new_value(), "valueB");
+}
+
+class SchedulerTestWithCredits : public SchedulerTest {
+ protected:
+  ConfigVec MakeConfigs() final {
+    internal::Configuration add_on;
+    add_on.set_max_inflight_txns(1);
+    add_on.set_credit_interval(1);
+    return MakeTestConfigurations("scheduler", kNumRegions, 1, kNumPartitions, add_on);
+  }
+
+  // Returns the next number of credits advertised by the scheduler of the given machine
+  uint32_t ReceiveCredits(MachineId from) {
+    for (;;) {
+      auto env = test_slogs[3]->ReceiveFromOutputSocket(kServerChannel);
+      CHECK(env != nullptr);
+      CHECK_EQ(env->request().type_case(), internal::Request::kSchedulerCredits);
+      if (env->from() == from) {
+        return env->request().scheduler_credits().credits();
+      }
+    }
+  }
+};
+
+TEST_F(SchedulerTestWithCredits, AdvertiseCredits) {
+  // Every scheduler starts by advertising all of its room
+  ASSERT_EQ(ReceiveCredits(1), 1U);
+
+  auto txn = MakeTestTransaction(test_slogs[0]->config(), 1001,
+                                 {{"B", KeyType::WRITE, {{0, 1}}}, {"C", KeyType::WRITE, {{0, 1}}}},
+                                 {{"COPY", "C", "B"}, {"COPY", "B", "C"}});
+  auto sharder = Sharder::MakeSharder(test_slogs[0]->config());
+  auto send_to_partition = [&](PartitionId p) {
+    internal::Envelope env;
+    env.mutable_request()->mutable_forward_txn()->set_allocated_txn(GeneratePartitionedTxn(sharder, txn, p));
+    sender[0]->Send(env, p, kSchedulerChannel);
+  };
+
+  // The txn stays at partition 1 until the remote reads from partition 2 arrive
+  send_to_partition(1);
+  ASSERT_EQ(ReceiveCredits(1), 0U);
+
+  send_to_partition(2);
+  delete txn;
+  // The room is given back once the txn finishes
+  ASSERT_EQ(ReceiveCredits(1), 1U);
+}
+
 #ifdef LOCK_MANAGER_DDR
 class SchedulerTestWithDeadlockResolver : public SchedulerTest {
  protected:
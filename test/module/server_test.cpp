@@ -0,0 +1,147 @@
+#include "module/server.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "common/proto_utils.h"
+#include "test/test_utils.h"
+
+using namespace std;
+using namespace slog;
+
+class ServerTest : public ::testing::Test {
+ protected:
+  static const uint32_t kMaxInflightTxns = 3;
+
+  void SetUp() {
+    internal::Configuration add_on;
+    add_on.set_max_inflight_txns(kMaxInflightTxns);
+    auto configs = MakeTestConfigurations("server", 1 /* num_regions */, 1 /* num_replicas */,
+                                          1 /* num_partitions */, add_on);
+    test_slog = make_unique<TestSlog>(configs[0]);
+    storage = make_shared<MultiVersionStorage>();
+    test_slog->AddServerAndClient(storage);
+    // Txns admitted by the server stop here and stay in flight until they are finished by the test
+    test_slog->AddOutputSocket(kForwarderChannel);
+    sender = test_slog->NewSender();
+    test_slog->StartInNewThreads();
+  }
+
+  Transaction* MakeTxn() {
+    return MakeTestTransaction(test_slog->config(), 0, {{"A", KeyType::READ}, {"B", KeyType::WRITE}});
+  }
+
+  // Returns the id of the next txn forwarded by the server
+  TxnId ReceiveForwardedTxn() {
+    auto env = test_slog->ReceiveFromOutputSocket(kForwarderChannel);
+    CHECK(env != nullptr);
+    CHECK_EQ(env->request().type_case(), internal::Request::kForwardTxn);
+    return env->request().forward_txn().txn().internal().id();
+  }
+
+  void FinishTxn(TxnId txn_id) {
+    internal::Envelope env;
+    auto txn = env.mutable_request()->mutable_finished_subtxn()->mutable_txn();
+    txn->mutable_internal()->set_id(txn_id);
+    txn->mutable_internal()->add_involved_partitions(0);
+    txn->set_status(TransactionStatus::COMMITTED);
+    sender->Send(env, test_slog->config()->local_machine_id(), kServerChannel);
+  }
+
+  shared_ptr<MultiVersionStorage> storage;
+  unique_ptr<TestSlog> test_slog;
+  unique_ptr<Sender> sender;
+};
+
+TEST_F(ServerTest, BoundInflightTxns) {
+  // A txn aborted before it is forwarded gives its credit back
+  test_slog->SendTxn(MakeTestTransaction(test_slog->config(), 0, {}));
+  auto aborted = test_slog->RecvTxnResult();
+  ASSERT_EQ(aborted.status(), TransactionStatus::ABORTED);
+  ASSERT_NE(aborted.abort_code(), AbortCode::RATE_LIMITED);
+
+  // Overload the server with many more txns than it can have in flight
+  const int kNumTxns = 20;
+  for (int i = 0; i < kNumTxns; i++) {
+    test_slog->SendTxn(MakeTxn());
+  }
+  for (uint32_t i = 0; i < kNumTxns - kMaxInflightTxns; i++) {
+    auto txn = test_slog->RecvTxnResult();
+    ASSERT_EQ(txn.status(), TransactionStatus::ABORTED);
+    ASSERT_EQ(txn.abort_code(), AbortCode::RATE_LIMITED);
+  }
+  vector<TxnId> inflight;
+  for (uint32_t i = 0; i < kMaxInflightTxns; i++) {
+    inflight.push_back(ReceiveForwardedTxn());
+  }
+  ASSERT_EQ(test_slog->ReceiveFromOutputSocket(kForwarderChannel, true, true /* dont_wait */), nullptr);
+
+  // A finished txn makes room for exactly one more
+  FinishTxn(inflight[0]);
+  auto finished = test_slog->RecvTxnResult();
+  ASSERT_EQ(finished.internal().id(), inflight[0]);
+  ASSERT_EQ(finished.status(), TransactionStatus::COMMITTED);
+
+  test_slog->SendTxn(MakeTxn());
+  test_slog->SendTxn(MakeTxn());
+  ASSERT_EQ(test_slog->RecvTxnResult().abort_code(), AbortCode::RATE_LIMITED);
+  ReceiveForwardedTxn();
+  ASSERT_EQ(test_slog->ReceiveFromOutputSocket(kForwarderChannel, true, true /* dont_wait */), nullptr);
+}
+
+TEST_F(ServerTest, BorrowAdvertisedCredits) {
+  vector<TxnId> inflight;
+  for (uint32_t i = 0; i < kMaxInflightTxns; i++) {
+    test_slog->SendTxn(MakeTxn());
+    inflight.push_back(ReceiveForwardedTxn());
+  }
+  test_slog->SendTxn(MakeTxn());
+  ASSERT_EQ(test_slog->RecvTxnResult().abort_code(), AbortCode::RATE_LIMITED);
+
+  // The scheduler has room for more txns, so the server may go beyond its own credits
+  internal::Envelope env;
+  env.mutable_request()->mutable_scheduler_credits()->set_credits(2);
+  sender->Send(env, test_slog->config()->local_machine_id(), kServerChannel);
+  this_thread::sleep_for(50ms);
+
+  for (int i = 0; i < 3; i++) {
+    test_slog->SendTxn(MakeTxn());
+  }
+  ReceiveForwardedTxn();
+  ReceiveForwardedTxn();
+  ASSERT_EQ(test_slog->RecvTxnResult().abort_code(), AbortCode::RATE_LIMITED);
+
+  // Borrowed credits are not given back when the txns finish, but the server's own credits are
+  FinishTxn(inflight[0]);
+  ASSERT_EQ(test_slog->RecvTxnResult().internal().id(), inflight[0]);
+  test_slog->SendTxn(MakeTxn());
+  test_slog->SendTxn(MakeTxn());
+  ReceiveForwardedTxn();
+  ASSERT_EQ(test_slog->RecvTxnResult().abort_code(), AbortCode::RATE_LIMITED);
+}
+
+TEST_F(ServerTest, ReadOnlyTxnReadsSnapshot) {
+  storage->Write(Key("A"), Record("valueA", 0, 1));
+
+  // A read-only txn over local keys is answered by the server right away
+  auto txn = MakeTestTransaction(test_slog->config(), 0, {{"A", KeyType::READ}, {"B", KeyType::READ}},
+                                 {{"GET", "A"}, {"GET", "B"}});
+  test_slog->SendTxn(txn, true /* read_only */);
+  auto result = test_slog->RecvTxnResult();
+  ASSERT_EQ(result.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(result.keys_size(), 2);
+  for (const auto& kv : result.keys()) {
+    if (kv.key() == "A") {
+      ASSERT_EQ(kv.value_entry().value(), "valueA");
+      ASSERT_EQ(kv.value_entry().metadata().counter(), 1U);
+    } else {
+      ASSERT_TRUE(kv.value_entry().value().empty());
+    }
+  }
+  ASSERT_EQ(test_slog->ReceiveFromOutputSocket(kForwarderChannel, true, true /* dont_wait */), nullptr);
+
+  // A txn marked read-only that writes goes through the normal path
+  test_slog->SendTxn(MakeTxn(), true /* read_only */);
+  ReceiveForwardedTxn();
+}
@@ -0,0 +1,114 @@
+#include "storage/durable_storage.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <fstream>
+
+#include "common/types.h"
+#include "test/test_utils.h"
+
+using namespace slog;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+class DurableStorageTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<DurableStorage> MakeStorage() {
+    // Disable periodic checkpoints so that only the tests trigger them
+    return std::make_unique<DurableStorage>(dir_.path(), milliseconds(1), seconds(0));
+  }
+
+  void AssertRecord(const Storage& storage, const Key& key, const std::string& value, uint32_t master,
+                    uint32_t counter) {
+    Record record;
+    ASSERT_TRUE(storage.Read(key, record)) << key;
+    ASSERT_EQ(record.to_string(), value);
+    ASSERT_EQ(record.metadata().master, master);
+    ASSERT_EQ(record.metadata().counter, counter);
+  }
+
+  TempDir dir_{"durable_storage_test"};
+};
+
+TEST_F(DurableStorageTest, RecoverFromLog) {
+  {
+    auto storage = MakeStorage();
+    ASSERT_FALSE(storage->Recover());
+    storage->Start();
+    storage->Write("key1", Record("value1", 1, 2));
+    storage->Write(Key("key2"), Record("value2", 3, 4));
+    storage->Write("key3", Record("value3"));
+    ASSERT_TRUE(storage->Update("key1", [](Record& record) { record.SetValue("value11"); }));
+    ASSERT_TRUE(storage->Delete("key3"));
+    storage->Flush();
+  }
+
+  auto storage = MakeStorage();
+  ASSERT_TRUE(storage->Recover());
+  AssertRecord(*storage, "key1", "value11", 1, 2);
+  AssertRecord(*storage, "key2", "value2", 3, 4);
+  Record record;
+  ASSERT_FALSE(storage->Read("key3", record));
+}
+
+TEST_F(DurableStorageTest, RecoverFromCheckpointAndLog) {
+  {
+    auto storage = MakeStorage();
+    ASSERT_FALSE(storage->Recover());
+    // Initial data is only persisted by a checkpoint
+    for (int i = 0; i < 100; i++) {
+      storage->Write("key" + std::to_string(i), Record("value" + std::to_string(i), i, i));
+    }
+    storage->Checkpoint();
+    storage->Start();
+    storage->Write("key1", Record("new1", 5, 6));
+    storage->Delete("key2");
+    storage->Checkpoint();
+    storage->Write("key3", Record("new3", 7, 8));
+    storage->Delete("key4");
+    storage->Write("key100", Record("value100"));
+  }
+
+  auto storage = MakeStorage();
+  ASSERT_TRUE(storage->Recover());
+  AssertRecord(*storage, "key0", "value0", 0, 0);
+  AssertRecord(*storage, "key1", "new1", 5, 6);
+  AssertRecord(*storage, "key3", "new3", 7, 8);
+  AssertRecord(*storage, "key99", "value99", 99, 99);
+  AssertRecord(*storage, "key100", "value100", 0, 0);
+  Record record;
+  ASSERT_FALSE(storage->Read("key2", record));
+  ASSERT_FALSE(storage->Read("key4", record));
+
+  // Writes after a recovery go to a new segment
+  storage->Start();
+  storage->Write("key5", Record("new5"));
+  storage.reset();
+  storage = MakeStorage();
+  ASSERT_TRUE(storage->Recover());
+  AssertRecord(*storage, "key5", "new5", 0, 0);
+  AssertRecord(*storage, "key100", "value100", 0, 0);
+}
+
+TEST_F(DurableStorageTest, IgnoreTornEntry) {
+  {
+    auto storage = MakeStorage();
+    ASSERT_FALSE(storage->Recover());
+    storage->Start();
+    storage->Write("key1", Record("value1"));
+    storage->Write("key2", Record("value2"));
+  }
+  // Cut off the end of the last entry
+  auto path = dir_.path() + "/wal-1.log";
+  std::ifstream in(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  ASSERT_EQ(truncate(path.c_str(), data.size() - 3), 0);
+
+  auto storage = MakeStorage();
+  ASSERT_TRUE(storage->Recover());
+  AssertRecord(*storage, "key1", "value1", 0, 0);
+  Record record;
+  ASSERT_FALSE(storage->Read("key2", record));
+}
@@ -0,0 +1,65 @@
+#include "storage/int_key_storage.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "common/types.h"
+
+using namespace slog;
+
+TEST(IntKeyTest, ParseIntKey) {
+  uint64_t id;
+  ASSERT_TRUE(ParseIntKey("0", id));
+  ASSERT_EQ(id, 0U);
+  ASSERT_TRUE(ParseIntKey("1234567", id));
+  ASSERT_EQ(id, 1234567U);
+  ASSERT_TRUE(ParseIntKey("18446744073709551615", id));
+  ASSERT_EQ(id, 18446744073709551615ULL);
+
+  ASSERT_FALSE(ParseIntKey("", id));
+  ASSERT_FALSE(ParseIntKey("007", id));
+  ASSERT_FALSE(ParseIntKey("-1", id));
+  ASSERT_FALSE(ParseIntKey("12a", id));
+  ASSERT_FALSE(ParseIntKey("18446744073709551616", id));
+  ASSERT_FALSE(ParseIntKey("100000000000000000000", id));
+}
+
+TEST(IntKeyMemOnlyStorageTest, ReadWriteDelete) {
+  IntKeyMemOnlyStorage storage;
+  // Non-canonical numbers are different keys from their canonical forms
+  std::vector<Key> keys{"0", "1", "123", "0123", "abc", "18446744073709551616"};
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_FALSE(storage.Write(keys[i], Record("value" + std::to_string(i), i, i)));
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    Record record;
+    ASSERT_TRUE(storage.Read(keys[i], record)) << keys[i];
+    ASSERT_EQ(record.to_string(), "value" + std::to_string(i));
+    auto view = storage.ReadView(keys[i]);
+    ASSERT_TRUE(view);
+    ASSERT_EQ(view->to_string(), "value" + std::to_string(i));
+    view.Release();
+    Metadata metadata;
+    ASSERT_TRUE(storage.GetMasterMetadata(keys[i], metadata));
+    ASSERT_EQ(metadata.master, i);
+  }
+
+  ASSERT_TRUE(storage.Update("123", [](Record& record) { record.SetValue("new"); }));
+  ASSERT_TRUE(storage.Update("abc", [](Record& record) { record.SetValue("new"); }));
+  ASSERT_FALSE(storage.Update("124", [](Record&) {}));
+  std::map<Key, std::string> all;
+  storage.ForEach([&](const Key& key, const Record& record) { all[key] = record.to_string(); });
+  ASSERT_EQ(all.size(), keys.size());
+  ASSERT_EQ(all["123"], "new");
+  ASSERT_EQ(all["abc"], "new");
+  ASSERT_EQ(all["0123"], "value3");
+
+  ASSERT_TRUE(storage.Delete("123"));
+  ASSERT_TRUE(storage.Delete("abc"));
+  ASSERT_FALSE(storage.Delete("123"));
+  Record record;
+  ASSERT_FALSE(storage.Read("123", record));
+  ASSERT_FALSE(storage.Read("abc", record));
+  ASSERT_TRUE(storage.Read("0123", record));
+}
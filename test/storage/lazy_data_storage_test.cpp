@@ -0,0 +1,165 @@
+#include "storage/lazy_data_storage.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "storage/init.h"
+#include "storage/mem_only_storage.h"
+
+using namespace slog;
+using namespace std;
+
+class LazyDataStorageTest : public ::testing::Test {
+ protected:
+  // Makes the configuration of partition 1 in a deployment of two regions with two partitions each
+  ConfigurationPtr MakeConfig(bool simple_partitioning2) {
+    internal::Configuration config;
+    config.set_protocol("ipc");
+    config.add_broker_ports(0);
+    config.set_server_port(1);
+    config.set_forwarder_port(2);
+    config.set_sequencer_port(3);
+    config.set_num_partitions(2);
+    for (int reg = 0; reg < 2; reg++) {
+      auto region = config.add_regions();
+      region->add_addresses("/tmp/test_lazy_data" + to_string(2 * reg));
+      region->add_addresses("/tmp/test_lazy_data" + to_string(2 * reg + 1));
+    }
+    if (simple_partitioning2) {
+      config.mutable_simple_partitioning2()->set_num_records(100);
+      config.mutable_simple_partitioning2()->set_record_size_bytes(10);
+    } else {
+      config.mutable_simple_partitioning()->set_num_records(100);
+      config.mutable_simple_partitioning()->set_record_size_bytes(10);
+    }
+    return make_shared<Configuration>(config, "/tmp/test_lazy_data1");
+  }
+
+  shared_ptr<LazyDataStorage> MakeStorage(const ConfigurationPtr& config) {
+    auto mem_only_storage = make_shared<MemOnlyStorage>();
+    uint64_t num_records = config->proto_config().has_simple_partitioning2()
+                               ? config->proto_config().simple_partitioning2().num_records()
+                               : config->proto_config().simple_partitioning().num_records();
+    return make_shared<LazyDataStorage>(mem_only_storage, mem_only_storage, Sharder::MakeSharder(config),
+                                        MakeMetadataInitializer(config), num_records, 10);
+  }
+};
+
+TEST_F(LazyDataStorageTest, MatchesGeneratedData) {
+  auto config = MakeConfig(false);
+  auto generated = make_shared<MemOnlyStorage>();
+  PopulateStorage(generated, MakeMetadataInitializer(config), config, "");
+  auto lazy = MakeStorage(config);
+
+  vector<Key> keys;
+  for (int i = 0; i < 110; i++) {
+    keys.push_back(to_string(i));
+  }
+  keys.push_back("abc");
+  vector<const Key*> key_ptrs;
+  for (const auto& key : keys) {
+    key_ptrs.push_back(&key);
+  }
+  vector<optional<Metadata>> metadata;
+  lazy->MultiGetMasterMetadata(key_ptrs, metadata);
+
+  int num_records = 0;
+  lazy->MultiRead(key_ptrs, [&](size_t i, const Record* record) {
+    Record expected;
+    bool exists = generated->Read(keys[i], expected);
+    ASSERT_EQ(record != nullptr, exists) << keys[i];
+    ASSERT_EQ(metadata[i].has_value(), exists) << keys[i];
+    if (exists) {
+      num_records++;
+      ASSERT_EQ(record->to_string(), expected.to_string());
+      ASSERT_EQ(record->metadata().master, expected.metadata().master);
+      ASSERT_EQ(record->metadata().counter, expected.metadata().counter);
+      ASSERT_EQ(metadata[i]->master, expected.metadata().master);
+      auto view = lazy->ReadView(keys[i]);
+      ASSERT_TRUE(view);
+      ASSERT_EQ(view->to_string(), expected.to_string());
+    } else {
+      ASSERT_FALSE(lazy->ReadView(keys[i]));
+    }
+  });
+  ASSERT_EQ(num_records, 50);
+}
+
+TEST_F(LazyDataStorageTest, SimplePartitioning2) {
+  auto config = MakeConfig(true);
+  auto metadata_initializer = MakeMetadataInitializer(config);
+  auto lazy = MakeStorage(config);
+  for (int i = 0; i < 110; i++) {
+    Record record;
+    // Same assignment as the data generation: partition = key / num_regions % num_partitions
+    bool exists = i < 100 && i / 2 % 2 == 1;
+    ASSERT_EQ(lazy->Read(to_string(i), record), exists) << i;
+    if (exists) {
+      ASSERT_EQ(record.to_string(), string(10, 'a'));
+      ASSERT_EQ(record.metadata().master, metadata_initializer->Compute(to_string(i)).master);
+    }
+  }
+}
+
+TEST_F(LazyDataStorageTest, WriteUpdateAndDelete) {
+  auto storage = MakeStorage(MakeConfig(false));
+  Record record;
+
+  // Updating an initial record materializes it
+  ASSERT_TRUE(storage->Update("1", [](Record& record) { record.SetValue("x"); }));
+  ASSERT_TRUE(storage->Read("1", record));
+  ASSERT_EQ(record.to_string(), "x");
+  // Keys of other partitions or beyond the initial records do not exist
+  ASSERT_FALSE(storage->Update("2", [](Record&) {}));
+  ASSERT_FALSE(storage->Update("101", [](Record&) {}));
+
+  // Writing reports whether the key existed
+  ASSERT_TRUE(storage->Write(Key("3"), Record("y")));
+  ASSERT_FALSE(storage->Write(Key("101"), Record("z")));
+  ASSERT_TRUE(storage->Read("101", record));
+  ASSERT_EQ(record.to_string(), "z");
+
+  // Deleted initial records are not derived again
+  ASSERT_TRUE(storage->Delete("1"));
+  ASSERT_TRUE(storage->Delete("5"));
+  ASSERT_FALSE(storage->Delete("5"));
+  ASSERT_FALSE(storage->Read("1", record));
+  ASSERT_FALSE(storage->ReadView("5"));
+  Metadata metadata;
+  ASSERT_FALSE(storage->GetMasterMetadata("5", metadata));
+  ASSERT_FALSE(storage->Update("5", [](Record&) {}));
+
+  // Until they are written again
+  ASSERT_FALSE(storage->Write(Key("5"), Record("w")));
+  ASSERT_TRUE(storage->Read("5", record));
+  ASSERT_EQ(record.to_string(), "w");
+  ASSERT_TRUE(storage->Read("7", record));
+  ASSERT_EQ(record.to_string(), string(10, 'a'));
+}
+
+TEST_F(LazyDataStorageTest, DeleteNeverExposesInitialRecord) {
+  auto storage = MakeStorage(MakeConfig(false));
+  ASSERT_TRUE(storage->Delete("1"));
+  atomic<bool> done(false);
+  atomic<bool> saw_initial(false);
+  thread reader([&] {
+    Record record;
+    while (!done) {
+      if (storage->Read("1", record) && record.to_string() != "x") {
+        saw_initial = true;
+      }
+    }
+  });
+
+  // While the key is written and deleted again, a reader sees either the written record or nothing, never the
+  // derived record
+  for (int i = 0; i < 1000; i++) {
+    storage->Write(Key("1"), Record("x"));
+    ASSERT_TRUE(storage->Delete("1"));
+  }
+  done = true;
+  reader.join();
+  ASSERT_FALSE(saw_initial);
+}
@@ -0,0 +1,110 @@
+#include "storage/master_metadata_index.h"
+
+#include <gtest/gtest.h>
+
+#include "common/types.h"
+#include "storage/mem_only_storage.h"
+
+using namespace slog;
+
+class MasterMetadataIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    records_ = std::make_shared<MemOnlyStorage>();
+    storage_ = std::make_unique<MasterMetadataIndexedStorage>(records_);
+  }
+
+  void AssertMetadata(const Key& key, uint32_t master, uint32_t counter) {
+    Metadata metadata;
+    ASSERT_TRUE(storage_->GetMasterMetadata(key, metadata)) << key;
+    ASSERT_EQ(metadata.master, master);
+    ASSERT_EQ(metadata.counter, counter);
+  }
+
+  std::shared_ptr<MemOnlyStorage> records_;
+  std::unique_ptr<MasterMetadataIndexedStorage> storage_;
+};
+
+TEST_F(MasterMetadataIndexTest, MaintainedOnWrites) {
+  Metadata metadata;
+  ASSERT_FALSE(storage_->GetMasterMetadata("key1", metadata));
+
+  ASSERT_FALSE(storage_->Write("key1", Record("value1", 1, 2)));
+  ASSERT_FALSE(storage_->Write(Key("key2"), Record("value2", 3, 4)));
+  AssertMetadata("key1", 1, 2);
+  AssertMetadata("key2", 3, 4);
+
+  Record record;
+  ASSERT_TRUE(storage_->Read("key2", record));
+  ASSERT_EQ(record.to_string(), "value2");
+
+  // Overwrite
+  ASSERT_TRUE(storage_->Write("key1", Record("value1", 5, 6)));
+  AssertMetadata("key1", 5, 6);
+
+  ASSERT_TRUE(storage_->Delete("key1"));
+  ASSERT_FALSE(storage_->GetMasterMetadata("key1", metadata));
+  ASSERT_FALSE(records_->Read("key1", record));
+}
+
+TEST_F(MasterMetadataIndexTest, MaintainedOnRemaster) {
+  storage_->Write("key1", Record("value1", 1, 2));
+
+  // Updating the value only does not change the index
+  ASSERT_TRUE(storage_->Update("key1", [](Record& record) { record.SetValue("value2"); }));
+  AssertMetadata("key1", 1, 2);
+
+  ASSERT_TRUE(storage_->Update("key1", [](Record& record) { record.SetMetadata(Metadata(2, 3)); }));
+  AssertMetadata("key1", 2, 3);
+  Record record;
+  ASSERT_TRUE(records_->Read("key1", record));
+  ASSERT_EQ(record.to_string(), "value2");
+  ASSERT_EQ(record.metadata().master, 2U);
+
+  ASSERT_FALSE(storage_->Update("key2", [](Record& record) { record.SetMetadata(Metadata(2, 3)); }));
+  Metadata metadata;
+  ASSERT_FALSE(storage_->GetMasterMetadata("key2", metadata));
+}
+
+TEST_F(MasterMetadataIndexTest, AddExistingRecords) {
+  records_->Write("key1", Record("value1", 1, 2));
+  records_->ForEach([this](const Key& key, const Record& record) { storage_->AddToIndex(key, record.metadata()); });
+  AssertMetadata("key1", 1, 2);
+}
+
+struct ConstantHash {
+  size_t operator()(const Key&) const { return 42; }
+};
+
+TEST(MasterMetadataIndexCollisionTest, KeysWithSameHash) {
+  auto records = std::make_shared<MemOnlyStorage>();
+  MasterMetadataIndexedStorageT<ConstantHash> storage(records);
+  Metadata metadata;
+
+  storage.Write("key1", Record("value1", 1, 2));
+  ASSERT_TRUE(storage.GetMasterMetadata("key1", metadata));
+  ASSERT_EQ(metadata.master, 1U);
+  // A key that is not stored is told apart from the stored key with the same hash
+  ASSERT_FALSE(storage.GetMasterMetadata("key2", metadata));
+
+  storage.Write("key2", Record("value2", 3, 4));
+  storage.Update("key1", [](Record& record) { record.SetMetadata(Metadata(5, 6)); });
+  Key key1("key1"), key2("key2"), key3("key3");
+  std::vector<const Key*> keys{&key1, &key2, &key3};
+  std::vector<std::optional<Metadata>> result;
+  storage.MultiGetMasterMetadata(keys, result);
+  ASSERT_EQ(result.size(), 3U);
+  ASSERT_TRUE(result[0].has_value());
+  ASSERT_EQ(result[0]->master, 5U);
+  ASSERT_EQ(result[0]->counter, 6U);
+  ASSERT_TRUE(result[1].has_value());
+  ASSERT_EQ(result[1]->master, 3U);
+  ASSERT_FALSE(result[2].has_value());
+
+  storage.Delete("key1");
+  ASSERT_FALSE(storage.GetMasterMetadata("key1", metadata));
+  ASSERT_TRUE(storage.GetMasterMetadata("key2", metadata));
+  ASSERT_EQ(metadata.master, 3U);
+  storage.Delete("key2");
+  ASSERT_FALSE(storage.GetMasterMetadata("key2", metadata));
+}
@@ -17,4 +17,101 @@ TEST(MemOnlyStorageTest, ReadWriteTest) {
   bool ok = storage.Read(key, ret);
   ASSERT_TRUE(ok);
   ASSERT_EQ(value, ret.to_string());
-}
\ No newline at end of file
+}
+
+TEST(MemOnlyStorageTest, ReadViewTest) {
+  MemOnlyStorage storage;
+  Key key = "key1";
+  Value value = "value1";
+  Record record(value, 2, 3);
+  storage.Write(key, record);
+
+  ASSERT_FALSE(storage.ReadView("key2"));
+
+  auto view = storage.ReadView(key);
+  ASSERT_TRUE(view);
+  ASSERT_EQ(value, std::string(view->data(), view->size()));
+  ASSERT_EQ(view->metadata().master, 2U);
+  ASSERT_EQ(view->metadata().counter, 3U);
+}
+
+TEST(MemOnlyStorageTest, UpdateTest) {
+  MemOnlyStorage storage;
+  Key key = "key1";
+  storage.Write(Key(key), Record("value1", 2, 3));
+
+  ASSERT_FALSE(storage.Update("key2", [](Record&) {}));
+
+  ASSERT_TRUE(storage.Update(key, [](Record& record) {
+    record.SetValue("value2");
+    record.SetMetadata(Metadata(4, 5));
+  }));
+  Record ret;
+  ASSERT_TRUE(storage.Read(key, ret));
+  ASSERT_EQ(ret.to_string(), "value2");
+  ASSERT_EQ(ret.metadata().master, 4U);
+  ASSERT_EQ(ret.metadata().counter, 5U);
+}
+
+TEST(MemOnlyStorageTest, MultiReadTest) {
+  MemOnlyStorage storage;
+  storage.Write(Key("key1"), Record("value1", 1, 2));
+  storage.Write(Key("key3"), Record("value3", 3, 4));
+
+  std::vector<Key> keys{"key1", "key2", "key3"};
+  std::vector<const Key*> key_ptrs{&keys[0], &keys[1], &keys[2]};
+  std::vector<std::string> values(keys.size());
+  storage.MultiRead(key_ptrs, [&](size_t i, const Record* record) {
+    if (record != nullptr) {
+      values[i] = record->to_string();
+    }
+  });
+  ASSERT_EQ(values, (std::vector<std::string>{"value1", "", "value3"}));
+
+  std::vector<std::optional<Metadata>> metadata;
+  storage.MultiGetMasterMetadata(key_ptrs, metadata);
+  ASSERT_EQ(metadata.size(), 3U);
+  ASSERT_EQ(metadata[0]->master, 1U);
+  ASSERT_EQ(metadata[0]->counter, 2U);
+  ASSERT_FALSE(metadata[1].has_value());
+  ASSERT_EQ(metadata[2]->master, 3U);
+}
+
+TEST(MemOnlyStorageTest, UpdatesInPlace) {
+  // Optimistic segments copy the record on update while the latched ones modify it in place
+  MemOnlyStorageT<OptimisticConcurrentHashMap<Key, Record>> optimistic;
+  MemOnlyStorageT<ConcurrentHashMap<Key, Record>> latched;
+  MemOnlyStorageT<FlatConcurrentHashMap<Key, Record>> flat;
+  ASSERT_FALSE(optimistic.UpdatesInPlace());
+  ASSERT_TRUE(latched.UpdatesInPlace());
+  ASSERT_TRUE(flat.UpdatesInPlace());
+}
+
+TEST(MemOnlyStorageTest, LatchedStorageOverwritesInPlace) {
+  LatchedMemOnlyStorage storage;
+  ASSERT_TRUE(storage.UpdatesInPlace());
+  storage.Write("key", Record("value1"));
+  const char* data = storage.ReadView("key")->data();
+  ASSERT_TRUE(storage.Update("key", [](Record& record) { record.SetValue("value2"); }));
+  auto view = storage.ReadView("key");
+  ASSERT_EQ(view->data(), data);
+  ASSERT_EQ(view->to_string(), "value2");
+}
+
+TEST(RecordTest, SetValueReusesBuffer) {
+  Record record("value1");
+  auto data = record.data();
+  record.SetValue("value2");
+  ASSERT_EQ(record.data(), data);
+  ASSERT_EQ(record.to_string(), "value2");
+
+  Record other("value3", 1, 2);
+  record = other;
+  ASSERT_EQ(record.data(), data);
+  ASSERT_EQ(record.to_string(), "value3");
+  ASSERT_EQ(record.metadata().master, 1U);
+
+  Record moved(std::move(record));
+  ASSERT_EQ(moved.data(), data);
+  ASSERT_EQ(record.size(), 0U);
+}
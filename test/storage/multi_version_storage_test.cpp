@@ -0,0 +1,191 @@
+#include "storage/multi_version_storage.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace slog;
+using namespace std;
+
+TEST(MultiVersionStorageTest, SnapshotDoesNotSeeLaterWrites) {
+  MultiVersionStorage storage;
+  storage.Write(Key("A"), Record("a1", 1, 2));
+  auto s1 = storage.AcquireSnapshot();
+
+  storage.BeginWriteBatch();
+  ASSERT_TRUE(storage.Write(Key("A"), Record("a2", 1, 2)));
+  ASSERT_FALSE(storage.Write(Key("B"), Record("b1")));
+  // Workers read the latest versions
+  Record record;
+  ASSERT_TRUE(storage.Read("A", record));
+  ASSERT_EQ(record.to_string(), "a2");
+  // The batch is not visible to new snapshots until it ends
+  auto s2 = storage.AcquireSnapshot();
+  ASSERT_EQ(s2, s1);
+  storage.EndWriteBatch();
+  auto s3 = storage.AcquireSnapshot();
+  ASSERT_GT(s3, s1);
+
+  ASSERT_TRUE(storage.ReadSnapshot("A", s1, record));
+  ASSERT_EQ(record.to_string(), "a1");
+  ASSERT_EQ(record.metadata().master, 1U);
+  ASSERT_EQ(record.metadata().counter, 2U);
+  ASSERT_FALSE(storage.ReadSnapshot("B", s1, record));
+  ASSERT_TRUE(storage.ReadSnapshot("A", s3, record));
+  ASSERT_EQ(record.to_string(), "a2");
+  ASSERT_TRUE(storage.ReadSnapshot("B", s3, record));
+  ASSERT_EQ(record.to_string(), "b1");
+
+  storage.ReleaseSnapshot(s1);
+  storage.ReleaseSnapshot(s2);
+  storage.ReleaseSnapshot(s3);
+}
+
+TEST(MultiVersionStorageTest, UpdateAndDelete) {
+  MultiVersionStorage storage;
+  storage.Write(Key("A"), Record("a1", 1, 2));
+  auto s1 = storage.AcquireSnapshot();
+
+  ASSERT_FALSE(storage.Update("B", [](Record&) {}));
+  ASSERT_TRUE(storage.Update("A", [](Record& record) { record.SetValue("a2"); }));
+  auto s2 = storage.AcquireSnapshot();
+  ASSERT_TRUE(storage.Delete("A"));
+  ASSERT_FALSE(storage.Delete("A"));
+  auto s3 = storage.AcquireSnapshot();
+
+  Record record;
+  ASSERT_FALSE(storage.Read("A", record));
+  ASSERT_FALSE(storage.ReadView("A"));
+  Metadata metadata;
+  ASSERT_FALSE(storage.GetMasterMetadata("A", metadata));
+  ASSERT_TRUE(storage.ReadSnapshot("A", s1, record));
+  ASSERT_EQ(record.to_string(), "a1");
+  ASSERT_TRUE(storage.ReadSnapshot("A", s2, record));
+  ASSERT_EQ(record.to_string(), "a2");
+  ASSERT_EQ(record.metadata().master, 1U);
+  ASSERT_FALSE(storage.ReadSnapshot("A", s3, record));
+
+  storage.ReleaseSnapshot(s1);
+  storage.ReleaseSnapshot(s2);
+  storage.ReleaseSnapshot(s3);
+}
+
+TEST(MultiVersionStorageTest, GarbageCollectBehindSlowestSnapshot) {
+  MultiVersionStorage storage;
+  storage.Write(Key("A"), Record("a1"));
+  auto s1 = storage.AcquireSnapshot();
+  storage.Write(Key("A"), Record("a2"));
+  storage.Write(Key("A"), Record("a3"));
+
+  // The version visible to the active snapshot is kept
+  Record record;
+  ASSERT_TRUE(storage.ReadSnapshot("A", s1, record));
+  ASSERT_EQ(record.to_string(), "a1");
+
+  storage.ReleaseSnapshot(s1);
+  auto s2 = storage.AcquireSnapshot();
+  storage.Write(Key("A"), Record("a4"));
+
+  // The versions before the one visible to the remaining snapshot are dropped by the next write
+  ASSERT_FALSE(storage.ReadSnapshot("A", s1, record));
+  ASSERT_TRUE(storage.ReadSnapshot("A", s2, record));
+  ASSERT_EQ(record.to_string(), "a3");
+  storage.ReleaseSnapshot(s2);
+}
+
+TEST(MultiVersionStorageTest, SweepColdKeysAndDeletedKeys) {
+  // Keep the background sweep out of the way
+  MultiVersionStorage storage(chrono::hours(1));
+  storage.Write(Key("A"), Record("a1"));
+  storage.Write(Key("B"), Record("b1"));
+  auto s1 = storage.AcquireSnapshot();
+  storage.Write(Key("A"), Record("a2"));
+  storage.Delete(Key("B"));
+
+  // Nothing visible to the active snapshot is collected
+  storage.CollectGarbage();
+  Record record;
+  ASSERT_TRUE(storage.ReadSnapshot("A", s1, record));
+  ASSERT_EQ(record.to_string(), "a1");
+  ASSERT_TRUE(storage.ReadSnapshot("B", s1, record));
+  ASSERT_EQ(record.to_string(), "b1");
+
+  // The old versions of keys that are not written anymore are dropped by the sweep
+  storage.ReleaseSnapshot(s1);
+  storage.CollectGarbage();
+  ASSERT_FALSE(storage.ReadSnapshot("A", s1, record));
+  ASSERT_FALSE(storage.ReadSnapshot("B", s1, record));
+  auto s2 = storage.AcquireSnapshot();
+  ASSERT_TRUE(storage.ReadSnapshot("A", s2, record));
+  ASSERT_EQ(record.to_string(), "a2");
+  ASSERT_FALSE(storage.ReadSnapshot("B", s2, record));
+
+  // A deleted key that is dropped can be written again
+  ASSERT_FALSE(storage.Write(Key("B"), Record("b2")));
+  ASSERT_TRUE(storage.Read("B", record));
+  ASSERT_EQ(record.to_string(), "b2");
+  storage.ReleaseSnapshot(s2);
+}
+
+TEST(MultiVersionStorageTest, ConcurrentWriters) {
+  MultiVersionStorage storage;
+  const int kNumWriters = 4;
+  const int kNumBatches = 5000;
+  vector<thread> writers;
+  for (int w = 0; w < kNumWriters; w++) {
+    writers.emplace_back([&storage, w] {
+      auto key = "K" + to_string(w);
+      for (int i = 1; i <= kNumBatches; i++) {
+        storage.BeginWriteBatch();
+        storage.Write(key, Record(to_string(i)));
+        storage.EndWriteBatch();
+      }
+    });
+  }
+  for (auto& t : writers) {
+    t.join();
+  }
+
+  // Every batch has finished so all of them are visible
+  ASSERT_EQ(storage.stable_position(), uint64_t(kNumWriters * kNumBatches));
+  auto position = storage.AcquireSnapshot();
+  Record record;
+  for (int w = 0; w < kNumWriters; w++) {
+    ASSERT_TRUE(storage.ReadSnapshot("K" + to_string(w), position, record));
+    ASSERT_EQ(record.to_string(), to_string(kNumBatches));
+  }
+  storage.ReleaseSnapshot(position);
+}
+
+TEST(MultiVersionStorageTest, SnapshotsSeeWholeBatches) {
+  MultiVersionStorage storage;
+  storage.Write(Key("A"), Record("0"));
+  storage.Write(Key("B"), Record("0"));
+
+  atomic<bool> stop = false;
+  vector<thread> readers;
+  for (int i = 0; i < 2; i++) {
+    readers.emplace_back([&] {
+      Record a, b;
+      while (!stop) {
+        auto position = storage.AcquireSnapshot();
+        ASSERT_TRUE(storage.ReadSnapshot("A", position, a));
+        ASSERT_TRUE(storage.ReadSnapshot("B", position, b));
+        storage.ReleaseSnapshot(position);
+        ASSERT_EQ(a.to_string(), b.to_string());
+      }
+    });
+  }
+
+  for (int i = 1; i <= 20000; i++) {
+    storage.BeginWriteBatch();
+    storage.Write(Key("A"), Record(to_string(i)));
+    storage.Write(Key("B"), Record(to_string(i)));
+    storage.EndWriteBatch();
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+}
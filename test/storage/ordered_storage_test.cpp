@@ -0,0 +1,43 @@
+#include "storage/ordered_storage.h"
+
+#include <gtest/gtest.h>
+
+#include "common/types.h"
+
+using namespace slog;
+
+TEST(OrderedStorageTest, Scan) {
+  OrderedStorage storage;
+  for (auto key : {"a", "b", "c", "d", "e"}) {
+    storage.Write(key, Record(std::string("value_") + key));
+  }
+
+  std::vector<std::pair<Key, Record>> result;
+  ASSERT_TRUE(storage.Scan("b", "e", 10, result));
+  ASSERT_EQ(result.size(), 3U);
+  ASSERT_EQ(result[0].first, "b");
+  ASSERT_EQ(result[2].first, "d");
+  ASSERT_EQ(result[2].second.to_string(), "value_d");
+
+  result.clear();
+  ASSERT_TRUE(storage.Scan("b", "", 2, result));
+  ASSERT_EQ(result.size(), 2U);
+  ASSERT_EQ(result[1].first, "c");
+}
+
+TEST(OrderedStorageTest, ScanAppendsToResult) {
+  OrderedStorage storage;
+  for (auto key : {"a", "b", "c"}) {
+    storage.Write(key, Record(std::string("value_") + key));
+  }
+
+  // The limit only counts the records appended by this call
+  std::vector<std::pair<Key, Record>> result;
+  result.emplace_back("x", Record("value_x"));
+  result.emplace_back("y", Record("value_y"));
+  ASSERT_TRUE(storage.Scan("a", "", 2, result));
+  ASSERT_EQ(result.size(), 4U);
+  ASSERT_EQ(result[0].first, "x");
+  ASSERT_EQ(result[2].first, "a");
+  ASSERT_EQ(result[3].first, "b");
+}
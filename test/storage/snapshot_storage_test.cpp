@@ -0,0 +1,107 @@
+#include "storage/snapshot_storage.h"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common/types.h"
+
+using namespace slog;
+
+class SnapshotStorageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/snapshot_storage_test_XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    path_ = path;
+
+    SnapshotWriter writer(path_);
+    for (int i = 0; i < kNumRecords; i++) {
+      writer.Add("key" + std::to_string(i), Record("value" + std::to_string(i), i % 3, i));
+    }
+    writer.Finish();
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+  static constexpr int kNumRecords = 1000;
+  std::string path_;
+};
+
+TEST_F(SnapshotStorageTest, ReadSnapshot) {
+  Snapshot snapshot(path_);
+  ASSERT_EQ(snapshot.size(), static_cast<size_t>(kNumRecords));
+  for (int i = 0; i < kNumRecords; i++) {
+    Snapshot::Entry entry;
+    ASSERT_TRUE(snapshot.Find("key" + std::to_string(i), entry));
+    ASSERT_EQ(entry.value, "value" + std::to_string(i));
+    ASSERT_EQ(entry.metadata.master, static_cast<uint32_t>(i % 3));
+    ASSERT_EQ(entry.metadata.counter, static_cast<uint32_t>(i));
+  }
+  Snapshot::Entry entry;
+  ASSERT_FALSE(snapshot.Find("key", entry));
+  ASSERT_FALSE(snapshot.Find("key1000", entry));
+
+  int count = 0;
+  snapshot.ForEach([&](const Snapshot::Entry& entry) {
+    ASSERT_EQ(entry.key, "key" + std::to_string(count));
+    count++;
+  });
+  ASSERT_EQ(count, kNumRecords);
+}
+
+TEST_F(SnapshotStorageTest, EmptySnapshot) {
+  SnapshotWriter writer(path_);
+  writer.Finish();
+  Snapshot snapshot(path_);
+  ASSERT_EQ(snapshot.size(), 0U);
+  Snapshot::Entry entry;
+  ASSERT_FALSE(snapshot.Find("key0", entry));
+}
+
+TEST_F(SnapshotStorageTest, ReadWriteOverlay) {
+  SnapshotStorage storage(path_);
+  Record record;
+  ASSERT_TRUE(storage.Read("key1", record));
+  ASSERT_EQ(record.to_string(), "value1");
+  auto view = storage.ReadView("key2");
+  ASSERT_TRUE(view);
+  ASSERT_EQ(view->to_string(), "value2");
+  view.Release();
+  Metadata metadata;
+  ASSERT_TRUE(storage.GetMasterMetadata("key5", metadata));
+  ASSERT_EQ(metadata.master, 2U);
+  ASSERT_EQ(metadata.counter, 5U);
+
+  // Overwrite a snapshot record and add a new one
+  ASSERT_TRUE(storage.Write("key1", Record("new1", 1, 1)));
+  ASSERT_FALSE(storage.Write(Key("new"), Record("new")));
+  ASSERT_TRUE(storage.Read("key1", record));
+  ASSERT_EQ(record.to_string(), "new1");
+  ASSERT_TRUE(storage.Read("new", record));
+  ASSERT_EQ(record.to_string(), "new");
+
+  // Update a snapshot record
+  ASSERT_TRUE(storage.Update("key3", [](Record& record) { record.SetValue("new3"); }));
+  ASSERT_TRUE(storage.Read("key3", record));
+  ASSERT_EQ(record.to_string(), "new3");
+  ASSERT_EQ(record.metadata().counter, 3U);
+  ASSERT_FALSE(storage.Update("missing", [](Record&) {}));
+
+  // Delete snapshot records, with and without overlay records
+  ASSERT_TRUE(storage.Delete("key1"));
+  ASSERT_TRUE(storage.Delete("key4"));
+  ASSERT_FALSE(storage.Delete("key4"));
+  ASSERT_FALSE(storage.Read("key1", record));
+  ASSERT_FALSE(storage.Read("key4", record));
+  ASSERT_FALSE(storage.ReadView("key4"));
+  ASSERT_FALSE(storage.GetMasterMetadata("key4", metadata));
+  ASSERT_FALSE(storage.Update("key4", [](Record&) {}));
+
+  // Write a deleted record again
+  ASSERT_FALSE(storage.Write("key4", Record("new4")));
+  ASSERT_TRUE(storage.Read("key4", record));
+  ASSERT_EQ(record.to_string(), "new4");
+}
@@ -0,0 +1,164 @@
+#include "storage/tiered_storage.h"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <thread>
+
+#include "common/types.h"
+#include "test/test_utils.h"
+
+using namespace slog;
+using std::chrono::hours;
+
+class TieredStorageTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<TieredStorage> MakeStorage(uint64_t memory_limit) {
+    // Disable periodic eviction so that only the tests trigger it
+    return std::make_unique<TieredStorage>(dir_.path(), memory_limit, hours(1));
+  }
+
+  // Writes records [begin, end) with 100-byte values
+  void WriteRecords(Storage& storage, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      storage.Write(std::to_string(i), Record(Value(100, 'a' + i % 26), i % 3, i));
+    }
+  }
+
+  void AssertRecord(const Storage& storage, int i) {
+    Record record;
+    ASSERT_TRUE(storage.Read(std::to_string(i), record)) << i;
+    ASSERT_EQ(record.to_string(), Value(100, 'a' + i % 26));
+    ASSERT_EQ(record.metadata().master, static_cast<uint32_t>(i % 3));
+    ASSERT_EQ(record.metadata().counter, static_cast<uint32_t>(i));
+  }
+
+  TempDir dir_{"tiered_storage_test"};
+};
+
+TEST_F(TieredStorageTest, SpillAndReadBack) {
+  auto storage = MakeStorage(1000);
+  WriteRecords(*storage, 0, 100);
+  ASSERT_EQ(storage->stats().hot_bytes, 10000U);
+
+  storage->Evict();
+  auto stats = storage->stats();
+  ASSERT_LE(stats.hot_bytes, 900U);
+  ASSERT_GE(stats.evictions, 91U);
+
+  // The metadata of spilled records stays in memory
+  Metadata metadata;
+  ASSERT_TRUE(storage->GetMasterMetadata("7", metadata));
+  ASSERT_EQ(metadata.master, 1U);
+  ASSERT_EQ(metadata.counter, 7U);
+  ASSERT_EQ(storage->stats().misses, 0U);
+
+  for (int i = 0; i < 100; i++) {
+    AssertRecord(*storage, i);
+  }
+  ASSERT_EQ(storage->stats().misses, stats.evictions);
+
+  // Updating and deleting spilled records
+  ASSERT_TRUE(storage->Update("7", [](Record& record) { record.SetMetadata(Metadata(2, 8)); }));
+  ASSERT_TRUE(storage->GetMasterMetadata("7", metadata));
+  ASSERT_EQ(metadata.master, 2U);
+  ASSERT_TRUE(storage->Delete("8"));
+  ASSERT_FALSE(storage->ReadView("8"));
+  ASSERT_FALSE(storage->Delete("8"));
+}
+
+TEST_F(TieredStorageTest, PrefetchLoadsSpilledValues) {
+  auto storage = MakeStorage(1000);
+  WriteRecords(*storage, 0, 100);
+  storage->Evict();
+
+  std::vector<Key> keys;
+  for (int i = 0; i < 100; i++) {
+    keys.push_back(std::to_string(i));
+  }
+  std::vector<const Key*> key_ptrs;
+  for (const auto& key : keys) {
+    key_ptrs.push_back(&key);
+  }
+  auto evictions = storage->stats().evictions;
+  std::promise<void> done;
+  ASSERT_TRUE(storage->Prefetch(key_ptrs, [&done] { done.set_value(); }));
+  // Every value is in memory once the storage says the prefetch is done
+  ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  ASSERT_EQ(storage->stats().prefetches, evictions);
+  ASSERT_EQ(storage->stats().hot_bytes, 10000U);
+
+  // Give the prefetches some lead time
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  for (int i = 0; i < 100; i++) {
+    AssertRecord(*storage, i);
+  }
+  auto stats = storage->stats();
+  ASSERT_EQ(stats.misses, 0U);
+  ASSERT_EQ(stats.hits, 100U);
+  ASSERT_GT(stats.avg_prefetch_lead_time_us, 0);
+
+  // Nothing to wait for when every value is in memory
+  ASSERT_FALSE(storage->Prefetch(key_ptrs, [] { FAIL(); }));
+}
+
+TEST_F(TieredStorageTest, RecentlyReadValuesStayInMemory) {
+  auto storage = MakeStorage(7000);
+  WriteRecords(*storage, 0, 50);
+  // Under the limit so this only starts a new round
+  storage->Evict();
+  ASSERT_EQ(storage->stats().evictions, 0U);
+
+  for (int i = 0; i < 10; i++) {
+    AssertRecord(*storage, i);
+  }
+  WriteRecords(*storage, 50, 100);
+  storage->Evict();
+  ASSERT_GT(storage->stats().evictions, 0U);
+
+  // Only records that have been neither read nor written since the previous round are evicted
+  auto misses = storage->stats().misses;
+  for (int i = 0; i < 10; i++) {
+    AssertRecord(*storage, i);
+  }
+  for (int i = 50; i < 100; i++) {
+    AssertRecord(*storage, i);
+  }
+  ASSERT_EQ(storage->stats().misses, misses);
+}
+
+TEST_F(TieredStorageTest, DeleteRacesPrefetch) {
+  auto storage = MakeStorage(1000);
+  std::vector<Key> keys;
+  for (int i = 0; i < 1000; i++) {
+    keys.push_back(std::to_string(i));
+  }
+  std::vector<const Key*> key_ptrs;
+  for (const auto& key : keys) {
+    key_ptrs.push_back(&key);
+  }
+
+  for (int round = 0; round < 20; round++) {
+    WriteRecords(*storage, 0, 1000);
+    storage->Evict();
+    std::promise<void> done;
+    ASSERT_TRUE(storage->Prefetch(key_ptrs, [&done] { done.set_value(); }));
+    // Deleted keys are never loaded back, nor read as empty records
+    std::thread reader([&] {
+      for (const auto& key : keys) {
+        if (auto record = storage->ReadView(key)) {
+          ASSERT_EQ(record->size(), 100U);
+        }
+      }
+    });
+    for (const auto& key : keys) {
+      ASSERT_TRUE(storage->Delete(key));
+    }
+    reader.join();
+    ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    for (const auto& key : keys) {
+      ASSERT_FALSE(storage->ReadView(key));
+    }
+    ASSERT_EQ(storage->stats().hot_bytes, 0U);
+  }
+}
@@ -1,7 +1,10 @@
 #include "test/test_utils.h"
 
 #include <glog/logging.h>
+#include <stdlib.h>
 
+#include <cstring>
+#include <filesystem>
 #include <random>
 #include <set>
 
@@ -43,7 +46,9 @@ ConfigVec MakeTestConfigurations(string&& prefix, int num_regions, int num_repli
   int num_machines = num_regions * num_partitions;
   string addr = "/tmp/test_" + prefix;
 
-  common_config.set_protocol("ipc");
+  if (common_config.protocol().empty()) {
+    common_config.set_protocol("ipc");
+  }
   common_config.add_broker_ports(0);
   common_config.add_broker_ports(1);
   common_config.set_forwarder_port(2);
@@ -125,6 +130,14 @@ ValueEntry TxnValueEntry(const Transaction& txn, const std::string& key) {
   return it->value_entry();
 }
 
+TempDir::TempDir(const std::string& prefix) {
+  auto path_template = "/tmp/" + prefix + "_XXXXXX";
+  CHECK(mkdtemp(path_template.data()) != nullptr) << "Cannot create temporary directory: " << strerror(errno);
+  path_ = path_template;
+}
+
+TempDir::~TempDir() { std::filesystem::remove_all(path_); }
+
 TestSlog::TestSlog(const ConfigurationPtr& config)
     : config_(config),
       sharder_(Sharder::MakeSharder(config)),
@@ -141,7 +154,9 @@ void TestSlog::Data(Key&& key, Record&& record) {
   storage_->Write(key, record);
 }
 
-void TestSlog::AddServerAndClient() { server_ = MakeRunnerFor<Server>(broker_, nullptr, kTestModuleTimeout); }
+void TestSlog::AddServerAndClient(const std::shared_ptr<MultiVersionStorage>& multi_version_storage) {
+  server_ = MakeRunnerFor<Server>(broker_, multi_version_storage, nullptr, kTestModuleTimeout);
+}
 
 void TestSlog::AddForwarder() {
   metadata_initializer_ = std::make_shared<ConstantMetadataInitializer>(0);
@@ -196,33 +211,20 @@ void TestSlog::AddOutputSocket(Channel channel, const std::vector<uint64_t>& tag
       broker_->AddChannel(Broker::ChannelOption(channel, false, tags));
   }
 
-  zmq::socket_t inproc_socket(*broker_->context(), ZMQ_PULL);
-  inproc_socket.bind(MakeInProcChannelAddress(channel));
-  inproc_sockets_.insert_or_assign(channel, std::move(inproc_socket));
+  inproc_channels_.insert_or_assign(channel, GetInprocChannel(*broker_->context(), channel));
 }
 
-zmq::pollitem_t TestSlog::GetPollItemForOutputSocket(Channel channel, bool inproc) {
+EnvelopePtr TestSlog::ReceiveFromOutputSocket(Channel channel, bool inproc, bool dont_wait) {
   if (inproc) {
-    auto it = inproc_sockets_.find(channel);
-    CHECK(it != inproc_sockets_.end()) << "Inproc socket " << channel << " does not exist";
-    return {static_cast<void*>(it->second), 0, /* fd */
-            ZMQ_POLLIN, 0 /* revent */};
-  }
-  auto it = outproc_sockets_.find(channel);
-  CHECK(it != outproc_sockets_.end()) << "Outproc socket " << channel << " does not exist";
-  return {static_cast<void*>(it->second), 0, /* fd */
-          ZMQ_POLLIN, 0 /* revent */};
-}
-
-EnvelopePtr TestSlog::ReceiveFromOutputSocket(Channel channel, bool inproc) {
-  if (inproc) {
-    CHECK(inproc_sockets_.count(channel) > 0) << "Inproc socket \"" << channel << "\" does not exist";
-    return RecvEnvelope(inproc_sockets_[channel]);
+    CHECK(inproc_channels_.count(channel) > 0) << "Inproc channel \"" << channel << "\" does not exist";
+    return RecvEnvelope(*inproc_channels_[channel], dont_wait);
   }
   CHECK(outproc_sockets_.count(channel) > 0) << "Outproc socket \"" << channel << "\" does not exist";
-  zmq::message_t msg;
-  outproc_sockets_[channel].recv(msg);
-  return DeserializeEnvelope(msg);
+  zmq::message_t msg, body;
+  if (!RecvAddressedBuffer(outproc_sockets_[channel], msg, body, dont_wait)) {
+    return nullptr;
+  }
+  return DeserializeEnvelope(msg, body);
 }
 
 unique_ptr<Sender> TestSlog::NewSender() { return std::make_unique<Sender>(broker_->config(), broker_->context()); }
@@ -259,11 +261,12 @@ void TestSlog::StartInNewThreads() {
   }
 }
 
-void TestSlog::SendTxn(Transaction* txn) {
+void TestSlog::SendTxn(Transaction* txn, bool read_only) {
   CHECK(server_ != nullptr) << "TestSlog does not have a server";
   api::Request request;
   auto txn_req = request.mutable_txn();
   txn_req->set_allocated_txn(txn);
+  txn_req->set_read_only(read_only);
   SendSerializedProtoWithEmptyDelim(client_socket_, request);
 }
 
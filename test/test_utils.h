@@ -8,6 +8,7 @@
 
 #include "common/configuration.h"
 #include "connection/broker.h"
+#include "connection/inproc_queue.h"
 #include "connection/sender.h"
 #include "connection/zmq_utils.h"
 #include "module/base/module.h"
@@ -15,6 +16,7 @@
 #include "proto/internal.pb.h"
 #include "storage/mem_only_storage.h"
 #include "storage/metadata_initializer.h"
+#include "storage/multi_version_storage.h"
 
 using std::pair;
 using std::shared_ptr;
@@ -39,6 +41,23 @@ TxnHolder MakeTestTxnHolder(const ConfigurationPtr& config, TxnId id, const std:
 
 ValueEntry TxnValueEntry(const Transaction& txn, const std::string& key);
 
+/**
+ * An empty directory under /tmp that is removed with its content when this goes out of scope
+ */
+class TempDir {
+ public:
+  explicit TempDir(const std::string& prefix);
+  ~TempDir();
+
+  TempDir(const TempDir&) = delete;
+  TempDir& operator=(const TempDir&) = delete;
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
 using ModuleRunnerPtr = unique_ptr<ModuleRunner>;
 
 /**
@@ -49,7 +68,7 @@ class TestSlog {
  public:
   TestSlog(const ConfigurationPtr& config);
   void Data(Key&& key, Record&& record);
-  void AddServerAndClient();
+  void AddServerAndClient(const std::shared_ptr<MultiVersionStorage>& multi_version_storage = nullptr);
   void AddForwarder();
   void AddSequencer();
   void AddLogManagers();
@@ -59,13 +78,12 @@ class TestSlog {
   void AddMultiHomeOrderer();
 
   void AddOutputSocket(Channel channel, const std::vector<uint64_t>& tags = {});
-  zmq::pollitem_t GetPollItemForOutputSocket(Channel channel, bool inproc = true);
-  EnvelopePtr ReceiveFromOutputSocket(Channel channel, bool inproc = true);
+  EnvelopePtr ReceiveFromOutputSocket(Channel channel, bool inproc = true, bool dont_wait = false);
 
   unique_ptr<Sender> NewSender();
 
   void StartInNewThreads();
-  void SendTxn(Transaction* txn);
+  void SendTxn(Transaction* txn, bool read_only = false);
   Transaction RecvTxnResult();
 
   const ConfigurationPtr& config() const { return config_; }
@@ -87,7 +105,7 @@ class TestSlog {
   ModuleRunnerPtr global_paxos_;
   ModuleRunnerPtr multi_home_orderer_;
 
-  std::unordered_map<Channel, zmq::socket_t> inproc_sockets_;
+  std::unordered_map<Channel, std::shared_ptr<InprocChannel>> inproc_channels_;
   std::unordered_map<Channel, zmq::socket_t> outproc_sockets_;
 
   zmq::context_t client_context_;